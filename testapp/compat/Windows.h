@@ -0,0 +1,34 @@
+#pragma once
+
+// Minimal stand-in for <Windows.h> on non-Windows hosts. It only provides the
+// scalar types and annotations that ViGEm/Common.h and the portable decoder
+// sources use, so the decode and DSU paths can be built headless.
+
+#include <cstdint>
+#include <cstring>
+
+typedef uint8_t  BYTE;
+typedef uint8_t  UCHAR;
+typedef uint16_t USHORT;
+typedef uint16_t WORD;
+typedef int16_t  SHORT;
+typedef uint32_t ULONG;
+typedef uint32_t DWORD;
+typedef int32_t  BOOL;
+typedef void*    LPVOID;
+
+#ifndef VOID
+#define VOID void
+#endif
+#ifndef FORCEINLINE
+#define FORCEINLINE inline
+#endif
+#ifndef _In_
+#define _In_
+#endif
+#ifndef _Out_
+#define _Out_
+#endif
+#ifndef RtlZeroMemory
+#define RtlZeroMemory(Destination, Length) std::memset((Destination), 0, (Length))
+#endif
@@ -0,0 +1,192 @@
+#include "BleDiscovery.h"
+
+#include <algorithm>
+
+namespace {
+bool IsKnownProductId(uint16_t productId)
+{
+    return productId == SWITCH2_PID_JOYCON_R || productId == SWITCH2_PID_JOYCON_L ||
+           productId == SWITCH2_PID_PRO || productId == SWITCH2_PID_NSO_GC;
+}
+
+// Known product IDs are routed to the slots that asked for them. An unknown
+// ID (a newer controller revision) is accepted by any slot rather than
+// leaving the user stuck on the pairing screen.
+bool Accepts(const PairingRequest& request, uint16_t productId)
+{
+    if (request.productIds.empty() || !IsKnownProductId(productId)) return true;
+    return std::find(request.productIds.begin(), request.productIds.end(), productId) != request.productIds.end();
+}
+}
+
+bool TryParseSwitch2ControllerAd(const std::vector<uint8_t>& d, uint16_t& productId)
+{
+    if (d.size() < 7) return false;
+    if (d[0] != 0x01 || d[1] != 0x00 || d[2] != 0x03) return false;
+    if (d[3] != 0x7E || d[4] != 0x05) return false;
+
+    productId = static_cast<uint16_t>(d[5] | (static_cast<uint16_t>(d[6]) << 8));
+    return productId >= 0x2060;
+}
+
+bool FakeAdvertisementSource::Start(Callback onAdvertisement)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback_ = std::move(onAdvertisement);
+    return true;
+}
+
+void FakeAdvertisementSource::Stop()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    callback_ = nullptr;
+}
+
+bool FakeAdvertisementSource::Running() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<bool>(callback_);
+}
+
+void FakeAdvertisementSource::Inject(const ControllerAdvertisement& ad)
+{
+    Callback cb;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cb = callback_;
+    }
+    if (cb) cb(ad);
+}
+
+DiscoveryService::DiscoveryService(AdvertisementSource& source, OpenCallback onMatch,
+                                   std::chrono::milliseconds advertisementTtl)
+    : source_(source), onMatch_(std::move(onMatch)), advertisementTtl_(advertisementTtl)
+{
+}
+
+DiscoveryService::~DiscoveryService()
+{
+    Stop();
+    WaitForOpens();
+}
+
+bool DiscoveryService::Start()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) return true;
+        running_ = true;
+    }
+    if (!source_.Start([this](const ControllerAdvertisement& ad) { OnAdvertisement(ad); })) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        return false;
+    }
+    return true;
+}
+
+void DiscoveryService::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        running_ = false;
+    }
+    source_.Stop();
+}
+
+int DiscoveryService::Enqueue(std::string label, std::vector<uint16_t> productIds, int slot)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    PairingRequest request{ nextTicket_++, std::move(label), std::move(productIds), slot };
+    const int ticket = request.ticket;
+
+    // Serve the new slot from advertisements that arrived before it was queued.
+    const auto now = std::chrono::steady_clock::now();
+    const SeenAdvertisement* best = nullptr;
+    for (auto it = recent_.begin(); it != recent_.end();) {
+        if (now - it->second.seenAt > advertisementTtl_) {
+            it = recent_.erase(it);
+            continue;
+        }
+        if (!claimed_.count(it->first) && Accepts(request, it->second.ad.productId) &&
+            (!best || it->second.seenAt < best->seenAt)) {
+            best = &it->second;
+        }
+        ++it;
+    }
+    if (best) {
+        const ControllerAdvertisement ad = best->ad;
+        claimed_.insert(ad.address);
+        recent_.erase(ad.address);
+        Launch(std::move(request), ad);
+        return ticket;
+    }
+
+    pending_.push_back(std::move(request));
+    return ticket;
+}
+
+void DiscoveryService::Cancel(int ticket)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.erase(std::remove_if(pending_.begin(), pending_.end(),
+        [ticket](const PairingRequest& r) { return r.ticket == ticket; }), pending_.end());
+}
+
+void DiscoveryService::Release(uint64_t address)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    claimed_.erase(address);
+}
+
+size_t DiscoveryService::PendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_.size();
+}
+
+void DiscoveryService::WaitForOpens()
+{
+    std::vector<std::thread> openers;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        openers.swap(openers_);
+    }
+    for (auto& t : openers) {
+        if (t.joinable()) t.join();
+    }
+}
+
+void DiscoveryService::OnAdvertisement(const ControllerAdvertisement& ad)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_ || claimed_.count(ad.address)) return;
+    if (TryMatchLocked(ad)) return;
+    recent_[ad.address] = { ad, std::chrono::steady_clock::now() };
+}
+
+bool DiscoveryService::TryMatchLocked(const ControllerAdvertisement& ad)
+{
+    for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+        if (!Accepts(*it, ad.productId)) continue;
+        PairingRequest request = std::move(*it);
+        pending_.erase(it);
+        claimed_.insert(ad.address);
+        recent_.erase(ad.address);
+        Launch(std::move(request), ad);
+        return true;
+    }
+    return false;
+}
+
+void DiscoveryService::Launch(PairingRequest request, ControllerAdvertisement ad)
+{
+    // The posted work holds its own copy of the callback, so it stays valid
+    // if the service is destroyed before the executor gets to it.
+    if (executor_) {
+        executor_->Post([onMatch = onMatch_, request = std::move(request), ad]() { onMatch(request, ad); });
+        return;
+    }
+    openers_.emplace_back([this, request = std::move(request), ad]() { onMatch_(request, ad); });
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "CoroutineExecutor.h"
+
+constexpr uint16_t SWITCH2_PID_JOYCON_R = 0x2066;
+constexpr uint16_t SWITCH2_PID_JOYCON_L = 0x2067;
+constexpr uint16_t SWITCH2_PID_PRO      = 0x2069;
+constexpr uint16_t SWITCH2_PID_NSO_GC   = 0x2073;
+
+struct ControllerAdvertisement {
+    uint64_t address   = 0;
+    uint16_t productId = 0;
+    int16_t  rssi      = 0;
+};
+
+bool TryParseSwitch2ControllerAd(const std::vector<uint8_t>& d, uint16_t& productId);
+
+// Where advertisements come from. The Windows build wraps a passive
+// BluetoothLEAdvertisementWatcher; FakeAdvertisementSource lets the matching
+// logic run without a radio.
+class AdvertisementSource {
+public:
+    using Callback = std::function<void(const ControllerAdvertisement&)>;
+    virtual ~AdvertisementSource() = default;
+    virtual bool Start(Callback onAdvertisement) = 0;
+    virtual void Stop() = 0;
+};
+
+class FakeAdvertisementSource : public AdvertisementSource {
+public:
+    bool Start(Callback onAdvertisement) override;
+    void Stop() override;
+    bool Running() const;
+
+    // Delivers an advertisement as the watcher thread would.
+    void Inject(const ControllerAdvertisement& ad);
+
+private:
+    mutable std::mutex mutex_;
+    Callback callback_;
+};
+
+// A player slot waiting for a controller. An empty productIds list accepts
+// any Switch 2 controller; slot is the caller's own index for the request.
+struct PairingRequest {
+    int                   ticket = 0;
+    std::string           label;
+    std::vector<uint16_t> productIds;
+    int                   slot = -1;
+};
+
+// One long-lived scan shared by every pending slot. Each advertisement is
+// matched against the queue in FIFO order, and each match is handed to the
+// open callback on its own thread, or posted to an executor when one is set,
+// so devices open concurrently. Recent
+// advertisements are remembered for a short while, so a controller whose
+// sync button was pressed before its slot was queued is still picked up.
+class DiscoveryService {
+public:
+    using OpenCallback = std::function<void(const PairingRequest&, const ControllerAdvertisement&)>;
+
+    DiscoveryService(AdvertisementSource& source, OpenCallback onMatch,
+                     std::chrono::milliseconds advertisementTtl = std::chrono::seconds(10));
+    ~DiscoveryService();
+
+    DiscoveryService(const DiscoveryService&) = delete;
+    DiscoveryService& operator=(const DiscoveryService&) = delete;
+
+    // Set before Start. The callback then runs on the executor and must not
+    // block; it is expected to spawn the open as a coroutine.
+    void SetExecutor(Executor* executor) { executor_ = executor; }
+
+    bool Start();
+    void Stop();
+
+    int  Enqueue(std::string label, std::vector<uint16_t> productIds = {}, int slot = -1);
+    void Cancel(int ticket);
+    // Releases an address so a later advertisement from it can match again,
+    // e.g. after the open failed.
+    void Release(uint64_t address);
+
+    size_t PendingCount() const;
+    void WaitForOpens();
+
+private:
+    struct SeenAdvertisement {
+        ControllerAdvertisement ad;
+        std::chrono::steady_clock::time_point seenAt;
+    };
+
+    void OnAdvertisement(const ControllerAdvertisement& ad);
+    bool TryMatchLocked(const ControllerAdvertisement& ad);
+    void Launch(PairingRequest request, ControllerAdvertisement ad);
+
+    AdvertisementSource& source_;
+    OpenCallback onMatch_;
+    std::chrono::milliseconds advertisementTtl_;
+    Executor* executor_ = nullptr;
+
+    mutable std::mutex mutex_;
+    std::deque<PairingRequest> pending_;
+    std::unordered_set<uint64_t> claimed_;
+    std::unordered_map<uint64_t, SeenAdvertisement> recent_;
+    std::vector<std::thread> openers_;
+    int nextTicket_ = 1;
+    bool running_ = false;
+};
@@ -0,0 +1,234 @@
+#include "CommandEngine.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr size_t kCmdOffset = 0;
+    constexpr size_t kSubOffset = 3;
+    constexpr size_t kResponseHeaderSize = 8;
+}
+
+bool ParseCommandResponse(const uint8_t* data, size_t size, CommandResponse& out)
+{
+    if (!data || size < kResponseHeaderSize) return false;
+    out.cmd = data[0];
+    out.transport = data[2];
+    out.sub = data[3];
+    out.ack0 = data[4];
+    out.ack1 = data[5];
+    return true;
+}
+
+CommandEngine::CommandEngine()
+{
+    timer_ = std::thread([this] { TimerLoop(); });
+}
+
+CommandEngine::~CommandEngine()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (timer_.joinable()) timer_.join();
+    CancelAll();
+}
+
+std::future<CommandReply> CommandEngine::Send(const std::vector<uint8_t>& packet, size_t prefixSize,
+                                              const WriteFn& write, std::chrono::milliseconds timeout)
+{
+    auto promise = std::make_shared<std::promise<CommandReply>>();
+    auto future = promise->get_future();
+    Send(packet, prefixSize, write, timeout, [promise](CommandReply reply) {
+        promise->set_value(std::move(reply));
+    });
+    return future;
+}
+
+void CommandEngine::Send(const std::vector<uint8_t>& packet, size_t prefixSize,
+                         const WriteFn& write, std::chrono::milliseconds timeout, DoneFn done)
+{
+    if (packet.size() < prefixSize + kSubOffset + 1 || !write)
+    {
+        CommandReply reply;
+        reply.status = CommandStatus::WriteFailed;
+        if (done) done(std::move(reply));
+        return;
+    }
+
+    auto p = std::make_shared<Pending>();
+    p->key = Key(packet[prefixSize + kCmdOffset], packet[prefixSize + kSubOffset]);
+    p->sentAt = Clock::now();
+    p->deadline = p->sentAt + timeout;
+    p->done = std::move(done);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        inFlight_[p->key].push_back(p);
+        ++stats_[p->key].sent;
+    }
+    cv_.notify_all();
+
+    bool written = false;
+    try { written = write(packet); } catch (...) { written = false; }
+    if (written) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!RemoveLocked(p)) return;
+        ++stats_[p->key].writeFailed;
+    }
+    CommandReply reply;
+    reply.status = CommandStatus::WriteFailed;
+    Finish(*p, std::move(reply));
+}
+
+void CommandEngine::OnResponse(const uint8_t* data, size_t size)
+{
+    CommandResponse header;
+    if (!ParseCommandResponse(data, size, header)) return;
+    const auto now = Clock::now();
+
+    std::shared_ptr<Pending> p;
+    CommandReply reply;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++responses_;
+        auto it = inFlight_.find(Key(header.cmd, header.sub));
+        if (it == inFlight_.end() || it->second.empty())
+        {
+            ++unmatched_;
+            return;
+        }
+
+        p = std::move(it->second.front());
+        it->second.pop_front();
+
+        reply.status = CommandStatus::Acked;
+        reply.header = header;
+        reply.rttMs = std::chrono::duration<double, std::milli>(now - p->sentAt).count();
+
+        KeyStats& s = stats_[p->key];
+        s.minRttMs = s.acked ? std::min(s.minRttMs, reply.rttMs) : reply.rttMs;
+        s.maxRttMs = std::max(s.maxRttMs, reply.rttMs);
+        s.totalRttMs += reply.rttMs;
+        ++s.acked;
+    }
+    reply.payload.assign(data, data + size);
+    Finish(*p, std::move(reply));
+}
+
+void CommandEngine::CancelAll()
+{
+    std::vector<std::shared_ptr<Pending>> cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto& [key, queue] : inFlight_)
+        {
+            cancelled.insert(cancelled.end(), queue.begin(), queue.end());
+            queue.clear();
+        }
+    }
+    for (auto& p : cancelled)
+        Finish(*p, CommandReply{});
+}
+
+uint64_t CommandEngine::ResponsesSeen() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return responses_;
+}
+
+uint64_t CommandEngine::Unmatched() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return unmatched_;
+}
+
+size_t CommandEngine::InFlight() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t n = 0;
+    for (const auto& [key, queue] : inFlight_) n += queue.size();
+    return n;
+}
+
+CommandEngine::KeyStats CommandEngine::Stats(uint8_t cmd, uint8_t sub) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stats_.find(Key(cmd, sub));
+    return it != stats_.end() ? it->second : KeyStats{};
+}
+
+std::vector<std::pair<uint16_t, CommandEngine::KeyStats>> CommandEngine::AllStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::pair<uint16_t, KeyStats>> out(stats_.begin(), stats_.end());
+    std::sort(out.begin(), out.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+    return out;
+}
+
+bool CommandEngine::RemoveLocked(const std::shared_ptr<Pending>& p)
+{
+    auto it = inFlight_.find(p->key);
+    if (it == inFlight_.end()) return false;
+    auto& queue = it->second;
+    auto pos = std::find(queue.begin(), queue.end(), p);
+    if (pos == queue.end()) return false;
+    queue.erase(pos);
+    return true;
+}
+
+// Completions run user code that may send the next command straight away,
+// so they are never invoked with mutex_ held.
+void CommandEngine::Finish(Pending& p, CommandReply reply)
+{
+    if (p.done) p.done(std::move(reply));
+}
+
+void CommandEngine::TimerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::vector<std::pair<std::shared_ptr<Pending>, CommandReply>> expired;
+    while (!stopping_)
+    {
+        const auto now = Clock::now();
+        auto next = Clock::time_point::max();
+        for (auto& [key, queue] : inFlight_)
+        {
+            // Deadlines within one key are in send order only when timeouts
+            // match, so scan the whole queue.
+            for (auto it = queue.begin(); it != queue.end();)
+            {
+                auto& p = *it;
+                if (p->deadline <= now)
+                {
+                    ++stats_[p->key].timedOut;
+                    CommandReply reply;
+                    reply.status = CommandStatus::TimedOut;
+                    reply.rttMs = std::chrono::duration<double, std::milli>(now - p->sentAt).count();
+                    expired.emplace_back(std::move(p), std::move(reply));
+                    it = queue.erase(it);
+                    continue;
+                }
+                next = std::min(next, p->deadline);
+                ++it;
+            }
+        }
+
+        if (!expired.empty())
+        {
+            lock.unlock();
+            for (auto& [p, reply] : expired) Finish(*p, std::move(reply));
+            expired.clear();
+            lock.lock();
+            continue;
+        }
+
+        if (next == Clock::time_point::max())
+            cv_.wait(lock);
+        else
+            cv_.wait_until(lock, next);
+    }
+}
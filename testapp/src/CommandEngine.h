@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Header of a command-response notification:
+// [cmd, flags, transport, sub, ack0, ack1, ...].
+struct CommandResponse {
+    uint8_t cmd       = 0;
+    uint8_t transport = 0;
+    uint8_t sub       = 0;
+    uint8_t ack0      = 0;
+    uint8_t ack1      = 0;
+};
+
+bool ParseCommandResponse(const uint8_t* data, size_t size, CommandResponse& out);
+
+enum class CommandStatus : uint8_t { Acked, TimedOut, WriteFailed, Cancelled };
+
+struct CommandReply {
+    CommandStatus        status = CommandStatus::Cancelled;
+    CommandResponse      header;
+    std::vector<uint8_t> payload;   // the whole notification, header included
+    double               rttMs = 0.0;
+
+    bool Acked() const { return status == CommandStatus::Acked; }
+};
+
+// Correlates outgoing commands with command-response notifications. Each
+// in-flight command is keyed by cmd/sub; a response completes the oldest
+// command with the same key. Commands that see no response within their
+// timeout complete as TimedOut from the engine's timer thread.
+class CommandEngine {
+public:
+    using WriteFn = std::function<bool(const std::vector<uint8_t>& packet)>;
+    using DoneFn  = std::function<void(CommandReply reply)>;
+
+    struct KeyStats {
+        uint64_t sent        = 0;
+        uint64_t acked       = 0;
+        uint64_t timedOut    = 0;
+        uint64_t writeFailed = 0;
+        double   minRttMs    = 0.0;
+        double   maxRttMs    = 0.0;
+        double   totalRttMs  = 0.0;
+
+        double MeanRttMs() const { return acked ? totalRttMs / static_cast<double>(acked) : 0.0; }
+    };
+
+    CommandEngine();
+    ~CommandEngine();
+
+    CommandEngine(const CommandEngine&) = delete;
+    CommandEngine& operator=(const CommandEngine&) = delete;
+
+    // packet is [prefixSize bytes][cmd, 0x91, transport, sub, ...]. The
+    // command is registered before write runs, so a response delivered from
+    // inside write still matches.
+    std::future<CommandReply> Send(const std::vector<uint8_t>& packet, size_t prefixSize,
+                                   const WriteFn& write, std::chrono::milliseconds timeout);
+    // Same, but completes through done instead of a future. done runs
+    // exactly once, outside the engine lock: on the thread that delivered
+    // the response, on the timer thread, or inline if the write fails.
+    void Send(const std::vector<uint8_t>& packet, size_t prefixSize,
+              const WriteFn& write, std::chrono::milliseconds timeout, DoneFn done);
+
+    // Feed every command-response notification here, from any thread.
+    void OnResponse(const uint8_t* data, size_t size);
+
+    void CancelAll();
+
+    uint64_t ResponsesSeen() const;
+    uint64_t Unmatched() const;
+    size_t InFlight() const;
+    KeyStats Stats(uint8_t cmd, uint8_t sub) const;
+    std::vector<std::pair<uint16_t, KeyStats>> AllStats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Pending {
+        uint16_t key = 0;
+        Clock::time_point sentAt;
+        Clock::time_point deadline;
+        DoneFn done;
+    };
+
+    static uint16_t Key(uint8_t cmd, uint8_t sub) { return static_cast<uint16_t>(cmd << 8 | sub); }
+
+    bool RemoveLocked(const std::shared_ptr<Pending>& p);
+    static void Finish(Pending& p, CommandReply reply);
+    void TimerLoop();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<uint16_t, std::deque<std::shared_ptr<Pending>>> inFlight_;
+    std::unordered_map<uint16_t, KeyStats> stats_;
+    uint64_t responses_ = 0;
+    uint64_t unmatched_ = 0;
+    bool stopping_ = false;
+    std::thread timer_;
+};
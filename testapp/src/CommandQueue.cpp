@@ -0,0 +1,141 @@
+#include "CommandQueue.h"
+
+#include <algorithm>
+
+CommandQueue::CommandQueue(size_t maxDepth)
+    : maxDepth_(std::max<size_t>(maxDepth, 1))
+{
+    worker_ = std::thread([this] { Run(); });
+}
+
+CommandQueue::~CommandQueue()
+{
+    Stop();
+}
+
+bool CommandQueue::Submit(OutboundCommand command)
+{
+    if (!command.write) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return false;
+        ++stats_.submitted;
+
+        if (command.priority == CommandPriority::Rumble)
+        {
+            if (command.coalesceKey != 0)
+            {
+                auto it = std::find_if(rumble_.begin(), rumble_.end(),
+                    [&](const OutboundCommand& c) { return c.coalesceKey == command.coalesceKey; });
+                if (it != rumble_.end())
+                {
+                    *it = std::move(command);
+                    ++stats_.coalesced;
+                    return true;
+                }
+            }
+            if (rumble_.size() >= maxDepth_)
+            {
+                rumble_.pop_front();
+                ++stats_.dropped;
+            }
+            rumble_.push_back(std::move(command));
+        }
+        else
+        {
+            if (normal_.size() >= maxDepth_)
+            {
+                ++stats_.dropped;
+                return false;
+            }
+            normal_.push_back(std::move(command));
+        }
+        stats_.maxDepth = std::max(stats_.maxDepth, rumble_.size() + normal_.size());
+    }
+    cv_.notify_one();
+    return true;
+}
+
+void CommandQueue::EndSettle(bool timedOut)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        settleEnded_ = true;
+        normalReadyAt_ = Clock::time_point{};
+        if (timedOut) ++stats_.timedOut;
+    }
+    cv_.notify_all();
+}
+
+void CommandQueue::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ && !worker_.joinable()) return;
+        stopping_ = true;
+        rumble_.clear();
+        normal_.clear();
+    }
+    cv_.notify_all();
+    if (worker_.joinable() && worker_.get_id() != std::this_thread::get_id())
+        worker_.join();
+}
+
+size_t CommandQueue::Depth() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return rumble_.size() + normal_.size();
+}
+
+CommandQueue::Stats CommandQueue::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool CommandQueue::NextLocked(OutboundCommand& out, std::unique_lock<std::mutex>& lock)
+{
+    for (;;)
+    {
+        if (stopping_) return false;
+        if (!rumble_.empty())
+        {
+            out = std::move(rumble_.front());
+            rumble_.pop_front();
+            return true;
+        }
+        if (!normal_.empty())
+        {
+            if (Clock::now() >= normalReadyAt_)
+            {
+                out = std::move(normal_.front());
+                normal_.pop_front();
+                return true;
+            }
+            cv_.wait_until(lock, normalReadyAt_);
+            continue;
+        }
+        cv_.wait(lock);
+    }
+}
+
+void CommandQueue::Run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    OutboundCommand cmd;
+    while (NextLocked(cmd, lock))
+    {
+        settleEnded_ = false;
+        lock.unlock();
+        bool ok = false;
+        try { ok = cmd.write(); } catch (...) { ok = false; }
+        lock.lock();
+
+        if (ok) ++stats_.written;
+        else    ++stats_.failed;
+        if (cmd.priority == CommandPriority::Normal && cmd.settle.count() > 0 && !settleEnded_)
+            normalReadyAt_ = Clock::now() + cmd.settle;
+        cmd = {};
+    }
+}
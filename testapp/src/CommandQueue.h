@@ -0,0 +1,77 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class CommandPriority : uint8_t { Rumble, Normal };
+
+// One outbound write. The write itself is a closure so the queue stays
+// independent of the BLE API; it runs on the queue's worker thread and may
+// block there.
+struct OutboundCommand {
+    CommandPriority           priority = CommandPriority::Normal;
+    std::function<bool()>     write;
+    // Rumble frames with the same non-zero key replace each other while
+    // queued: only the newest amplitude matters.
+    uint32_t                  coalesceKey = 0;
+    // Quiet time after a normal command before the next normal command.
+    // Rumble frames are still sent during it, and EndSettle cuts it short.
+    std::chrono::milliseconds settle{ 0 };
+};
+
+// Per-device outbound queue with its own worker. Submit never blocks, so it
+// is safe to call from BLE notification callbacks. Normal commands run in
+// FIFO order with a bounded depth (new commands are dropped when full);
+// rumble frames always go ahead of them.
+class CommandQueue {
+public:
+    struct Stats {
+        uint64_t submitted = 0;
+        uint64_t written   = 0;
+        uint64_t failed    = 0;
+        uint64_t timedOut  = 0;   // written, but reported unanswered through EndSettle
+        uint64_t dropped   = 0;
+        uint64_t coalesced = 0;
+        size_t   maxDepth  = 0;
+    };
+
+    explicit CommandQueue(size_t maxDepth = 32);
+    ~CommandQueue();
+
+    CommandQueue(const CommandQueue&) = delete;
+    CommandQueue& operator=(const CommandQueue&) = delete;
+
+    bool Submit(OutboundCommand command);
+    // Ends the current settle time now, e.g. from the ack of the command
+    // that started it; safe to call from any thread, including from inside
+    // that command's write. timedOut counts the command as unanswered.
+    void EndSettle(bool timedOut = false);
+    void Stop();
+
+    size_t Depth() const;
+    Stats GetStats() const;
+
+private:
+    void Run();
+    bool NextLocked(OutboundCommand& out, std::unique_lock<std::mutex>& lock);
+
+    using Clock = std::chrono::steady_clock;
+
+    const size_t maxDepth_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<OutboundCommand> rumble_;
+    std::deque<OutboundCommand> normal_;
+    Clock::time_point normalReadyAt_{};
+    bool settleEnded_ = false;   // EndSettle ran while the current write was in progress
+    bool stopping_ = false;
+    Stats stats_;
+    std::thread worker_;
+};
@@ -0,0 +1,227 @@
+#include "CommandSequencer.h"
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Layout of every script entry: cmd at 0, sub at 3.
+    constexpr size_t kCmdOffset = 0;
+    constexpr size_t kSubOffset = 3;
+    constexpr size_t kMinCommandSize = 4;
+}
+
+const InitScript& JoyCon2InitScript()
+{
+    static const InitScript script{ "JoyCon2", 17, {
+        {0x07,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x00,0x30,0x01,0x00},
+        {0x10,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x16,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x0A,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x03,0x00,0x00,0x00},
+        {0x09,0x91,0x01,0x07,0x00,0x08,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+        {0x0C,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x37,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x80,0x30,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x40,0xC0,0x1F,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x10,0x7E,0x00,0x00,0x40,0x30,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x18,0x7E,0x00,0x00,0x00,0x31,0x01,0x00},
+        {0x11,0x91,0x01,0x03,0x00,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x20,0x7E,0x00,0x00,0x60,0x30,0x01,0x00},
+        {0x0A,0x91,0x01,0x08,0x00,0x14,0x00,0x00,
+         0x01,0x59,0x09,0x00,0x00,0xFF,0xFF,0xFF,0xFF,0x35,0x00,0x46,
+         0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+        {0x11,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x0C,0x91,0x01,0x04,0x00,0x04,0x00,0x00,0x37,0x00,0x00,0x00},
+    } };
+    return script;
+}
+
+const InitScript& ProCon2InitScript()
+{
+    static const InitScript script{ "ProCon2", 33, {
+        {0x07,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x00,0x30,0x01,0x00},
+        {0x16,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x0A,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x03,0x00,0x00,0x00},
+        {0x09,0x91,0x01,0x07,0x00,0x08,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+        {0x0C,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x2F,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x80,0x30,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0xC0,0x30,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x40,0xC0,0x1F,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x10,0x7E,0x00,0x00,0x40,0x30,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x18,0x7E,0x00,0x00,0x00,0x31,0x01,0x00},
+        {0x11,0x91,0x01,0x03,0x00,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x20,0x7E,0x00,0x00,0x60,0x30,0x01,0x00},
+        {0x0A,0x91,0x01,0x08,0x00,0x14,0x00,0x00,
+         0x01,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x35,0x00,0x46,
+         0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+        {0x0C,0x91,0x01,0x04,0x00,0x04,0x00,0x00,0x2F,0x00,0x00,0x00},
+    } };
+    return script;
+}
+
+const InitScript& NSOGCInitScript()
+{
+    static const InitScript script{ "NSOGC", 13, {
+        {0x07,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x00,0x30,0x01,0x00},
+        {0x10,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x16,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
+        {0x0A,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x03,0x00,0x00,0x00},
+        {0x09,0x91,0x01,0x07,0x00,0x08,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+        {0x0C,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x27,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x80,0x30,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0xC0,0x30,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x40,0xC0,0x1F,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x10,0x7E,0x00,0x00,0x40,0x30,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x18,0x7E,0x00,0x00,0x00,0x31,0x01,0x00},
+        {0x11,0x91,0x01,0x03,0x00,0x00,0x00,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x02,0x7E,0x00,0x00,0x40,0x31,0x01,0x00},
+        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x20,0x7E,0x00,0x00,0x60,0x30,0x01,0x00},
+        {0x0A,0x91,0x01,0x08,0x00,0x14,0x00,0x00,
+         0x01,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x35,0x00,0x46,
+         0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
+        {0x0C,0x91,0x01,0x04,0x00,0x04,0x00,0x00,0x27,0x00,0x00,0x00},
+    } };
+    return script;
+}
+
+CommandSequencer::CommandSequencer(CommandEngine& engine, WriteFn write)
+    : CommandSequencer(engine, std::move(write), Options{})
+{
+}
+
+CommandSequencer::CommandSequencer(CommandEngine& engine, WriteFn write, Options options)
+    : engine_(engine)
+    , write_(std::move(write))
+    , options_(options)
+{
+}
+
+// The calling thread pumps a private executor, so the blocking and the
+// coroutine paths share one implementation.
+CommandSequencer::Result CommandSequencer::Run(const InitScript& script, const std::atomic<bool>* cancel)
+{
+    Executor executor;
+    Result result;
+    bool done = false;
+    Spawn<Result>(executor, RunAsync(executor, script, cancel), [&](std::optional<Result> r, std::exception_ptr) {
+        if (r) result = *r;
+        done = true;
+    });
+    executor.RunUntil([&] { return done; });
+    return result;
+}
+
+Task<CommandSequencer::Result> CommandSequencer::RunAsync(Executor& executor, const InitScript& script,
+                                                          const std::atomic<bool>* cancel)
+{
+    Result result;
+    const auto start = Clock::now();
+    const uint64_t responsesBefore = engine_.ResponsesSeen();
+
+    std::vector<uint8_t> packet;
+    for (size_t i = 0; i < script.commands.size(); ++i)
+    {
+        if (cancel && cancel->load()) break;
+
+        const auto& cmd = script.commands[i];
+        if (cmd.size() < kMinCommandSize) continue;
+
+        packet.assign(script.prefixSize, 0x00);
+        packet.insert(packet.end(), cmd.begin(), cmd.end());
+        ++result.sent;
+
+        if (result.blind)
+        {
+            write_(packet);
+            co_await executor.Sleep(options_.blindDelay);
+            continue;
+        }
+
+        bool acked = false;
+        for (int attempt = 0; attempt <= options_.retries && !acked; ++attempt)
+        {
+            if (attempt > 0) ++result.retried;
+            Completion<CommandReply> replied(executor);
+            engine_.Send(packet, script.prefixSize, write_, options_.ackTimeout,
+                         [replied](CommandReply reply) { replied.Set(std::move(reply)); });
+            CommandReply reply = co_await replied;
+            acked = reply.Acked();
+            if (acked && onReply_) onReply_(reply);
+        }
+
+        if (acked)
+        {
+            ++result.acked;
+            continue;
+        }
+
+        ++result.timedOut;
+        if (i == 0 && engine_.ResponsesSeen() == responsesBefore)
+            result.blind = true;
+    }
+
+    result.elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    co_return result;
+}
+
+FakeCommandResponder::FakeCommandResponder(size_t prefixSize)
+    : prefixSize_(prefixSize)
+{
+}
+
+FakeCommandResponder::~FakeCommandResponder()
+{
+    for (auto& t : pending_)
+        if (t.joinable()) t.join();
+}
+
+void FakeCommandResponder::DropNext(uint8_t cmd, uint8_t sub, int count)
+{
+    drops_[Key(cmd, sub)] = count;
+}
+
+void FakeCommandResponder::Ignore(uint8_t cmd, uint8_t sub)
+{
+    drops_[Key(cmd, sub)] = -1;
+}
+
+bool FakeCommandResponder::Write(const std::vector<uint8_t>& packet)
+{
+    ++writes_;
+    if (packet.size() < prefixSize_ + kMinCommandSize) return true;
+
+    const uint8_t cmd = packet[prefixSize_ + kCmdOffset];
+    const uint8_t transport = packet[prefixSize_ + 2];
+    const uint8_t sub = packet[prefixSize_ + kSubOffset];
+    if (silent_ || !deliver_) return true;
+
+    auto it = drops_.find(Key(cmd, sub));
+    if (it != drops_.end())
+    {
+        if (it->second < 0) return true;
+        if (it->second > 0)
+        {
+            --it->second;
+            return true;
+        }
+    }
+
+    std::vector<uint8_t> response = { cmd, 0x01, transport, sub, 0x10, 0x78, 0x00, 0x00 };
+    if (payload_)
+    {
+        auto extra = payload_(packet.data() + prefixSize_, packet.size() - prefixSize_);
+        response.insert(response.end(), extra.begin(), extra.end());
+    }
+    if (latency_.count() == 0)
+    {
+        deliver_(response.data(), response.size());
+        return true;
+    }
+
+    pending_.emplace_back([deliver = deliver_, latency = latency_, response = std::move(response)] {
+        std::this_thread::sleep_for(latency);
+        deliver(response.data(), response.size());
+    });
+    return true;
+}
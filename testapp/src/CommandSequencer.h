@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "CommandEngine.h"
+#include "CoroutineExecutor.h"
+
+// An init script is a table of commands in [cmd, 0x91, 0x01, sub, ...] form.
+// prefixSize zero bytes are written ahead of each one, matching what the
+// controller expects on the characteristic the script is sent to.
+struct InitScript {
+    const char* name;
+    size_t      prefixSize;
+    std::vector<std::vector<uint8_t>> commands;
+};
+
+const InitScript& JoyCon2InitScript();
+const InitScript& ProCon2InitScript();
+const InitScript& NSOGCInitScript();
+
+// Sends an init script one command at a time and moves on as soon as the
+// matching cmd/sub response arrives, instead of sleeping a fixed time after
+// each write. A command that is never acknowledged is retried, then skipped.
+// If the controller has not answered anything after the first command, the
+// sequencer falls back to fixed pacing for the rest of the script.
+class CommandSequencer {
+public:
+    using WriteFn = CommandEngine::WriteFn;
+    using ReplyFn = std::function<void(const CommandReply& reply)>;
+
+    struct Options {
+        std::chrono::milliseconds ackTimeout{ 200 };
+        int                       retries = 1;
+        std::chrono::milliseconds blindDelay{ 80 };
+    };
+
+    struct Result {
+        size_t sent     = 0;
+        size_t acked    = 0;
+        size_t retried  = 0;
+        size_t timedOut = 0;
+        bool   blind    = false;
+        double elapsedMs = 0.0;
+
+        bool Complete() const { return sent > 0 && acked == sent; }
+    };
+
+    // Responses are matched by engine, which must be fed the controller's
+    // command-response notifications.
+    CommandSequencer(CommandEngine& engine, WriteFn write);
+    CommandSequencer(CommandEngine& engine, WriteFn write, Options options);
+
+    // Called with every acknowledged reply, e.g. to pick up flash reads.
+    void OnReply(ReplyFn onReply) { onReply_ = std::move(onReply); }
+
+    // Blocks the calling thread until the script is done.
+    Result Run(const InitScript& script, const std::atomic<bool>* cancel = nullptr);
+
+    // Runs the script as a coroutine on executor, so several controllers can
+    // be initialised at once without a thread each. The sequencer, script and
+    // cancel flag must outlive the returned task.
+    Task<Result> RunAsync(Executor& executor, const InitScript& script,
+                          const std::atomic<bool>* cancel = nullptr);
+
+private:
+    CommandEngine& engine_;
+    WriteFn write_;
+    Options options_;
+    ReplyFn onReply_;
+};
+
+// Scripted stand-in for a controller: answers written commands with a
+// response header, optionally after a delay, and can drop or ignore chosen
+// commands to exercise the retry and fallback paths.
+class FakeCommandResponder {
+public:
+    using DeliverFn = std::function<void(const uint8_t* data, size_t size)>;
+    // Returns bytes appended after the response header for a command.
+    using PayloadFn = std::function<std::vector<uint8_t>(const uint8_t* command, size_t size)>;
+
+    explicit FakeCommandResponder(size_t prefixSize);
+    ~FakeCommandResponder();
+
+    void Attach(DeliverFn deliver) { deliver_ = std::move(deliver); }
+    bool Write(const std::vector<uint8_t>& packet);
+
+    void SetLatency(std::chrono::milliseconds latency) { latency_ = latency; }
+    void DropNext(uint8_t cmd, uint8_t sub, int count);
+    void Ignore(uint8_t cmd, uint8_t sub);
+    void SetSilent(bool silent) { silent_ = silent; }
+    void SetPayload(PayloadFn payload) { payload_ = std::move(payload); }
+
+    size_t Writes() const { return writes_; }
+
+private:
+    static uint16_t Key(uint8_t cmd, uint8_t sub) { return static_cast<uint16_t>(cmd << 8 | sub); }
+
+    size_t prefixSize_;
+    DeliverFn deliver_;
+    PayloadFn payload_;
+    std::chrono::milliseconds latency_{ 0 };
+    bool silent_ = false;
+    size_t writes_ = 0;
+    std::unordered_map<uint16_t, int> drops_;
+    std::vector<std::thread> pending_;
+};
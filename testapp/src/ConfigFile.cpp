@@ -0,0 +1,953 @@
+#include "ConfigFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <system_error>
+
+namespace
+{
+    bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+    void AppendUtf8(std::string& out, uint32_t cp)
+    {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if (cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if (cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // The enum spellings used in the files. Lookups are linear; none of
+    // these has more than a couple of dozen entries.
+    struct EnumName {
+        const char* name;
+        int value;
+    };
+
+    constexpr EnumName kButtonMappings[] = {
+        { "None", 0 }, { "L3", 1 }, { "R3", 2 }, { "L1", 3 }, { "R1", 4 }, { "L2", 5 }, { "R2", 6 },
+        { "Cross", 7 }, { "Circle", 8 }, { "Square", 9 }, { "Triangle", 10 },
+        { "Share", 11 }, { "Options", 12 },
+        { "DPad Up", 13 }, { "DPad Down", 14 }, { "DPad Left", 15 }, { "DPad Right", 16 },
+    };
+    constexpr EnumName kUpdatePolicies[] = {
+        { "LowLatency", static_cast<int>(UpdatePolicy::LowLatency) },
+        { "Balanced120Hz", static_cast<int>(UpdatePolicy::Balanced120Hz) },
+        { "Legacy60Hz", static_cast<int>(UpdatePolicy::Legacy60Hz) },
+    };
+    constexpr EnumName kControllerTypes[] = {
+        { "SingleJoyCon", SingleJoyCon }, { "DualJoyCon", DualJoyCon },
+        { "ProController", ProController }, { "NSOGCController", NSOGCController },
+    };
+    constexpr EnumName kSides[] = {
+        { "Left", static_cast<int>(JoyConSide::Left) }, { "Right", static_cast<int>(JoyConSide::Right) },
+    };
+    constexpr EnumName kOrientations[] = {
+        { "Upright", static_cast<int>(JoyConOrientation::Upright) },
+        { "Sideways", static_cast<int>(JoyConOrientation::Sideways) },
+    };
+    constexpr EnumName kGyroSources[] = {
+        { "Both", static_cast<int>(GyroSource::Both) }, { "Left", static_cast<int>(GyroSource::Left) },
+        { "Right", static_cast<int>(GyroSource::Right) },
+    };
+    constexpr EnumName kGyroModes[] = {
+        { "Raw", static_cast<int>(GyroMode::Raw) }, { "DsuUdp", static_cast<int>(GyroMode::DsuUdp) },
+    };
+    constexpr EnumName kGyroAimOutputs[] = {
+        { "Off", static_cast<int>(GyroAimOutput::Off) }, { "Mouse", static_cast<int>(GyroAimOutput::Mouse) },
+        { "RightStick", static_cast<int>(GyroAimOutput::RightStick) },
+    };
+
+    template <size_t N>
+    const char* NameOf(const EnumName (&names)[N], int value)
+    {
+        for (const auto& n : names)
+            if (n.value == value) return n.name;
+        return names[0].name;
+    }
+
+    std::string Quoted(std::string_view s)
+    {
+        std::string out;
+        out.reserve(s.size() + 2);
+        out += '"';
+        out.append(s.data(), s.size());
+        out += '"';
+        return out;
+    }
+
+    // The schema checks. Each reads the value for key, checks its type and
+    // range and stores it; a violation fails the reader at the value, so
+    // the diagnostic points at the offending text.
+    void Warn(JsonReader& r, ConfigDiagnostics& d, size_t offset, std::string message)
+    {
+        ConfigIssue issue;
+        r.Locate(offset, issue.line, issue.column);
+        issue.error = false;
+        issue.message = std::move(message);
+        d.issues.push_back(std::move(issue));
+    }
+
+    bool SkipUnknown(JsonReader& r, ConfigDiagnostics& d, std::string_view key)
+    {
+        Warn(r, d, r.Offset(), "unknown key " + Quoted(key) + " ignored");
+        return r.Skip();
+    }
+
+    bool ReadInt(JsonReader& r, std::string_view key, int min, int max, int& out)
+    {
+        long long v = 0;
+        if (r.Peek() != JsonReader::Kind::Number) {
+            r.Fail(Quoted(key) + " must be a number");
+            return false;
+        }
+        if (!r.ReadInteger(v)) return false;
+        if (v < min || v > max) {
+            r.Fail(Quoted(key) + " must be between " + std::to_string(min) + " and " + std::to_string(max));
+            return false;
+        }
+        out = static_cast<int>(v);
+        return true;
+    }
+
+    bool ReadReal(JsonReader& r, std::string_view key, double min, double max, float& out)
+    {
+        double v = 0;
+        if (r.Peek() != JsonReader::Kind::Number) {
+            r.Fail(Quoted(key) + " must be a number");
+            return false;
+        }
+        if (!r.ReadNumber(v)) return false;
+        if (v < min || v > max) {
+            char range[64];
+            std::snprintf(range, sizeof(range), " must be between %g and %g", min, max);
+            r.Fail(Quoted(key) + range);
+            return false;
+        }
+        out = static_cast<float>(v);
+        return true;
+    }
+
+    bool ReadFlag(JsonReader& r, std::string_view key, bool& out)
+    {
+        if (r.Peek() != JsonReader::Kind::Bool) {
+            r.Fail(Quoted(key) + " must be true or false");
+            return false;
+        }
+        return r.ReadBool(out);
+    }
+
+    template <typename E, size_t N>
+    bool ReadEnum(JsonReader& r, std::string_view key, const EnumName (&names)[N], E& out)
+    {
+        std::string_view s;
+        if (r.Peek() != JsonReader::Kind::String) {
+            r.Fail(Quoted(key) + " must be a string");
+            return false;
+        }
+        if (!r.ReadString(s)) return false;
+        for (const auto& n : names) {
+            if (s == n.name) {
+                out = static_cast<E>(n.value);
+                return true;
+            }
+        }
+        std::string message = Quoted(key) + ": unknown value " + Quoted(s) + ", expected one of";
+        for (size_t i = 0; i < N; ++i) message += (i ? ", " : " ") + Quoted(names[i].name);
+        r.Fail(std::move(message));
+        return false;
+    }
+
+    // Over-long names are cut at a character boundary rather than rejected;
+    // the UI cannot show more anyway.
+    bool ReadName(JsonReader& r, ConfigDiagnostics& d, std::string_view key, size_t maxLength, std::string& out)
+    {
+        std::string_view s;
+        if (r.Peek() != JsonReader::Kind::String) {
+            r.Fail(Quoted(key) + " must be a string");
+            return false;
+        }
+        if (!r.ReadString(s)) return false;
+        if (s.size() > maxLength) {
+            size_t n = maxLength;
+            while (n > 0 && (static_cast<unsigned char>(s[n]) & 0xC0) == 0x80) --n;
+            s = s.substr(0, n);
+            Warn(r, d, r.Offset(), Quoted(key) + " longer than " + std::to_string(maxLength) + " bytes, truncated");
+        }
+        out.assign(s.data(), s.size());
+        return true;
+    }
+
+    bool ExpectKind(JsonReader& r, std::string_view key, JsonReader::Kind kind)
+    {
+        if (r.Peek() == kind) return true;
+        if (!r.Failed()) r.Fail(Quoted(key) + (kind == JsonReader::Kind::Object ? " must be an object" : " must be an array"));
+        return false;
+    }
+
+    bool ReadLayout(JsonReader& r, ConfigDiagnostics& d, LayoutConfig& out)
+    {
+        if (!ExpectKind(r, "layouts[]", JsonReader::Kind::Object) || !r.BeginObject()) return false;
+        std::string_view key;
+        while (r.NextMember(key)) {
+            bool ok;
+            if (key == "name") ok = ReadName(r, d, key, AppConfig::kMaxLayoutName, out.name);
+            else if (key == "glMapping") ok = ReadEnum(r, key, kButtonMappings, out.glMapping);
+            else if (key == "grMapping") ok = ReadEnum(r, key, kButtonMappings, out.grMapping);
+            else ok = SkipUnknown(r, d, key);
+            if (!ok) return false;
+        }
+        return !r.Failed();
+    }
+
+    bool ReadGyroAim(JsonReader& r, ConfigDiagnostics& d, GyroAimTuning& out)
+    {
+        if (!ExpectKind(r, "gyroAim", JsonReader::Kind::Object) || !r.BeginObject()) return false;
+        std::string_view key;
+        while (r.NextMember(key)) {
+            bool ok;
+            if (key == "sensitivity") ok = ReadReal(r, key, 0.05, 20.0, out.sensitivity);
+            else if (key == "acceleration") ok = ReadReal(r, key, 0.0, 4.0, out.acceleration);
+            else if (key == "tighteningDps") ok = ReadReal(r, key, 0.0, 30.0, out.tighteningDps);
+            else if (key == "stickDeadzone") ok = ReadReal(r, key, 0.0, 0.9, out.stickDeadzone);
+            else if (key == "invertX") ok = ReadFlag(r, key, out.invertX);
+            else if (key == "invertY") ok = ReadFlag(r, key, out.invertY);
+            else ok = SkipUnknown(r, d, key);
+            if (!ok) return false;
+        }
+        return !r.Failed();
+    }
+
+    bool ReadPolicy(JsonReader& r, ConfigDiagnostics& d, PolicyConfig& out)
+    {
+        if (!ExpectKind(r, "policy", JsonReader::Kind::Object) || !r.BeginObject()) return false;
+        std::string_view key;
+        while (r.NextMember(key)) {
+            bool ok;
+            if (key == "updatePolicy") ok = ReadEnum(r, key, kUpdatePolicies, out.updatePolicy);
+            else if (key == "smoothMotionClock") ok = ReadFlag(r, key, out.smoothMotionClock);
+            else if (key == "useControllerCalibration") ok = ReadFlag(r, key, out.useControllerCalibration);
+            else if (key == "connectKnownDevices") ok = ReadFlag(r, key, out.connectKnownDevices);
+            else if (key == "mouseSensitivity") ok = ReadReal(r, key, 0.1, 10.0, out.mouseSensitivity);
+            else if (key == "mouseAcceleration") ok = ReadReal(r, key, 0.0, 4.0, out.mouseAcceleration);
+            else if (key == "gyroAim") ok = ReadGyroAim(r, d, out.gyroAim);
+            else if (key == "skipUnchangedReports") ok = ReadFlag(r, key, out.skipUnchangedReports);
+            else if (key == "keepaliveMs") ok = ReadInt(r, key, 10, 1000, out.keepaliveMs);
+            else ok = SkipUnknown(r, d, key);
+            if (!ok) return false;
+        }
+        return !r.Failed();
+    }
+
+    bool ReadPlayer(JsonReader& r, ConfigDiagnostics& d, PlayerSetupConfig& out)
+    {
+        if (!ExpectKind(r, "players[]", JsonReader::Kind::Object) || !r.BeginObject()) return false;
+        std::string_view key;
+        while (r.NextMember(key)) {
+            bool ok;
+            if (key == "controllerType") ok = ReadEnum(r, key, kControllerTypes, out.controllerType);
+            else if (key == "joyconSide") ok = ReadEnum(r, key, kSides, out.joyconSide);
+            else if (key == "orientation") ok = ReadEnum(r, key, kOrientations, out.joyconOrientation);
+            else if (key == "gyroSource") ok = ReadEnum(r, key, kGyroSources, out.gyroSource);
+            else if (key == "gyroMode") ok = ReadEnum(r, key, kGyroModes, out.gyroMode);
+            else if (key == "gyroAim") ok = ReadEnum(r, key, kGyroAimOutputs, out.gyroAim);
+            else ok = SkipUnknown(r, d, key);
+            if (!ok) return false;
+        }
+        return !r.Failed();
+    }
+
+    bool ReadStick(JsonReader& r, ConfigDiagnostics& d, std::string_view section, StickCalibration& out)
+    {
+        if (!ExpectKind(r, section, JsonReader::Kind::Object) || !r.BeginObject()) return false;
+        std::string_view key;
+        while (r.NextMember(key)) {
+            bool ok;
+            if (key == "centerX") ok = ReadInt(r, key, 0, 4095, out.centerX);
+            else if (key == "centerY") ok = ReadInt(r, key, 0, 4095, out.centerY);
+            else if (key == "minX") ok = ReadInt(r, key, 0, 4095, out.minX);
+            else if (key == "maxX") ok = ReadInt(r, key, 0, 4095, out.maxX);
+            else if (key == "minY") ok = ReadInt(r, key, 0, 4095, out.minY);
+            else if (key == "maxY") ok = ReadInt(r, key, 0, 4095, out.maxY);
+            else ok = SkipUnknown(r, d, key);
+            if (!ok) return false;
+        }
+        if (r.Failed()) return false;
+        if (out.minX >= out.maxX || out.minY >= out.maxY) {
+            r.Fail(Quoted(section) + ": min must be below max on both axes");
+            return false;
+        }
+        return true;
+    }
+
+    bool ReadProfile(JsonReader& r, ConfigDiagnostics& d, CalibrationProfile& out)
+    {
+        if (!ExpectKind(r, "profiles[]", JsonReader::Kind::Object) || !r.BeginObject()) return false;
+        std::string_view key;
+        while (r.NextMember(key)) {
+            bool ok;
+            if (key == "name") ok = ReadName(r, d, key, 255, out.name);
+            else if (key == "leftStick") ok = ReadStick(r, d, key, out.leftStick);
+            else if (key == "rightStick") ok = ReadStick(r, d, key, out.rightStick);
+            else ok = SkipUnknown(r, d, key);
+            if (!ok) return false;
+        }
+        return !r.Failed();
+    }
+
+    // Checks the document ends after the root value and turns the reader's
+    // failure, if any, into the error diagnostic.
+    bool Finish(JsonReader& r, ConfigDiagnostics& d)
+    {
+        if (!r.Failed() && !r.AtEnd()) r.Fail("unexpected text after the end of the document");
+        if (!r.Failed()) return true;
+        ConfigIssue issue;
+        r.Locate(r.Offset(), issue.line, issue.column);
+        issue.message = r.Error();
+        d.issues.push_back(std::move(issue));
+        return false;
+    }
+
+    // Shortest text that reads back as the same float.
+    void AppendJsonNumber(std::string& out, float v)
+    {
+        char buf[32];
+        const auto res = std::to_chars(buf, buf + sizeof(buf), v);
+        out.append(buf, res.ptr);
+    }
+}
+
+void JsonReader::SkipWhitespace()
+{
+    // A byte-order mark is what Notepad puts in front of a UTF-8 file.
+    if (pos_ == 0 && text_.size() >= 3 && text_.compare(0, 3, "\xEF\xBB\xBF") == 0) pos_ = 3;
+    while (pos_ < text_.size()) {
+        const char c = text_[pos_];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+        ++pos_;
+    }
+}
+
+void JsonReader::Fail(std::string message)
+{
+    if (failed_) return;
+    failed_ = true;
+    error_ = std::move(message);
+}
+
+void JsonReader::Locate(size_t offset, int& line, int& column) const
+{
+    offset = std::min(offset, text_.size());
+    line = 1;
+    size_t lineStart = 0;
+    for (size_t i = 0; i < offset; ++i) {
+        if (text_[i] == '\n') {
+            ++line;
+            lineStart = i + 1;
+        }
+    }
+    column = static_cast<int>(offset - lineStart) + 1;
+}
+
+JsonReader::Kind JsonReader::Peek()
+{
+    if (failed_) return Kind::Invalid;
+    SkipWhitespace();
+    tokenStart_ = pos_;
+    if (pos_ >= text_.size()) return Kind::End;
+    switch (text_[pos_]) {
+    case '{': return Kind::Object;
+    case '[': return Kind::Array;
+    case '"': return Kind::String;
+    case 't': case 'f': return Kind::Bool;
+    case 'n': return Kind::Null;
+    default: return (text_[pos_] == '-' || IsDigit(text_[pos_])) ? Kind::Number : Kind::Invalid;
+    }
+}
+
+bool JsonReader::Expect(char c)
+{
+    SkipWhitespace();
+    tokenStart_ = pos_;
+    if (pos_ < text_.size() && text_[pos_] == c) {
+        ++pos_;
+        return true;
+    }
+    Fail(pos_ < text_.size() ? std::string("expected '") + c + "'" : std::string("unexpected end of file"));
+    return false;
+}
+
+bool JsonReader::Push()
+{
+    if (depth_ >= kMaxDepth) {
+        Fail("nested too deeply");
+        return false;
+    }
+    first_[depth_++] = true;
+    return true;
+}
+
+bool JsonReader::BeginObject()
+{
+    return !failed_ && Expect('{') && Push();
+}
+
+bool JsonReader::BeginArray()
+{
+    return !failed_ && Expect('[') && Push();
+}
+
+bool JsonReader::NextMember(std::string_view& key)
+{
+    if (failed_ || depth_ == 0) return false;
+    SkipWhitespace();
+    if (pos_ < text_.size() && text_[pos_] == '}') {
+        ++pos_;
+        --depth_;
+        return false;
+    }
+    if (!first_[depth_ - 1] && !Expect(',')) return false;
+    first_[depth_ - 1] = false;
+    SkipWhitespace();
+    if (pos_ >= text_.size() || text_[pos_] != '"') {
+        tokenStart_ = pos_;
+        Fail(pos_ < text_.size() ? "expected a key" : "unexpected end of file");
+        return false;
+    }
+    return ScanString(key, keyScratch_) && Expect(':');
+}
+
+bool JsonReader::NextElement()
+{
+    if (failed_ || depth_ == 0) return false;
+    SkipWhitespace();
+    if (pos_ < text_.size() && text_[pos_] == ']') {
+        ++pos_;
+        --depth_;
+        return false;
+    }
+    if (!first_[depth_ - 1] && !Expect(',')) return false;
+    first_[depth_ - 1] = false;
+    // A trailing comma leaves a ']' where the element should be.
+    if (Peek() == Kind::Invalid) {
+        Fail(pos_ < text_.size() ? "expected a value" : "unexpected end of file");
+        return false;
+    }
+    return true;
+}
+
+bool JsonReader::ReadString(std::string_view& out)
+{
+    return ScanString(out, scratch_);
+}
+
+bool JsonReader::ScanString(std::string_view& out, std::string& buffer)
+{
+    if (failed_) return false;
+    SkipWhitespace();
+    tokenStart_ = pos_;
+    if (pos_ >= text_.size() || text_[pos_] != '"') {
+        Fail("expected a string");
+        return false;
+    }
+    const size_t begin = ++pos_;
+
+    // Most strings have no escapes and are returned in place.
+    while (pos_ < text_.size()) {
+        const unsigned char c = static_cast<unsigned char>(text_[pos_]);
+        if (c == '"') {
+            out = text_.substr(begin, pos_ - begin);
+            ++pos_;
+            return true;
+        }
+        if (c == '\\') break;
+        if (c < 0x20) {
+            tokenStart_ = pos_;
+            Fail("control character in string");
+            return false;
+        }
+        ++pos_;
+    }
+
+    buffer.assign(text_.data() + begin, pos_ - begin);
+    auto hex4 = [this](uint32_t& cp) {
+        if (pos_ + 4 > text_.size()) return false;
+        cp = 0;
+        for (int i = 0; i < 4; ++i) {
+            const char h = text_[pos_++];
+            cp <<= 4;
+            if (IsDigit(h)) cp |= static_cast<uint32_t>(h - '0');
+            else if (h >= 'a' && h <= 'f') cp |= static_cast<uint32_t>(h - 'a' + 10);
+            else if (h >= 'A' && h <= 'F') cp |= static_cast<uint32_t>(h - 'A' + 10);
+            else return false;
+        }
+        return true;
+    };
+    while (pos_ < text_.size()) {
+        const size_t at = pos_;
+        const char c = text_[pos_++];
+        if (c == '"') {
+            out = buffer;
+            return true;
+        }
+        if (static_cast<unsigned char>(c) < 0x20) {
+            tokenStart_ = at;
+            Fail("control character in string");
+            return false;
+        }
+        if (c != '\\') {
+            buffer += c;
+            continue;
+        }
+        if (pos_ >= text_.size()) break;
+        switch (text_[pos_++]) {
+        case '"': buffer += '"'; break;
+        case '\\': buffer += '\\'; break;
+        case '/': buffer += '/'; break;
+        case 'b': buffer += '\b'; break;
+        case 'f': buffer += '\f'; break;
+        case 'n': buffer += '\n'; break;
+        case 'r': buffer += '\r'; break;
+        case 't': buffer += '\t'; break;
+        case 'u': {
+            uint32_t cp = 0;
+            bool ok = hex4(cp);
+            if (ok && cp >= 0xD800 && cp <= 0xDBFF) {
+                uint32_t low = 0;
+                ok = pos_ + 2 <= text_.size() && text_[pos_] == '\\' && text_[pos_ + 1] == 'u';
+                if (ok) {
+                    pos_ += 2;
+                    ok = hex4(low) && low >= 0xDC00 && low <= 0xDFFF;
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                ok = false;
+            }
+            if (!ok) {
+                tokenStart_ = at;
+                Fail("invalid \\u escape");
+                return false;
+            }
+            AppendUtf8(buffer, cp);
+            break;
+        }
+        default:
+            tokenStart_ = at;
+            Fail("invalid escape in string");
+            return false;
+        }
+    }
+    Fail("unterminated string");
+    return false;
+}
+
+bool JsonReader::ScanNumber(std::string_view& token)
+{
+    SkipWhitespace();
+    tokenStart_ = pos_;
+    size_t p = pos_;
+    const size_t n = text_.size();
+    auto digits = [&] {
+        const size_t start = p;
+        while (p < n && IsDigit(text_[p])) ++p;
+        return p > start;
+    };
+    if (p < n && text_[p] == '-') ++p;
+    bool ok = p < n && IsDigit(text_[p]);
+    if (ok && text_[p] == '0') ++p;
+    else if (ok) digits();
+    if (ok && p < n && text_[p] == '.') {
+        ++p;
+        ok = digits();
+    }
+    if (ok && p < n && (text_[p] == 'e' || text_[p] == 'E')) {
+        ++p;
+        if (p < n && (text_[p] == '+' || text_[p] == '-')) ++p;
+        ok = digits();
+    }
+    if (!ok) {
+        Fail("expected a number");
+        return false;
+    }
+    token = text_.substr(pos_, p - pos_);
+    pos_ = p;
+    return true;
+}
+
+bool JsonReader::ReadNumber(double& out)
+{
+    std::string_view token;
+    if (failed_ || !ScanNumber(token)) return false;
+    const auto result = std::from_chars(token.data(), token.data() + token.size(), out);
+    if (result.ec != std::errc()) {
+        Fail("number out of range");
+        return false;
+    }
+    return true;
+}
+
+bool JsonReader::ReadInteger(long long& out)
+{
+    std::string_view token;
+    if (failed_ || !ScanNumber(token)) return false;
+    if (token.find_first_of(".eE") != std::string_view::npos) {
+        Fail("expected a whole number");
+        return false;
+    }
+    const auto result = std::from_chars(token.data(), token.data() + token.size(), out);
+    if (result.ec != std::errc()) {
+        Fail("number out of range");
+        return false;
+    }
+    return true;
+}
+
+bool JsonReader::ReadBool(bool& out)
+{
+    if (failed_) return false;
+    SkipWhitespace();
+    tokenStart_ = pos_;
+    if (text_.compare(pos_, 4, "true") == 0) {
+        pos_ += 4;
+        out = true;
+        return true;
+    }
+    if (text_.compare(pos_, 5, "false") == 0) {
+        pos_ += 5;
+        out = false;
+        return true;
+    }
+    Fail("expected true or false");
+    return false;
+}
+
+bool JsonReader::ReadNull()
+{
+    if (failed_) return false;
+    SkipWhitespace();
+    tokenStart_ = pos_;
+    if (text_.compare(pos_, 4, "null") == 0) {
+        pos_ += 4;
+        return true;
+    }
+    Fail("expected null");
+    return false;
+}
+
+bool JsonReader::Skip()
+{
+    switch (Peek()) {
+    case Kind::Object: {
+        if (!BeginObject()) return false;
+        std::string_view key;
+        while (NextMember(key))
+            if (!Skip()) return false;
+        return !failed_;
+    }
+    case Kind::Array:
+        if (!BeginArray()) return false;
+        while (NextElement())
+            if (!Skip()) return false;
+        return !failed_;
+    case Kind::String: {
+        std::string_view s;
+        return ReadString(s);
+    }
+    case Kind::Number: {
+        std::string_view token;
+        return ScanNumber(token);
+    }
+    case Kind::Bool: {
+        bool b;
+        return ReadBool(b);
+    }
+    case Kind::Null:
+        return ReadNull();
+    case Kind::End:
+        Fail("unexpected end of file");
+        return false;
+    default:
+        Fail("expected a value");
+        return false;
+    }
+}
+
+bool JsonReader::AtEnd()
+{
+    SkipWhitespace();
+    tokenStart_ = pos_;
+    return pos_ >= text_.size();
+}
+
+void AppendJsonString(std::string& out, std::string_view s)
+{
+    static constexpr char kHex[] = "0123456789abcdef";
+    out += '"';
+    for (const char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += kHex[(c >> 4) & 0x0F];
+                out += kHex[c & 0x0F];
+            } else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+std::string JsonQuote(std::string_view s)
+{
+    std::string out;
+    AppendJsonString(out, s);
+    return out;
+}
+
+bool ConfigDiagnostics::HasErrors() const
+{
+    for (const auto& issue : issues)
+        if (issue.error) return true;
+    return false;
+}
+
+std::string ConfigDiagnostics::Format(const std::string& path) const
+{
+    std::string out;
+    for (const auto& issue : issues) {
+        out += path + ":" + std::to_string(issue.line) + ":" + std::to_string(issue.column)
+            + (issue.error ? ": error: " : ": warning: ") + issue.message + "\n";
+    }
+    return out;
+}
+
+const char* ButtonMappingName(ButtonMapping mapping) { return NameOf(kButtonMappings, static_cast<int>(mapping)); }
+const char* UpdatePolicyName(UpdatePolicy policy) { return NameOf(kUpdatePolicies, static_cast<int>(policy)); }
+const char* ControllerTypeName(ControllerType type) { return NameOf(kControllerTypes, type); }
+
+bool ParseAppConfig(std::string_view text, AppConfig& out, ConfigDiagnostics& diagnostics)
+{
+    JsonReader r(text);
+    AppConfig config;
+    size_t activeAt = 0;
+    if (r.Peek() != JsonReader::Kind::Object) r.Fail("the config must be a JSON object");
+
+    std::string_view key;
+    if (r.BeginObject()) {
+        while (r.NextMember(key)) {
+            bool ok = true;
+            if (key == "activeLayoutIndex") {
+                activeAt = r.Offset();
+                ok = ReadInt(r, key, 0, 1 << 16, config.activeLayoutIndex);
+            } else if (key == "layouts") {
+                ok = ExpectKind(r, key, JsonReader::Kind::Array) && r.BeginArray();
+                config.layouts.clear();
+                while (ok && r.NextElement()) {
+                    config.layouts.emplace_back();
+                    ok = ReadLayout(r, diagnostics, config.layouts.back());
+                }
+            } else if (key == "policy") {
+                ok = ReadPolicy(r, diagnostics, config.policy.emplace());
+            } else if (key == "players") {
+                ok = ExpectKind(r, key, JsonReader::Kind::Array) && r.BeginArray();
+                auto& players = config.players.emplace();
+                while (ok && r.NextElement()) {
+                    if (players.size() == AppConfig::kMaxPlayers) {
+                        r.Fail("at most " + std::to_string(AppConfig::kMaxPlayers) + " players");
+                        break;
+                    }
+                    players.emplace_back();
+                    ok = ReadPlayer(r, diagnostics, players.back());
+                }
+            } else {
+                ok = SkipUnknown(r, diagnostics, key);
+            }
+            if (!ok || r.Failed()) break;
+        }
+    }
+    if (!Finish(r, diagnostics)) return false;
+
+    if (config.activeLayoutIndex > 0 && config.activeLayoutIndex >= static_cast<int>(config.layouts.size())) {
+        Warn(r, diagnostics, activeAt, "\"activeLayoutIndex\" is past the last layout, using the first");
+        config.activeLayoutIndex = 0;
+    }
+    out = std::move(config);
+    return true;
+}
+
+std::string SerializeAppConfig(const AppConfig& config)
+{
+    std::string f;
+    f.reserve(256 + 96 * config.layouts.size());
+    f += "{\n  \"activeLayoutIndex\": " + std::to_string(config.activeLayoutIndex) + ",\n  \"layouts\": [\n";
+    for (size_t i = 0; i < config.layouts.size(); ++i) {
+        const auto& l = config.layouts[i];
+        f += "    {\"name\":";
+        AppendJsonString(f, l.name);
+        f += ",\"glMapping\":\"";
+        f += ButtonMappingName(l.glMapping);
+        f += "\",\"grMapping\":\"";
+        f += ButtonMappingName(l.grMapping);
+        f += "\"}";
+        if (i + 1 < config.layouts.size()) f += ",";
+        f += "\n";
+    }
+    f += "  ]";
+    if (config.policy) {
+        const auto& p = *config.policy;
+        f += ",\n  \"policy\": {\n    \"updatePolicy\": \"";
+        f += UpdatePolicyName(p.updatePolicy);
+        f += "\",\n    \"smoothMotionClock\": ";
+        f += p.smoothMotionClock ? "true" : "false";
+        f += ",\n    \"useControllerCalibration\": ";
+        f += p.useControllerCalibration ? "true" : "false";
+        f += ",\n    \"connectKnownDevices\": ";
+        f += p.connectKnownDevices ? "true" : "false";
+        f += ",\n    \"mouseSensitivity\": ";
+        AppendJsonNumber(f, p.mouseSensitivity);
+        f += ",\n    \"mouseAcceleration\": ";
+        AppendJsonNumber(f, p.mouseAcceleration);
+        const auto& a = p.gyroAim;
+        f += ",\n    \"gyroAim\": {\"sensitivity\":";
+        AppendJsonNumber(f, a.sensitivity);
+        f += ",\"acceleration\":";
+        AppendJsonNumber(f, a.acceleration);
+        f += ",\"tighteningDps\":";
+        AppendJsonNumber(f, a.tighteningDps);
+        f += ",\"stickDeadzone\":";
+        AppendJsonNumber(f, a.stickDeadzone);
+        f += ",\"invertX\":";
+        f += a.invertX ? "true" : "false";
+        f += ",\"invertY\":";
+        f += a.invertY ? "true" : "false";
+        f += "},\n    \"skipUnchangedReports\": ";
+        f += p.skipUnchangedReports ? "true" : "false";
+        f += ",\n    \"keepaliveMs\": ";
+        f += std::to_string(p.keepaliveMs);
+        f += "\n  }";
+    }
+    if (config.players) {
+        f += ",\n  \"players\": [\n";
+        for (size_t i = 0; i < config.players->size(); ++i) {
+            const auto& p = (*config.players)[i];
+            f += "    {\"controllerType\":\"";
+            f += ControllerTypeName(p.controllerType);
+            f += "\",\"joyconSide\":\"";
+            f += NameOf(kSides, static_cast<int>(p.joyconSide));
+            f += "\",\"orientation\":\"";
+            f += NameOf(kOrientations, static_cast<int>(p.joyconOrientation));
+            f += "\",\"gyroSource\":\"";
+            f += NameOf(kGyroSources, static_cast<int>(p.gyroSource));
+            f += "\",\"gyroMode\":\"";
+            f += NameOf(kGyroModes, static_cast<int>(p.gyroMode));
+            f += "\",\"gyroAim\":\"";
+            f += NameOf(kGyroAimOutputs, static_cast<int>(p.gyroAim));
+            f += "\"}";
+            if (i + 1 < config.players->size()) f += ",";
+            f += "\n";
+        }
+        f += "  ]";
+    }
+    f += "\n}\n";
+    return f;
+}
+
+bool ParseCalibrationConfig(std::string_view text, CalibrationConfig& out, ConfigDiagnostics& diagnostics)
+{
+    JsonReader r(text);
+    CalibrationConfig config;
+    size_t activeAt = 0;
+    if (r.Peek() != JsonReader::Kind::Object) r.Fail("the calibration file must be a JSON object");
+
+    std::string_view key;
+    if (r.BeginObject()) {
+        while (r.NextMember(key)) {
+            bool ok = true;
+            if (key == "activeIndex") {
+                activeAt = r.Offset();
+                ok = ReadInt(r, key, 0, 1 << 16, config.activeIndex);
+            } else if (key == "profiles") {
+                ok = ExpectKind(r, key, JsonReader::Kind::Array) && r.BeginArray();
+                config.profiles.clear();
+                while (ok && r.NextElement()) {
+                    config.profiles.emplace_back();
+                    ok = ReadProfile(r, diagnostics, config.profiles.back());
+                }
+            } else {
+                ok = SkipUnknown(r, diagnostics, key);
+            }
+            if (!ok || r.Failed()) break;
+        }
+    }
+    if (!Finish(r, diagnostics)) return false;
+
+    if (config.activeIndex > 0 && config.activeIndex >= static_cast<int>(config.profiles.size())) {
+        Warn(r, diagnostics, activeAt, "\"activeIndex\" is past the last profile, using the first");
+        config.activeIndex = 0;
+    }
+    out = std::move(config);
+    return true;
+}
+
+std::string SerializeCalibrationConfig(const std::vector<CalibrationProfile>& profiles, int activeIndex)
+{
+    std::string f;
+    f.reserve(64 + 384 * profiles.size());
+    auto writeStick = [&f](const char* key, const StickCalibration& cal) {
+        f += "      \"";
+        f += key;
+        f += "\": {\n";
+        f += "        \"centerX\": " + std::to_string(cal.centerX) + ",\n";
+        f += "        \"centerY\": " + std::to_string(cal.centerY) + ",\n";
+        f += "        \"minX\": " + std::to_string(cal.minX) + ",\n";
+        f += "        \"maxX\": " + std::to_string(cal.maxX) + ",\n";
+        f += "        \"minY\": " + std::to_string(cal.minY) + ",\n";
+        f += "        \"maxY\": " + std::to_string(cal.maxY) + "\n";
+        f += "      }";
+    };
+
+    f += "{\n  \"activeIndex\": " + std::to_string(activeIndex) + ",\n  \"profiles\": [\n";
+    for (size_t i = 0; i < profiles.size(); ++i) {
+        f += "    {\n      \"name\": ";
+        AppendJsonString(f, profiles[i].name);
+        f += ",\n";
+        writeStick("leftStick", profiles[i].leftStick);
+        f += ",\n";
+        writeStick("rightStick", profiles[i].rightStick);
+        f += "\n    }";
+        if (i + 1 < profiles.size()) f += ",";
+        f += "\n";
+    }
+    f += "  ]\n}\n";
+    return f;
+}
+
+bool ReadTextFile(const std::string& path, std::string& text)
+{
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    text.clear();
+    char buffer[4096];
+    size_t n;
+    while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0) text.append(buffer, n);
+    const bool ok = !std::ferror(f);
+    std::fclose(f);
+    return ok;
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "JoyConDecoder.h"
+#include "ReportPipeline.h"
+
+// Pull reader over a JSON document, one pass and no intermediate copies:
+// keys and strings come back as views into the text (escaped strings are
+// decoded into a buffer the reader reuses), numbers are converted in place.
+// The first malformed token stops it; Failed/Error/Offset say what and where.
+class JsonReader {
+public:
+    enum class Kind { Object, Array, String, Number, Bool, Null, End, Invalid };
+
+    explicit JsonReader(std::string_view text) : text_(text) {}
+
+    // What the next value is, without consuming it.
+    Kind Peek();
+
+    bool BeginObject();
+    // Reads the next key and its colon; false once the closing brace is consumed.
+    bool NextMember(std::string_view& key);
+    bool BeginArray();
+    // False once the closing bracket is consumed.
+    bool NextElement();
+
+    // The view is valid until the next call on the reader.
+    bool ReadString(std::string_view& out);
+    bool ReadNumber(double& out);
+    // Fails on numbers with a fraction or exponent, or outside int64.
+    bool ReadInteger(long long& out);
+    bool ReadBool(bool& out);
+    bool ReadNull();
+    // Skips one whole value, however deeply nested.
+    bool Skip();
+    // True when only whitespace is left.
+    bool AtEnd();
+
+    bool Failed() const { return failed_; }
+    const std::string& Error() const { return error_; }
+    // Where the last token started, or where parsing stopped after a failure.
+    size_t Offset() const { return tokenStart_; }
+    // 1-based line and column of an offset into the text.
+    void Locate(size_t offset, int& line, int& column) const;
+
+    // Set by the caller when the document is well-formed but wrong, so
+    // parsing stops the same way a syntax error does.
+    void Fail(std::string message);
+
+private:
+    static constexpr int kMaxDepth = 32;
+
+    void SkipWhitespace();
+    bool Expect(char c);
+    bool Push();
+    bool ScanString(std::string_view& out, std::string& buffer);
+    bool ScanNumber(std::string_view& token);
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    size_t tokenStart_ = 0;
+    int depth_ = 0;
+    bool first_[kMaxDepth] = {};
+    bool failed_ = false;
+    std::string error_;
+    std::string scratch_;      // decoded strings that had escapes
+    std::string keyScratch_;   // the same for keys, which outlive their value
+};
+
+// Appends s as a quoted JSON string, escaping what needs it.
+void AppendJsonString(std::string& out, std::string_view s);
+std::string JsonQuote(std::string_view s);
+
+// A problem found while loading a config file. Errors reject the document;
+// warnings (unknown keys, truncated names) are reported and loading goes on.
+struct ConfigIssue {
+    int line = 0;
+    int column = 0;
+    bool error = true;
+    std::string message;
+};
+
+struct ConfigDiagnostics {
+    std::vector<ConfigIssue> issues;
+
+    bool HasErrors() const;
+    // "file:line:col: error: message", one per line.
+    std::string Format(const std::string& path) const;
+};
+
+// Names used in the config files for the app's enums.
+const char* ButtonMappingName(ButtonMapping mapping);
+const char* UpdatePolicyName(UpdatePolicy policy);
+const char* ControllerTypeName(ControllerType type);
+
+// joycon2cpp_config.json. Sections missing from the file stay unset, so a
+// file written by an older version leaves the rest of the settings alone.
+struct LayoutConfig {
+    std::string   name = "Layout 1";
+    ButtonMapping glMapping = ButtonMapping::NONE;
+    ButtonMapping grMapping = ButtonMapping::NONE;
+    bool operator==(const LayoutConfig&) const = default;
+};
+
+struct PlayerSetupConfig {
+    ControllerType    controllerType = SingleJoyCon;
+    JoyConSide        joyconSide = JoyConSide::Left;
+    JoyConOrientation joyconOrientation = JoyConOrientation::Upright;
+    GyroSource        gyroSource = GyroSource::Both;
+    GyroMode          gyroMode = GyroMode::Raw;
+    GyroAimOutput     gyroAim = GyroAimOutput::Off;
+    bool operator==(const PlayerSetupConfig&) const = default;
+};
+
+struct PolicyConfig {
+    UpdatePolicy updatePolicy = UpdatePolicy::LowLatency;
+    bool smoothMotionClock = true;
+    bool useControllerCalibration = true;
+    bool connectKnownDevices = true;
+    float mouseSensitivity = 1.0f;    // 0.1 to 10
+    float mouseAcceleration = 0.0f;   // 0 to 4
+    GyroAimTuning gyroAim{};
+    bool skipUnchangedReports = true;
+    int  keepaliveMs = 100;           // 10 to 1000
+    bool operator==(const PolicyConfig&) const = default;
+};
+
+struct AppConfig {
+    static constexpr size_t kMaxLayoutName = 63;
+    static constexpr size_t kMaxPlayers = 4;
+
+    std::vector<LayoutConfig> layouts;
+    int activeLayoutIndex = 0;
+    std::optional<PolicyConfig> policy;
+    std::optional<std::vector<PlayerSetupConfig>> players;
+    bool operator==(const AppConfig&) const = default;
+};
+
+// calibration.json.
+struct CalibrationConfig {
+    std::vector<CalibrationProfile> profiles;
+    int activeIndex = 0;
+};
+
+// Both parsers leave out untouched unless the document is valid.
+bool ParseAppConfig(std::string_view text, AppConfig& out, ConfigDiagnostics& diagnostics);
+std::string SerializeAppConfig(const AppConfig& config);
+
+bool ParseCalibrationConfig(std::string_view text, CalibrationConfig& out, ConfigDiagnostics& diagnostics);
+std::string SerializeCalibrationConfig(const std::vector<CalibrationProfile>& profiles, int activeIndex);
+
+// Whole file into text; false if it cannot be opened.
+bool ReadTextFile(const std::string& path, std::string& text);
@@ -0,0 +1,147 @@
+#include "CoroutineExecutor.h"
+
+Executor::~Executor()
+{
+    Stop();
+}
+
+void Executor::Start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (thread_.joinable()) return;
+    stopping_ = false;
+    thread_ = std::thread([this] {
+        threadId_.store(std::this_thread::get_id());
+        Loop();
+        threadId_.store(std::thread::id{});
+    });
+}
+
+void Executor::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable() && std::this_thread::get_id() != thread_.get_id()) thread_.join();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_.clear();
+    timers_.clear();
+}
+
+void Executor::Post(std::coroutine_handle<> handle)
+{
+    Post(Work([handle] { handle.resume(); }));
+}
+
+void Executor::Post(std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        ready_.push_back(std::move(fn));
+    }
+    cv_.notify_one();
+}
+
+void Executor::PostAt(Clock::time_point when, std::coroutine_handle<> handle)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        timers_.emplace(when, handle);
+    }
+    cv_.notify_one();
+}
+
+// Due timers are moved to the back of the ready queue before anything is
+// taken, so a timer never overtakes work that was posted before it fired.
+bool Executor::TakeLocked(Clock::time_point now, Work& out)
+{
+    while (!timers_.empty() && timers_.begin()->first <= now)
+    {
+        auto h = timers_.begin()->second;
+        timers_.erase(timers_.begin());
+        ready_.push_back([h] { h.resume(); });
+    }
+    if (ready_.empty()) return false;
+    out = std::move(ready_.front());
+    ready_.pop_front();
+    return true;
+}
+
+size_t Executor::RunReady()
+{
+    // Only what is ready at entry runs; work posted meanwhile waits for the
+    // next call, so a coroutine that keeps yielding cannot starve the caller.
+    size_t budget;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget = ready_.size();
+        for (auto it = timers_.begin(); it != timers_.end() && it->first <= Clock::now(); ++it) ++budget;
+    }
+
+    size_t ran = 0;
+    while (ran < budget)
+    {
+        Work work;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!TakeLocked(Clock::now(), work)) break;
+        }
+        work();
+        resumed_.fetch_add(1, std::memory_order_relaxed);
+        ++ran;
+    }
+    return ran;
+}
+
+void Executor::RunUntil(const std::function<bool()>& done)
+{
+    while (!done())
+    {
+        if (RunReady() > 0) continue;
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopping_) return;
+        if (!ready_.empty()) continue;
+        // Completions may be set from other threads; wake up periodically to
+        // re-check done() even when nothing was posted.
+        auto until = Clock::now() + std::chrono::milliseconds(5);
+        if (!timers_.empty() && timers_.begin()->first < until) until = timers_.begin()->first;
+        cv_.wait_until(lock, until);
+    }
+}
+
+bool Executor::OnExecutorThread() const
+{
+    return threadId_.load() == std::this_thread::get_id();
+}
+
+size_t Executor::Pending() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ready_.size() + timers_.size();
+}
+
+void Executor::Loop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        Work work;
+        if (TakeLocked(Clock::now(), work))
+        {
+            lock.unlock();
+            work();
+            resumed_.fetch_add(1, std::memory_order_relaxed);
+            lock.lock();
+            continue;
+        }
+        if (timers_.empty())
+            cv_.wait(lock);
+        else
+            cv_.wait_until(lock, timers_.begin()->first);
+    }
+}
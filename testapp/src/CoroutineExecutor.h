@@ -0,0 +1,353 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Runs coroutines on one thread. Work is resumed in the order it was posted;
+// timed work is resumed once its deadline passes, in deadline order. The
+// executor either owns a thread (Start) or is pumped by the caller
+// (RunReady / RunUntil), which is how its scheduling is exercised off
+// Windows.
+class Executor {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    Executor() = default;
+    ~Executor();
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+    void Start();
+    // Coroutines still suspended on the executor are not resumed again.
+    void Stop();
+
+    void Post(std::coroutine_handle<> handle);
+    void Post(std::function<void()> fn);
+    void PostAt(Clock::time_point when, std::coroutine_handle<> handle);
+
+    // Runs everything that is ready now on the calling thread.
+    size_t RunReady();
+    // Pumps on the calling thread until done() is true.
+    void RunUntil(const std::function<bool()>& done);
+
+    bool     OnExecutorThread() const;
+    size_t   Pending() const;
+    uint64_t Resumed() const { return resumed_.load(std::memory_order_relaxed); }
+
+    struct ScheduleAwaiter {
+        Executor& executor;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { executor.Post(h); }
+        void await_resume() const noexcept {}
+    };
+
+    struct SleepAwaiter {
+        Executor& executor;
+        Clock::time_point when;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h) { executor.PostAt(when, h); }
+        void await_resume() const noexcept {}
+    };
+
+    // Moves the awaiting coroutine onto this executor.
+    ScheduleAwaiter Schedule() { return { *this }; }
+    SleepAwaiter Sleep(Clock::duration delay) { return { *this, Clock::now() + delay }; }
+
+private:
+    using Work = std::function<void()>;
+
+    bool TakeLocked(Clock::time_point now, Work& out);
+    void Loop();
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Work> ready_;
+    std::multimap<Clock::time_point, std::coroutine_handle<>> timers_;
+    std::thread thread_;
+    std::atomic<std::thread::id> threadId_{};
+    std::atomic<uint64_t> resumed_{ 0 };
+    bool stopping_ = false;
+};
+
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            auto next = h.promise().continuation;
+            return next ? next : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct PromiseBase {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr      error;
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    // Fire-and-forget frame used to start a Task; frees itself when done.
+    struct Detached {
+        struct promise_type {
+            Detached get_return_object() const noexcept { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() const noexcept {}
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+    };
+}
+
+// Lazily started coroutine. Awaiting a Task starts it and resumes the awaiter
+// on whichever thread the Task finishes on; results and exceptions pass
+// through co_await.
+template <typename T>
+class Task {
+public:
+    struct promise_type : detail::PromiseBase {
+        std::optional<T> value;
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        template <typename U>
+        void return_value(U&& v) { value.emplace(std::forward<U>(v)); }
+    };
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ~Task() { if (handle_) handle_.destroy(); }
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    T await_resume()
+    {
+        auto& p = handle_.promise();
+        if (p.error) std::rethrow_exception(p.error);
+        return std::move(*p.value);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+    std::coroutine_handle<promise_type> handle_;
+};
+
+template <>
+class Task<void> {
+public:
+    struct promise_type : detail::PromiseBase {
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        void return_void() const noexcept {}
+    };
+
+    Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle_) handle_.destroy();
+            handle_ = std::exchange(other.handle_, {});
+        }
+        return *this;
+    }
+    ~Task() { if (handle_) handle_.destroy(); }
+
+    bool await_ready() const noexcept { return !handle_ || handle_.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+    {
+        handle_.promise().continuation = awaiting;
+        return handle_;
+    }
+    void await_resume()
+    {
+        if (handle_.promise().error) std::rethrow_exception(handle_.promise().error);
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// One-shot result that can be set from any thread, typically a completion
+// callback. The coroutine awaiting it is resumed on the executor.
+template <typename T>
+class Completion {
+public:
+    explicit Completion(Executor& executor) : state_(std::make_shared<State>(executor)) {}
+
+    // The first Set wins; later ones are ignored and return false.
+    bool Set(T value) const
+    {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> lock(state_->mutex);
+            if (state_->value) return false;
+            state_->value.emplace(std::move(value));
+            waiter = std::exchange(state_->waiter, {});
+        }
+        if (waiter) state_->executor.Post(waiter);
+        return true;
+    }
+
+    bool IsSet() const
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        return state_->value.has_value();
+    }
+
+    auto operator co_await() const
+    {
+        struct Awaiter {
+            std::shared_ptr<typename Completion::State> state;
+            bool await_ready() const
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                return state->value.has_value();
+            }
+            bool await_suspend(std::coroutine_handle<> h) const
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (state->value) return false;
+                state->waiter = h;
+                return true;
+            }
+            T await_resume() const
+            {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                return std::move(*state->value);
+            }
+        };
+        return Awaiter{ state_ };
+    }
+
+private:
+    struct State {
+        explicit State(Executor& e) : executor(e) {}
+        Executor&               executor;
+        std::mutex              mutex;
+        std::optional<T>        value;
+        std::coroutine_handle<> waiter;
+    };
+    std::shared_ptr<State> state_;
+};
+
+// Starts task on the executor and reports its result through onDone, on the
+// executor thread. exception_ptr is null on success.
+template <typename T>
+void Spawn(Executor& executor, Task<T> task, std::function<void(std::optional<T>, std::exception_ptr)> onDone)
+{
+    [](Executor& ex, Task<T> t, std::function<void(std::optional<T>, std::exception_ptr)> done) -> detail::Detached {
+        co_await ex.Schedule();
+        std::optional<T> result;
+        std::exception_ptr error;
+        try { result.emplace(co_await t); } catch (...) { error = std::current_exception(); }
+        if (done) done(std::move(result), error);
+    }(executor, std::move(task), std::move(onDone));
+}
+
+inline void Spawn(Executor& executor, Task<void> task, std::function<void(std::exception_ptr)> onDone = nullptr)
+{
+    [](Executor& ex, Task<void> t, std::function<void(std::exception_ptr)> done) -> detail::Detached {
+        co_await ex.Schedule();
+        std::exception_ptr error;
+        try { co_await t; } catch (...) { error = std::current_exception(); }
+        if (done) done(error);
+    }(executor, std::move(task), std::move(onDone));
+}
+
+// Bridges into blocking code. Must not be called on the executor's own
+// thread, which would then never get to run the task.
+template <typename T>
+std::future<T> SpawnFuture(Executor& executor, Task<T> task)
+{
+    auto promise = std::make_shared<std::promise<T>>();
+    auto future = promise->get_future();
+    if constexpr (std::is_void_v<T>)
+    {
+        Spawn(executor, std::move(task), [promise](std::exception_ptr error) {
+            if (error) promise->set_exception(error); else promise->set_value();
+        });
+    }
+    else
+    {
+        Spawn<T>(executor, std::move(task), [promise](std::optional<T> value, std::exception_ptr error) {
+            if (error) promise->set_exception(error); else promise->set_value(std::move(*value));
+        });
+    }
+    return future;
+}
+
+// Runs every task concurrently on the executor and resumes once all of them
+// have finished. Results keep the order of the input; the first exception
+// is rethrown after all tasks are done.
+template <typename T>
+Task<std::vector<T>> WhenAll(Executor& executor, std::vector<Task<T>> tasks)
+{
+    struct Shared {
+        std::mutex                    mutex;
+        std::vector<std::optional<T>> results;
+        std::exception_ptr            error;
+        size_t                        remaining = 0;
+    };
+    auto shared = std::make_shared<Shared>();
+    shared->results.resize(tasks.size());
+    shared->remaining = tasks.size();
+    Completion<bool> all(executor);
+    if (tasks.empty()) all.Set(true);
+
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        Spawn<T>(executor, std::move(tasks[i]), [shared, all, i](std::optional<T> value, std::exception_ptr error) {
+            bool last = false;
+            {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                if (error && !shared->error) shared->error = error;
+                shared->results[i] = std::move(value);
+                last = --shared->remaining == 0;
+            }
+            if (last) all.Set(true);
+        });
+    }
+
+    co_await all;
+    if (shared->error) std::rethrow_exception(shared->error);
+    std::vector<T> out;
+    out.reserve(shared->results.size());
+    for (auto& r : shared->results) out.push_back(std::move(*r));
+    co_return out;
+}
@@ -0,0 +1,127 @@
+#include "DeviceRegistry.h"
+#include "Persistence.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    constexpr const char* kHeader = "# joycon2cpp known devices v1";
+
+    bool SameAssignment(const KnownDevice& a, const KnownDevice& b)
+    {
+        return a.player == b.player && a.controllerType == b.controllerType && a.side == b.side;
+    }
+}
+
+DeviceRegistry::DeviceRegistry(std::string path)
+    : path_(std::move(path))
+{
+}
+
+bool DeviceRegistry::Load()
+{
+    std::ifstream f(path_);
+    if (!f.is_open()) return false;
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return Parse(ss.str());
+}
+
+bool DeviceRegistry::Save() const
+{
+    std::lock_guard<std::mutex> lock(saveMutex_);
+    return WriteFileAtomically(path_, Serialize());
+}
+
+// Format:
+//   # joycon2cpp known devices v1
+//   device <player> <controller type> <L|R> <address hex> <product id hex>
+// Malformed lines are skipped on their own.
+bool DeviceRegistry::Parse(const std::string& text)
+{
+    std::istringstream in(text);
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line != kHeader) return false;
+
+    std::vector<KnownDevice> parsed;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream ls(line);
+        std::string kind, side;
+        if (!(ls >> kind) || kind[0] == '#' || kind != "device") continue;
+
+        KnownDevice d;
+        unsigned long long address = 0;
+        unsigned pid = 0;
+        if (!(ls >> std::dec >> d.player >> d.controllerType >> side >> std::hex >> address >> pid)) continue;
+        if (d.player < 0 || address == 0 || pid > 0xFFFF || (side != "L" && side != "R")) continue;
+        d.side = side == "L" ? JoyConSide::Left : JoyConSide::Right;
+        d.address = address;
+        d.productId = static_cast<uint16_t>(pid);
+        parsed.push_back(d);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    devices_ = std::move(parsed);
+    return true;
+}
+
+std::string DeviceRegistry::Serialize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out = kHeader;
+    out += '\n';
+    char buf[96];
+    for (const auto& d : devices_)
+    {
+        std::snprintf(buf, sizeof(buf), "device %d %d %c %012llx %04x\n",
+            d.player, d.controllerType, d.side == JoyConSide::Left ? 'L' : 'R',
+            static_cast<unsigned long long>(d.address), static_cast<unsigned>(d.productId));
+        out += buf;
+    }
+    return out;
+}
+
+bool DeviceRegistry::Find(int player, int controllerType, JoyConSide side, KnownDevice& out) const
+{
+    KnownDevice key;
+    key.player = player;
+    key.controllerType = controllerType;
+    key.side = side;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& d : devices_)
+    {
+        if (!SameAssignment(d, key)) continue;
+        out = d;
+        return true;
+    }
+    return false;
+}
+
+void DeviceRegistry::Remember(const KnownDevice& device)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    devices_.erase(std::remove_if(devices_.begin(), devices_.end(), [&](const KnownDevice& d) {
+        return SameAssignment(d, device) || d.address == device.address;
+    }), devices_.end());
+    devices_.push_back(device);
+}
+
+void DeviceRegistry::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    devices_.clear();
+}
+
+std::vector<KnownDevice> DeviceRegistry::All() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return devices_;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "JoyConDecoder.h"
+
+// A controller that has been paired to a player before. controllerType holds
+// the app's ControllerType value; side tells the two halves of a dual Joy-Con
+// player apart and is Left for single-stick controllers.
+struct KnownDevice {
+    int        player = 0;
+    int        controllerType = 0;
+    JoyConSide side = JoyConSide::Left;
+    uint64_t   address = 0;
+    uint16_t   productId = 0;
+};
+
+// Remembered player-to-controller assignments, so a session can open known
+// controllers by address instead of scanning for their advertisements.
+class DeviceRegistry {
+public:
+    explicit DeviceRegistry(std::string path);
+
+    bool Load();
+    bool Save() const;
+
+    bool Parse(const std::string& text);
+    std::string Serialize() const;
+
+    bool Find(int player, int controllerType, JoyConSide side, KnownDevice& out) const;
+    // Replaces whatever was remembered for the same player/type/side, and
+    // drops the address from any other assignment.
+    void Remember(const KnownDevice& device);
+    void Clear();
+    std::vector<KnownDevice> All() const;
+
+private:
+    std::string path_;
+    mutable std::mutex mutex_;
+    mutable std::mutex saveMutex_;
+    std::vector<KnownDevice> devices_;
+};
@@ -1,8 +1,15 @@
+#ifdef _WIN32
 #ifndef NOMINMAX
 #define NOMINMAX
 #endif
 #include <winsock2.h>
 #include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
 
 #include "DsuServer.h"
 
@@ -15,6 +22,16 @@
 #include <vector>
 #include <ViGEm/Common.h>
 
+#ifndef _WIN32
+using SOCKET = int;
+using socklen_type = socklen_t;
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+inline int closesocket(SOCKET s) { return ::close(s); }
+#else
+using socklen_type = int;
+#endif
+
 namespace {
 constexpr uint16_t kProtocolVersion = 1001;
 constexpr uint32_t kMsgVersion = 0x100000;
@@ -203,19 +220,25 @@ std::vector<uint8_t> BuildDataPacket(uint32_t serverId, uint8_t slot, DsuServer:
     out.push_back(report.bTriggerL);
 
     out.insert(out.end(), 12, 0);
-    WriteU64(out, NowMicros());
-    WriteFloat(out, report.wAccelX / 4096.0f);
-    WriteFloat(out, report.wAccelY / 4096.0f);
-    WriteFloat(out, report.wAccelZ / 4096.0f);
-    WriteFloat(out, report.wGyroX * 360.0f / 48000.0f);
-    WriteFloat(out, report.wGyroY * 360.0f / 48000.0f);
-    WriteFloat(out, report.wGyroZ * 360.0f / 48000.0f);
+    const auto& motion = state.motion;
+    WriteU64(out, motion.timestampUs != 0 ? motion.timestampUs : NowMicros());
+    WriteFloat(out, motion.accelX);
+    WriteFloat(out, motion.accelY);
+    WriteFloat(out, motion.accelZ);
+    WriteFloat(out, motion.gyroX);
+    WriteFloat(out, motion.gyroY);
+    WriteFloat(out, motion.gyroZ);
 
     FinalizePacket(out);
     return out;
 }
 }
 
+std::vector<uint8_t> DsuServer::EncodeDataPacket(uint32_t serverId, uint8_t slot, const ControllerState& state)
+{
+    return BuildDataPacket(serverId, slot, state);
+}
+
 DsuServer::DsuServer()
 {
     std::random_device rd;
@@ -233,14 +256,18 @@ bool DsuServer::Start(uint16_t port)
         return true;
     }
 
+#ifdef _WIN32
     WSADATA wsaData{};
     if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0) {
         return false;
     }
+#endif
 
     SOCKET sock = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
     if (sock == INVALID_SOCKET) {
+#ifdef _WIN32
         WSACleanup();
+#endif
         return false;
     }
 
@@ -251,7 +278,9 @@ bool DsuServer::Start(uint16_t port)
 
     if (bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == SOCKET_ERROR) {
         closesocket(sock);
+#ifdef _WIN32
         WSACleanup();
+#endif
         return false;
     }
 
@@ -261,7 +290,7 @@ bool DsuServer::Start(uint16_t port)
         std::array<uint8_t, 1024> buffer{};
         while (running_.load()) {
             sockaddr_in client{};
-            int clientLen = sizeof(client);
+            socklen_type clientLen = sizeof(client);
             const int received = recvfrom(static_cast<SOCKET>(socket_), reinterpret_cast<char*>(buffer.data()), static_cast<int>(buffer.size()), 0, reinterpret_cast<sockaddr*>(&client), &clientLen);
             if (received < 20) {
                 continue;
@@ -341,6 +370,10 @@ void DsuServer::Stop()
     }
 
     if (socket_ != ~uintptr_t{ 0 }) {
+#ifndef _WIN32
+        // Closing a socket does not wake a blocked recvfrom() on POSIX.
+        ::shutdown(static_cast<SOCKET>(socket_), SHUT_RDWR);
+#endif
         closesocket(static_cast<SOCKET>(socket_));
         socket_ = ~uintptr_t{ 0 };
     }
@@ -349,7 +382,9 @@ void DsuServer::Stop()
         serverThread_.join();
     }
 
+#ifdef _WIN32
     WSACleanup();
+#endif
 }
 
 bool DsuServer::IsRunning() const
@@ -370,7 +405,7 @@ void DsuServer::SetControllerConnected(uint8_t slot, bool connected)
     }
 }
 
-void DsuServer::UpdateController(uint8_t slot, const DS4_REPORT_EX& report, bool connected)
+void DsuServer::UpdateController(uint8_t slot, const DS4_REPORT_EX& report, const MotionSample& motion, bool connected)
 {
     if (slot >= controllers_.size()) {
         return;
@@ -381,6 +416,7 @@ void DsuServer::UpdateController(uint8_t slot, const DS4_REPORT_EX& report, bool
         std::lock_guard<std::mutex> lock(controllersMutex_);
         auto& state = controllers_[slot];
         state.report = report;
+        state.motion = motion;
         state.connected = connected;
         ++state.packetCounter;
         snapshot = state;
@@ -5,7 +5,11 @@
 #include <cstdint>
 #include <mutex>
 #include <thread>
-#include <ViGEm/Client.h>
+#include <vector>
+#include <Windows.h>
+#include <ViGEm/Common.h>
+
+#include "JoyConDecoder.h"
 
 class DsuServer {
 public:
@@ -20,14 +24,19 @@ public:
     bool IsRunning() const;
 
     void SetControllerConnected(uint8_t slot, bool connected = true);
-    void UpdateController(uint8_t slot, const DS4_REPORT_EX& report, bool connected = true);
+    void UpdateController(uint8_t slot, const DS4_REPORT_EX& report, const MotionSample& motion, bool connected = true);
 
     struct ControllerState {
         DS4_REPORT_EX report{};
+        MotionSample motion{};
         bool connected = false;
         uint32_t packetCounter = 0;
     };
 
+    // The controller data packet sent for a slot, CRC included; what every
+    // UpdateController to a subscribed client costs on the wire side.
+    static std::vector<uint8_t> EncodeDataPacket(uint32_t serverId, uint8_t slot, const ControllerState& state);
+
 private:
     struct ClientEndpoint {
         std::array<uint8_t, 32> address{};
@@ -0,0 +1,246 @@
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "FileWatcher.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+
+namespace
+{
+    void AddName(std::vector<std::string>& names, std::string name)
+    {
+        if (std::find(names.begin(), names.end(), name) == names.end()) names.push_back(std::move(name));
+    }
+
+#ifdef _WIN32
+    std::string Utf8(const wchar_t* text, int length)
+    {
+        const int n = WideCharToMultiByte(CP_UTF8, 0, text, length, nullptr, 0, nullptr, nullptr);
+        std::string out(static_cast<size_t>(std::max(n, 0)), '\0');
+        if (n > 0) WideCharToMultiByte(CP_UTF8, 0, text, length, out.data(), n, nullptr, nullptr);
+        return out;
+    }
+#endif
+}
+
+FileWatcher::FileWatcher(std::chrono::milliseconds settle)
+    : settle_(settle)
+{
+}
+
+FileWatcher::~FileWatcher()
+{
+    Stop();
+}
+
+const char* FileWatcher::Backend()
+{
+#ifdef _WIN32
+    return "ReadDirectoryChangesW";
+#elif defined(__linux__)
+    return "inotify";
+#else
+    return "polling";
+#endif
+}
+
+bool FileWatcher::Start(const std::string& directory, ChangeFn onChange)
+{
+    if (running_.load()) return false;
+    directory_ = directory.empty() ? "." : directory;
+    onChange_ = std::move(onChange);
+    stop_.store(false);
+
+#ifdef _WIN32
+    const std::wstring wide = std::filesystem::path(directory_).wstring();
+    HANDLE dir = CreateFileW(wide.c_str(), FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (dir == INVALID_HANDLE_VALUE) return false;
+    HANDLE stopEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (!stopEvent) {
+        CloseHandle(dir);
+        return false;
+    }
+    dirHandle_ = dir;
+    stopEvent_ = stopEvent;
+#elif defined(__linux__)
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) return false;
+    // Atomic saves show up as IN_MOVED_TO, editors writing in place as
+    // IN_CLOSE_WRITE.
+    if (inotify_add_watch(inotifyFd_, directory_.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+        pipe2(wakeFds_, O_NONBLOCK | O_CLOEXEC) != 0) {
+        close(inotifyFd_);
+        inotifyFd_ = -1;
+        return false;
+    }
+#else
+    std::error_code ec;
+    if (!std::filesystem::is_directory(directory_, ec)) return false;
+#endif
+
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread([this] { Run(); });
+    return true;
+}
+
+void FileWatcher::Stop()
+{
+    if (!running_.load()) return;
+    stop_.store(true);
+#ifdef _WIN32
+    SetEvent(static_cast<HANDLE>(stopEvent_));
+#elif defined(__linux__)
+    const char wake = 1;
+    (void)!write(wakeFds_[1], &wake, 1);
+#endif
+    if (thread_.joinable()) thread_.join();
+
+#ifdef _WIN32
+    CloseHandle(static_cast<HANDLE>(dirHandle_));
+    CloseHandle(static_cast<HANDLE>(stopEvent_));
+    dirHandle_ = stopEvent_ = nullptr;
+#elif defined(__linux__)
+    close(inotifyFd_);
+    close(wakeFds_[0]);
+    close(wakeFds_[1]);
+    inotifyFd_ = wakeFds_[0] = wakeFds_[1] = -1;
+#endif
+    running_.store(false, std::memory_order_release);
+}
+
+#ifdef _WIN32
+void FileWatcher::Run()
+{
+    HANDLE dir = static_cast<HANDLE>(dirHandle_);
+    HANDLE stopEvent = static_cast<HANDLE>(stopEvent_);
+    OVERLAPPED ov{};
+    ov.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    alignas(DWORD) BYTE buffer[16 * 1024];
+    std::vector<std::string> pending;
+    bool reading = false;
+
+    while (!stop_.load()) {
+        // One read stays outstanding across settle timeouts; the system
+        // queues changes between reads on the same handle.
+        if (!reading) {
+            ResetEvent(ov.hEvent);
+            if (!ReadDirectoryChangesW(dir, buffer, sizeof(buffer), FALSE,
+                    FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE,
+                    nullptr, &ov, nullptr))
+                break;
+            reading = true;
+        }
+
+        // Wait for a change; with changes pending, only for the settle time.
+        const HANDLE handles[2] = { ov.hEvent, stopEvent };
+        const DWORD timeout = pending.empty() ? INFINITE : static_cast<DWORD>(settle_.count());
+        const DWORD wait = WaitForMultipleObjects(2, handles, FALSE, timeout);
+        if (wait == WAIT_TIMEOUT) {
+            onChange_(pending);
+            pending.clear();
+            continue;
+        }
+        if (wait != WAIT_OBJECT_0) break;
+        reading = false;
+
+        DWORD bytes = 0;
+        if (!GetOverlappedResult(dir, &ov, &bytes, FALSE)) break;
+        if (bytes == 0) continue;   // the buffer overflowed; nothing to name
+        for (size_t offset = 0;;) {
+            const auto* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(buffer + offset);
+            if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED ||
+                info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+                AddName(pending, Utf8(info->FileName, static_cast<int>(info->FileNameLength / sizeof(WCHAR))));
+            if (info->NextEntryOffset == 0) break;
+            offset += info->NextEntryOffset;
+        }
+    }
+    if (reading) {
+        CancelIoEx(dir, &ov);
+        DWORD ignored = 0;
+        GetOverlappedResult(dir, &ov, &ignored, TRUE);
+    }
+    CloseHandle(ov.hEvent);
+}
+#elif defined(__linux__)
+void FileWatcher::Run()
+{
+    alignas(inotify_event) char buffer[16 * 1024];
+    std::vector<std::string> pending;
+
+    while (!stop_.load()) {
+        pollfd fds[2] = { { inotifyFd_, POLLIN, 0 }, { wakeFds_[0], POLLIN, 0 } };
+        const int timeout = pending.empty() ? -1 : static_cast<int>(settle_.count());
+        const int ready = poll(fds, 2, timeout);
+        if (ready < 0) continue;   // EINTR
+        if (fds[1].revents) break;
+        if (ready == 0) {
+            onChange_(pending);
+            pending.clear();
+            continue;
+        }
+
+        for (;;) {
+            const ssize_t n = read(inotifyFd_, buffer, sizeof(buffer));
+            if (n <= 0) break;
+            for (ssize_t offset = 0; offset < n;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+                if (event->len > 0) AddName(pending, event->name);
+                offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+            }
+        }
+    }
+}
+#else
+void FileWatcher::Run()
+{
+    // Size and modification time of every file, compared every settle period.
+    using Stamp = std::pair<std::uintmax_t, std::filesystem::file_time_type>;
+    auto scan = [this] {
+        std::map<std::string, Stamp> files;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(directory_, ec)) {
+            if (!entry.is_regular_file(ec)) continue;
+            files[entry.path().filename().string()] = { entry.file_size(ec), entry.last_write_time(ec) };
+        }
+        return files;
+    };
+
+    auto known = scan();
+    std::vector<std::string> pending;
+    const auto period = std::max(settle_, std::chrono::milliseconds(250));
+    while (!stop_.load()) {
+        std::this_thread::sleep_for(period);
+        auto now = scan();
+        bool changed = false;
+        for (const auto& [name, stamp] : now) {
+            auto it = known.find(name);
+            if (it != known.end() && it->second == stamp) continue;
+            AddName(pending, name);
+            changed = true;
+        }
+        known = std::move(now);
+        if (!changed && !pending.empty()) {
+            onChange_(pending);
+            pending.clear();
+        }
+    }
+}
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Watches one directory and reports files in it that were written, created
+// or renamed into place. Editors save in several steps (truncate and write,
+// or write a temp file and rename it), so changes are gathered until the
+// directory has been quiet for the settle time and then delivered together,
+// each name once. The callback runs on the watcher's own thread.
+//
+// inotify on Linux, ReadDirectoryChangesW on Windows; elsewhere the
+// directory is polled.
+class FileWatcher {
+public:
+    // Names are relative to the watched directory.
+    using ChangeFn = std::function<void(const std::vector<std::string>& names)>;
+
+    explicit FileWatcher(std::chrono::milliseconds settle = std::chrono::milliseconds(100));
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool Start(const std::string& directory, ChangeFn onChange);
+    void Stop();
+    bool Running() const { return running_.load(std::memory_order_acquire); }
+
+    // "inotify", "ReadDirectoryChangesW" or "polling".
+    static const char* Backend();
+
+private:
+    void Run();
+
+    std::chrono::milliseconds settle_;
+    std::string directory_;
+    ChangeFn onChange_;
+    std::thread thread_;
+    std::atomic<bool> running_{ false };
+    std::atomic<bool> stop_{ false };
+
+#ifdef _WIN32
+    void* dirHandle_ = nullptr;
+    void* stopEvent_ = nullptr;
+#elif defined(__linux__)
+    int inotifyFd_ = -1;
+    int wakeFds_[2] = { -1, -1 };
+#endif
+};
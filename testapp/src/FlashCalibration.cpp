@@ -0,0 +1,372 @@
+#include "FlashCalibration.h"
+#include "Persistence.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    constexpr const char* kHeader = "# joycon2cpp flash calibration v1";
+
+    // Reply layout: 8 byte response header, then [len, 0x7E, 0, 0, addr LE32].
+    constexpr size_t  kReplyEchoOffset = 8;
+    constexpr size_t  kReplyDataOffset = 16;
+    constexpr uint8_t kFlashReadMarker = 0x7E;
+
+    // Command layout: [cmd, 0x91, transport, sub, 0, len, 0, 0] then the same
+    // [len, 0x7E, 0, 0, addr LE32] block the reply echoes.
+    constexpr size_t kCommandBodyOffset = 8;
+
+    constexpr size_t   kStickRecordSize = 9;
+    constexpr size_t   kUserMagicSize = 2;
+    constexpr uint8_t  kUserMagic[kUserMagicSize] = { 0xB2, 0xA1 };
+    constexpr size_t   kImuRecordSize = 6;
+
+    // Anything outside these ranges is an erased or foreign record rather
+    // than a stick: centers sit near mid-scale and each half-range covers a
+    // decent share of the 12-bit span.
+    constexpr int kMinCenter = 1024;
+    constexpr int kMaxCenter = 3072;
+    constexpr int kMinDelta  = 256;
+    constexpr int kMaxDelta  = 2047;
+
+    // Gyro offsets beyond this many counts (~7.5 deg/s) are not a resting bias.
+    constexpr int kMaxGyroBias = 1000;
+
+    uint32_t ReadU32LE(const uint8_t* p)
+    {
+        return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+               static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+    }
+
+    int16_t ReadS16LE(const uint8_t* p)
+    {
+        return static_cast<int16_t>(p[0] | p[1] << 8);
+    }
+
+    bool AllBytes(const uint8_t* p, size_t n, uint8_t value)
+    {
+        for (size_t i = 0; i < n; ++i)
+            if (p[i] != value) return false;
+        return true;
+    }
+
+    bool HasUserMagic(const uint8_t* p)
+    {
+        return p[0] == kUserMagic[0] && p[1] == kUserMagic[1];
+    }
+
+    void AppendStick(std::string& out, const char* side, bool fromUser, const StickCalibration& c)
+    {
+        char buf[96];
+        std::snprintf(buf, sizeof(buf), "stick %s %d %d %d %d %d %d %d\n",
+            side, fromUser ? 1 : 0, c.centerX, c.centerY, c.minX, c.maxX, c.minY, c.maxY);
+        out += buf;
+    }
+
+    bool ParseStick(std::istringstream& ls, bool& fromUser, StickCalibration& c)
+    {
+        int user = 0;
+        if (!(ls >> user >> c.centerX >> c.centerY >> c.minX >> c.maxX >> c.minY >> c.maxY)) return false;
+        fromUser = user != 0;
+        return c.minX < c.centerX && c.centerX < c.maxX && c.minY < c.centerY && c.centerY < c.maxY;
+    }
+}
+
+bool ParseFlashReadReply(const uint8_t* reply, size_t size, FlashRead& out)
+{
+    if (!reply || size < kReplyDataOffset) return false;
+    if (reply[0] != FLASH_READ_CMD || reply[3] != FLASH_READ_SUB) return false;
+
+    const uint8_t* echo = reply + kReplyEchoOffset;
+    if (echo[1] != kFlashReadMarker) return false;
+
+    const size_t length = echo[0];
+    if (size < kReplyDataOffset + length) return false;
+
+    out.address = ReadU32LE(echo + 4);
+    out.data.assign(reply + kReplyDataOffset, reply + kReplyDataOffset + length);
+    return true;
+}
+
+// Six 12-bit values packed into 9 bytes, two per 3 bytes:
+// center X/Y, then the distance to the max edge, then to the min edge.
+bool DecodeStickCalibration(const uint8_t* packed, StickCalibration& out)
+{
+    if (!packed) return false;
+    if (AllBytes(packed, kStickRecordSize, 0xFF) || AllBytes(packed, kStickRecordSize, 0x00)) return false;
+
+    int v[6];
+    for (int i = 0; i < 3; ++i)
+    {
+        const uint8_t* p = packed + i * 3;
+        v[i * 2]     = p[0] | (p[1] & 0x0F) << 8;
+        v[i * 2 + 1] = p[1] >> 4 | p[2] << 4;
+    }
+
+    const int centerX = v[0], centerY = v[1];
+    const int maxDX = v[2], maxDY = v[3];
+    const int minDX = v[4], minDY = v[5];
+
+    auto centerOk = [](int c) { return c >= kMinCenter && c <= kMaxCenter; };
+    auto deltaOk  = [](int d) { return d >= kMinDelta && d <= kMaxDelta; };
+    if (!centerOk(centerX) || !centerOk(centerY)) return false;
+    if (!deltaOk(maxDX) || !deltaOk(maxDY) || !deltaOk(minDX) || !deltaOk(minDY)) return false;
+
+    out.centerX = centerX;
+    out.centerY = centerY;
+    out.minX = centerX - minDX;
+    out.maxX = centerX + maxDX;
+    out.minY = centerY - minDY;
+    out.maxY = centerY + maxDY;
+    return true;
+}
+
+void DeviceCalibration::ApplyTo(CalibrationProfile& profile) const
+{
+    if (hasLeftStick) profile.leftStick = leftStick;
+    if (hasRightStick) profile.rightStick = rightStick;
+}
+
+void DeviceCalibration::ApplyTo(MotionScale& scale) const
+{
+    if (!hasGyroBias) return;
+    scale.gyroBiasX = gyroBiasX;
+    scale.gyroBiasY = gyroBiasY;
+    scale.gyroBiasZ = gyroBiasZ;
+}
+
+FlashCalibrationReader::FlashCalibrationReader(FlashStickLayout layout)
+    : layout_(layout)
+{
+}
+
+bool FlashCalibrationReader::Feed(const uint8_t* reply, size_t size)
+{
+    FlashRead read;
+    if (!ParseFlashReadReply(reply, size, read)) return false;
+    Feed(read);
+    return true;
+}
+
+void FlashCalibrationReader::Feed(const FlashRead& read)
+{
+    if (read.data.empty()) return;
+    blocks_[read.address] = read.data;
+}
+
+bool FlashCalibrationReader::Bytes(uint32_t address, size_t count, const uint8_t*& out) const
+{
+    // Blocks never overlap in the init scripts, so the one starting at or
+    // before address is the only candidate.
+    auto it = blocks_.upper_bound(address);
+    if (it == blocks_.begin()) return false;
+    --it;
+    const uint32_t offset = address - it->first;
+    if (offset + count > it->second.size()) return false;
+    out = it->second.data() + offset;
+    return true;
+}
+
+bool FlashCalibrationReader::ReadStick(uint32_t factory, uint32_t user, StickCalibration& out, bool& fromUser) const
+{
+    const uint8_t* p = nullptr;
+    if (Bytes(user, kUserMagicSize + kStickRecordSize, p) && HasUserMagic(p) &&
+        DecodeStickCalibration(p + kUserMagicSize, out))
+    {
+        fromUser = true;
+        return true;
+    }
+
+    fromUser = false;
+    return Bytes(factory, kStickRecordSize, p) && DecodeStickCalibration(p, out);
+}
+
+DeviceCalibration FlashCalibrationReader::Result() const
+{
+    DeviceCalibration result;
+
+    switch (layout_)
+    {
+    case FlashStickLayout::LeftOnly:
+        result.hasLeftStick = ReadStick(FLASH_FACTORY_PRIMARY_STICK, FLASH_USER_PRIMARY_STICK,
+                                        result.leftStick, result.leftFromUser);
+        break;
+    case FlashStickLayout::RightOnly:
+        result.hasRightStick = ReadStick(FLASH_FACTORY_PRIMARY_STICK, FLASH_USER_PRIMARY_STICK,
+                                         result.rightStick, result.rightFromUser);
+        break;
+    case FlashStickLayout::Both:
+        result.hasLeftStick = ReadStick(FLASH_FACTORY_PRIMARY_STICK, FLASH_USER_PRIMARY_STICK,
+                                        result.leftStick, result.leftFromUser);
+        result.hasRightStick = ReadStick(FLASH_FACTORY_SECONDARY_STICK, FLASH_USER_SECONDARY_STICK,
+                                         result.rightStick, result.rightFromUser);
+        break;
+    }
+
+    const uint8_t* imu = nullptr;
+    if (Bytes(FLASH_IMU_CALIBRATION, kImuRecordSize, imu) && !AllBytes(imu, kImuRecordSize, 0xFF))
+    {
+        const int gx = ReadS16LE(imu), gy = ReadS16LE(imu + 2), gz = ReadS16LE(imu + 4);
+        auto plausible = [](int v) { return v >= -kMaxGyroBias && v <= kMaxGyroBias; };
+        if (plausible(gx) && plausible(gy) && plausible(gz))
+        {
+            result.hasGyroBias = true;
+            result.gyroBiasX = static_cast<float>(gx);
+            result.gyroBiasY = static_cast<float>(gy);
+            result.gyroBiasZ = static_cast<float>(gz);
+        }
+    }
+
+    return result;
+}
+
+void FakeFlashImage::Write(uint32_t address, const std::vector<uint8_t>& bytes)
+{
+    for (size_t i = 0; i < bytes.size(); ++i)
+        bytes_[address + static_cast<uint32_t>(i)] = bytes[i];
+}
+
+std::vector<uint8_t> FakeFlashImage::Reply(const uint8_t* command, size_t size) const
+{
+    if (!command || size < kCommandBodyOffset + 8) return {};
+    if (command[0] != FLASH_READ_CMD || command[3] != FLASH_READ_SUB) return {};
+
+    const uint8_t* body = command + kCommandBodyOffset;
+    const uint8_t length = body[0];
+    const uint32_t address = ReadU32LE(body + 4);
+
+    std::vector<uint8_t> out(body, body + 8);
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        auto it = bytes_.find(address + i);
+        out.push_back(it != bytes_.end() ? it->second : 0xFF);
+    }
+    return out;
+}
+
+FlashCalibrationCache::FlashCalibrationCache(std::string path)
+    : path_(std::move(path))
+{
+}
+
+bool FlashCalibrationCache::Load()
+{
+    std::ifstream f(path_);
+    if (!f.is_open()) return false;
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return Parse(ss.str());
+}
+
+bool FlashCalibrationCache::Save() const
+{
+    std::lock_guard<std::mutex> lock(saveMutex_);
+    return WriteFileAtomically(path_, Serialize());
+}
+
+// Format:
+//   # joycon2cpp flash calibration v1
+//   device <address hex>
+//   stick <left|right> <from user 0|1> <cx> <cy> <minX> <maxX> <minY> <maxY>
+//   gyro <bias x> <bias y> <bias z>
+//   end
+bool FlashCalibrationCache::Parse(const std::string& text)
+{
+    std::istringstream in(text);
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line != kHeader) return false;
+
+    std::unordered_map<uint64_t, DeviceCalibration> parsed;
+    DeviceCalibration current;
+    uint64_t address = 0;
+    bool inDevice = false;
+    bool broken = false;
+
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream ls(line);
+        std::string kind;
+        if (!(ls >> kind) || kind[0] == '#') continue;
+
+        if (kind == "device")
+        {
+            current = {};
+            broken = false;
+            inDevice = true;
+            unsigned long long a = 0;
+            if (!(ls >> std::hex >> a)) broken = true;
+            address = a;
+        }
+        else if (kind == "stick" && inDevice)
+        {
+            std::string side;
+            ls >> side;
+            if (side == "left")
+                current.hasLeftStick = ParseStick(ls, current.leftFromUser, current.leftStick);
+            else if (side == "right")
+                current.hasRightStick = ParseStick(ls, current.rightFromUser, current.rightStick);
+            else
+                broken = true;
+        }
+        else if (kind == "gyro" && inDevice)
+        {
+            if (ls >> current.gyroBiasX >> current.gyroBiasY >> current.gyroBiasZ)
+                current.hasGyroBias = true;
+            else
+                broken = true;
+        }
+        else if (kind == "end" && inDevice)
+        {
+            if (!broken && current.Any())
+                parsed[address] = current;
+            inDevice = false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_ = std::move(parsed);
+    return true;
+}
+
+std::string FlashCalibrationCache::Serialize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out = kHeader;
+    out += '\n';
+    char buf[96];
+    for (const auto& [address, c] : entries_)
+    {
+        std::snprintf(buf, sizeof(buf), "device %012llx\n", static_cast<unsigned long long>(address));
+        out += buf;
+        if (c.hasLeftStick) AppendStick(out, "left", c.leftFromUser, c.leftStick);
+        if (c.hasRightStick) AppendStick(out, "right", c.rightFromUser, c.rightStick);
+        if (c.hasGyroBias)
+        {
+            std::snprintf(buf, sizeof(buf), "gyro %g %g %g\n", c.gyroBiasX, c.gyroBiasY, c.gyroBiasZ);
+            out += buf;
+        }
+        out += "end\n";
+    }
+    return out;
+}
+
+bool FlashCalibrationCache::Find(uint64_t address, DeviceCalibration& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(address);
+    if (it == entries_.end()) return false;
+    out = it->second;
+    return true;
+}
+
+void FlashCalibrationCache::Store(uint64_t address, const DeviceCalibration& calibration)
+{
+    if (!calibration.Any()) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[address] = calibration;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "JoyConDecoder.h"
+
+// Flash read: cmd 0x02 sub 0x04. The request payload is
+// [len, 0x7E, 0, 0, address LE32]; the response echoes it after the 8 byte
+// header and the data follows at offset 16.
+constexpr uint8_t FLASH_READ_CMD = 0x02;
+constexpr uint8_t FLASH_READ_SUB = 0x04;
+
+// Calibration locations read by the official init scripts. Each stick record
+// is 9 bytes of packed 12-bit values: center X/Y, max delta X/Y, min delta
+// X/Y. User records start with the 0xB2A1 magic. The IMU record begins with
+// the gyro zero offsets as three signed 16-bit counts.
+constexpr uint32_t FLASH_FACTORY_PRIMARY_STICK   = 0x130A8;
+constexpr uint32_t FLASH_FACTORY_SECONDARY_STICK = 0x130E8;
+constexpr uint32_t FLASH_USER_PRIMARY_STICK      = 0x1FC040;
+constexpr uint32_t FLASH_USER_SECONDARY_STICK    = 0x1FC060;
+constexpr uint32_t FLASH_IMU_CALIBRATION         = 0x13040;
+
+struct FlashRead {
+    uint32_t address = 0;
+    std::vector<uint8_t> data;
+};
+
+bool ParseFlashReadReply(const uint8_t* reply, size_t size, FlashRead& out);
+bool DecodeStickCalibration(const uint8_t* packed, StickCalibration& out);
+
+// Which physical sticks the primary/secondary records describe.
+enum class FlashStickLayout { LeftOnly, RightOnly, Both };
+
+struct DeviceCalibration {
+    bool hasLeftStick  = false;
+    bool hasRightStick = false;
+    bool hasGyroBias   = false;
+    bool leftFromUser  = false;
+    bool rightFromUser = false;
+    StickCalibration leftStick;
+    StickCalibration rightStick;
+    float gyroBiasX = 0.0f, gyroBiasY = 0.0f, gyroBiasZ = 0.0f;
+
+    bool Any() const { return hasLeftStick || hasRightStick || hasGyroBias; }
+    void ApplyTo(CalibrationProfile& profile) const;
+    void ApplyTo(MotionScale& scale) const;
+};
+
+// Collects flash read replies for one device and decodes the calibration
+// records once the blocks that hold them have arrived.
+class FlashCalibrationReader {
+public:
+    explicit FlashCalibrationReader(FlashStickLayout layout);
+
+    bool Feed(const uint8_t* reply, size_t size);
+    void Feed(const FlashRead& read);
+
+    DeviceCalibration Result() const;
+
+private:
+    bool Bytes(uint32_t address, size_t count, const uint8_t*& out) const;
+    bool ReadStick(uint32_t factory, uint32_t user, StickCalibration& out, bool& fromUser) const;
+
+    FlashStickLayout layout_;
+    std::map<uint32_t, std::vector<uint8_t>> blocks_;
+};
+
+// Flash contents for exercising the reader without a controller: answers a
+// flash read command with the reply body the controller would send. Plug
+// Reply into FakeCommandResponder::SetPayload.
+class FakeFlashImage {
+public:
+    void Write(uint32_t address, const std::vector<uint8_t>& bytes);
+    std::vector<uint8_t> Reply(const uint8_t* command, size_t size) const;
+
+private:
+    std::map<uint32_t, uint8_t> bytes_;
+};
+
+// Decoded calibration per BLE address, kept on disk so a known controller is
+// calibrated before its init script has even run.
+class FlashCalibrationCache {
+public:
+    explicit FlashCalibrationCache(std::string path);
+
+    bool Load();
+    bool Save() const;
+
+    bool Parse(const std::string& text);
+    std::string Serialize() const;
+
+    bool Find(uint64_t address, DeviceCalibration& out) const;
+    void Store(uint64_t address, const DeviceCalibration& calibration);
+
+private:
+    std::string path_;
+    mutable std::mutex mutex_;
+    mutable std::mutex saveMutex_;
+    std::unordered_map<uint64_t, DeviceCalibration> entries_;
+};
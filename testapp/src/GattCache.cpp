@@ -0,0 +1,302 @@
+#include "GattCache.h"
+#include "Persistence.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    constexpr const char* kHeader = "# joycon2cpp GATT cache v1";
+
+    struct RoleUuid {
+        GattRole    role;
+        const char* name;
+        const char* uuid;
+    };
+
+    constexpr RoleUuid kRoles[] = {
+        { GattRole::InputReport,      "InputReport",      "ab7de9be-89fe-49ad-828f-118f09df7fd2" },
+        { GattRole::WriteCommand,     "WriteCommand",     "649d4ac9-8eb7-4e6c-af44-1ea54fe5f005" },
+        { GattRole::CmdResponseBasic, "CmdResponseBasic", "c765a961-d9d8-4d36-a20a-5315b111836a" },
+        { GattRole::CmdResponseLeft,  "CmdResponseLeft",  "63a3810f-aec7-474b-9010-3d52403cb996" },
+        { GattRole::CmdResponseRight, "CmdResponseRight", "640ca58e-0e88-410c-a7f3-426faf2b690b" },
+        { GattRole::CmdResponsePro,   "CmdResponsePro",   "506d9f7d-4278-4e95-a549-326ba77657e0" },
+        { GattRole::CmdResponseGC,    "CmdResponseGC",    "46f6ad29-cdaf-4569-a2fe-339020b94604" },
+        { GattRole::RumbleLeft,       "RumbleLeft",       "ce49a830-dced-48ae-931e-c8cf88aadbea" },
+        { GattRole::RumbleRight,      "RumbleRight",      "65a724b3-f1e7-4a61-8078-a342376b27ff" },
+        { GattRole::RumblePro,        "RumblePro",        "3dacbc7e-6955-40b5-8eaf-6f9809e8b379" },
+        { GattRole::RumbleGC,         "RumbleGC",         "af95885e-44b3-4a24-9cf0-483cc129469a" },
+        { GattRole::VibrationLeft,    "VibrationLeft",    "289326cb-a471-485d-a8f4-240c14f18241" },
+        { GattRole::VibrationRight,   "VibrationRight",   "fa19b0fb-cd1f-46a7-84a1-bbb09e00c149" },
+        { GattRole::VibrationPro,     "VibrationPro",     "cc483f51-9258-427d-a939-630c31f72b05" },
+        { GattRole::VibrationGC,      "VibrationGC",      "3f8fb670-ab25-45bf-b540-38c72834d064" },
+    };
+    static_assert(sizeof(kRoles) / sizeof(kRoles[0]) == static_cast<size_t>(GattRole::Count),
+        "every GattRole needs a UUID");
+
+    int HexValue(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    const std::unordered_map<Uuid128, GattRole, Uuid128Hash>& RoleTable()
+    {
+        static const std::unordered_map<Uuid128, GattRole, Uuid128Hash> table = [] {
+            std::unordered_map<Uuid128, GattRole, Uuid128Hash> t;
+            t.reserve(static_cast<size_t>(GattRole::Count) * 2);
+            for (const auto& r : kRoles)
+            {
+                Uuid128 u;
+                if (ParseUuid(r.uuid, u)) t.emplace(u, r.role);
+            }
+            return t;
+        }();
+        return table;
+    }
+}
+
+bool ParseUuid(std::string_view text, Uuid128& out)
+{
+    if (text.size() == 38 && text.front() == '{' && text.back() == '}')
+        text = text.substr(1, 36);
+    if (text.size() != 36) return false;
+
+    uint64_t words[2] = { 0, 0 };
+    int nibble = 0;
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (i == 8 || i == 13 || i == 18 || i == 23)
+        {
+            if (text[i] != '-') return false;
+            continue;
+        }
+        const int v = HexValue(text[i]);
+        if (v < 0) return false;
+        uint64_t& w = words[nibble / 16];
+        w = (w << 4) | static_cast<uint64_t>(v);
+        ++nibble;
+    }
+    out.hi = words[0];
+    out.lo = words[1];
+    return true;
+}
+
+std::string FormatUuid(const Uuid128& uuid)
+{
+    char buf[40];
+    std::snprintf(buf, sizeof(buf), "%08x-%04x-%04x-%04x-%012llx",
+        static_cast<unsigned>(uuid.hi >> 32),
+        static_cast<unsigned>((uuid.hi >> 16) & 0xFFFF),
+        static_cast<unsigned>(uuid.hi & 0xFFFF),
+        static_cast<unsigned>(uuid.lo >> 48),
+        static_cast<unsigned long long>(uuid.lo & 0xFFFFFFFFFFFFull));
+    return buf;
+}
+
+Uuid128 UuidFromGuidFields(uint32_t data1, uint16_t data2, uint16_t data3, const uint8_t data4[8])
+{
+    Uuid128 u;
+    u.hi = (static_cast<uint64_t>(data1) << 32) | (static_cast<uint64_t>(data2) << 16) | data3;
+    for (int i = 0; i < 8; ++i)
+        u.lo = (u.lo << 8) | data4[i];
+    return u;
+}
+
+void UuidToGuidFields(const Uuid128& uuid, uint32_t& data1, uint16_t& data2, uint16_t& data3, uint8_t data4[8])
+{
+    data1 = static_cast<uint32_t>(uuid.hi >> 32);
+    data2 = static_cast<uint16_t>(uuid.hi >> 16);
+    data3 = static_cast<uint16_t>(uuid.hi);
+    for (int i = 0; i < 8; ++i)
+        data4[i] = static_cast<uint8_t>(uuid.lo >> (56 - 8 * i));
+}
+
+const char* GattRoleName(GattRole role)
+{
+    const size_t i = static_cast<size_t>(role);
+    return i < static_cast<size_t>(GattRole::Count) ? kRoles[i].name : "Unknown";
+}
+
+bool GattRoleFromName(std::string_view name, GattRole& out)
+{
+    for (const auto& r : kRoles)
+    {
+        if (name == r.name)
+        {
+            out = r.role;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LookupGattRole(const Uuid128& characteristic, GattRole& out)
+{
+    const auto& table = RoleTable();
+    auto it = table.find(characteristic);
+    if (it == table.end()) return false;
+    out = it->second;
+    return true;
+}
+
+bool ValidateGattCacheEntry(const GattCacheEntry& entry)
+{
+    if (entry.address == 0 || entry.characteristics.empty()) return false;
+
+    bool seen[static_cast<size_t>(GattRole::Count)] = {};
+    for (const auto& c : entry.characteristics)
+    {
+        GattRole role;
+        if (!LookupGattRole(c.characteristic, role) || role != c.role) return false;
+        if (c.service == Uuid128{}) return false;
+        bool& s = seen[static_cast<size_t>(role)];
+        if (s) return false;
+        s = true;
+    }
+    return seen[static_cast<size_t>(GattRole::InputReport)] &&
+           seen[static_cast<size_t>(GattRole::WriteCommand)];
+}
+
+GattCache::GattCache(std::string path)
+    : path_(std::move(path))
+{
+}
+
+bool GattCache::Load()
+{
+    std::ifstream f(path_);
+    if (!f.is_open()) return false;
+    std::stringstream ss;
+    ss << f.rdbuf();
+    return Parse(ss.str());
+}
+
+bool GattCache::Save() const
+{
+    std::lock_guard<std::mutex> lock(saveMutex_);
+    return WriteFileAtomically(path_, Serialize());
+}
+
+// Format:
+//   # joycon2cpp GATT cache v1
+//   device <address hex> <product id hex>
+//   char <role> <service uuid> <characteristic uuid>
+//   end
+// A file with another header is ignored as a whole; a malformed or stale
+// device block is dropped on its own.
+bool GattCache::Parse(const std::string& text)
+{
+    std::istringstream in(text);
+    std::string line;
+    if (!std::getline(in, line)) return false;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line != kHeader) return false;
+
+    std::unordered_map<uint64_t, GattCacheEntry> parsed;
+    GattCacheEntry current;
+    bool inDevice = false;
+    bool broken = false;
+
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::istringstream ls(line);
+        std::string kind;
+        if (!(ls >> kind) || kind[0] == '#') continue;
+
+        if (kind == "device")
+        {
+            current = {};
+            broken = false;
+            inDevice = true;
+            unsigned long long address = 0;
+            unsigned pid = 0;
+            if (!(ls >> std::hex >> address >> pid) || pid > 0xFFFF) broken = true;
+            current.address = address;
+            current.productId = static_cast<uint16_t>(pid);
+        }
+        else if (kind == "char" && inDevice)
+        {
+            std::string role, service, characteristic;
+            GattCachedCharacteristic c;
+            if (!(ls >> role >> service >> characteristic) ||
+                !GattRoleFromName(role, c.role) ||
+                !ParseUuid(service, c.service) ||
+                !ParseUuid(characteristic, c.characteristic))
+            {
+                broken = true;
+                continue;
+            }
+            current.characteristics.push_back(c);
+        }
+        else if (kind == "end" && inDevice)
+        {
+            if (!broken && ValidateGattCacheEntry(current))
+                parsed[Key(current.address, current.productId)] = current;
+            inDevice = false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_ = std::move(parsed);
+    return true;
+}
+
+std::string GattCache::Serialize() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out = kHeader;
+    out += '\n';
+    char buf[64];
+    for (const auto& [key, e] : entries_)
+    {
+        std::snprintf(buf, sizeof(buf), "device %012llx %04x\n",
+            static_cast<unsigned long long>(e.address), static_cast<unsigned>(e.productId));
+        out += buf;
+        for (const auto& c : e.characteristics)
+        {
+            out += "char ";
+            out += GattRoleName(c.role);
+            out += ' ';
+            out += FormatUuid(c.service);
+            out += ' ';
+            out += FormatUuid(c.characteristic);
+            out += '\n';
+        }
+        out += "end\n";
+    }
+    return out;
+}
+
+bool GattCache::Find(uint64_t address, uint16_t productId, GattCacheEntry& out) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(Key(address, productId));
+    if (it == entries_.end()) return false;
+    out = it->second;
+    return true;
+}
+
+bool GattCache::Store(GattCacheEntry entry)
+{
+    if (!ValidateGattCacheEntry(entry)) return false;
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[Key(entry.address, entry.productId)] = std::move(entry);
+    return true;
+}
+
+void GattCache::Invalidate(uint64_t address, uint16_t productId)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(Key(address, productId));
+}
+
+size_t GattCache::Size() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 128-bit UUID in canonical string order: hi holds the first eight bytes of
+// "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx", lo the last eight.
+struct Uuid128 {
+    uint64_t hi = 0;
+    uint64_t lo = 0;
+
+    bool operator==(const Uuid128& o) const { return hi == o.hi && lo == o.lo; }
+    bool operator!=(const Uuid128& o) const { return !(*this == o); }
+};
+
+struct Uuid128Hash {
+    size_t operator()(const Uuid128& u) const
+    {
+        return static_cast<size_t>(u.hi ^ (u.lo * 0x9E3779B97F4A7C15ull));
+    }
+};
+
+bool ParseUuid(std::string_view text, Uuid128& out);
+std::string FormatUuid(const Uuid128& uuid);
+Uuid128 UuidFromGuidFields(uint32_t data1, uint16_t data2, uint16_t data3, const uint8_t data4[8]);
+void UuidToGuidFields(const Uuid128& uuid, uint32_t& data1, uint16_t& data2, uint16_t& data3, uint8_t data4[8]);
+
+// What a characteristic is used for. Side specific roles stay distinct so the
+// caller decides which ones apply to the device it is opening.
+enum class GattRole : uint8_t {
+    InputReport,
+    WriteCommand,
+    CmdResponseBasic,
+    CmdResponseLeft,
+    CmdResponseRight,
+    CmdResponsePro,
+    CmdResponseGC,
+    RumbleLeft,
+    RumbleRight,
+    RumblePro,
+    RumbleGC,
+    VibrationLeft,
+    VibrationRight,
+    VibrationPro,
+    VibrationGC,
+    Count
+};
+
+const char* GattRoleName(GattRole role);
+bool GattRoleFromName(std::string_view name, GattRole& out);
+
+// Precomputed characteristic UUID -> role table.
+bool LookupGattRole(const Uuid128& characteristic, GattRole& out);
+
+struct GattCachedCharacteristic {
+    GattRole role = GattRole::Count;
+    Uuid128  service;
+    Uuid128  characteristic;
+};
+
+struct GattCacheEntry {
+    uint64_t address   = 0;
+    uint16_t productId = 0;
+    std::vector<GattCachedCharacteristic> characteristics;
+};
+
+// An entry is usable when every characteristic still maps to the role it was
+// stored under, no role repeats, and the input/write pair is present.
+bool ValidateGattCacheEntry(const GattCacheEntry& entry);
+
+// Per-device record of where each characteristic was found, so reconnects can
+// ask for those services directly from the system cache instead of running a
+// full uncached discovery. Safe to use from concurrent connection threads.
+class GattCache {
+public:
+    explicit GattCache(std::string path);
+
+    bool Load();
+    bool Save() const;
+
+    bool Parse(const std::string& text);
+    std::string Serialize() const;
+
+    bool Find(uint64_t address, uint16_t productId, GattCacheEntry& out) const;
+    bool Store(GattCacheEntry entry);
+    void Invalidate(uint64_t address, uint16_t productId);
+    size_t Size() const;
+
+private:
+    static uint64_t Key(uint64_t address, uint16_t productId)
+    {
+        return (address & 0xFFFFFFFFFFFFull) | (static_cast<uint64_t>(productId) << 48);
+    }
+
+    std::string path_;
+    mutable std::mutex mutex_;
+    mutable std::mutex saveMutex_;
+    std::unordered_map<uint64_t, GattCacheEntry> entries_;
+};
@@ -0,0 +1,102 @@
+#include "GyroAim.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Still means within these of the bias and gravity estimates.
+    constexpr float kStillRate = 6.f;       // deg/s
+    constexpr float kStillAccel = 0.05f;    // g
+    // How fast the estimates follow the sensors, in seconds.
+    constexpr float kBiasTimeConstant = 2.f;
+    constexpr float kGravityTimeConstant = 0.25f;
+    // A longer gap between samples is a stall; it is not integrated.
+    constexpr float kMaxStep = 0.05f;
+    // Stick output counts turns slower than this share of the tightening
+    // rate (and never below the floor) as rest, so sensor noise on a
+    // controller at rest leaves the stick centred.
+    constexpr float kStickRestFraction = 0.25f;
+    constexpr float kStickRestFloorDps = 1.f;
+
+    int32_t TakeWhole(float& remainder)
+    {
+        const float whole = std::trunc(remainder);
+        remainder -= whole;
+        return static_cast<int32_t>(whole);
+    }
+}
+
+void GyroAim::Update(const MotionSample& sample, GyroAimOutput output, const GyroAimTuning& tuning, GyroAimResult& out)
+{
+    out = {};
+    if (!sample.valid) return;
+
+    float dt = 0.f;
+    if (!started_) {
+        upX_ = sample.accelX;
+        upY_ = sample.accelY;
+        upZ_ = sample.accelZ;
+        started_ = true;
+    } else if (sample.timestampUs > lastUs_) {
+        dt = std::min(static_cast<float>(sample.timestampUs - lastUs_) * 1e-6f, kMaxStep);
+    }
+    lastUs_ = sample.timestampUs;
+
+    const float ax = sample.accelX - upX_, ay = sample.accelY - upY_, az = sample.accelZ - upZ_;
+    const float ga = std::min(dt / kGravityTimeConstant, 1.f);
+    upX_ += ax * ga;
+    upY_ += ay * ga;
+    upZ_ += az * ga;
+
+    const float gx = sample.gyroX - biasX_, gy = sample.gyroY - biasY_, gz = sample.gyroZ - biasZ_;
+    const bool still = gx * gx + gy * gy + gz * gz < kStillRate * kStillRate &&
+                       ax * ax + ay * ay + az * az < kStillAccel * kStillAccel;
+    stillUs_ = still ? stillUs_ + static_cast<uint64_t>(dt * 1e6f) : 0;
+    if (Still()) {
+        const float b = std::min(dt / kBiasTimeConstant, 1.f);
+        biasX_ += gx * b;
+        biasY_ += gy * b;
+        biasZ_ += gz * b;
+    }
+    if (output == GyroAimOutput::Off) return;
+
+    // Yaw about gravity, so a controller held flat, upright or tilted turns
+    // the view the same way. Right-hand rule: positive yaw turns left and
+    // positive pitch raises the nose; screen x grows right and y down.
+    const float upLength = std::sqrt(upX_ * upX_ + upY_ * upY_ + upZ_ * upZ_);
+    const float yaw = upLength > 0.5f ? (gx * upX_ + gy * upY_ + gz * upZ_) / upLength : gy;
+    float x = tuning.invertX ? yaw : -yaw;
+    float y = tuning.invertY ? gx : -gx;
+
+    const float speed = std::sqrt(x * x + y * y);
+    float gain = tuning.sensitivity * (1.f + tuning.acceleration * std::min(speed / kAccelerationRate, 1.f));
+    if (speed < tuning.tighteningDps) gain *= speed / tuning.tighteningDps;
+    x *= gain;
+    y *= gain;
+
+    if (output == GyroAimOutput::Mouse) {
+        remainderX_ += x * dt * kPixelsPerDegree;
+        remainderY_ += y * dt * kPixelsPerDegree;
+        out.mouseDx = TakeWhole(remainderX_);
+        out.mouseDy = TakeWhole(remainderY_);
+        return;
+    }
+
+    // The stick holds a rate, not a distance. A real turn starts at the
+    // game's deadzone edge so slow aim is not swallowed by it; below the rest
+    // rate the stick stays centred.
+    if (speed < std::max(tuning.tighteningDps * kStickRestFraction, kStickRestFloorDps)) return;
+    const float sx = x / kStickFullRate, sy = y / kStickFullRate;
+    const float m = std::sqrt(sx * sx + sy * sy);
+    if (m <= 0.f) return;
+    const float dz = std::clamp(tuning.stickDeadzone, 0.f, 0.9f);
+    const float scale = (dz + (1.f - dz) * std::min(m, 1.f)) / m;
+    out.stickX = sx * scale;
+    out.stickY = sy * scale;
+}
+
+void GyroAim::Reset()
+{
+    *this = GyroAim{};
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+#include "JoyConDecoder.h"
+
+// Where a player's gyro aim goes, besides the motion the DS4/DSU output
+// already carries.
+enum class GyroAimOutput { Off, Mouse, RightStick };
+
+struct GyroAimTuning {
+    float sensitivity = 1.0f;     // Mouse: 10 px per degree at 1. Stick: full deflection at 360/sensitivity deg/s
+    float acceleration = 0.0f;    // extra gain at kAccelerationRate deg/s and faster, as a fraction of sensitivity
+    float tighteningDps = 3.0f;   // slower turns are scaled down toward zero, hiding hand shake
+    float stickDeadzone = 0.1f;   // the game's inner stick deadzone, which stick output starts past
+    bool  invertX = false;
+    bool  invertY = false;
+    bool operator==(const GyroAimTuning&) const = default;
+};
+
+// One sample's worth of aim: whole pixels for a mouse, or a right stick
+// position in [-1, 1] (y positive down, as in a DS4 report).
+struct GyroAimResult {
+    int32_t mouseDx = 0, mouseDy = 0;
+    float   stickX = 0.f, stickY = 0.f;
+};
+
+// Turns motion samples into aim as they arrive, on the thread that decodes
+// them. The gyro's rest bias is tracked while the controller lies still, so
+// drift does not creep into the aim, and gravity is tracked from the
+// accelerometer so yaw follows the player's turn however the controller is
+// held ("player space"); pitch is the controller's own X axis.
+class GyroAim {
+public:
+    static constexpr float kAccelerationRate = 180.f;   // deg/s
+    static constexpr float kPixelsPerDegree = 10.f;
+    static constexpr float kStickFullRate = 360.f;      // deg/s at sensitivity 1
+
+    void Update(const MotionSample& sample, GyroAimOutput output, const GyroAimTuning& tuning, GyroAimResult& out);
+    void Reset();
+
+    // Current rest bias estimate, deg/s.
+    float BiasX() const { return biasX_; }
+    float BiasY() const { return biasY_; }
+    float BiasZ() const { return biasZ_; }
+    // True once the controller has been still long enough to trust the bias.
+    bool Still() const { return stillUs_ >= kStillTimeUs; }
+
+private:
+    static constexpr uint64_t kStillTimeUs = 500000;
+
+    uint64_t lastUs_ = 0;
+    bool     started_ = false;
+    uint64_t stillUs_ = 0;
+    float    biasX_ = 0.f, biasY_ = 0.f, biasZ_ = 0.f;
+    float    upX_ = 0.f, upY_ = 0.f, upZ_ = 0.f;   // low-passed accelerometer, in g
+    float    remainderX_ = 0.f, remainderY_ = 0.f;
+};
@@ -1,12 +1,13 @@
 #include "JoyConDecoder.h"
+#include "ConfigFile.h"
+#include "Persistence.h"
+#include "Snapshot.h"
 #include <cmath>
 #include <algorithm>
-#include <ViGEm/Client.h>
 #include <ViGEm/Common.h>
 #include <cstdint>
 #include <cstdio>
 #include <vector>
-#include <fstream>
 #include <iostream>
 
 int16_t to_signed_16(uint8_t lsb, uint8_t msb) {
@@ -23,6 +24,21 @@ static CalibrationProfile MakeDefaultProfile()
     return p;
 }
 
+static SnapshotCell<CalibrationProfile> g_activeCalibrationSnapshot{ MakeDefaultProfile() };
+
+static void PublishActiveCalibration()
+{
+    g_activeCalibrationSnapshot.Publish(GetActiveCalibration());
+}
+
+// The decoders run on input threads while the UI edits the profile list, so
+// their fallback reads the published copy, refreshed once per change.
+static const CalibrationProfile& ActiveCalibrationForThread()
+{
+    thread_local SnapshotReader<CalibrationProfile> reader;
+    return reader.Read(g_activeCalibrationSnapshot);
+}
+
 void ExtractRawStick(const std::vector<uint8_t>& buffer, bool isLeft, int& outX, int& outY)
 {
     if (buffer.size() < 16) {
@@ -35,10 +51,10 @@ void ExtractRawStick(const std::vector<uint8_t>& buffer, bool isLeft, int& outX,
     outY = (data[2] << 4) | ((data[1] & 0xF0) >> 4);
 }
 
-void LoadCalibrationProfiles(const std::string& path)
+static void ReadCalibrationProfiles(const std::string& path)
 {
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    std::string text;
+    if (!ReadTextFile(path, text)) {
         if (g_calibrationProfiles.empty()) {
             g_calibrationProfiles.push_back(MakeDefaultProfile());
             g_activeCalibrationIndex = 0;
@@ -46,132 +62,45 @@ void LoadCalibrationProfiles(const std::string& path)
         return;
     }
 
-    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
-    file.close();
-
-    g_calibrationProfiles.clear();
-    g_activeCalibrationIndex = 0;
-
-    size_t activePos = content.find("\"activeIndex\"");
-    if (activePos != std::string::npos) {
-        size_t colon = content.find(':', activePos);
-        size_t end = content.find_first_of(",\n}", colon);
-        try { g_activeCalibrationIndex = std::stoi(content.substr(colon + 1, end - colon - 1)); } catch (...) {}
-    }
-
-    size_t profilesPos = content.find("\"profiles\"");
-    if (profilesPos == std::string::npos) {
-        g_calibrationProfiles.push_back(MakeDefaultProfile());
-        g_activeCalibrationIndex = 0;
-        return;
-    }
-
-    size_t arrayStart = content.find('[', profilesPos);
-    if (arrayStart == std::string::npos) {
-        g_calibrationProfiles.push_back(MakeDefaultProfile());
-        g_activeCalibrationIndex = 0;
+    CalibrationConfig config;
+    ConfigDiagnostics diagnostics;
+    const bool ok = ParseCalibrationConfig(text, config, diagnostics);
+    if (!diagnostics.issues.empty()) std::cerr << diagnostics.Format(path);
+    if (!ok) {
+        // Keep what is loaded; the defaults only if there is nothing yet.
+        if (g_calibrationProfiles.empty()) g_calibrationProfiles.push_back(MakeDefaultProfile());
         return;
     }
+    if (config.profiles.empty()) config.profiles.push_back(MakeDefaultProfile());
+    g_calibrationProfiles = std::move(config.profiles);
+    g_activeCalibrationIndex = config.activeIndex;
+}
 
-    size_t pos = arrayStart + 1;
-    while (pos < content.size()) {
-        size_t objStart = content.find('{', pos);
-        if (objStart == std::string::npos) break;
-
-        int depth = 1;
-        size_t objEnd = objStart + 1;
-        while (objEnd < content.size() && depth > 0) {
-            if (content[objEnd] == '{') ++depth;
-            else if (content[objEnd] == '}') --depth;
-            ++objEnd;
-        }
-
-        std::string obj = content.substr(objStart, objEnd - objStart);
-        CalibrationProfile p;
-
-        size_t namePos = obj.find("\"name\"");
-        if (namePos != std::string::npos) {
-            size_t q1 = obj.find('"', namePos + 6);
-            size_t q2 = obj.find('"', q1 + 1);
-            if (q1 != std::string::npos && q2 != std::string::npos)
-                p.name = obj.substr(q1 + 1, q2 - q1 - 1);
-        }
-
-        auto parseStick = [&](const std::string& sectionKey, StickCalibration& cal) {
-            size_t spos = obj.find("\"" + sectionKey + "\"");
-            if (spos == std::string::npos) return;
-            size_t bstart = obj.find('{', spos);
-            size_t bend = obj.find('}', bstart);
-            if (bstart == std::string::npos || bend == std::string::npos) return;
-            std::string section = obj.substr(bstart, bend - bstart + 1);
-
-            auto readInt = [&](const std::string& key, int def) -> int {
-                size_t kpos = section.find("\"" + key + "\"");
-                if (kpos == std::string::npos) return def;
-                size_t cpos = section.find(':', kpos);
-                if (cpos == std::string::npos) return def;
-                size_t epos = section.find_first_of(",}", cpos);
-                try { return std::stoi(section.substr(cpos + 1, epos - cpos - 1)); } catch (...) { return def; }
-            };
+void LoadCalibrationProfiles(const std::string& path)
+{
+    ReadCalibrationProfiles(path);
+    PublishActiveCalibration();
+}
 
-            cal.centerX = readInt("centerX", 2048);
-            cal.centerY = readInt("centerY", 2048);
-            cal.minX    = readInt("minX", 0);
-            cal.maxX    = readInt("maxX", 4095);
-            cal.minY    = readInt("minY", 0);
-            cal.maxY    = readInt("maxY", 4095);
-        };
-
-        parseStick("leftStick", p.leftStick);
-        parseStick("rightStick", p.rightStick);
-        g_calibrationProfiles.push_back(p);
-        pos = objEnd;
-    }
+void SetCalibrationProfiles(std::vector<CalibrationProfile> profiles, int activeIndex)
+{
+    if (profiles.empty()) profiles.push_back(MakeDefaultProfile());
+    g_calibrationProfiles = std::move(profiles);
+    g_activeCalibrationIndex = (activeIndex >= 0 && activeIndex < static_cast<int>(g_calibrationProfiles.size())) ? activeIndex : 0;
+    PublishActiveCalibration();
+}
 
-    if (g_calibrationProfiles.empty()) {
-        g_calibrationProfiles.push_back(MakeDefaultProfile());
-        g_activeCalibrationIndex = 0;
-    }
-    if (g_activeCalibrationIndex < 0 || g_activeCalibrationIndex >= static_cast<int>(g_calibrationProfiles.size()))
-        g_activeCalibrationIndex = 0;
+std::string SerializeCalibrationProfiles()
+{
+    return SerializeCalibrationConfig(g_calibrationProfiles, g_activeCalibrationIndex);
 }
 
 void SaveCalibrationProfiles(const std::string& path)
 {
-    std::ofstream file(path);
-    if (!file.is_open()) {
+    if (!WriteFileAtomically(path, SerializeCalibrationProfiles())) {
         std::cerr << "Failed to save calibration profiles to " << path << "\n";
         return;
     }
-
-    auto writeStick = [&](const std::string& key, const StickCalibration& cal) {
-        file << "      \"" << key << "\": {\n";
-        file << "        \"centerX\": " << cal.centerX << ",\n";
-        file << "        \"centerY\": " << cal.centerY << ",\n";
-        file << "        \"minX\": "    << cal.minX    << ",\n";
-        file << "        \"maxX\": "    << cal.maxX    << ",\n";
-        file << "        \"minY\": "    << cal.minY    << ",\n";
-        file << "        \"maxY\": "    << cal.maxY    << "\n";
-        file << "      }";
-    };
-
-    file << "{\n";
-    file << "  \"activeIndex\": " << g_activeCalibrationIndex << ",\n";
-    file << "  \"profiles\": [\n";
-    for (size_t i = 0; i < g_calibrationProfiles.size(); ++i) {
-        const auto& p = g_calibrationProfiles[i];
-        file << "    {\n";
-        file << "      \"name\": \"" << p.name << "\",\n";
-        writeStick("leftStick", p.leftStick);
-        file << ",\n";
-        writeStick("rightStick", p.rightStick);
-        file << "\n";
-        file << "    }";
-        if (i + 1 < g_calibrationProfiles.size()) file << ",";
-        file << "\n";
-    }
-    file << "  ]\n}\n";
-    file.close();
     std::cout << "Calibration profiles saved to " << path << "\n";
 }
 
@@ -183,6 +112,7 @@ const std::vector<CalibrationProfile>& GetCalibrationProfiles()
 void AddCalibrationProfile(const CalibrationProfile& profile)
 {
     g_calibrationProfiles.push_back(profile);
+    PublishActiveCalibration();
 }
 
 void DeleteCalibrationProfile(int index)
@@ -192,6 +122,7 @@ void DeleteCalibrationProfile(int index)
     g_calibrationProfiles.erase(g_calibrationProfiles.begin() + index);
     if (g_activeCalibrationIndex >= static_cast<int>(g_calibrationProfiles.size()))
         g_activeCalibrationIndex = static_cast<int>(g_calibrationProfiles.size()) - 1;
+    PublishActiveCalibration();
 }
 
 int GetActiveCalibrationIndex()
@@ -203,6 +134,7 @@ void SetActiveCalibrationIndex(int index)
 {
     if (index >= 0 && index < static_cast<int>(g_calibrationProfiles.size()))
         g_activeCalibrationIndex = index;
+    PublishActiveCalibration();
 }
 
 const CalibrationProfile& GetActiveCalibration()
@@ -216,6 +148,11 @@ const CalibrationProfile& GetActiveCalibration()
     return g_calibrationProfiles[idx];
 }
 
+std::shared_ptr<const CalibrationProfile> GetActiveCalibrationSnapshot()
+{
+    return g_activeCalibrationSnapshot.Load();
+}
+
 namespace {
 constexpr size_t JC2_COMMON_REPORT_MIN_SIZE = 0x3C;
 constexpr size_t JC2_COMMON_REPORT_MARKER_OFFSET = 0x29;
@@ -313,7 +250,7 @@ constexpr uint32_t BUTTON_MINUS_MASK_LEFT = 0x000100;
 constexpr uint32_t BUTTON_L_MASK_LEFT     = 0x000040;
 constexpr uint32_t BUTTON_STICK_MASK_LEFT = 0x000800;
 
-StickData DecodeJoystick(const std::vector<uint8_t>& buffer, JoyConSide side, JoyConOrientation orientation)
+StickData DecodeJoystick(const std::vector<uint8_t>& buffer, JoyConSide side, JoyConOrientation orientation, const CalibrationProfile* calibration)
 {
     if (buffer.size() < 16) {
         return { 0, 0, 0, 0 };
@@ -325,9 +262,8 @@ StickData DecodeJoystick(const std::vector<uint8_t>& buffer, JoyConSide side, Jo
     int x_raw, y_raw;
     ExtractRawStick(buffer, isLeft, x_raw, y_raw);
 
-    const StickCalibration& cal = isLeft
-        ? GetActiveCalibration().leftStick
-        : GetActiveCalibration().rightStick;
+    const CalibrationProfile& profile = calibration ? *calibration : ActiveCalibrationForThread();
+    const StickCalibration& cal = isLeft ? profile.leftStick : profile.rightStick;
 
     float x = ApplyCalibratedAxis(x_raw, cal.centerX, cal.minX, cal.maxX);
     float y = ApplyCalibratedAxis(y_raw, cal.centerY, cal.minY, cal.maxY);
@@ -352,9 +288,9 @@ StickData DecodeJoystick(const std::vector<uint8_t>& buffer, JoyConSide side, Jo
     return { outX, outY, 0, 0 };
 }
 
-static std::pair<int16_t, int16_t> decode_joystick(const std::vector<uint8_t>& buffer, bool isLeft, bool upright)
+static std::pair<int16_t, int16_t> decode_joystick(const std::vector<uint8_t>& buffer, bool isLeft, bool upright, const CalibrationProfile* calibration)
 {
-    auto res = DecodeJoystick(buffer, isLeft ? JoyConSide::Left : JoyConSide::Right, upright ? JoyConOrientation::Upright : JoyConOrientation::Sideways);
+    auto res = DecodeJoystick(buffer, isLeft ? JoyConSide::Left : JoyConSide::Right, upright ? JoyConOrientation::Upright : JoyConOrientation::Sideways, calibration);
     return { res.x, res.y };
 }
 
@@ -408,6 +344,52 @@ MotionData DecodeMotionRaw(const std::vector<uint8_t>& buffer)
     return raw;
 }
 
+MotionSample DecodeMotionSample(const std::vector<uint8_t>& buffer, uint64_t timestampUs, const MotionScale& scale)
+{
+    MotionSample sample{};
+    sample.timestampUs = timestampUs;
+    sample.reportCounter = ExtractReportCounter(buffer);
+
+    MotionData raw{};
+    if (!TryDecodeCommonInputReport05Motion(buffer, raw)) {
+        return sample;
+    }
+
+    const float accelScale = scale.accelCountsPerG > 0.0f ? 1.0f / scale.accelCountsPerG : 0.0f;
+    const float gyroScale = scale.gyroCountsPerDps > 0.0f ? 1.0f / scale.gyroCountsPerDps : 0.0f;
+    sample.accelX = raw.accelX * accelScale;
+    sample.accelY = raw.accelY * accelScale;
+    sample.accelZ = raw.accelZ * accelScale;
+    sample.gyroX  = (raw.gyroX - scale.gyroBiasX) * gyroScale;
+    sample.gyroY  = (raw.gyroY - scale.gyroBiasY) * gyroScale;
+    sample.gyroZ  = (raw.gyroZ - scale.gyroBiasZ) * gyroScale;
+    sample.valid = true;
+    return sample;
+}
+
+MotionSample CombineMotionSamples(const MotionSample& left, const MotionSample& right, GyroSource gyroSource)
+{
+    switch (gyroSource) {
+        case GyroSource::Left:  return left;
+        case GyroSource::Right: return right;
+        case GyroSource::Both:
+        default:
+            break;
+    }
+
+    if (!left.valid) return right;
+    if (!right.valid) return left;
+
+    MotionSample combined = left.timestampUs >= right.timestampUs ? left : right;
+    combined.accelX = (left.accelX + right.accelX) * 0.5f;
+    combined.accelY = (left.accelY + right.accelY) * 0.5f;
+    combined.accelZ = (left.accelZ + right.accelZ) * 0.5f;
+    combined.gyroX  = (left.gyroX + right.gyroX) * 0.5f;
+    combined.gyroY  = (left.gyroY + right.gyroY) * 0.5f;
+    combined.gyroZ  = (left.gyroZ + right.gyroZ) * 0.5f;
+    return combined;
+}
+
 MotionData DecodeMotion(const std::vector<uint8_t>& buffer)
 {
     return DecodeMotionRaw(buffer);
@@ -435,7 +417,7 @@ static std::pair<int16_t, int16_t> decode_calibrated_stick(const uint8_t* data,
     };
 }
 
-DS4_REPORT_EX GenerateDS4Report(const std::vector<uint8_t>& buffer, JoyConSide side, JoyConOrientation orientation)
+DS4_REPORT_EX GenerateDS4Report(const std::vector<uint8_t>& buffer, JoyConSide side, JoyConOrientation orientation, const CalibrationProfile* calibration)
 {
     DS4_REPORT_EX report{};
     DS4_REPORT_INIT(reinterpret_cast<PDS4_REPORT>(&report.Report));
@@ -448,7 +430,7 @@ DS4_REPORT_EX GenerateDS4Report(const std::vector<uint8_t>& buffer, JoyConSide s
     int btnOffset = isLeft ? 4 : 3;
     uint32_t state = (buffer[btnOffset] << 16) | (buffer[btnOffset + 1] << 8) | buffer[btnOffset + 2];
 
-    auto [stickX, stickY] = decode_joystick(buffer, isLeft, upright);
+    auto [stickX, stickY] = decode_joystick(buffer, isLeft, upright, calibration);
 
     if (isLeft) {
         bool up    = (state & BUTTON_UP_MASK_LEFT) != 0;
@@ -505,7 +487,7 @@ DS4_REPORT_EX GenerateDS4Report(const std::vector<uint8_t>& buffer, JoyConSide s
     return report;
 }
 
-DS4_REPORT_EX GenerateDualJoyConDS4Report(const std::vector<uint8_t>& leftBuffer, const std::vector<uint8_t>& rightBuffer, GyroSource gyroSource)
+DS4_REPORT_EX GenerateDualJoyConDS4Report(const std::vector<uint8_t>& leftBuffer, const std::vector<uint8_t>& rightBuffer, GyroSource gyroSource, const CalibrationProfile* calibration)
 {
     DS4_REPORT_EX report{};
     DS4_REPORT_INIT(reinterpret_cast<PDS4_REPORT>(&report.Report));
@@ -514,11 +496,11 @@ DS4_REPORT_EX GenerateDualJoyConDS4Report(const std::vector<uint8_t>& leftBuffer
 
     DS4_REPORT_EX leftReport{};
     if (leftBuffer.size() >= 0x3C)
-        leftReport = GenerateDS4Report(leftBuffer, JoyConSide::Left, JoyConOrientation::Upright);
+        leftReport = GenerateDS4Report(leftBuffer, JoyConSide::Left, JoyConOrientation::Upright, calibration);
 
     DS4_REPORT_EX rightReport{};
     if (rightBuffer.size() >= 0x3C)
-        rightReport = GenerateDS4Report(rightBuffer, JoyConSide::Right, JoyConOrientation::Upright);
+        rightReport = GenerateDS4Report(rightBuffer, JoyConSide::Right, JoyConOrientation::Upright, calibration);
 
     USHORT leftDpad           = leftReport.Report.wButtons & 0xF;
     USHORT leftButtonsNoDpad  = leftReport.Report.wButtons & ~0xF;
@@ -581,7 +563,7 @@ DS4_REPORT_EX GenerateDualJoyConDS4Report(const std::vector<uint8_t>& leftBuffer
             auto combine_16 = [](int16_t a, int16_t b) -> int16_t {
                 if (a == 0) return b;
                 if (b == 0) return a;
-                return static_cast<int16_t>((a / 2) + (b / 2));
+                return static_cast<int16_t>((static_cast<int>(a) + static_cast<int>(b)) / 2);
             };
             report.Report.wAccelX = combine_16(leftReport.Report.wAccelX, rightReport.Report.wAccelX);
             report.Report.wAccelY = combine_16(leftReport.Report.wAccelY, rightReport.Report.wAccelY);
@@ -614,7 +596,7 @@ constexpr uint64_t BUTTON_L_THUMB     = 0x000008000000;
 constexpr uint64_t TRIGGER_LT_MASK    = 0x000000800000;
 constexpr uint64_t TRIGGER_RT_MASK    = 0x008000000000;
 
-DS4_REPORT_EX GenerateProControllerReport(const std::vector<uint8_t>& buffer)
+DS4_REPORT_EX GenerateProControllerReport(const std::vector<uint8_t>& buffer, const CalibrationProfile* calibration)
 {
     DS4_REPORT_EX report{};
     DS4_REPORT_INIT(reinterpret_cast<PDS4_REPORT>(&report.Report));
@@ -656,7 +638,7 @@ DS4_REPORT_EX GenerateProControllerReport(const std::vector<uint8_t>& buffer)
     report.Report.bTriggerL = (state & TRIGGER_LT_MASK) ? 255 : 0;
     report.Report.bTriggerR = (state & TRIGGER_RT_MASK) ? 255 : 0;
 
-    const auto& cal = GetActiveCalibration();
+    const auto& cal = calibration ? *calibration : ActiveCalibrationForThread();
     auto [lx, ly] = decode_calibrated_stick(&buffer[10], cal.leftStick);
     ly = -ly;
     auto [rx, ry] = decode_calibrated_stick(&buffer[13], cal.rightStick);
@@ -672,7 +654,7 @@ DS4_REPORT_EX GenerateProControllerReport(const std::vector<uint8_t>& buffer)
     return report;
 }
 
-DS4_REPORT_EX GenerateNSOGCReport(const std::vector<uint8_t>& buffer)
+DS4_REPORT_EX GenerateNSOGCReport(const std::vector<uint8_t>& buffer, const CalibrationProfile* calibration)
 {
     DS4_REPORT_EX report{};
     DS4_REPORT_INIT(reinterpret_cast<PDS4_REPORT>(&report.Report));
@@ -716,7 +698,7 @@ DS4_REPORT_EX GenerateNSOGCReport(const std::vector<uint8_t>& buffer)
     report.Report.bTriggerL = buffer[0x3c];
     report.Report.bTriggerR = buffer[0x3d];
 
-    const auto& cal = GetActiveCalibration();
+    const auto& cal = calibration ? *calibration : ActiveCalibrationForThread();
     auto [lx, ly] = decode_calibrated_stick(&buffer[10], cal.leftStick);
     ly = -ly;
     auto [rx, ry] = decode_calibrated_stick(&buffer[13], cal.rightStick);
@@ -738,6 +720,15 @@ uint32_t ExtractButtonState(const std::vector<uint8_t>& buffer)
     return (buffer[3] << 16) | (buffer[4] << 8) | buffer[5];
 }
 
+uint32_t ExtractReportCounter(const std::vector<uint8_t>& buffer)
+{
+    // Byte 3 is the first button byte, not part of the counter.
+    if (buffer.size() < 3) return 0;
+    return static_cast<uint32_t>(buffer[0])
+        | (static_cast<uint32_t>(buffer[1]) << 8)
+        | (static_cast<uint32_t>(buffer[2]) << 16);
+}
+
 std::pair<int16_t, int16_t> GetRawOpticalMouse(const std::vector<uint8_t>& buffer)
 {
     if (buffer.size() < 0x18) return { 0, 0 };
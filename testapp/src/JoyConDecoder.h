@@ -1,10 +1,11 @@
 #pragma once
 #include <vector>
+#include <memory>
 #include <utility>
 #include <cstdint>
 #include <string>
 #include <Windows.h>
-#include <ViGEm/Client.h>
+#include <ViGEm/Common.h>
 
 enum class JoyConSide { Left, Right };
 enum class JoyConOrientation { Upright, Sideways };
@@ -23,6 +24,24 @@ struct MotionData {
     SHORT accelX, accelY, accelZ;
 };
 
+// Per-device conversion from raw IMU counts to physical units. The defaults
+// match the Joy-Con 2 datasheet values: 4096 = 1 g, 48000 = 360 deg/s.
+struct MotionScale {
+    float accelCountsPerG = 4096.0f;
+    float gyroCountsPerDps = 48000.0f / 360.0f;
+    float gyroBiasX = 0.0f, gyroBiasY = 0.0f, gyroBiasZ = 0.0f;   // raw counts at rest
+};
+
+// Full-precision motion sample decoded straight from a report. accel is in g,
+// gyro in deg/s; timestampUs is the steady-clock time the sample belongs to.
+struct MotionSample {
+    float accelX = 0.0f, accelY = 0.0f, accelZ = 0.0f;
+    float gyroX = 0.0f, gyroY = 0.0f, gyroZ = 0.0f;
+    uint64_t timestampUs = 0;
+    uint32_t reportCounter = 0;
+    bool valid = false;
+};
+
 struct StickCalibration {
     int centerX = 2048;
     int centerY = 2048;
@@ -38,21 +57,39 @@ struct CalibrationProfile {
     StickCalibration rightStick;
 };
 
+// The profile list is edited from one thread (the UI). Every change that
+// affects the active profile publishes a copy of it; input threads only ever
+// see those copies, through GetActiveCalibrationSnapshot or the decoders'
+// nullptr fallback.
 void LoadCalibrationProfiles(const std::string& path);
 void SaveCalibrationProfiles(const std::string& path);
+// The file SaveCalibrationProfiles writes, for saving it elsewhere.
+std::string SerializeCalibrationProfiles();
+// Replaces the whole list, e.g. with a calibration file reloaded after an
+// outside edit.
+void SetCalibrationProfiles(std::vector<CalibrationProfile> profiles, int activeIndex);
 void ExtractRawStick(const std::vector<uint8_t>& buffer, bool isLeft, int& outX, int& outY);
 const std::vector<CalibrationProfile>& GetCalibrationProfiles();
 void AddCalibrationProfile(const CalibrationProfile& profile);
 void DeleteCalibrationProfile(int index);
 int GetActiveCalibrationIndex();
 void SetActiveCalibrationIndex(int index);
+// Editing thread only: a reference into the list, invalidated by the next edit.
 const CalibrationProfile& GetActiveCalibration();
+std::shared_ptr<const CalibrationProfile> GetActiveCalibrationSnapshot();
+
+// The report generators take an optional per-device calibration; nullptr
+// falls back to the active profile.
 
-DS4_REPORT_EX GenerateDS4Report(const std::vector<uint8_t>& buffer, JoyConSide side, JoyConOrientation orientation);
-DS4_REPORT_EX GenerateDualJoyConDS4Report(const std::vector<uint8_t>& leftBuffer, const std::vector<uint8_t>& rightBuffer, GyroSource gyroSource);
-DS4_REPORT_EX GenerateProControllerReport(const std::vector<uint8_t>& buffer);
-DS4_REPORT_EX GenerateNSOGCReport(const std::vector<uint8_t>& buffer);
+DS4_REPORT_EX GenerateDS4Report(const std::vector<uint8_t>& buffer, JoyConSide side, JoyConOrientation orientation, const CalibrationProfile* calibration = nullptr);
+DS4_REPORT_EX GenerateDualJoyConDS4Report(const std::vector<uint8_t>& leftBuffer, const std::vector<uint8_t>& rightBuffer, GyroSource gyroSource, const CalibrationProfile* calibration = nullptr);
+DS4_REPORT_EX GenerateProControllerReport(const std::vector<uint8_t>& buffer, const CalibrationProfile* calibration = nullptr);
+DS4_REPORT_EX GenerateNSOGCReport(const std::vector<uint8_t>& buffer, const CalibrationProfile* calibration = nullptr);
 uint32_t ExtractButtonState(const std::vector<uint8_t>& buffer);
+// The controller's 24-bit report counter; it wraps at 2^24.
+uint32_t ExtractReportCounter(const std::vector<uint8_t>& buffer);
 std::pair<int16_t, int16_t> GetRawOpticalMouse(const std::vector<uint8_t>& buffer);
-StickData DecodeJoystick(const std::vector<uint8_t>& buffer, JoyConSide side, JoyConOrientation orientation);
+StickData DecodeJoystick(const std::vector<uint8_t>& buffer, JoyConSide side, JoyConOrientation orientation, const CalibrationProfile* calibration = nullptr);
 MotionData DecodeMotionRaw(const std::vector<uint8_t>& buffer);
+MotionSample DecodeMotionSample(const std::vector<uint8_t>& buffer, uint64_t timestampUs, const MotionScale& scale = {});
+MotionSample CombineMotionSamples(const MotionSample& left, const MotionSample& right, GyroSource gyroSource);
@@ -0,0 +1,183 @@
+#include "LogRing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+
+namespace
+{
+    uint64_t SteadyNowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    int64_t SystemNowNs()
+    {
+        return static_cast<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    size_t RoundUpPow2(size_t n)
+    {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+}
+
+const char* LogLevelName(LogLevel level)
+{
+    switch (level) {
+    case LogLevel::Debug:   return "DEBUG";
+    case LogLevel::Info:    return "INFO";
+    case LogLevel::Warning: return "WARN";
+    case LogLevel::Error:   return "ERROR";
+    }
+    return "INFO";
+}
+
+LogRing::LogRing(size_t capacity)
+    : cells_(std::make_unique<Cell[]>(RoundUpPow2(std::max<size_t>(capacity, 2))))
+    , mask_(RoundUpPow2(std::max<size_t>(capacity, 2)) - 1)
+{
+    for (size_t i = 0; i <= mask_; ++i) cells_[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool LogRing::Push(LogLevel level, int player, std::string_view text)
+{
+    const uint64_t now = SteadyNowNs();
+    uint64_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &cells_[pos & mask_];
+        const uint64_t seq = cell->sequence.load(std::memory_order_acquire);
+        const int64_t diff = static_cast<int64_t>(seq - pos);
+        if (diff == 0) {
+            if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            pos = enqueuePos_.load(std::memory_order_relaxed);
+        }
+    }
+
+    LogRecord& r = cell->record;
+    size_t n = std::min(text.size(), LogRecord::kMaxText);
+    // Cut at a character boundary, not inside a UTF-8 sequence.
+    if (n < text.size())
+        while (n > 0 && (static_cast<unsigned char>(text[n]) & 0xC0) == 0x80) --n;
+    std::memcpy(r.text, text.data(), n);
+    r.length = static_cast<uint16_t>(n);
+    r.timestampNs = now;
+    r.sequence = pos;
+    r.level = level;
+    r.player = static_cast<int8_t>(std::clamp(player, -1, 127));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+LogHistory::LogHistory(size_t capacity)
+    : lines_(std::max<size_t>(capacity, 1))
+    , steadyAtStartNs_(SteadyNowNs())
+    , systemAtStartNs_(SystemNowNs())
+{
+}
+
+void LogHistory::Append(const LogRecord& record)
+{
+    Entry& e = lines_[(start_ + size_) % lines_.size()];
+    if (size_ < lines_.size()) ++size_;
+    else start_ = (start_ + 1) % lines_.size();
+    ++appended_;
+
+    const int64_t wallNs = systemAtStartNs_ + (static_cast<int64_t>(record.timestampNs) - static_cast<int64_t>(steadyAtStartNs_));
+    const std::time_t seconds = static_cast<std::time_t>(wallNs / 1000000000);
+    const int millis = static_cast<int>((wallNs / 1000000) % 1000);
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char prefix[48];
+    int n = std::snprintf(prefix, sizeof(prefix), "%02d:%02d:%02d.%03d %-5s ",
+        local.tm_hour, local.tm_min, local.tm_sec, millis, LogLevelName(record.level));
+    if (record.player >= 0 && n > 0 && n < static_cast<int>(sizeof(prefix)))
+        n += std::snprintf(prefix + n, sizeof(prefix) - n, "[P%d] ", record.player + 1);
+
+    // The entry's string keeps its capacity, so a full history stops allocating.
+    e.text.assign(prefix, static_cast<size_t>(std::clamp(n, 0, static_cast<int>(sizeof(prefix) - 1))));
+    e.text.append(record.text, record.length);
+    e.level = record.level;
+}
+
+std::string LogHistory::Joined(const char* separator) const
+{
+    std::string out;
+    for (size_t i = 0; i < size_; ++i) {
+        out += Line(i);
+        out += separator;
+    }
+    return out;
+}
+
+RollingLogFile::RollingLogFile(uint64_t maxBytes, int keep)
+    : maxBytes_(std::max<uint64_t>(maxBytes, 4096))
+    , keep_(std::max(keep, 1))
+{
+}
+
+RollingLogFile::~RollingLogFile()
+{
+    Close();
+}
+
+bool RollingLogFile::Open(const std::string& path)
+{
+    Close();
+    path_ = path;
+    file_ = std::fopen(path_.c_str(), "ab");
+    if (!file_) return false;
+    std::error_code ec;
+    const auto existing = std::filesystem::file_size(path_, ec);
+    size_ = ec ? 0 : static_cast<uint64_t>(existing);
+    return true;
+}
+
+void RollingLogFile::Close()
+{
+    if (!file_) return;
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+void RollingLogFile::Write(std::string_view line)
+{
+    if (!file_) return;
+    std::fwrite(line.data(), 1, line.size(), file_);
+    std::fputc('\n', file_);
+    size_ += line.size() + 1;
+    if (size_ >= maxBytes_) Roll();
+}
+
+void RollingLogFile::Flush()
+{
+    if (file_) std::fflush(file_);
+}
+
+void RollingLogFile::Roll()
+{
+    std::fclose(file_);
+    file_ = nullptr;
+    std::error_code ec;
+    std::filesystem::remove(path_ + "." + std::to_string(keep_), ec);
+    for (int i = keep_ - 1; i >= 1; --i)
+        std::filesystem::rename(path_ + "." + std::to_string(i), path_ + "." + std::to_string(i + 1), ec);
+    std::filesystem::rename(path_, path_ + ".1", ec);
+    file_ = std::fopen(path_.c_str(), "wb");
+    size_ = 0;
+}
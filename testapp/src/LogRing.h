@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class LogLevel : uint8_t { Debug, Info, Warning, Error };
+
+const char* LogLevelName(LogLevel level);
+
+// One log message as the logging thread left it: the text is copied in
+// verbatim and everything else is stored raw, so turning it into a line
+// (clock time, level, player) happens on the thread that drains the ring.
+struct LogRecord {
+    static constexpr size_t kMaxText = 232;
+
+    uint64_t timestampNs = 0;   // steady clock
+    uint64_t sequence = 0;      // order of Push across all threads
+    LogLevel level = LogLevel::Info;
+    int8_t   player = -1;       // 0-based player slot, -1 for app-wide messages
+    uint16_t length = 0;
+    char     text[kMaxText];
+};
+
+// Fixed-capacity multi-producer, single-consumer ring of log records
+// (Vyukov's bounded queue). Push never blocks, allocates or takes a lock,
+// so BLE callbacks and input threads can log; when the consumer falls a
+// whole ring behind, new records are dropped and counted.
+class LogRing {
+public:
+    explicit LogRing(size_t capacity = 1024);
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    // Any thread. Text longer than LogRecord::kMaxText is cut.
+    bool Push(LogLevel level, int player, std::string_view text);
+
+    // Consumer thread only: hands each waiting record to fn, oldest first.
+    template <typename Fn>
+    size_t Drain(Fn&& fn)
+    {
+        size_t n = 0;
+        for (;;) {
+            Cell& cell = cells_[dequeuePos_ & mask_];
+            if (cell.sequence.load(std::memory_order_acquire) != dequeuePos_ + 1) break;
+            fn(static_cast<const LogRecord&>(cell.record));
+            cell.sequence.store(dequeuePos_ + mask_ + 1, std::memory_order_release);
+            ++dequeuePos_;
+            ++n;
+        }
+        return n;
+    }
+
+    size_t Capacity() const { return mask_ + 1; }
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Cell {
+        std::atomic<uint64_t> sequence{ 0 };
+        LogRecord record;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_ = 0;
+    alignas(64) std::atomic<uint64_t> enqueuePos_{ 0 };
+    alignas(64) uint64_t dequeuePos_ = 0;
+    std::atomic<uint64_t> dropped_{ 0 };
+};
+
+// The last N drained records, formatted once as they arrive:
+// "12:34:56.789 WARN  [P2] text". Owned by the consumer thread; lines are
+// indexed oldest first so a list clipper can draw just the visible ones.
+class LogHistory {
+public:
+    explicit LogHistory(size_t capacity = 1000);
+
+    void Append(const LogRecord& record);
+
+    size_t Size() const { return size_; }
+    const std::string& Line(size_t i) const { return lines_[(start_ + i) % lines_.size()].text; }
+    LogLevel Level(size_t i) const { return lines_[(start_ + i) % lines_.size()].level; }
+    // Bumped by every Append, for follow-the-tail scrolling.
+    uint64_t Appended() const { return appended_; }
+
+    std::string Joined(const char* separator = "\n") const;
+
+private:
+    struct Entry {
+        std::string text;
+        LogLevel level = LogLevel::Info;
+    };
+
+    std::vector<Entry> lines_;
+    size_t start_ = 0;
+    size_t size_ = 0;
+    uint64_t appended_ = 0;
+    // Steady-clock record times become wall-clock times through this pair.
+    uint64_t steadyAtStartNs_ = 0;
+    int64_t systemAtStartNs_ = 0;
+};
+
+// Appends lines to path; once it passes maxBytes it becomes path.1, the old
+// path.1 becomes path.2 and so on, keeping the newest keep files.
+class RollingLogFile {
+public:
+    explicit RollingLogFile(uint64_t maxBytes = 1 << 20, int keep = 3);
+    ~RollingLogFile();
+
+    RollingLogFile(const RollingLogFile&) = delete;
+    RollingLogFile& operator=(const RollingLogFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return file_ != nullptr; }
+    const std::string& Path() const { return path_; }
+
+    void Write(std::string_view line);
+    void Flush();
+
+private:
+    void Roll();
+
+    std::string path_;
+    std::FILE* file_ = nullptr;
+    uint64_t size_ = 0;
+    uint64_t maxBytes_;
+    int keep_;
+};
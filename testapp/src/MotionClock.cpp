@@ -0,0 +1,60 @@
+#include "MotionClock.h"
+
+#include <algorithm>
+
+namespace {
+constexpr double kMinPeriodUs = 1000.0;
+constexpr double kMaxPeriodUs = 50000.0;
+constexpr double kPeriodGain = 0.02;
+constexpr double kDriftGain = 0.05;
+constexpr uint32_t kMaxCounterStep = 8;
+constexpr uint32_t kCounterMask = 0xFFFFFF;   // the report counter is 24 bits
+constexpr double kResyncPeriods = 4.0;
+}
+
+void MotionClock::Reset()
+{
+    *this = MotionClock{};
+}
+
+uint64_t MotionClock::Stamp(uint64_t arrivalUs, uint32_t reportCounter)
+{
+    if (lastOutputUs_ == 0) {
+        lastArrivalUs_ = arrivalUs;
+        lastOutputUs_ = arrivalUs;
+        lastCounter_ = reportCounter;
+        return arrivalUs;
+    }
+
+    // The report counter lets a lost report count as two periods instead of
+    // one long one. Anything implausible is treated as a single step.
+    uint32_t steps = (reportCounter - lastCounter_) & kCounterMask;
+    if (steps == 0 || steps > kMaxCounterStep) steps = 1;
+    lastCounter_ = reportCounter;
+
+    const double arrivalDelta = static_cast<double>(arrivalUs - lastArrivalUs_) / steps;
+    lastArrivalUs_ = arrivalUs;
+    if (arrivalDelta >= kMinPeriodUs && arrivalDelta <= kMaxPeriodUs) {
+        periodUs_ = periodUs_ == 0.0 ? arrivalDelta : periodUs_ + kPeriodGain * (arrivalDelta - periodUs_);
+    }
+    if (periodUs_ == 0.0) {
+        lastOutputUs_ = std::max(arrivalUs, lastOutputUs_ + 1);
+        return lastOutputUs_;
+    }
+
+    const double predicted = static_cast<double>(lastOutputUs_) + periodUs_ * steps;
+    const double error = static_cast<double>(arrivalUs) - predicted;
+    double output;
+    if (error < 0.0 || error > periodUs_ * kResyncPeriods) {
+        // Early arrival means our estimate runs late; a long gap means the
+        // link stalled. Either way snap to the host clock.
+        output = static_cast<double>(arrivalUs);
+        driftUs_ = 0.0;
+    } else {
+        driftUs_ += kDriftGain * (error - driftUs_);
+        output = predicted + kDriftGain * driftUs_;
+    }
+
+    lastOutputUs_ = std::max(static_cast<uint64_t>(output), lastOutputUs_ + 1);
+    return lastOutputUs_;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+// Turns BLE arrival times into motion sample timestamps. Arrival times carry
+// the radio/stack scheduling jitter; the controller itself samples on a steady
+// cadence. The clock tracks that cadence and the lower envelope of arrivals
+// (a report can be delayed, never early), so the output advances by whole
+// report periods and only drifts slowly toward the host clock.
+class MotionClock {
+public:
+    // reportCounter is the controller's 24-bit counter; steps wrap at 2^24.
+    uint64_t Stamp(uint64_t arrivalUs, uint32_t reportCounter);
+    void Reset();
+
+    double PeriodUs() const { return periodUs_; }
+
+private:
+    uint64_t lastArrivalUs_ = 0;
+    uint64_t lastOutputUs_ = 0;
+    uint32_t lastCounter_ = 0;
+    double periodUs_ = 0.0;
+    double driftUs_ = 0.0;
+};
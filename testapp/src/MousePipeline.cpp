@@ -0,0 +1,154 @@
+#include "MousePipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace
+{
+    // Stick thresholds, in calibrated units (full deflection is 32767).
+    constexpr int   kScrollDeadzone = 4000;
+    constexpr int   kSideButtonThreshold = 28000;
+    // Wheel units per report at full deflection; 120 is one notch.
+    constexpr float kScrollSpeed = 40.f;
+    constexpr float kNotch = 120.f;
+
+    MouseEvent ButtonEvent(MouseEvent::Type type, MouseButton button)
+    {
+        MouseEvent e;
+        e.type = type;
+        e.button = button;
+        return e;
+    }
+
+    // Whole pixels out of an accumulator, leaving the fraction behind.
+    int32_t TakeWhole(float& remainder)
+    {
+        const float whole = std::trunc(remainder);
+        remainder -= whole;
+        return static_cast<int32_t>(whole);
+    }
+}
+
+MousePipeline::MousePipeline(const MouseCurve& curve)
+    : curve_(curve)
+{
+    BuildGain();
+}
+
+void MousePipeline::SetCurve(const MouseCurve& curve)
+{
+    if (curve == curve_) return;
+    curve_ = curve;
+    BuildGain();
+}
+
+void MousePipeline::BuildGain()
+{
+    for (int v = 0; v <= kSaturation; ++v)
+        gain_[v] = curve_.sensitivity * (1.f + curve_.acceleration * static_cast<float>(v) / 16.f);
+}
+
+float MousePipeline::Gain(float speed) const
+{
+    const int i = static_cast<int>(std::min(speed + 0.5f, static_cast<float>(kSaturation)));
+    return gain_[std::max(i, 0)];
+}
+
+void MousePipeline::Process(const MouseReport& in, float scale, MouseBatch& out)
+{
+    if (!havePosition_) {
+        lastX_ = in.opticalX;
+        lastY_ = in.opticalY;
+        havePosition_ = true;
+    } else {
+        const int16_t dx = WrapDelta(in.opticalX, lastX_);
+        const int16_t dy = WrapDelta(in.opticalY, lastY_);
+        lastX_ = in.opticalX;
+        lastY_ = in.opticalY;
+        if (dx || dy) {
+            const float fx = dx, fy = dy;
+            const float g = Gain(std::sqrt(fx * fx + fy * fy)) * scale;
+            remainderX_ += fx * g;
+            remainderY_ += fy * g;
+            MouseEvent e;
+            e.dx = TakeWhole(remainderX_);
+            e.dy = TakeWhole(remainderY_);
+            if (e.dx || e.dy) out.Add(e);
+        }
+    }
+
+    Edge(in.left, left_, MouseButton::Left, out);
+    Edge(in.right, right_, MouseButton::Right, out);
+    Edge(in.middle, middle_, MouseButton::Middle, out);
+
+    // The stick scrolls, faster the further it is pushed.
+    const int y = in.stickY;
+    if (std::abs(y) > kScrollDeadzone) {
+        const float speed = (std::abs(y) - kScrollDeadzone) / (32767.f - kScrollDeadzone) * kScrollSpeed;
+        scroll_ += y > 0 ? -speed : speed;
+        if (std::abs(scroll_) >= kNotch) {
+            const int notches = static_cast<int>(scroll_ / kNotch);
+            scroll_ -= notches * kNotch;
+            MouseEvent e;
+            e.type = MouseEvent::Type::Wheel;
+            e.wheel = notches * static_cast<int32_t>(kNotch);
+            out.Add(e);
+        }
+    } else {
+        scroll_ = 0.f;
+    }
+
+    // A flick to either side is one click of back or forward.
+    auto click = [&out](bool flicked, bool& latched, MouseButton button) {
+        if (flicked && !latched) {
+            out.Add(ButtonEvent(MouseEvent::Type::Down, button));
+            out.Add(ButtonEvent(MouseEvent::Type::Up, button));
+        }
+        latched = flicked;
+    };
+    click(in.stickX < -kSideButtonThreshold, back_, MouseButton::X1);
+    click(in.stickX > kSideButtonThreshold, forward_, MouseButton::X2);
+}
+
+void MousePipeline::Release(MouseBatch& out)
+{
+    Edge(false, left_, MouseButton::Left, out);
+    Edge(false, right_, MouseButton::Right, out);
+    Edge(false, middle_, MouseButton::Middle, out);
+    back_ = forward_ = false;
+    Reset();
+}
+
+void MousePipeline::Reset()
+{
+    havePosition_ = false;
+    remainderX_ = remainderY_ = 0.f;
+    scroll_ = 0.f;
+}
+
+void MousePipeline::Edge(bool now, bool& held, MouseButton button, MouseBatch& out)
+{
+    if (now == held) return;
+    out.Add(ButtonEvent(now ? MouseEvent::Type::Down : MouseEvent::Type::Up, button));
+    held = now;
+}
+
+void RecordingMouseSink::Send(const MouseBatch& batch)
+{
+    ++batches_;
+    for (const MouseEvent& e : batch) {
+        events_.push_back(e);
+        if (e.type == MouseEvent::Type::Move) {
+            totalX_ += e.dx;
+            totalY_ += e.dy;
+        }
+    }
+}
+
+void RecordingMouseSink::Clear()
+{
+    events_.clear();
+    batches_ = 0;
+    totalX_ = totalY_ = 0;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// What one right Joy-Con report says about the mouse: the optical sensor's
+// running position, the three mouse buttons and the calibrated stick, which
+// scrolls (up/down) and clicks back/forward (flicked left/right).
+struct MouseReport {
+    int16_t opticalX = 0, opticalY = 0;
+    bool    left = false, right = false, middle = false;
+    int16_t stickX = 0, stickY = 0;
+};
+
+enum class MouseButton : uint8_t { Left, Right, Middle, X1, X2 };
+
+struct MouseEvent {
+    enum class Type : uint8_t { Move, Down, Up, Wheel };
+
+    Type        type = Type::Move;
+    MouseButton button = MouseButton::Left;
+    int32_t     dx = 0, dy = 0;   // Move: pixels
+    int32_t     wheel = 0;        // Wheel: 120 per notch, positive away from the user
+};
+
+// Everything one report turns into, in order, so a sink can inject it in one
+// call. Fixed size: a report moves once, changes each of three buttons at
+// most once, scrolls once and clicks each side button down and up.
+struct MouseBatch {
+    static constexpr size_t kMaxEvents = 10;
+
+    std::array<MouseEvent, kMaxEvents> events;
+    size_t count = 0;
+
+    void Clear() { count = 0; }
+    bool Empty() const { return count == 0; }
+    const MouseEvent* begin() const { return events.data(); }
+    const MouseEvent* end() const { return events.data() + count; }
+    void Add(const MouseEvent& e) { if (count < kMaxEvents) events[count++] = e; }
+};
+
+// Pointer speed as a function of how fast the sensor moves. The gain at rest
+// is sensitivity; every 16 counts per report of speed add acceleration times
+// that, up to MousePipeline::kSaturation counts.
+struct MouseCurve {
+    float sensitivity = 1.0f;
+    float acceleration = 0.0f;
+    bool operator==(const MouseCurve&) const = default;
+};
+
+// Turns reports into pointer motion, button edges, wheel notches and side
+// button clicks. Motion keeps the fraction of a pixel it could not send and
+// adds it to the next report, so slow movement at low speeds still arrives
+// instead of rounding away to nothing.
+class MousePipeline {
+public:
+    static constexpr int kSaturation = 64;
+
+    explicit MousePipeline(const MouseCurve& curve = {});
+
+    // Rebuilds the gain table only when the curve changed.
+    void SetCurve(const MouseCurve& curve);
+    const MouseCurve& Curve() const { return curve_; }
+    // Gain for a sensor speed in counts per report.
+    float Gain(float speed) const;
+
+    // Appends this report's events to out. scale is the mode's speed on top
+    // of the curve. The first report after a Reset only sets the position.
+    void Process(const MouseReport& in, float scale, MouseBatch& out);
+
+    // Button-up events for anything held, then Reset; for leaving mouse mode.
+    void Release(MouseBatch& out);
+    // Forgets the sensor position and the sub-pixel remainders.
+    void Reset();
+
+    // Sensor positions are 16-bit counters: the delta is taken modulo 2^16,
+    // so a counter that rolls over reads as a small move, not a jump.
+    static int16_t WrapDelta(int16_t now, int16_t last)
+    {
+        return static_cast<int16_t>(static_cast<uint16_t>(static_cast<uint16_t>(now) - static_cast<uint16_t>(last)));
+    }
+
+private:
+    void BuildGain();
+    void Edge(bool now, bool& held, MouseButton button, MouseBatch& out);
+
+    MouseCurve curve_;
+    std::array<float, kSaturation + 1> gain_{};
+    bool    havePosition_ = false;
+    int16_t lastX_ = 0, lastY_ = 0;
+    float   remainderX_ = 0.f, remainderY_ = 0.f;
+    float   scroll_ = 0.f;
+    bool    left_ = false, right_ = false, middle_ = false;
+    bool    back_ = false, forward_ = false;
+};
+
+// Where mouse batches go: SendInput in the app, uinput or a recorder elsewhere.
+class MouseSink {
+public:
+    virtual ~MouseSink() = default;
+    virtual void Send(const MouseBatch& batch) = 0;
+};
+
+// Keeps every event it is sent; stands in for the OS when there is none.
+class RecordingMouseSink : public MouseSink {
+public:
+    void Send(const MouseBatch& batch) override;
+
+    const std::vector<MouseEvent>& Events() const { return events_; }
+    uint64_t Batches() const { return batches_; }
+    // Sum of all Move events.
+    int64_t TotalX() const { return totalX_; }
+    int64_t TotalY() const { return totalY_; }
+    void Clear();
+
+private:
+    std::vector<MouseEvent> events_;
+    uint64_t batches_ = 0;
+    int64_t  totalX_ = 0, totalY_ = 0;
+};
@@ -0,0 +1,216 @@
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Persistence.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <vector>
+
+bool WriteFileAtomically(const std::string& path, const std::string& contents)
+{
+    const std::string temp = path + ".tmp";
+    std::FILE* f = std::fopen(temp.c_str(), "wb");
+    if (!f) return false;
+
+    bool ok = std::fwrite(contents.data(), 1, contents.size(), f) == contents.size();
+    ok = std::fflush(f) == 0 && ok;
+#ifdef _WIN32
+    ok = _commit(_fileno(f)) == 0 && ok;
+#else
+    ok = fsync(fileno(f)) == 0 && ok;
+#endif
+    ok = std::fclose(f) == 0 && ok;
+
+    std::error_code ec;
+    if (ok)
+    {
+        // Replaces an existing file on Windows too (MoveFileEx semantics).
+        std::filesystem::rename(temp, path, ec);
+        if (!ec) return true;
+    }
+    std::filesystem::remove(temp, ec);
+    return false;
+}
+
+PersistenceService::PersistenceService(std::chrono::milliseconds debounce, std::chrono::milliseconds maxDelay)
+    : debounce_(debounce)
+    , maxDelay_(maxDelay)
+{
+}
+
+PersistenceService::~PersistenceService()
+{
+    Stop();
+}
+
+void PersistenceService::Start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    stop_ = false;
+    running_ = true;
+    worker_ = std::thread([this] { WriterLoop(); });
+}
+
+void PersistenceService::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return;
+        stop_ = true;
+    }
+    cv_.notify_all();
+    worker_.join();
+
+    // Changes that slipped in after the worker's last pass.
+    std::vector<Job> late;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = false;
+        for (auto& [path, entry] : entries_)
+        {
+            if (!entry.dirty) continue;
+            late.push_back(Job{ path, entry.serialize, std::move(entry.contents) });
+            entry.contents.reset();
+            entry.dirty = false;
+        }
+    }
+    for (auto& job : late) Write(job);
+}
+
+bool PersistenceService::Running() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+void PersistenceService::Register(const std::string& path, std::function<std::string()> serialize)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[path].serialize = std::move(serialize);
+}
+
+void PersistenceService::Touch(Entry& entry)
+{
+    const auto now = Clock::now();
+    if (!entry.dirty) entry.firstChange = now;
+    entry.lastChange = now;
+    entry.dirty = true;
+    requests_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PersistenceService::MarkDirty(const std::string& path)
+{
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(path);
+        if (it == entries_.end() || !it->second.serialize) return;
+        if (running_)
+        {
+            Touch(it->second);
+            cv_.notify_one();
+            return;
+        }
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        job = Job{ path, it->second.serialize, std::nullopt };
+    }
+    Write(job);
+}
+
+void PersistenceService::Submit(const std::string& path, std::string contents)
+{
+    Job job;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_)
+        {
+            Entry& entry = entries_[path];
+            entry.contents = std::move(contents);
+            Touch(entry);
+            cv_.notify_one();
+            return;
+        }
+        requests_.fetch_add(1, std::memory_order_relaxed);
+        job = Job{ path, nullptr, std::move(contents) };
+    }
+    Write(job);
+}
+
+void PersistenceService::Flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!running_) return;
+    flushAll_ = true;
+    cv_.notify_one();
+    idle_.wait(lock, [this] {
+        if (writing_ > 0) return false;
+        for (const auto& [path, entry] : entries_)
+            if (entry.dirty) return false;
+        return true;
+    });
+}
+
+bool PersistenceService::Pending(const std::string& path) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(path);
+    return it != entries_.end() && it->second.dirty;
+}
+
+void PersistenceService::Write(Job& job)
+{
+    const std::string text = job.contents ? std::move(*job.contents) : job.serialize();
+    // The worker and synchronous callers would otherwise share temp files.
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    if (WriteFileAtomically(job.path, text)) writes_.fetch_add(1, std::memory_order_relaxed);
+    else failures_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PersistenceService::WriterLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;)
+    {
+        const bool all = stop_ || flushAll_;
+        const auto now = Clock::now();
+        auto next = Clock::time_point::max();
+        std::vector<Job> due;
+        for (auto& [path, entry] : entries_)
+        {
+            if (!entry.dirty) continue;
+            const auto at = std::min(entry.lastChange + debounce_, entry.firstChange + maxDelay_);
+            if (!all && at > now)
+            {
+                next = std::min(next, at);
+                continue;
+            }
+            due.push_back(Job{ path, entry.serialize, std::move(entry.contents) });
+            entry.contents.reset();
+            entry.dirty = false;
+        }
+        flushAll_ = false;
+
+        if (!due.empty())
+        {
+            // Serialising and writing happen unlocked; a change arriving
+            // meanwhile marks the entry dirty again and is picked up next.
+            ++writing_;
+            lock.unlock();
+            for (auto& job : due) Write(job);
+            lock.lock();
+            --writing_;
+            idle_.notify_all();
+            continue;
+        }
+
+        idle_.notify_all();
+        if (stop_) return;
+        if (next == Clock::time_point::max()) cv_.wait(lock);
+        else cv_.wait_until(lock, next);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+// Replaces path with contents in one step: the text goes to a temporary
+// file next to it, which is flushed to disk and renamed over the original.
+// A crash or full disk leaves either the old file or the new one, never a
+// truncated mix.
+bool WriteFileAtomically(const std::string& path, const std::string& contents);
+
+// Writes settings and cache files on a background thread. Callers only say
+// that a file changed; changes to the same file are coalesced, and a file
+// is written once it has been quiet for the debounce interval (or has been
+// pending for maxDelay, so a steady stream of edits still gets saved).
+// Nothing here blocks on disk except Flush and Stop.
+class PersistenceService {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PersistenceService(std::chrono::milliseconds debounce = std::chrono::milliseconds(250),
+                                std::chrono::milliseconds maxDelay = std::chrono::milliseconds(2000));
+    ~PersistenceService();
+
+    PersistenceService(const PersistenceService&) = delete;
+    PersistenceService& operator=(const PersistenceService&) = delete;
+
+    void Start();
+    // Writes whatever is still pending, then stops the worker. Until the
+    // next Start, changes are written synchronously by the caller.
+    void Stop();
+    bool Running() const;
+
+    // For state with its own lock: serialize is called on the worker, at
+    // write time, so only the latest state is ever written.
+    void Register(const std::string& path, std::function<std::string()> serialize);
+    void MarkDirty(const std::string& path);
+
+    // For state owned by a single thread: serialise it there and hand over
+    // the text; a later Submit for the same path replaces it.
+    void Submit(const std::string& path, std::string contents);
+
+    // Writes everything pending now and waits for it.
+    void Flush();
+
+    // True while a change to path is queued and not yet written.
+    bool Pending(const std::string& path) const;
+
+    uint64_t Requests() const { return requests_.load(std::memory_order_relaxed); }
+    uint64_t Writes() const { return writes_.load(std::memory_order_relaxed); }
+    uint64_t Failures() const { return failures_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        std::function<std::string()> serialize;
+        std::optional<std::string>   contents;   // Submit: text waiting to be written
+        bool              dirty = false;
+        Clock::time_point firstChange{};
+        Clock::time_point lastChange{};
+    };
+
+    struct Job {
+        std::string path;
+        std::function<std::string()> serialize;
+        std::optional<std::string> contents;
+    };
+
+    void Touch(Entry& entry);
+    void WriterLoop();
+    void Write(Job& job);
+
+    std::chrono::milliseconds debounce_;
+    std::chrono::milliseconds maxDelay_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::condition_variable idle_;
+    std::mutex writeMutex_;
+    std::map<std::string, Entry> entries_;
+    std::thread worker_;
+    bool running_ = false;
+    bool stop_ = false;
+    bool flushAll_ = false;
+    int  writing_ = 0;
+
+    std::atomic<uint64_t> requests_{ 0 };
+    std::atomic<uint64_t> writes_{ 0 };
+    std::atomic<uint64_t> failures_{ 0 };
+};
@@ -0,0 +1,142 @@
+#include "PlayerTelemetry.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // A step this large is a reset or garbage, not lost reports.
+    constexpr uint32_t kMaxSequenceStep = 1000;
+    // The controller's report counter is 24 bits.
+    constexpr uint32_t kSequenceMask = 0xFFFFFF;
+
+    float StickAxis(uint8_t value)
+    {
+        return (static_cast<float>(value) - 128.f) / 127.f;
+    }
+}
+
+const char* TelemetryTraceName(TelemetryTrace trace)
+{
+    switch (trace) {
+    case TelemetryTrace::IntervalMs: return "Interval (ms)";
+    case TelemetryTrace::DecodeUs:   return "Decode (us)";
+    case TelemetryTrace::SubmitUs:   return "Submit (us)";
+    case TelemetryTrace::LeftX:      return "Left X";
+    case TelemetryTrace::LeftY:      return "Left Y";
+    case TelemetryTrace::RightX:     return "Right X";
+    case TelemetryTrace::RightY:     return "Right Y";
+    case TelemetryTrace::GyroX:      return "Gyro X (deg/s)";
+    case TelemetryTrace::GyroY:      return "Gyro Y (deg/s)";
+    case TelemetryTrace::GyroZ:      return "Gyro Z (deg/s)";
+    case TelemetryTrace::Count:      break;
+    }
+    return "?";
+}
+
+void PlayerTelemetry::RecordReport(uint64_t arrivalNs, uint32_t sequence)
+{
+    ++totals_.reports;
+    ++windowReports_;
+    if (!started_) {
+        started_ = true;
+        windowStartNs_ = arrivalNs;
+    } else {
+        const uint32_t step = (sequence - lastSequence_) & kSequenceMask;
+        if (step > 1 && step <= kMaxSequenceStep) totals_.lost += step - 1;
+        if (arrivalNs > lastArrivalNs_) {
+            const double ms = static_cast<double>(arrivalNs - lastArrivalNs_) * 1e-6;
+            ++intervals_;
+            intervalSum_ += ms;
+            intervalSquares_ += ms * ms;
+            intervalMax_ = std::max(intervalMax_, ms);
+            Push(TelemetryTrace::IntervalMs, static_cast<float>(ms));
+        }
+    }
+    lastArrivalNs_ = arrivalNs;
+    lastSequence_ = sequence;
+    if (arrivalNs - windowStartNs_ >= kWindowNs) Publish(arrivalNs);
+}
+
+void PlayerTelemetry::RecordHeld()
+{
+    ++totals_.held;
+}
+
+void PlayerTelemetry::RecordOutput(const PipelineOutput& out, uint64_t decodeNs, uint64_t submitNs)
+{
+    ++totals_.submitted;
+    ++outputs_;
+    const double decodeUs = static_cast<double>(decodeNs) * 1e-3, submitUs = static_cast<double>(submitNs) * 1e-3;
+    decodeSum_ += decodeUs;
+    decodeMax_ = std::max(decodeMax_, decodeUs);
+    submitSum_ += submitUs;
+    submitMax_ = std::max(submitMax_, submitUs);
+    Push(TelemetryTrace::DecodeUs, static_cast<float>(decodeUs));
+    Push(TelemetryTrace::SubmitUs, static_cast<float>(submitUs));
+
+    const auto& r = out.report.Report;
+    Push(TelemetryTrace::LeftX, StickAxis(r.bThumbLX));
+    Push(TelemetryTrace::LeftY, -StickAxis(r.bThumbLY));
+    Push(TelemetryTrace::RightX, StickAxis(r.bThumbRX));
+    Push(TelemetryTrace::RightY, -StickAxis(r.bThumbRY));
+    if (out.motion.valid) {
+        Push(TelemetryTrace::GyroX, out.motion.gyroX);
+        Push(TelemetryTrace::GyroY, out.motion.gyroY);
+        Push(TelemetryTrace::GyroZ, out.motion.gyroZ);
+    }
+}
+
+void PlayerTelemetry::RecordSkipped(bool vigem, bool dsu)
+{
+    totals_.vigemSkipped += vigem;
+    totals_.dsuSkipped += dsu;
+}
+
+size_t PlayerTelemetry::CopyTrace(TelemetryTrace trace, float* out) const
+{
+    const Ring& ring = rings_[static_cast<size_t>(trace)];
+    const uint64_t head = ring.head.load(std::memory_order_acquire);
+    const size_t n = static_cast<size_t>(std::min<uint64_t>(head, kTraceLength));
+    // The writer may overwrite the oldest few while this copies; a plot
+    // does not mind, and every value read is one that was written.
+    for (size_t i = 0; i < n; ++i)
+        out[i] = ring.values[(head - n + i) % kTraceLength].load(std::memory_order_relaxed);
+    return n;
+}
+
+void PlayerTelemetry::Push(TelemetryTrace trace, float value)
+{
+    Ring& ring = rings_[static_cast<size_t>(trace)];
+    const uint64_t head = ring.head.load(std::memory_order_relaxed);
+    ring.values[head % kTraceLength].store(value, std::memory_order_relaxed);
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+void PlayerTelemetry::Publish(uint64_t nowNs)
+{
+    TelemetrySnapshot s = totals_;
+    const double seconds = static_cast<double>(nowNs - windowStartNs_) * 1e-9;
+    s.rateHz = static_cast<float>(windowReports_ / seconds);
+    if (intervals_ > 0) {
+        const double mean = intervalSum_ / intervals_;
+        s.intervalMs = static_cast<float>(mean);
+        s.jitterMs = static_cast<float>(std::sqrt(std::max(0.0, intervalSquares_ / intervals_ - mean * mean)));
+        s.intervalMaxMs = static_cast<float>(intervalMax_);
+    }
+    if (outputs_ > 0) {
+        s.decodeUs = static_cast<float>(decodeSum_ / outputs_);
+        s.decodeMaxUs = static_cast<float>(decodeMax_);
+        s.submitUs = static_cast<float>(submitSum_ / outputs_);
+        s.submitMaxUs = static_cast<float>(submitMax_);
+    }
+    s.windowEndNs = nowNs;
+    snapshot_.Store(s);
+
+    windowStartNs_ = nowNs;
+    windowReports_ = 0;
+    intervals_ = 0;
+    intervalSum_ = intervalSquares_ = intervalMax_ = 0.0;
+    outputs_ = 0;
+    decodeSum_ = decodeMax_ = submitSum_ = submitMax_ = 0.0;
+}
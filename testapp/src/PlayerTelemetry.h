@@ -0,0 +1,83 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "ReportPipeline.h"
+#include "Seqlock.h"
+
+// A player's numbers over the last publish window, for the telemetry panel.
+struct TelemetrySnapshot {
+    uint64_t reports = 0;        // since connect
+    uint64_t submitted = 0;      // reports handed to the sinks
+    uint64_t vigemSkipped = 0;   // of those, unchanged ones the ViGEm pad was not sent
+    uint64_t dsuSkipped = 0;     // and the same for DSU
+    uint64_t held = 0;           // held back by the update policy
+    uint64_t lost = 0;           // never seen: gaps in the report sequence
+    float    rateHz = 0.f;
+    float    intervalMs = 0.f;   // mean time between reports
+    float    jitterMs = 0.f;     // standard deviation of that
+    float    intervalMaxMs = 0.f;
+    float    decodeUs = 0.f;     // mean pipeline time
+    float    decodeMaxUs = 0.f;
+    float    submitUs = 0.f;     // mean DSU + ViGEm time
+    float    submitMaxUs = 0.f;
+    uint64_t windowEndNs = 0;    // steady clock; zero until the first window closes
+};
+
+enum class TelemetryTrace : uint8_t { IntervalMs, DecodeUs, SubmitUs, LeftX, LeftY, RightX, RightY, GyroX, GyroY, GyroZ, Count };
+
+const char* TelemetryTraceName(TelemetryTrace trace);
+
+// Live telemetry for one player. The thread that feeds the player's
+// pipeline records every report; it publishes a TelemetrySnapshot through a
+// seqlock twice a second and appends per-report samples to fixed rings of
+// atomics. The UI reads both whenever it likes without any lock, so a slow
+// frame can never hold up input. Record* belong to one thread at a time.
+class PlayerTelemetry {
+public:
+    static constexpr size_t   kTraceLength = 256;   // about two seconds at 125 Hz
+    static constexpr uint64_t kWindowNs = 500'000'000;
+
+    // A report arrived. sequence is the controller's report counter (or any
+    // counter that steps by one per report), taken modulo 2^24; a bigger
+    // step counts as lost.
+    void RecordReport(uint64_t arrivalNs, uint32_t sequence);
+    // The update policy held the report back.
+    void RecordHeld();
+    // The report went out: decodeNs in the pipeline, submitNs in the sinks.
+    void RecordOutput(const PipelineOutput& out, uint64_t decodeNs, uint64_t submitNs);
+    // The sinks' change filters kept this output from them.
+    void RecordSkipped(bool vigem, bool dsu);
+
+    TelemetrySnapshot Snapshot() const { return snapshot_.Load(); }
+    // Copies the newest samples of a trace into out, oldest first; returns
+    // how many (at most kTraceLength).
+    size_t CopyTrace(TelemetryTrace trace, float* out) const;
+
+private:
+    struct Ring {
+        std::array<std::atomic<float>, kTraceLength> values{};
+        std::atomic<uint64_t> head{ 0 };   // samples written so far
+    };
+
+    void Push(TelemetryTrace trace, float value);
+    void Publish(uint64_t nowNs);
+
+    Seqlock<TelemetrySnapshot> snapshot_;
+    std::array<Ring, static_cast<size_t>(TelemetryTrace::Count)> rings_;
+
+    // Writer-only state.
+    TelemetrySnapshot totals_;
+    bool     started_ = false;
+    uint64_t lastArrivalNs_ = 0;
+    uint32_t lastSequence_ = 0;
+    uint64_t windowStartNs_ = 0;
+    uint32_t windowReports_ = 0;
+    uint32_t intervals_ = 0;
+    double   intervalSum_ = 0.0, intervalSquares_ = 0.0, intervalMax_ = 0.0;
+    uint32_t outputs_ = 0;
+    double   decodeSum_ = 0.0, decodeMax_ = 0.0, submitSum_ = 0.0, submitMax_ = 0.0;
+};
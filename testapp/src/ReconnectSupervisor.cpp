@@ -0,0 +1,206 @@
+#include "ReconnectSupervisor.h"
+
+#include <algorithm>
+
+const char* LinkStateName(LinkState state)
+{
+    switch (state)
+    {
+    case LinkState::Connected:    return "connected";
+    case LinkState::Waiting:      return "waiting to reconnect";
+    case LinkState::Reconnecting: return "reconnecting";
+    case LinkState::Stopped:      return "stopped";
+    }
+    return "unknown";
+}
+
+ReconnectSupervisor::ReconnectSupervisor(ReconnectTransport& transport)
+    : ReconnectSupervisor(transport, Options{})
+{
+}
+
+ReconnectSupervisor::ReconnectSupervisor(ReconnectTransport& transport, Options options)
+    : transport_(transport)
+    , options_(options)
+{
+    const size_t workers = std::max<size_t>(1, options_.workers);
+    for (size_t i = 0; i < workers; ++i)
+        workers_.emplace_back([this] { WorkerLoop(); });
+}
+
+ReconnectSupervisor::~ReconnectSupervisor()
+{
+    Stop();
+}
+
+int ReconnectSupervisor::Track(const KnownDevice& device)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int id = nextLink_++;
+    Link& link = links_[id];
+    link.device = device;
+    link.backoff = options_.initialBackoff;
+    return id;
+}
+
+// The first retry goes out immediately; a drop is often just the radio
+// renegotiating and the device is back before any backoff would matter.
+void ReconnectSupervisor::OnDisconnected(int link)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = links_.find(link);
+        if (it == links_.end() || stopping_) return;
+        Link& l = it->second;
+        if (l.state == LinkState::Reconnecting)
+        {
+            l.droppedWhileReconnecting = true;
+            return;
+        }
+        if (l.state != LinkState::Connected) return;
+        l.state = LinkState::Waiting;
+        l.due = Clock::now();
+        l.backoff = options_.initialBackoff;
+        l.attempts = 0;
+    }
+    cv_.notify_one();
+    Emit(link, LinkState::Waiting, 0);
+}
+
+void ReconnectSupervisor::Untrack(int link)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    links_.erase(link);
+}
+
+void ReconnectSupervisor::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ && workers_.empty()) return;
+        stopping_ = true;
+        for (auto& [id, l] : links_) l.state = LinkState::Stopped;
+    }
+    cv_.notify_all();
+    for (auto& t : workers_)
+        if (t.joinable()) t.join();
+    workers_.clear();
+}
+
+LinkState ReconnectSupervisor::State(int link) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = links_.find(link);
+    return it != links_.end() ? it->second.state : LinkState::Stopped;
+}
+
+uint32_t ReconnectSupervisor::Attempts(int link) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = links_.find(link);
+    return it != links_.end() ? it->second.attempts : 0;
+}
+
+uint64_t ReconnectSupervisor::Reconnects() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reconnects_;
+}
+
+void ReconnectSupervisor::WorkerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_)
+    {
+        const auto now = Clock::now();
+        auto next = Clock::time_point::max();
+        int pick = -1;
+        for (auto& [id, l] : links_)
+        {
+            if (l.state != LinkState::Waiting) continue;
+            if (l.due <= now) { pick = id; break; }
+            next = std::min(next, l.due);
+        }
+
+        if (pick < 0)
+        {
+            if (next == Clock::time_point::max())
+                cv_.wait(lock);
+            else
+                cv_.wait_until(lock, next);
+            continue;
+        }
+
+        Link& link = links_[pick];
+        link.state = LinkState::Reconnecting;
+        link.droppedWhileReconnecting = false;
+        ++link.attempts;
+        const KnownDevice device = link.device;
+        const uint32_t attempts = link.attempts;
+
+        lock.unlock();
+        Emit(pick, LinkState::Reconnecting, attempts);
+        bool ok = false;
+        try { ok = transport_.Reconnect(pick, device); } catch (...) { ok = false; }
+        lock.lock();
+
+        if (stopping_) break;
+        auto it = links_.find(pick);
+        if (it == links_.end()) continue;
+        Link& l = it->second;
+        LinkState result;
+        if (ok && !l.droppedWhileReconnecting)
+        {
+            l.state = LinkState::Connected;
+            l.backoff = options_.initialBackoff;
+            ++reconnects_;
+            result = LinkState::Connected;
+        }
+        else
+        {
+            l.state = LinkState::Waiting;
+            l.due = Clock::now() + (ok ? std::chrono::milliseconds(0) : l.backoff);
+            if (!ok) l.backoff = std::min(l.backoff * 2, options_.maxBackoff);
+            result = LinkState::Waiting;
+        }
+        const uint32_t n = l.attempts;
+        if (result == LinkState::Connected) l.attempts = 0;
+
+        lock.unlock();
+        cv_.notify_all();
+        Emit(pick, result, n);
+        lock.lock();
+    }
+}
+
+void ReconnectSupervisor::Emit(int link, LinkState state, uint32_t attempts)
+{
+    if (onEvent_) onEvent_(link, state, attempts);
+}
+
+bool FakeReconnectTransport::Reconnect(int link, const KnownDevice& device)
+{
+    bool reachable = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++calls_[device.address];
+        auto it = reachable_.find(device.address);
+        reachable = it != reachable_.end() && it->second;
+    }
+    if (latency_.count() > 0) std::this_thread::sleep_for(latency_);
+    if (reachable && onConnect_) onConnect_(link);
+    return reachable;
+}
+
+void FakeReconnectTransport::SetReachable(uint64_t address, bool reachable)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    reachable_[address] = reachable;
+}
+
+uint32_t FakeReconnectTransport::Calls(uint64_t address) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = calls_.find(address);
+    return it != calls_.end() ? it->second : 0;
+}
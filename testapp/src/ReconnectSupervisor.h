@@ -0,0 +1,108 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "DeviceRegistry.h"
+
+// Opens a known controller again and puts it back behind its player. Called
+// from a supervisor worker thread; may block for as long as a connect takes.
+class ReconnectTransport {
+public:
+    virtual ~ReconnectTransport() = default;
+    virtual bool Reconnect(int link, const KnownDevice& device) = 0;
+};
+
+enum class LinkState : uint8_t { Connected, Waiting, Reconnecting, Stopped };
+
+const char* LinkStateName(LinkState state);
+
+// Tracks every live controller link. A link reported as dropped is retried
+// in the background with exponential backoff until the transport brings it
+// back; several links reconnect in parallel on a small worker pool.
+class ReconnectSupervisor {
+public:
+    struct Options {
+        std::chrono::milliseconds initialBackoff{ 250 };
+        std::chrono::milliseconds maxBackoff{ 8000 };
+        size_t                    workers = 4;
+    };
+
+    using EventFn = std::function<void(int link, LinkState state, uint32_t attempts)>;
+
+    explicit ReconnectSupervisor(ReconnectTransport& transport);
+    ReconnectSupervisor(ReconnectTransport& transport, Options options);
+    ~ReconnectSupervisor();
+
+    ReconnectSupervisor(const ReconnectSupervisor&) = delete;
+    ReconnectSupervisor& operator=(const ReconnectSupervisor&) = delete;
+
+    // Set before the first Track; called on state changes, off the lock.
+    void OnEvent(EventFn onEvent) { onEvent_ = std::move(onEvent); }
+
+    // New links start out Connected.
+    int  Track(const KnownDevice& device);
+    void OnDisconnected(int link);
+    // Forgets a link; an attempt already running finishes but is discarded.
+    void Untrack(int link);
+    void Stop();
+
+    LinkState State(int link) const;
+    uint32_t  Attempts(int link) const;
+    uint64_t  Reconnects() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Link {
+        KnownDevice               device;
+        LinkState                 state = LinkState::Connected;
+        Clock::time_point         due{};
+        std::chrono::milliseconds backoff{ 0 };
+        uint32_t                  attempts = 0;
+        bool                      droppedWhileReconnecting = false;
+    };
+
+    void WorkerLoop();
+    void Emit(int link, LinkState state, uint32_t attempts);
+
+    ReconnectTransport& transport_;
+    Options options_;
+    EventFn onEvent_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<int, Link> links_;
+    int nextLink_ = 0;
+    uint64_t reconnects_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+// Stand-in for the BLE side: each address can be made reachable or not, and
+// the reconnect calls are counted per address.
+class FakeReconnectTransport : public ReconnectTransport {
+public:
+    bool Reconnect(int link, const KnownDevice& device) override;
+
+    void SetReachable(uint64_t address, bool reachable);
+    void SetLatency(std::chrono::milliseconds latency) { latency_ = latency; }
+    // Runs inside a successful Reconnect, e.g. to report an immediate drop.
+    void OnConnect(std::function<void(int link)> onConnect) { onConnect_ = std::move(onConnect); }
+
+    uint32_t Calls(uint64_t address) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::unordered_map<uint64_t, bool> reachable_;
+    std::unordered_map<uint64_t, uint32_t> calls_;
+    std::chrono::milliseconds latency_{ 0 };
+    std::function<void(int link)> onConnect_;
+};
@@ -0,0 +1,41 @@
+#include "RedrawScheduler.h"
+
+#include <algorithm>
+
+void RedrawScheduler::Request(int frames)
+{
+    pending_ = std::max(pending_, frames);
+}
+
+void RedrawScheduler::SetVisible(bool visible)
+{
+    // Coming back needs a fresh frame at once, not at the next interval.
+    if (visible && !visible_) pending_ = std::max(pending_, 1);
+    visible_ = visible;
+}
+
+bool RedrawScheduler::Due(uint64_t nowNs) const
+{
+    if (!visible_) return false;
+    if (pending_ > 0) return true;
+    return intervalNs_ > 0 && nowNs - lastDrawNs_ >= intervalNs_;
+}
+
+void RedrawScheduler::Drawn(uint64_t nowNs)
+{
+    if (pending_ > 0) --pending_;
+    lastDrawNs_ = nowNs;
+    ++frames_;
+}
+
+uint32_t RedrawScheduler::WaitMs(uint64_t nowNs) const
+{
+    if (!visible_) return kMaxWaitMs;
+    if (pending_ > 0) return 0;
+    if (intervalNs_ == 0) return kMaxWaitMs;
+    const uint64_t next = lastDrawNs_ + intervalNs_;
+    if (next <= nowNs) return 0;
+    // Round up so the wake lands on or after the deadline, not just before.
+    const uint64_t ms = (next - nowNs + 999'999) / 1'000'000;
+    return static_cast<uint32_t>(std::min<uint64_t>(ms, kMaxWaitMs));
+}
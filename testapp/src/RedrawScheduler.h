@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+// Decides when the UI thread draws a frame, so an idle window costs next to
+// nothing. A frame is drawn when something asked for one (input, a new log
+// line, a widget still being dragged) or when the screen's refresh interval
+// comes round for its live numbers; in between the thread sleeps in its
+// message wait. Times are steady-clock nanoseconds, passed in by the caller.
+class RedrawScheduler {
+public:
+    // Frames drawn after a request, so hover highlights and the frame after
+    // a click settle before the UI goes quiet.
+    static constexpr int kSettleFrames = 3;
+    // The longest the loop sleeps while hidden or idle; background work that
+    // does not wake it (config reloads, layout hotkeys) waits at most this.
+    static constexpr uint32_t kMaxWaitMs = 250;
+
+    // Draw the next frames, at the display's rate.
+    void Request(int frames = kSettleFrames);
+    // Zero draws only on request.
+    void SetRefreshInterval(uint64_t intervalNs) { intervalNs_ = intervalNs; }
+    // While hidden nothing is drawn, however much was requested.
+    void SetVisible(bool visible);
+
+    bool Due(uint64_t nowNs) const;
+    void Drawn(uint64_t nowNs);
+    // How long the loop may sleep before the next frame is due.
+    uint32_t WaitMs(uint64_t nowNs) const;
+
+    bool Visible() const { return visible_; }
+    uint64_t Frames() const { return frames_; }
+
+private:
+    int      pending_ = kSettleFrames;   // the first frame draws at once
+    uint64_t intervalNs_ = 0;
+    uint64_t lastDrawNs_ = 0;
+    bool     visible_ = true;
+    uint64_t frames_ = 0;
+};
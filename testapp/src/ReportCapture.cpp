@@ -0,0 +1,338 @@
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ReportCapture.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+    size_t RoundUpPow2(size_t n)
+    {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    std::string FileSafe(const std::string& label)
+    {
+        std::string out;
+        for (char c : label)
+        {
+            const bool keep = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+            out += keep ? c : '_';
+        }
+        return out.empty() ? "device" : out;
+    }
+
+    bool ValidHeader(const CaptureFileHeader& h, size_t fileSize)
+    {
+        return std::memcmp(h.magic, CAPTURE_MAGIC, sizeof(h.magic)) == 0 &&
+               h.version == CAPTURE_VERSION &&
+               h.headerSize >= sizeof(CaptureFileHeader) && h.headerSize % 8 == 0 &&
+               h.recordStride >= sizeof(CaptureRecord) && h.recordStride % 8 == 0 &&
+               h.headerSize <= fileSize;
+    }
+}
+
+CaptureRing::CaptureRing(size_t capacity)
+    : slots_(std::make_unique<CaptureRecord[]>(RoundUpPow2(std::max<size_t>(capacity, 2))))
+    , mask_(RoundUpPow2(std::max<size_t>(capacity, 2)) - 1)
+{
+}
+
+bool CaptureRing::Push(const uint8_t* data, size_t size, uint64_t arrivalNs) noexcept
+{
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint32_t sequence = sequence_++;
+    if (head - tail_.load(std::memory_order_acquire) > mask_)
+    {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    CaptureRecord& r = slots_[head & mask_];
+    const size_t n = std::min(size, CAPTURE_MAX_REPORT);
+    r.arrivalNs = arrivalNs;
+    r.sequence = sequence;
+    r.length = static_cast<uint16_t>(n);
+    r.flags = size > CAPTURE_MAX_REPORT ? CAPTURE_FLAG_TRUNCATED : 0;
+    if (n) std::memcpy(r.data, data, n);
+    // Slots are reused, so clear the tail to keep files byte-for-byte stable.
+    std::memset(r.data + n, 0, CAPTURE_MAX_REPORT - n);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+size_t CaptureRing::Drain(const SpanFn& sink)
+{
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    const size_t n = static_cast<size_t>(head - tail);
+    if (n == 0) return 0;
+
+    const size_t first = static_cast<size_t>(tail & mask_);
+    const size_t run = std::min(n, Capacity() - first);
+    sink(&slots_[first], run);
+    if (run < n) sink(&slots_[0], n - run);
+    tail_.store(head, std::memory_order_release);
+    return n;
+}
+
+CaptureStream::CaptureStream(size_t ringCapacity, std::FILE* file, std::string path)
+    : ring_(ringCapacity)
+    , file_(file)
+    , path_(std::move(path))
+{
+}
+
+CaptureStream::~CaptureStream()
+{
+    Close();
+}
+
+size_t CaptureStream::Flush()
+{
+    if (!file_) return 0;
+    const size_t n = ring_.Drain([this](const CaptureRecord* records, size_t count) {
+        std::fwrite(records, sizeof(CaptureRecord), count, file_);
+    });
+    if (n)
+    {
+        std::fflush(file_);
+        written_.fetch_add(n, std::memory_order_relaxed);
+    }
+    return n;
+}
+
+void CaptureStream::Close()
+{
+    if (!file_) return;
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+CaptureRecorder::CaptureRecorder(std::string directory, size_t ringCapacity, std::chrono::milliseconds flushInterval)
+    : directory_(std::move(directory))
+    , ringCapacity_(ringCapacity)
+    , flushInterval_(flushInterval)
+{
+}
+
+CaptureRecorder::~CaptureRecorder()
+{
+    Stop();
+}
+
+bool CaptureRecorder::Start()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return true;
+    std::error_code ec;
+    std::filesystem::create_directories(directory_, ec);
+    if (ec) return false;
+    running_ = true;
+    writer_ = std::thread([this] { WriterLoop(); });
+    return true;
+}
+
+void CaptureRecorder::Stop()
+{
+    std::vector<std::shared_ptr<CaptureStream>> streams;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_ && !writer_.joinable()) return;
+        running_ = false;
+    }
+    cv_.notify_all();
+    if (writer_.joinable()) writer_.join();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        streams.swap(streams_);
+    }
+    for (auto& s : streams)
+    {
+        s->Flush();
+        s->Close();
+    }
+}
+
+bool CaptureRecorder::Running() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return running_;
+}
+
+std::shared_ptr<CaptureStream> CaptureRecorder::Open(const CaptureStreamInfo& info)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) return nullptr;
+
+    CaptureFileHeader h{};
+    std::memcpy(h.magic, CAPTURE_MAGIC, sizeof(h.magic));
+    h.version = CAPTURE_VERSION;
+    h.headerSize = sizeof(CaptureFileHeader);
+    h.recordStride = sizeof(CaptureRecord);
+    h.maxReport = static_cast<uint32_t>(CAPTURE_MAX_REPORT);
+    h.address = info.address;
+    h.productId = info.productId;
+    h.controllerType = static_cast<uint8_t>(info.controllerType);
+    h.side = static_cast<uint8_t>(info.side);
+    h.startNs = NowNs();
+    h.wallClockUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    std::strncpy(h.label, info.label.c_str(), sizeof(h.label) - 1);
+
+    char name[96];
+    std::snprintf(name, sizeof(name), "_%012llx_%lld_%u.j2cap",
+        static_cast<unsigned long long>(info.address),
+        static_cast<long long>(h.wallClockUs / 1000), nextFile_++);
+    const std::string path = (std::filesystem::path(directory_) / (FileSafe(info.label) + name)).string();
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return nullptr;
+    if (std::fwrite(&h, sizeof(h), 1, f) != 1)
+    {
+        std::fclose(f);
+        return nullptr;
+    }
+    std::fflush(f);
+
+    auto stream = std::make_shared<CaptureStream>(ringCapacity_, f, path);
+    streams_.push_back(stream);
+    return stream;
+}
+
+size_t CaptureRecorder::Streams() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return streams_.size();
+}
+
+uint64_t CaptureRecorder::Written() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t n = 0;
+    for (const auto& s : streams_) n += s->Written();
+    return n;
+}
+
+uint64_t CaptureRecorder::Dropped() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint64_t n = 0;
+    for (const auto& s : streams_) n += s->Dropped();
+    return n;
+}
+
+uint64_t CaptureRecorder::NowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void CaptureRecorder::WriterLoop()
+{
+    std::vector<std::shared_ptr<CaptureStream>> streams;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (running_)
+    {
+        cv_.wait_for(lock, flushInterval_, [this] { return !running_; });
+        streams = streams_;
+        lock.unlock();
+        for (auto& s : streams) s->Flush();
+        streams.clear();
+        lock.lock();
+    }
+}
+
+CaptureFile::~CaptureFile()
+{
+    Close();
+}
+
+bool CaptureFile::Open(const std::string& path)
+{
+    Close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < static_cast<LONGLONG>(sizeof(CaptureFileHeader)))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    file_ = file;
+    mapping_ = mapping;
+    size_ = static_cast<size_t>(size.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st{};
+    if (::fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(CaptureFileHeader)))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* view = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced on its own.
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+    size_ = static_cast<size_t>(st.st_size);
+#endif
+    base_ = static_cast<const uint8_t*>(view);
+
+    if (!ValidHeader(Header(), size_))
+    {
+        Close();
+        return false;
+    }
+    count_ = (size_ - Header().headerSize) / Header().recordStride;
+    return true;
+}
+
+void CaptureFile::Close()
+{
+    if (base_)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(base_);
+#else
+        ::munmap(const_cast<uint8_t*>(base_), size_);
+#endif
+    }
+#ifdef _WIN32
+    if (mapping_) CloseHandle(mapping_);
+    if (file_) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = nullptr;
+#endif
+    base_ = nullptr;
+    size_ = 0;
+    count_ = 0;
+}
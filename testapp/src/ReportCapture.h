@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JoyConDecoder.h"
+
+// On-disk layout of a report capture: one header, then fixed-stride records
+// up to the end of the file. Fields are little-endian and naturally aligned,
+// so a mapped file is read in place. A record cut short by a crash is
+// ignored by readers.
+constexpr char     CAPTURE_MAGIC[8] = { 'J', '2', 'C', 'C', 'A', 'P', 'T', '\0' };
+constexpr uint32_t CAPTURE_VERSION = 1;
+constexpr size_t   CAPTURE_MAX_REPORT = 96;
+
+constexpr uint16_t CAPTURE_FLAG_TRUNCATED = 0x0001;   // report was longer than CAPTURE_MAX_REPORT
+
+struct CaptureFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordStride;
+    uint32_t maxReport;
+    uint64_t address;
+    uint16_t productId;
+    uint8_t  controllerType;    // the app's ControllerType value
+    uint8_t  side;              // JoyConSide
+    uint32_t reserved0;
+    uint64_t startNs;           // steady clock when the capture began
+    int64_t  wallClockUs;       // system clock at the same moment
+    char     label[64];
+    uint8_t  reserved[8];
+};
+
+struct CaptureRecord {
+    uint64_t arrivalNs;         // steady clock, same base as startNs
+    uint32_t sequence;          // per stream; gaps mark dropped records
+    uint16_t length;
+    uint16_t flags;
+    uint8_t  data[CAPTURE_MAX_REPORT];
+};
+
+static_assert(sizeof(CaptureFileHeader) == 128, "capture header layout changed");
+static_assert(sizeof(CaptureRecord) == 16 + CAPTURE_MAX_REPORT, "capture record layout changed");
+
+struct CaptureStreamInfo {
+    int         controllerType = 0;
+    JoyConSide  side = JoyConSide::Left;
+    uint64_t    address = 0;
+    uint16_t    productId = 0;
+    std::string label;
+};
+
+// Single-producer, single-consumer ring of records. Push never blocks,
+// locks or allocates; when the consumer falls behind, new records are
+// dropped and counted rather than overwriting unread ones.
+class CaptureRing {
+public:
+    using SpanFn = std::function<void(const CaptureRecord* records, size_t count)>;
+
+    // capacity is rounded up to a power of two.
+    explicit CaptureRing(size_t capacity);
+
+    CaptureRing(const CaptureRing&) = delete;
+    CaptureRing& operator=(const CaptureRing&) = delete;
+
+    bool Push(const uint8_t* data, size_t size, uint64_t arrivalNs) noexcept;
+
+    // Consumer side: hands everything pushed so far to sink in at most two
+    // contiguous spans, then frees the slots. Returns the record count.
+    size_t Drain(const SpanFn& sink);
+
+    size_t   Capacity() const { return mask_ + 1; }
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    std::unique_ptr<CaptureRecord[]> slots_;
+    size_t mask_;
+
+    alignas(64) std::atomic<uint64_t> head_{ 0 };   // next slot to fill; producer
+    uint32_t sequence_ = 0;                          // producer only
+    std::atomic<uint64_t> dropped_{ 0 };
+    alignas(64) std::atomic<uint64_t> tail_{ 0 };   // next slot to drain; consumer
+};
+
+// One device's capture file. The device's input callback is the only
+// producer; the recorder's writer thread is the only consumer.
+class CaptureStream {
+public:
+    CaptureStream(size_t ringCapacity, std::FILE* file, std::string path);
+    ~CaptureStream();
+
+    CaptureStream(const CaptureStream&) = delete;
+    CaptureStream& operator=(const CaptureStream&) = delete;
+
+    bool Push(const uint8_t* data, size_t size, uint64_t arrivalNs) noexcept { return ring_.Push(data, size, arrivalNs); }
+
+    const std::string& Path() const { return path_; }
+    uint64_t Written() const { return written_.load(std::memory_order_relaxed); }
+    uint64_t Dropped() const { return ring_.Dropped(); }
+
+private:
+    friend class CaptureRecorder;
+
+    // Writer thread only.
+    size_t Flush();
+    void   Close();
+
+    CaptureRing ring_;
+    std::FILE* file_;
+    std::string path_;
+    std::atomic<uint64_t> written_{ 0 };
+};
+
+// Opt-in recorder of raw input reports, one file per device. Files are
+// written by a background thread that drains every stream's ring on a short
+// interval, so the callback only pays for a copy into the ring.
+class CaptureRecorder {
+public:
+    explicit CaptureRecorder(std::string directory,
+                             size_t ringCapacity = 4096,
+                             std::chrono::milliseconds flushInterval = std::chrono::milliseconds(20));
+    ~CaptureRecorder();
+
+    CaptureRecorder(const CaptureRecorder&) = delete;
+    CaptureRecorder& operator=(const CaptureRecorder&) = delete;
+
+    // Creates the directory and starts the writer; true if already running.
+    bool Start();
+    // Drains and closes every file. Streams handed out stay valid but are
+    // no longer written.
+    void Stop();
+    bool Running() const;
+
+    // Starts a new file for a device and returns the stream its callback
+    // pushes into, or null if the recorder is stopped or the file could not
+    // be created.
+    std::shared_ptr<CaptureStream> Open(const CaptureStreamInfo& info);
+
+    const std::string& Directory() const { return directory_; }
+    size_t   Streams() const;
+    uint64_t Written() const;
+    uint64_t Dropped() const;
+
+    static uint64_t NowNs();
+
+private:
+    void WriterLoop();
+
+    std::string directory_;
+    size_t ringCapacity_;
+    std::chrono::milliseconds flushInterval_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<std::shared_ptr<CaptureStream>> streams_;
+    std::thread writer_;
+    uint32_t nextFile_ = 0;
+    bool running_ = false;
+};
+
+// Read-only view of a capture file. The file is memory-mapped, so records
+// are read in place without copying or parsing.
+class CaptureFile {
+public:
+    CaptureFile() = default;
+    ~CaptureFile();
+
+    CaptureFile(const CaptureFile&) = delete;
+    CaptureFile& operator=(const CaptureFile&) = delete;
+
+    // Fails on a missing file, a bad header or an unknown version.
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const { return base_ != nullptr; }
+
+    const CaptureFileHeader& Header() const { return *reinterpret_cast<const CaptureFileHeader*>(base_); }
+    size_t Count() const { return count_; }
+    const CaptureRecord& Record(size_t index) const
+    {
+        return *reinterpret_cast<const CaptureRecord*>(base_ + Header().headerSize + index * Header().recordStride);
+    }
+
+private:
+    const uint8_t* base_ = nullptr;
+    size_t size_ = 0;
+    size_t count_ = 0;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
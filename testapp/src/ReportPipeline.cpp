@@ -0,0 +1,260 @@
+#include "ReportPipeline.h"
+
+#include "DsuServer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+std::chrono::microseconds PolicyInterval(UpdatePolicy policy)
+{
+    switch (policy)
+    {
+    case UpdatePolicy::Balanced120Hz: return std::chrono::microseconds(8333);
+    case UpdatePolicy::Legacy60Hz:    return std::chrono::microseconds(16667);
+    default:                          return std::chrono::microseconds(0);
+    }
+}
+
+void ApplyButtonMapping(DS4_REPORT_EX& r, ButtonMapping m)
+{
+    switch (m)
+    {
+    case ButtonMapping::L3:         r.Report.wButtons |= DS4_BUTTON_THUMB_LEFT;     break;
+    case ButtonMapping::R3:         r.Report.wButtons |= DS4_BUTTON_THUMB_RIGHT;    break;
+    case ButtonMapping::L1:         r.Report.wButtons |= DS4_BUTTON_SHOULDER_LEFT;  break;
+    case ButtonMapping::R1:         r.Report.wButtons |= DS4_BUTTON_SHOULDER_RIGHT; break;
+    case ButtonMapping::L2:         r.Report.bTriggerL = 255;                       break;
+    case ButtonMapping::R2:         r.Report.bTriggerR = 255;                       break;
+    case ButtonMapping::CROSS:      r.Report.wButtons |= DS4_BUTTON_CROSS;          break;
+    case ButtonMapping::CIRCLE:     r.Report.wButtons |= DS4_BUTTON_CIRCLE;         break;
+    case ButtonMapping::SQUARE:     r.Report.wButtons |= DS4_BUTTON_SQUARE;         break;
+    case ButtonMapping::TRIANGLE:   r.Report.wButtons |= DS4_BUTTON_TRIANGLE;       break;
+    case ButtonMapping::SHARE:      r.Report.wButtons |= DS4_BUTTON_SHARE;          break;
+    case ButtonMapping::OPTIONS:    r.Report.wButtons |= DS4_BUTTON_OPTIONS;        break;
+    case ButtonMapping::DPAD_UP:    DS4_SET_DPAD(reinterpret_cast<PDS4_REPORT>(&r.Report), DS4_BUTTON_DPAD_NORTH); break;
+    case ButtonMapping::DPAD_DOWN:  DS4_SET_DPAD(reinterpret_cast<PDS4_REPORT>(&r.Report), DS4_BUTTON_DPAD_SOUTH); break;
+    case ButtonMapping::DPAD_LEFT:  DS4_SET_DPAD(reinterpret_cast<PDS4_REPORT>(&r.Report), DS4_BUTTON_DPAD_WEST);  break;
+    case ButtonMapping::DPAD_RIGHT: DS4_SET_DPAD(reinterpret_cast<PDS4_REPORT>(&r.Report), DS4_BUTTON_DPAD_EAST);  break;
+    default: break;
+    }
+}
+
+void ApplyGLGRMapping(DS4_REPORT_EX& report, const std::vector<uint8_t>& buffer, ButtonMapping gl, ButtonMapping gr)
+{
+    if (buffer.size() < 9) return;
+    uint64_t state = 0;
+    for (int i = 3; i <= 8; ++i) state = (state << 8) | buffer[i];
+    if (state & 0x000000000200ULL) ApplyButtonMapping(report, gl);
+    if (state & 0x000000000100ULL) ApplyButtonMapping(report, gr);
+}
+
+bool EmitGate::ShouldEmit(UpdatePolicy policy, uint64_t nowNs)
+{
+    const uint64_t intervalNs = static_cast<uint64_t>(PolicyInterval(policy).count()) * 1000;
+    if (intervalNs == 0 || !armed_ || nowNs - lastNs_ >= intervalNs)
+    {
+        lastNs_ = nowNs;
+        armed_ = true;
+        return true;
+    }
+    return false;
+}
+
+bool ReportChangeFilter::Admit(const DS4_REPORT_EX& report, uint64_t nowNs, const ChangeFilterConfig& config, MotionFilter motion)
+{
+    const auto& r = report.Report;
+    const int16_t sensors[6] = { r.wGyroX, r.wGyroY, r.wGyroZ, r.wAccelX, r.wAccelY, r.wAccelZ };
+    DS4_REPORT_EX key = report;
+    key.Report.wTimestamp = 0;
+    key.Report.wGyroX = key.Report.wGyroY = key.Report.wGyroZ = 0;
+    key.Report.wAccelX = key.Report.wAccelY = key.Report.wAccelZ = 0;
+    const uint64_t keepaliveNs = static_cast<uint64_t>(config.keepaliveMs) * 1000000;
+    bool same = config.enabled && motion != MotionFilter::Stream && primed_ && nowNs - lastSentNs_ < keepaliveNs &&
+                std::memcmp(key.ReportBuffer, last_.ReportBuffer, sizeof(key.ReportBuffer)) == 0;
+    // Compared with what was last sent rather than the previous report, so
+    // a slow turn still gets out once it has added up past the noise.
+    if (same && motion == MotionFilter::Changes)
+        for (int i = 0; i < 6 && same; ++i)
+            same = std::abs(sensors[i] - lastMotion_[i]) <= config.motionNoise;
+    if (same)
+    {
+        ++suppressed_;
+        return false;
+    }
+    last_ = key;
+    std::memcpy(lastMotion_, sensors, sizeof(sensors));
+    lastSentNs_ = nowNs;
+    primed_ = true;
+    ++sent_;
+    return true;
+}
+
+uint64_t ReportPipeline::StampMotion(const std::vector<uint8_t>& buffer, uint64_t arrivalNs, JoyConSide half)
+{
+    const uint64_t us = arrivalNs / 1000;
+    MotionClock& clock = half == JoyConSide::Right ? rightClock_ : leftClock_;
+    const uint64_t smoothed = clock.Stamp(us, ExtractReportCounter(buffer));
+    return config_.smoothMotionClock ? smoothed : us;
+}
+
+bool ReportPipeline::Process(const std::vector<uint8_t>& buffer, uint64_t arrivalNs, PipelineOutput& out)
+{
+    // The clock sees every report, emitted or not, to keep its cadence.
+    const uint64_t sampleUs = StampMotion(buffer, arrivalNs);
+    ++processed_;
+    if (!gate_.ShouldEmit(config_.policy, arrivalNs)) return false;
+
+    const CalibrationProfile* cal = config_.calibration.get();
+    switch (config_.controllerType)
+    {
+    case ProController:
+        out.report = GenerateProControllerReport(buffer, cal);
+        ApplyGLGRMapping(out.report, buffer, config_.glMapping, config_.grMapping);
+        break;
+    case NSOGCController:
+        out.report = GenerateNSOGCReport(buffer, cal);
+        break;
+    default:
+        out.report = GenerateDS4Report(buffer, config_.side, config_.orientation, cal);
+        break;
+    }
+    const bool wantMotion = config_.decodeMotion || config_.aimOutput != GyroAimOutput::Off;
+    FinishMotion(wantMotion ? DecodeMotionSample(buffer, sampleUs, config_.motionScale) : MotionSample{}, out);
+    out.arrivalNs = arrivalNs;
+    ++emitted_;
+    return true;
+}
+
+bool ReportPipeline::ProcessDual(const std::vector<uint8_t>& left, uint64_t leftSampleUs,
+                                 const std::vector<uint8_t>& right, uint64_t rightSampleUs,
+                                 uint64_t arrivalNs, PipelineOutput& out)
+{
+    ++processed_;
+    if (!gate_.ShouldEmit(config_.policy, arrivalNs)) return false;
+
+    out.report = GenerateDualJoyConDS4Report(left, right, config_.gyroSource, config_.calibration.get());
+    const bool wantMotion = config_.decodeMotion || config_.aimOutput != GyroAimOutput::Off;
+    FinishMotion(wantMotion
+        ? CombineMotionSamples(DecodeMotionSample(left, leftSampleUs, config_.motionScale),
+                               DecodeMotionSample(right, rightSampleUs, config_.rightMotionScale),
+                               config_.gyroSource)
+        : MotionSample{}, out);
+    out.arrivalNs = arrivalNs;
+    ++emitted_;
+    return true;
+}
+
+void ReportPipeline::FinishMotion(const MotionSample& motion, PipelineOutput& out)
+{
+    out.motion = config_.decodeMotion ? motion : MotionSample{};
+    out.aimMouseDx = out.aimMouseDy = 0;
+    if (config_.aimOutput == GyroAimOutput::Off) return;
+
+    GyroAimResult aim;
+    aim_.Update(motion, config_.aimOutput, config_.aim, aim);
+    if (config_.aimOutput == GyroAimOutput::Mouse) {
+        out.aimMouseDx = aim.mouseDx;
+        out.aimMouseDy = aim.mouseDy;
+        return;
+    }
+    // Added to the physical stick, so it still works alongside the gyro.
+    auto add = [](BYTE& axis, float v) {
+        axis = static_cast<BYTE>(std::clamp(static_cast<int>(std::lround(axis + v * 127.f)), 0, 255));
+    };
+    add(out.report.Report.bThumbRX, aim.stickX);
+    add(out.report.Report.bThumbRY, aim.stickY);
+}
+
+void ReportPipeline::Reset()
+{
+    leftClock_.Reset();
+    rightClock_.Reset();
+    gate_.Reset();
+    aim_.Reset();
+    processed_ = 0;
+    emitted_ = 0;
+}
+
+EmittedReportRecord MakeEmittedRecord(uint8_t slot, const PipelineOutput& out)
+{
+    EmittedReportRecord r;
+    std::memset(&r, 0, sizeof(r));
+    r.arrivalNs = out.arrivalNs;
+    r.motionTimestampUs = out.motion.timestampUs;
+    r.reportCounter = out.motion.reportCounter;
+    r.slot = slot;
+    r.motionValid = out.motion.valid ? 1 : 0;
+    r.accel[0] = out.motion.accelX;
+    r.accel[1] = out.motion.accelY;
+    r.accel[2] = out.motion.accelZ;
+    r.gyro[0] = out.motion.gyroX;
+    r.gyro[1] = out.motion.gyroY;
+    r.gyro[2] = out.motion.gyroZ;
+    std::memcpy(r.report, out.report.ReportBuffer, sizeof(out.report.ReportBuffer));
+    return r;
+}
+
+uint64_t DigestRecord(uint64_t seed, const EmittedReportRecord& record)
+{
+    const auto* bytes = reinterpret_cast<const uint8_t*>(&record);
+    uint64_t h = seed;
+    for (size_t i = 0; i < sizeof(record); ++i)
+    {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+void NullReportSink::Emit(uint8_t slot, const PipelineOutput& out)
+{
+    digest_ = DigestRecord(digest_, MakeEmittedRecord(slot, out));
+    ++count_;
+}
+
+void DsuReportSink::Emit(uint8_t slot, const PipelineOutput& out)
+{
+    if (server_.IsRunning()) server_.UpdateController(slot, out.report, out.motion);
+}
+
+RecordingReportSink::~RecordingReportSink()
+{
+    Close();
+}
+
+bool RecordingReportSink::Open(const std::string& path)
+{
+    Close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) return false;
+
+    ReportRecordingHeader h{};
+    std::memcpy(h.magic, REPORT_RECORDING_MAGIC, sizeof(h.magic));
+    h.version = REPORT_RECORDING_VERSION;
+    h.recordStride = sizeof(EmittedReportRecord);
+    if (std::fwrite(&h, sizeof(h), 1, file_) != 1)
+    {
+        Close();
+        return false;
+    }
+    count_ = 0;
+    digest_ = REPORT_DIGEST_SEED;
+    return true;
+}
+
+void RecordingReportSink::Close()
+{
+    if (!file_) return;
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+void RecordingReportSink::Emit(uint8_t slot, const PipelineOutput& out)
+{
+    const EmittedReportRecord r = MakeEmittedRecord(slot, out);
+    digest_ = DigestRecord(digest_, r);
+    ++count_;
+    if (file_) std::fwrite(&r, sizeof(r), 1, file_);
+}
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GyroAim.h"
+#include "JoyConDecoder.h"
+#include "MotionClock.h"
+
+class DsuServer;
+
+enum class UpdatePolicy { LowLatency, Balanced120Hz, Legacy60Hz };
+enum ControllerType { SingleJoyCon = 1, DualJoyCon = 2, ProController = 3, NSOGCController = 4 };
+
+enum class ButtonMapping {
+    NONE, L3, R3, L1, R1, L2, R2,
+    CROSS, CIRCLE, SQUARE, TRIANGLE,
+    SHARE, OPTIONS,
+    DPAD_UP, DPAD_DOWN, DPAD_LEFT, DPAD_RIGHT
+};
+
+// Minimum spacing between emitted reports; zero emits every report.
+std::chrono::microseconds PolicyInterval(UpdatePolicy policy);
+
+void ApplyButtonMapping(DS4_REPORT_EX& report, ButtonMapping mapping);
+// Presses the buttons mapped to the Pro Controller's GL/GR paddles.
+void ApplyGLGRMapping(DS4_REPORT_EX& report, const std::vector<uint8_t>& buffer, ButtonMapping gl, ButtonMapping gr);
+
+// Rate limiter behind UpdatePolicy. The first report always goes out.
+class EmitGate {
+public:
+    bool ShouldEmit(UpdatePolicy policy, uint64_t nowNs);
+    void Reset() { armed_ = false; }
+
+private:
+    uint64_t lastNs_ = 0;
+    bool armed_ = false;
+};
+
+// When a sink may skip a report it has already seen.
+struct ChangeFilterConfig {
+    bool     enabled = true;
+    uint32_t keepaliveMs = 100;   // an unchanged report still goes out this often
+    int32_t  motionNoise = 16;    // raw gyro/accel counts a resting controller drifts by
+    bool operator==(const ChangeFilterConfig&) const = default;
+};
+
+// How a sink's consumer uses the DS4 report's motion fields.
+enum class MotionFilter : uint8_t {
+    Ignore,    // not at all: motion is never compared
+    Changes,   // reads them as they are: a change beyond motionNoise is new input
+    Stream,    // integrates them: every report goes out
+};
+
+// One sink's memory of what it was last sent, so an idle controller does
+// not cost a driver call or a packet per report. The DS4 report's inputs
+// (sticks, buttons, triggers, touch, battery) are compared; its timestamp
+// never is, and its motion fields only as the sink's MotionFilter says,
+// since sensor noise alone would make every report look new.
+class ReportChangeFilter {
+public:
+    // True if the report should go to the sink; it then counts as sent.
+    bool Admit(const DS4_REPORT_EX& report, uint64_t nowNs, const ChangeFilterConfig& config, MotionFilter motion);
+    void Reset() { primed_ = false; }
+
+    uint64_t Sent() const { return sent_; }
+    uint64_t Suppressed() const { return suppressed_; }
+
+private:
+    DS4_REPORT_EX last_{};
+    int16_t  lastMotion_[6] = {};
+    uint64_t lastSentNs_ = 0;
+    bool     primed_ = false;
+    uint64_t sent_ = 0;
+    uint64_t suppressed_ = 0;
+};
+
+// What the pipeline needs to know about one virtual controller. Live code
+// refreshes the fields the user can change while connected (policy, motion
+// clock, GL/GR layout) before each report.
+struct PipelineConfig {
+    ControllerType    controllerType = SingleJoyCon;
+    JoyConSide        side = JoyConSide::Left;            // single Joy-Con only
+    JoyConOrientation orientation = JoyConOrientation::Upright;
+    GyroSource        gyroSource = GyroSource::Both;      // dual Joy-Con only
+    UpdatePolicy      policy = UpdatePolicy::LowLatency;
+    bool              smoothMotionClock = true;
+    bool              decodeMotion = true;                // false: output motion stays invalid
+    GyroAimOutput     aimOutput = GyroAimOutput::Off;     // decodes motion for itself if needed
+    GyroAimTuning     aim{};
+    ButtonMapping     glMapping = ButtonMapping::NONE;
+    ButtonMapping     grMapping = ButtonMapping::NONE;
+    std::shared_ptr<const CalibrationProfile> calibration;   // null: active profile
+    MotionScale       motionScale{};                      // dual: left half
+    MotionScale       rightMotionScale{};                 // dual: right half
+};
+
+struct PipelineOutput {
+    DS4_REPORT_EX report{};
+    MotionSample  motion{};
+    uint64_t      arrivalNs = 0;   // arrival of the report that produced this output
+    int32_t       aimMouseDx = 0, aimMouseDy = 0;   // GyroAimOutput::Mouse: pixels to move the pointer
+};
+
+// Decode → remap → motion for one virtual controller: the part of handling a
+// report that does not touch Windows, shared by the live handlers and the
+// capture replay. Not thread-safe; each instance belongs to one callback or
+// update thread.
+class ReportPipeline {
+public:
+    ReportPipeline() = default;
+    explicit ReportPipeline(PipelineConfig config) : config_(std::move(config)) {}
+
+    PipelineConfig&       Config() { return config_; }
+    const PipelineConfig& Config() const { return config_; }
+
+    // Motion timestamp in microseconds for a report; each dual half keeps
+    // its own clock.
+    uint64_t StampMotion(const std::vector<uint8_t>& buffer, uint64_t arrivalNs, JoyConSide half = JoyConSide::Left);
+
+    // Single Joy-Con, Pro Controller and GC. Returns false when the update
+    // policy holds the report back.
+    bool Process(const std::vector<uint8_t>& buffer, uint64_t arrivalNs, PipelineOutput& out);
+    // Dual Joy-Con, from the latest report of each half and the sample times
+    // StampMotion gave them.
+    bool ProcessDual(const std::vector<uint8_t>& left, uint64_t leftSampleUs,
+                     const std::vector<uint8_t>& right, uint64_t rightSampleUs,
+                     uint64_t arrivalNs, PipelineOutput& out);
+
+    const GyroAim& Aim() const { return aim_; }
+
+    uint64_t Processed() const { return processed_; }
+    uint64_t Emitted() const { return emitted_; }
+    void     Reset();
+
+private:
+    // Decoded motion goes to out only when config_.decodeMotion asks for it.
+    void FinishMotion(const MotionSample& motion, PipelineOutput& out);
+
+    PipelineConfig config_;
+    MotionClock    leftClock_, rightClock_;
+    EmitGate       gate_;
+    GyroAim        aim_;
+    uint64_t       processed_ = 0;
+    uint64_t       emitted_ = 0;
+};
+
+// Where emitted reports go. slot is the DSU slot / player index.
+class ReportSink {
+public:
+    virtual ~ReportSink() = default;
+    virtual void Emit(uint8_t slot, const PipelineOutput& out) = 0;
+};
+
+// Byte layout of an emitted report as the recording sink writes it and the
+// digest hashes it. Built field by field, so equal outputs give equal bytes.
+struct EmittedReportRecord {
+    uint64_t arrivalNs;
+    uint64_t motionTimestampUs;
+    uint32_t reportCounter;
+    uint8_t  slot;
+    uint8_t  motionValid;
+    uint16_t reserved;
+    float    accel[3];
+    float    gyro[3];
+    uint8_t  report[64];   // DS4_REPORT_EX::ReportBuffer, zero padded
+};
+
+static_assert(sizeof(EmittedReportRecord) == 112, "emitted report layout changed");
+
+EmittedReportRecord MakeEmittedRecord(uint8_t slot, const PipelineOutput& out);
+// FNV-1a over the record bytes, chained from seed.
+uint64_t DigestRecord(uint64_t seed, const EmittedReportRecord& record);
+
+constexpr uint64_t REPORT_DIGEST_SEED = 0xcbf29ce484222325ULL;
+
+// Counts and fingerprints what it is given; for measuring the pipeline alone
+// and for comparing two runs without writing files.
+class NullReportSink : public ReportSink {
+public:
+    void Emit(uint8_t slot, const PipelineOutput& out) override;
+
+    uint64_t Count() const { return count_; }
+    uint64_t Digest() const { return digest_; }
+
+private:
+    uint64_t count_ = 0;
+    uint64_t digest_ = REPORT_DIGEST_SEED;
+};
+
+// Feeds the DSU server like the live handlers do. Reports are dropped while
+// the server is stopped.
+class DsuReportSink : public ReportSink {
+public:
+    explicit DsuReportSink(DsuServer& server) : server_(server) {}
+    void Emit(uint8_t slot, const PipelineOutput& out) override;
+
+private:
+    DsuServer& server_;
+};
+
+constexpr char     REPORT_RECORDING_MAGIC[8] = { 'J', '2', 'C', 'R', 'E', 'P', 'T', '\0' };
+constexpr uint32_t REPORT_RECORDING_VERSION = 1;
+
+struct ReportRecordingHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t recordStride;
+};
+
+// Writes every emitted report to a file: the header, then one
+// EmittedReportRecord per report. Two recordings of the same capture are
+// byte-identical unless the pipeline's output changed.
+class RecordingReportSink : public ReportSink {
+public:
+    RecordingReportSink() = default;
+    ~RecordingReportSink();
+
+    RecordingReportSink(const RecordingReportSink&) = delete;
+    RecordingReportSink& operator=(const RecordingReportSink&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    void Emit(uint8_t slot, const PipelineOutput& out) override;
+
+    uint64_t Count() const { return count_; }
+    uint64_t Digest() const { return digest_; }
+
+private:
+    std::FILE* file_ = nullptr;
+    uint64_t   count_ = 0;
+    uint64_t   digest_ = REPORT_DIGEST_SEED;
+};
@@ -0,0 +1,158 @@
+#include "ReportReplay.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <thread>
+
+ReplayDriver::ReplayDriver(ReportSink& sink, ReplayOptions options)
+    : sink_(sink)
+    , options_(std::move(options))
+{
+    if (options_.speed <= 0.0) options_.speed = 1.0;
+}
+
+bool ReplayDriver::Add(const std::string& path, uint8_t slot)
+{
+    auto file = std::make_unique<CaptureFile>();
+    if (!file->Open(path))
+    {
+        error_ = "cannot read capture " + path;
+        return false;
+    }
+
+    const CaptureFileHeader& h = file->Header();
+    const auto type = static_cast<ControllerType>(h.controllerType);
+    const JoyConSide side = h.side == static_cast<uint8_t>(JoyConSide::Right) ? JoyConSide::Right : JoyConSide::Left;
+
+    size_t index = controllers_.size();
+    for (size_t i = 0; i < controllers_.size(); ++i)
+    {
+        if (controllers_[i]->slot != slot) continue;
+        bool halfTaken = false;
+        for (const auto& s : sources_)
+            if (s.controller == i && s.half == side) halfTaken = true;
+        if (type != DualJoyCon || controllers_[i]->pipeline.Config().controllerType != DualJoyCon || halfTaken)
+        {
+            error_ = "slot " + std::to_string(slot) + " is already replaying another capture";
+            return false;
+        }
+        index = i;
+    }
+
+    if (index == controllers_.size())
+    {
+        PipelineConfig cfg;
+        cfg.controllerType = type;
+        cfg.side = side;
+        cfg.orientation = options_.orientation;
+        cfg.gyroSource = options_.gyroSource;
+        cfg.policy = options_.policy;
+        cfg.smoothMotionClock = options_.smoothMotionClock;
+        cfg.decodeMotion = options_.decodeMotion;
+        cfg.glMapping = options_.glMapping;
+        cfg.grMapping = options_.grMapping;
+        cfg.calibration = options_.calibration;
+
+        auto c = std::make_unique<Controller>();
+        c->slot = slot;
+        c->pipeline = ReportPipeline(cfg);
+        controllers_.push_back(std::move(c));
+    }
+
+    Source source;
+    source.file = std::move(file);
+    source.controller = index;
+    source.half = side;
+    sources_.push_back(std::move(source));
+    return true;
+}
+
+void ReplayDriver::Feed(Source& source, const CaptureRecord& record, ReplayStats& stats)
+{
+    ++stats.records;
+    if (record.flags & CAPTURE_FLAG_TRUNCATED) ++stats.truncated;
+    if (source.started && record.sequence != source.lastSequence + 1)
+        stats.sequenceGaps += record.sequence - source.lastSequence - 1;
+    source.lastSequence = record.sequence;
+    source.started = true;
+
+    Controller& c = *controllers_[source.controller];
+    PipelineOutput out;
+    if (c.pipeline.Config().controllerType != DualJoyCon)
+    {
+        scratch_.assign(record.data, record.data + record.length);
+        if (c.pipeline.Process(scratch_, record.arrivalNs, out))
+        {
+            sink_.Emit(c.slot, out);
+            ++stats.emitted;
+        }
+        return;
+    }
+
+    // Like the live dual handlers: stamp the half that arrived, then rebuild
+    // the combined report once both halves have been seen.
+    const bool isLeft = source.half == JoyConSide::Left;
+    auto& buf = isLeft ? c.left : c.right;
+    buf.assign(record.data, record.data + record.length);
+    (isLeft ? c.leftUs : c.rightUs) = c.pipeline.StampMotion(buf, record.arrivalNs, source.half);
+    (isLeft ? c.hasLeft : c.hasRight) = true;
+    if (!c.hasLeft || !c.hasRight) return;
+    if (c.pipeline.ProcessDual(c.left, c.leftUs, c.right, c.rightUs, record.arrivalNs, out))
+    {
+        sink_.Emit(c.slot, out);
+        ++stats.emitted;
+    }
+}
+
+ReplayStats ReplayDriver::Run(const std::atomic<bool>* cancel)
+{
+    using Clock = std::chrono::steady_clock;
+    ReplayStats stats;
+
+    uint64_t firstNs = std::numeric_limits<uint64_t>::max(), lastNs = 0;
+    for (const auto& s : sources_)
+    {
+        if (s.next >= s.file->Count()) continue;
+        firstNs = std::min(firstNs, s.file->Record(s.next).arrivalNs);
+        lastNs = std::max(lastNs, s.file->Record(s.file->Count() - 1).arrivalNs);
+    }
+    if (firstNs > lastNs) return stats;
+    stats.capturedMs = (lastNs - firstNs) / 1e6;
+
+    const bool paced = options_.mode != ReplayMode::AsFastAsPossible;
+    const double speed = options_.mode == ReplayMode::Accelerated ? options_.speed : 1.0;
+    const auto start = Clock::now();
+
+    for (;;)
+    {
+        if (cancel && cancel->load(std::memory_order_relaxed))
+        {
+            stats.cancelled = true;
+            break;
+        }
+
+        // A handful of streams at most, so a linear scan beats a heap.
+        Source* pick = nullptr;
+        for (auto& s : sources_)
+        {
+            if (s.next >= s.file->Count()) continue;
+            if (!pick || s.file->Record(s.next).arrivalNs < pick->file->Record(pick->next).arrivalNs) pick = &s;
+        }
+        if (!pick) break;
+
+        const CaptureRecord& record = pick->file->Record(pick->next++);
+        if (paced)
+        {
+            const auto offset = std::chrono::nanoseconds(static_cast<int64_t>((record.arrivalNs - firstNs) / speed));
+            const auto due = start + std::chrono::duration_cast<Clock::duration>(offset);
+            if (Clock::now() < due) std::this_thread::sleep_until(due);
+            // Includes oversleeping, which is as much a pacing error as falling behind.
+            stats.maxLateUs = std::max(stats.maxLateUs, std::chrono::duration<double, std::micro>(Clock::now() - due).count());
+        }
+        Feed(*pick, record, stats);
+    }
+
+    stats.wallMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ReportCapture.h"
+#include "ReportPipeline.h"
+
+enum class ReplayMode {
+    RealTime,           // original arrival spacing
+    Accelerated,        // arrival spacing divided by ReplayOptions::speed
+    AsFastAsPossible,   // no pacing; measures pipeline throughput
+};
+
+// Settings the live app takes from the UI rather than from the capture.
+struct ReplayOptions {
+    ReplayMode        mode = ReplayMode::RealTime;
+    double            speed = 1.0;
+    UpdatePolicy      policy = UpdatePolicy::LowLatency;
+    bool              smoothMotionClock = true;
+    bool              decodeMotion = true;
+    JoyConOrientation orientation = JoyConOrientation::Upright;
+    GyroSource        gyroSource = GyroSource::Both;
+    ButtonMapping     glMapping = ButtonMapping::NONE;
+    ButtonMapping     grMapping = ButtonMapping::NONE;
+    std::shared_ptr<const CalibrationProfile> calibration;   // null: active profile
+};
+
+struct ReplayStats {
+    uint64_t records = 0;         // captured reports fed to a pipeline
+    uint64_t emitted = 0;         // reports handed to the sink
+    uint64_t sequenceGaps = 0;    // records the capture itself dropped
+    uint64_t truncated = 0;
+    double   capturedMs = 0.0;    // first to last arrival in the captures
+    double   wallMs = 0.0;
+    double   maxLateUs = 0.0;     // paced modes: worst delay behind schedule
+    bool     cancelled = false;
+
+    double ReportsPerSecond() const { return wallMs > 0.0 ? records * 1000.0 / wallMs : 0.0; }
+    double NsPerReport() const { return records ? wallMs * 1e6 / records : 0.0; }
+};
+
+// Runs captured report streams back through ReportPipeline into a sink, in
+// arrival order across all streams. Each capture becomes one virtual
+// controller on its slot, except that the two halves of a dual Joy-Con
+// added on the same slot share one.
+class ReplayDriver {
+public:
+    explicit ReplayDriver(ReportSink& sink, ReplayOptions options = {});
+
+    ReplayDriver(const ReplayDriver&) = delete;
+    ReplayDriver& operator=(const ReplayDriver&) = delete;
+
+    // False, with Error() set, if the file is unreadable or the slot is
+    // already taken by a different controller.
+    bool Add(const std::string& path, uint8_t slot);
+
+    // Blocks until every record has been replayed or cancel is set.
+    ReplayStats Run(const std::atomic<bool>* cancel = nullptr);
+
+    size_t Streams() const { return sources_.size(); }
+    const std::string& Error() const { return error_; }
+
+private:
+    struct Controller {
+        uint8_t              slot = 0;
+        ReportPipeline       pipeline;
+        std::vector<uint8_t> left, right;      // dual: latest report per half
+        uint64_t             leftUs = 0, rightUs = 0;
+        bool                 hasLeft = false, hasRight = false;
+    };
+
+    struct Source {
+        std::unique_ptr<CaptureFile> file;
+        size_t     controller = 0;
+        JoyConSide half = JoyConSide::Left;
+        size_t     next = 0;
+        uint32_t   lastSequence = 0;
+        bool       started = false;
+    };
+
+    void Feed(Source& source, const CaptureRecord& record, ReplayStats& stats);
+
+    ReportSink& sink_;
+    ReplayOptions options_;
+    std::vector<Source> sources_;
+    std::vector<std::unique_ptr<Controller>> controllers_;
+    std::vector<uint8_t> scratch_;
+    std::string error_;
+};
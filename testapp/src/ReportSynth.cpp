@@ -0,0 +1,234 @@
+#include "ReportSynth.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+constexpr double kPi = 3.14159265358979323846;
+
+// The shared 48-bit button field in bytes 3-8, big-endian. Joy-Con halves
+// report the same bits; each decoder just reads its own three bytes.
+constexpr uint64_t kDpadDown  = 0x000000010000;
+constexpr uint64_t kDpadUp    = 0x000000020000;
+constexpr uint64_t kDpadRight = 0x000000040000;
+constexpr uint64_t kDpadLeft  = 0x000000080000;
+constexpr uint64_t kL         = 0x000000400000;
+constexpr uint64_t kZL        = 0x000000800000;
+constexpr uint64_t kMinus     = 0x000001000000;
+constexpr uint64_t kPlus      = 0x000002000000;
+constexpr uint64_t kRStick    = 0x000004000000;
+constexpr uint64_t kLStick    = 0x000008000000;
+constexpr uint64_t kY         = 0x000100000000;
+constexpr uint64_t kB         = 0x000200000000;
+constexpr uint64_t kX         = 0x000400000000;
+constexpr uint64_t kA         = 0x000800000000;
+constexpr uint64_t kR         = 0x004000000000;
+constexpr uint64_t kZR        = 0x008000000000;
+
+constexpr uint64_t kLeftButtons[] = { kDpadDown, kDpadUp, kDpadRight, kDpadLeft, kL, kZL, kMinus, kLStick };
+constexpr uint64_t kRightButtons[] = { kY, kB, kX, kA, kR, kZR, kPlus, kRStick };
+
+constexpr int kStickCenter = 2048;
+constexpr int kStickTravel = 1400;   // counts from centre at full deflection
+
+// mt19937 output is fixed by the standard; the <random> distributions are
+// not, so these keep a seed's output identical across standard libraries.
+double Uniform(std::mt19937& rng)
+{
+    return (rng() >> 5) * (1.0 / 134217728.0);
+}
+
+double Gaussian(std::mt19937& rng)
+{
+    const double u1 = std::max(Uniform(rng), 1e-12);
+    const double u2 = Uniform(rng);
+    return std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * kPi * u2);
+}
+
+void PutStick(uint8_t* r, size_t offset, int x, int y)
+{
+    x = std::clamp(x, 0, 4095);
+    y = std::clamp(y, 0, 4095);
+    r[offset] = static_cast<uint8_t>(x & 0xFF);
+    r[offset + 1] = static_cast<uint8_t>(((x >> 8) & 0x0F) | ((y & 0x0F) << 4));
+    r[offset + 2] = static_cast<uint8_t>(y >> 4);
+}
+
+void PutS16(uint8_t* r, size_t offset, double value)
+{
+    const auto v = static_cast<int16_t>(std::clamp(std::lround(value), -32768L, 32767L));
+    r[offset] = static_cast<uint8_t>(v & 0xFF);
+    r[offset + 1] = static_cast<uint8_t>((v >> 8) & 0xFF);
+}
+}
+
+SyntheticController::SyntheticController(SyntheticControllerConfig config)
+    : config_(config)
+    , rng_(config.seed)
+{
+    if (config_.rateHz <= 0.0) config_.rateHz = 125.0;
+    periodNs_ = static_cast<uint64_t>(1e9 / config_.rateHz);
+
+    // Joy-Con halves, single or one half of a dual pair, only press their own
+    // buttons; Pro and NSO GC controllers have both sets.
+    const bool joyCon = config_.type == SingleJoyCon || config_.type == DualJoyCon;
+    const bool left = !joyCon || config_.side == JoyConSide::Left;
+    const bool right = !joyCon || config_.side == JoyConSide::Right;
+    if (left)
+        for (uint64_t b : kLeftButtons) buttonPool_.push_back(b);
+    if (right)
+        for (uint64_t b : kRightButtons) buttonPool_.push_back(b);
+}
+
+void SyntheticController::Next(std::vector<uint8_t>& out)
+{
+    out.resize(SYNTH_REPORT_SIZE);
+    Next(out.data());
+}
+
+void SyntheticController::Next(uint8_t* out)
+{
+    std::memset(out, 0, SYNTH_REPORT_SIZE);
+    const uint64_t i = index_++;
+    const double t = static_cast<double>(i) / config_.rateHz;
+
+    if (held_ && i >= releaseAt_) held_ = 0;
+    if (!held_ && !buttonPool_.empty() && Uniform(rng_) < config_.pressesPerSecond / config_.rateHz)
+    {
+        held_ = buttonPool_[rng_() % buttonPool_.size()];
+        releaseAt_ = i + std::max<uint64_t>(1, static_cast<uint64_t>(config_.holdMs * config_.rateHz / 1000.0));
+    }
+
+    // Counter in the low three bytes; byte 3 is the top of the button field.
+    out[0] = static_cast<uint8_t>(i);
+    out[1] = static_cast<uint8_t>(i >> 8);
+    out[2] = static_cast<uint8_t>(i >> 16);
+    for (int b = 0; b < 6; ++b) out[3 + b] = static_cast<uint8_t>(held_ >> (8 * (5 - b)));
+
+    // Left stick circles, right stick traces a figure eight; a few counts of
+    // noise keep the deadzone and calibration paths honest.
+    const double travel = config_.stickDeflection * kStickTravel;
+    const double phase = 2.0 * kPi * config_.stickHz * t;
+    PutStick(out, 10,
+        kStickCenter + static_cast<int>(travel * std::cos(phase) + 3.0 * Gaussian(rng_)),
+        kStickCenter + static_cast<int>(travel * std::sin(phase) + 3.0 * Gaussian(rng_)));
+    PutStick(out, 13,
+        kStickCenter + static_cast<int>(travel * std::sin(phase) + 3.0 * Gaussian(rng_)),
+        kStickCenter + static_cast<int>(travel * std::sin(2.0 * phase) * 0.5 + 3.0 * Gaussian(rng_)));
+
+    const bool joyCon = config_.type == SingleJoyCon || config_.type == DualJoyCon;
+    if (joyCon && config_.side == JoyConSide::Right)
+    {
+        mouseX_ += static_cast<int>(std::lround(4.0 * std::cos(phase * 0.5)));
+        mouseY_ += static_cast<int>(std::lround(4.0 * std::sin(phase * 0.5)));
+        PutS16(out, 0x10, static_cast<int16_t>(mouseX_));
+        PutS16(out, 0x12, static_cast<int16_t>(mouseY_));
+    }
+
+    // A wrist rolling back and forth: gyro X follows the roll rate and the
+    // gravity vector in accel turns with the roll angle.
+    const double omega = 2.0 * kPi * config_.motionHz;
+    const double rateDps = config_.gyroAmplitudeDps * std::cos(omega * t);
+    const double rollRad = (config_.gyroAmplitudeDps / omega) * std::sin(omega * t) * kPi / 180.0;
+    const double accelScale = config_.scale.accelCountsPerG;
+    const double gyroScale = config_.scale.gyroCountsPerDps;
+    out[0x29] = 0x01;
+    PutS16(out, 0x30, accelScale * config_.accelNoiseG * Gaussian(rng_));
+    PutS16(out, 0x32, accelScale * (std::sin(rollRad) + config_.accelNoiseG * Gaussian(rng_)));
+    PutS16(out, 0x34, accelScale * (std::cos(rollRad) + config_.accelNoiseG * Gaussian(rng_)));
+    PutS16(out, 0x36, config_.scale.gyroBiasX + gyroScale * (rateDps + config_.gyroNoiseDps * Gaussian(rng_)));
+    PutS16(out, 0x38, config_.scale.gyroBiasY + gyroScale * (0.3 * rateDps * std::sin(omega * t) + config_.gyroNoiseDps * Gaussian(rng_)));
+    PutS16(out, 0x3A, config_.scale.gyroBiasZ + gyroScale * config_.gyroNoiseDps * Gaussian(rng_));
+
+    out[0x3C] = (held_ & kZL) ? 0xFF : 0x00;
+    out[0x3D] = (held_ & kZR) ? 0xFF : 0x00;
+}
+
+ImpairedChannel::ImpairedChannel(ChannelConfig config)
+    : config_(config)
+    , rng_(config.seed)
+{
+}
+
+bool ImpairedChannel::Transmit(uint64_t sentNs, uint64_t& arrivalNs)
+{
+    ++sent_;
+
+    // Every report draws the same number of values whatever happens to it,
+    // so changing the loss settings does not reshuffle the jitter.
+    const double transition = Uniform(rng_);
+    const double lossDraw = Uniform(rng_);
+    const double jitterDraw = Uniform(rng_);
+
+    if (bad_) bad_ = transition >= config_.burstExit;
+    else bad_ = transition < config_.burstEnter;
+
+    if (lossDraw < (bad_ ? config_.burstLoss : config_.lossRate))
+    {
+        ++lost_;
+        if (bad_) ++burstLost_;
+        return false;
+    }
+
+    double delayUs = config_.latencyUs;
+    if (config_.jitterUs > 0.0) delayUs -= config_.jitterUs * std::log(std::max(1.0 - jitterDraw, 1e-12));
+    arrivalNs = sentNs + static_cast<uint64_t>(std::max(delayUs, 0.0) * 1000.0);
+    if (config_.preserveOrder) arrivalNs = std::max(arrivalNs, lastArrivalNs_);
+    lastArrivalNs_ = arrivalNs;
+    return true;
+}
+
+SyntheticStream::SyntheticStream(const std::vector<SyntheticDeviceSpec>& devices, uint64_t startNs)
+{
+    devices_.reserve(devices.size());
+    for (size_t i = 0; i < devices.size(); ++i)
+    {
+        SyntheticController controller(devices[i].controller);
+        // Spread the devices across one period so they don't all fire at once.
+        const uint64_t offset = controller.PeriodNs() * i / std::max<size_t>(devices.size(), 1);
+        devices_.push_back(Device{ std::move(controller), ImpairedChannel(devices[i].channel), startNs + offset });
+    }
+    scratch_.resize(SYNTH_REPORT_SIZE);
+}
+
+size_t SyntheticStream::RunUntil(uint64_t untilNs, const DeliverFn& deliver)
+{
+    for (size_t i = 0; i < devices_.size(); ++i)
+    {
+        Device& d = devices_[i];
+        while (d.nextSendNs <= untilNs)
+        {
+            Pending f;
+            f.sentNs = d.nextSendNs;
+            f.device = i;
+            d.controller.Next(f.data.data());
+            d.nextSendNs += d.controller.PeriodNs();
+            if (!d.channel.Transmit(f.sentNs, f.arrivalNs)) continue;
+            f.order = order_++;
+            inFlight_.push(f);
+        }
+    }
+
+    size_t count = 0;
+    while (!inFlight_.empty() && inFlight_.top().arrivalNs <= untilNs)
+    {
+        const Pending& f = inFlight_.top();
+        std::memcpy(scratch_.data(), f.data.data(), SYNTH_REPORT_SIZE);
+        const size_t device = f.device;
+        const uint64_t sentNs = f.sentNs, arrivalNs = f.arrivalNs;
+        inFlight_.pop();
+        deliver(device, scratch_, sentNs, arrivalNs);
+        ++count;
+    }
+    delivered_ += count;
+    return count;
+}
+
+uint64_t SyntheticStream::NextEventNs() const
+{
+    uint64_t next = inFlight_.empty() ? UINT64_MAX : inFlight_.top().arrivalNs;
+    for (const auto& d : devices_) next = std::min(next, d.nextSendNs);
+    return next;
+}
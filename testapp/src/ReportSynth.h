@@ -0,0 +1,154 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <vector>
+
+#include "JoyConDecoder.h"
+#include "ReportPipeline.h"
+
+constexpr size_t SYNTH_REPORT_SIZE = 0x40;
+
+// What a synthetic controller does with its inputs. Everything is driven by
+// seed, so two runs with the same config produce the same reports.
+struct SyntheticControllerConfig {
+    ControllerType type = ProController;
+    JoyConSide     side = JoyConSide::Left;   // Joy-Con halves only
+    double   rateHz = 125.0;
+    uint32_t seed = 1;
+    double   pressesPerSecond = 2.0;          // new button presses started per second
+    double   holdMs = 120.0;                  // how long each press lasts
+    double   stickHz = 0.5;                   // one stick circle per 1/stickHz seconds
+    double   stickDeflection = 0.8;           // fraction of full travel
+    double   gyroAmplitudeDps = 180.0;        // peak rate of the simulated wrist motion
+    double   motionHz = 1.0;
+    double   gyroNoiseDps = 0.4;
+    double   accelNoiseG = 0.01;
+    MotionScale scale{};                      // counts per unit, as the decoder expects
+};
+
+// Produces Joy-Con 2 input reports: a report counter in bytes 0-2, the
+// 48-bit button field in bytes 3-8, both 12-bit sticks, optical mouse
+// motion, analog triggers, and IMU samples behind the common-report marker.
+// Buttons are drawn from the ones the given controller type actually has.
+class SyntheticController {
+public:
+    explicit SyntheticController(SyntheticControllerConfig config);
+
+    // Fills out with the next report and advances by one report period.
+    void Next(uint8_t* out);
+    void Next(std::vector<uint8_t>& out);
+
+    const SyntheticControllerConfig& Config() const { return config_; }
+    uint64_t PeriodNs() const { return periodNs_; }
+    uint64_t Generated() const { return index_; }
+
+private:
+    SyntheticControllerConfig config_;
+    std::mt19937 rng_;
+    std::vector<uint64_t> buttonPool_;
+    uint64_t periodNs_;
+    uint64_t index_ = 0;
+    uint64_t held_ = 0;
+    uint64_t releaseAt_ = 0;      // report index when held_ is released
+    int mouseX_ = 0, mouseY_ = 0;
+};
+
+// One direction of a BLE link. Every report is delayed by latencyUs plus an
+// exponentially distributed jitter (a radio link delays, it never delivers
+// early), and is lost either at random or in bursts following a two-state
+// Gilbert-Elliott model.
+struct ChannelConfig {
+    double   latencyUs = 7500.0;
+    double   jitterUs = 0.0;        // mean of the extra delay
+    double   lossRate = 0.0;        // loss probability in the good state
+    double   burstEnter = 0.0;      // per report: chance to enter the bad state
+    double   burstExit = 0.25;      // per report: chance to leave it
+    double   burstLoss = 1.0;       // loss probability in the bad state
+    bool     preserveOrder = true;  // BLE delivers in order; delays queue up
+    uint32_t seed = 1;
+};
+
+class ImpairedChannel {
+public:
+    explicit ImpairedChannel(ChannelConfig config);
+
+    // Arrival time of a report sent at sentNs, or false if it is lost.
+    bool Transmit(uint64_t sentNs, uint64_t& arrivalNs);
+
+    const ChannelConfig& Config() const { return config_; }
+    uint64_t Sent() const { return sent_; }
+    uint64_t Lost() const { return lost_; }
+    uint64_t BurstLost() const { return burstLost_; }
+
+private:
+    ChannelConfig config_;
+    std::mt19937 rng_;
+    bool bad_ = false;
+    uint64_t lastArrivalNs_ = 0;
+    uint64_t sent_ = 0;
+    uint64_t lost_ = 0;
+    uint64_t burstLost_ = 0;
+};
+
+struct SyntheticDeviceSpec {
+    SyntheticControllerConfig controller;
+    ChannelConfig channel;
+};
+
+// N synthetic controllers, each behind its own channel, delivered in
+// arrival order as if they shared one host. Time is virtual: the caller
+// decides how fast it passes, so the same specs give the same deliveries
+// whether they are paced in real time or run flat out.
+class SyntheticStream {
+public:
+    // sentNs is when the controller produced the report, arrivalNs when the
+    // host receives it.
+    using DeliverFn = std::function<void(size_t device, const std::vector<uint8_t>& report,
+                                         uint64_t sentNs, uint64_t arrivalNs)>;
+
+    SyntheticStream(const std::vector<SyntheticDeviceSpec>& devices, uint64_t startNs);
+
+    // Delivers everything that arrives at or before untilNs. Returns the
+    // number of reports delivered.
+    size_t RunUntil(uint64_t untilNs, const DeliverFn& deliver);
+
+    // Earliest time anything can next arrive: the first report in flight or
+    // the next one a controller sends, whichever comes first.
+    uint64_t NextEventNs() const;
+
+    size_t Devices() const { return devices_.size(); }
+    const SyntheticController& Controller(size_t device) const { return devices_[device].controller; }
+    const ImpairedChannel&     Channel(size_t device) const { return devices_[device].channel; }
+    uint64_t Delivered() const { return delivered_; }
+    uint64_t InFlight() const { return inFlight_.size(); }
+
+private:
+    struct Device {
+        SyntheticController controller;
+        ImpairedChannel     channel;
+        uint64_t            nextSendNs;
+    };
+
+    struct Pending {
+        uint64_t arrivalNs;
+        uint64_t sentNs;
+        uint64_t order;   // ties break in send order
+        size_t   device;
+        std::array<uint8_t, SYNTH_REPORT_SIZE> data;
+
+        bool operator>(const Pending& other) const
+        {
+            return arrivalNs != other.arrivalNs ? arrivalNs > other.arrivalNs : order > other.order;
+        }
+    };
+
+    std::vector<Device> devices_;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> inFlight_;
+    std::vector<uint8_t> scratch_;
+    uint64_t order_ = 0;
+    uint64_t delivered_ = 0;
+};
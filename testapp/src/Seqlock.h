@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// A small value that one thread writes often and others read now and then,
+// without either side ever blocking. The writer bumps a sequence number to
+// odd, copies the value in and bumps it back to even; a reader copies the
+// value out and retries if the sequence moved under it. The value is kept in
+// atomic words so a read that races a write is a retry, not a data race.
+// One writer at a time.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>, "Seqlock values are copied word by word");
+
+public:
+    Seqlock() { Store(T{}); }
+
+    Seqlock(const Seqlock&) = delete;
+    Seqlock& operator=(const Seqlock&) = delete;
+
+    void Store(const T& value)
+    {
+        std::array<uint64_t, kWords> words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+        const uint64_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < kWords; ++i) words_[i].store(words[i], std::memory_order_relaxed);
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    // False if a write was in progress; out is then unchanged.
+    bool TryLoad(T& out) const
+    {
+        const uint64_t before = sequence_.load(std::memory_order_acquire);
+        if (before & 1) return false;
+        std::array<uint64_t, kWords> words;
+        for (size_t i = 0; i < kWords; ++i) words[i] = words_[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence_.load(std::memory_order_relaxed) != before) return false;
+        std::memcpy(static_cast<void*>(&out), words.data(), sizeof(T));
+        return true;
+    }
+
+    // Spins until a write-free copy is had; writes are a few stores long.
+    T Load() const
+    {
+        T out{};
+        while (!TryLoad(out)) {
+        }
+        return out;
+    }
+
+    // Even, and bumped by two per Store.
+    uint64_t Sequence() const { return sequence_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr size_t kWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence_{ 0 };
+    std::array<std::atomic<uint64_t>, kWords> words_{};
+};
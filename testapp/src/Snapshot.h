@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+// Settings that the UI thread edits while input threads read them, published
+// read-copy-update style: a writer builds a whole new value and swaps it in,
+// and a value is never modified once published. Readers keep the snapshot
+// they last took (see SnapshotReader), so an old value is freed only after
+// the last reader holding it has moved on.
+template <typename T>
+class SnapshotCell {
+public:
+    explicit SnapshotCell(T initial = T{})
+        : current_(std::make_shared<const T>(std::move(initial)))
+    {
+    }
+
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+    void Publish(T value)
+    {
+        auto next = std::make_shared<const T>(std::move(value));
+        std::lock_guard<std::mutex> lock(mutex_);
+        current_ = std::move(next);
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    // Copies the current value, lets fn change the copy and publishes it.
+    // Writers serialise on the lock; readers are not blocked by fn.
+    template <typename Fn>
+    void Update(Fn&& fn)
+    {
+        std::lock_guard<std::mutex> update(updateMutex_);
+        T next = *Load();
+        fn(next);
+        Publish(std::move(next));
+    }
+
+    std::shared_ptr<const T> Load(uint64_t* version = nullptr) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (version) *version = version_.load(std::memory_order_relaxed);
+        return current_;
+    }
+
+    // Bumped by every Publish; a reader whose copy matches has nothing to do.
+    uint64_t Version() const { return version_.load(std::memory_order_acquire); }
+
+private:
+    mutable std::mutex mutex_;   // guards current_; held only to copy the pointer
+    std::mutex updateMutex_;
+    std::shared_ptr<const T> current_;
+    std::atomic<uint64_t> version_{ 1 };
+};
+
+// One reader's view of a SnapshotCell. Checking for a newer value is one
+// atomic load; the cell's lock is taken only on the first read after a
+// Publish. Not thread-safe: give each thread or callback its own.
+template <typename T>
+class SnapshotReader {
+public:
+    // True if the snapshot changed since the last call.
+    bool Refresh(const SnapshotCell<T>& cell)
+    {
+        if (value_ && cell.Version() == version_) return false;
+        value_ = cell.Load(&version_);
+        return true;
+    }
+
+    const T& Read(const SnapshotCell<T>& cell)
+    {
+        Refresh(cell);
+        return *value_;
+    }
+
+    // The snapshot from the last Refresh or Read; null before the first.
+    const std::shared_ptr<const T>& Current() const { return value_; }
+    uint64_t Version() const { return version_; }
+
+private:
+    std::shared_ptr<const T> value_;
+    uint64_t version_ = 0;
+};
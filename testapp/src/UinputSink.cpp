@@ -0,0 +1,391 @@
+#include "UinputSink.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#ifdef __linux__
+namespace
+{
+    // What hid-playstation reports for a DualShock 4 v2, so SDL and games
+    // map the device the same way they map the real controller.
+    constexpr uint16_t kSonyVendor = 0x054C;
+    constexpr uint16_t kDs4Product = 0x09CC;
+    constexpr uint16_t kDs4Version = 0x8111;
+    constexpr int kAccelPerG = 8192;
+    constexpr int kAccelRange = 32768;
+    constexpr int kGyroPerDps = 1024;
+    constexpr int kGyroRange = 2048 * kGyroPerDps;
+
+    constexpr uint16_t kAxisCodes[6] = { ABS_X, ABS_Y, ABS_RX, ABS_RY, ABS_Z, ABS_RZ };
+
+    struct ButtonCode {
+        uint16_t mask;
+        uint16_t code;
+    };
+    constexpr ButtonCode kButtons[] = {
+        { DS4_BUTTON_CROSS, BTN_SOUTH }, { DS4_BUTTON_CIRCLE, BTN_EAST },
+        { DS4_BUTTON_TRIANGLE, BTN_NORTH }, { DS4_BUTTON_SQUARE, BTN_WEST },
+        { DS4_BUTTON_SHOULDER_LEFT, BTN_TL }, { DS4_BUTTON_SHOULDER_RIGHT, BTN_TR },
+        { DS4_BUTTON_TRIGGER_LEFT, BTN_TL2 }, { DS4_BUTTON_TRIGGER_RIGHT, BTN_TR2 },
+        { DS4_BUTTON_SHARE, BTN_SELECT }, { DS4_BUTTON_OPTIONS, BTN_START },
+        { DS4_BUTTON_THUMB_LEFT, BTN_THUMBL }, { DS4_BUTTON_THUMB_RIGHT, BTN_THUMBR },
+    };
+
+    // DS4 d-pad direction (0 = north, clockwise, 8 = none) as hat x/y.
+    constexpr int8_t kHat[9][2] = {
+        { 0, -1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, 0 },
+    };
+
+    // One write()'s worth of events.
+    struct EventBatch {
+        input_event events[32];
+        size_t count = 0;
+
+        void Add(uint16_t type, uint16_t code, int32_t value)
+        {
+            if (count == sizeof(events) / sizeof(events[0])) return;
+            input_event& e = events[count++];
+            std::memset(&e, 0, sizeof(e));
+            e.type = type;
+            e.code = code;
+            e.value = value;
+        }
+        void Sync() { Add(EV_SYN, SYN_REPORT, 0); }
+    };
+
+    bool WriteBatch(int fd, const EventBatch& batch, uint64_t& writes, uint64_t& errors)
+    {
+        const ssize_t bytes = static_cast<ssize_t>(batch.count * sizeof(input_event));
+        ++writes;
+        if (write(fd, batch.events, static_cast<size_t>(bytes)) == bytes) return true;
+        ++errors;
+        return false;
+    }
+
+    int OpenUinput(std::string& error)
+    {
+        const int fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) error = std::string("/dev/uinput: ") + std::strerror(errno);
+        return fd;
+    }
+
+    bool EnableAbs(int fd, uint16_t code, int32_t min, int32_t max, int32_t resolution)
+    {
+        uinput_abs_setup abs{};
+        abs.code = code;
+        abs.absinfo.minimum = min;
+        abs.absinfo.maximum = max;
+        abs.absinfo.resolution = resolution;
+        return ioctl(fd, UI_SET_ABSBIT, code) == 0 && ioctl(fd, UI_ABS_SETUP, &abs) == 0;
+    }
+
+    bool CreateDevice(int fd, const std::string& name, uint16_t bus, uint16_t vendor, uint16_t product, uint16_t version)
+    {
+        uinput_setup setup{};
+        setup.id.bustype = bus;
+        setup.id.vendor = vendor;
+        setup.id.product = product;
+        setup.id.version = version;
+        std::strncpy(setup.name, name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
+        return ioctl(fd, UI_DEV_SETUP, &setup) == 0 && ioctl(fd, UI_DEV_CREATE) == 0;
+    }
+
+    // Closes fd and reports the failed step; for the creation paths.
+    int Fail(int fd, std::string& error, const char* step)
+    {
+        error = std::string(step) + ": " + std::strerror(errno);
+        close(fd);
+        return -1;
+    }
+
+    int CreateGamepad(const std::string& name, std::string& error)
+    {
+        const int fd = OpenUinput(error);
+        if (fd < 0) return -1;
+        bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0 && ioctl(fd, UI_SET_EVBIT, EV_ABS) == 0;
+        for (const auto& b : kButtons) ok = ok && ioctl(fd, UI_SET_KEYBIT, b.code) == 0;
+        ok = ok && ioctl(fd, UI_SET_KEYBIT, BTN_MODE) == 0;
+        for (uint16_t code : kAxisCodes) ok = ok && EnableAbs(fd, code, 0, 255, 0);
+        ok = ok && EnableAbs(fd, ABS_HAT0X, -1, 1, 0) && EnableAbs(fd, ABS_HAT0Y, -1, 1, 0);
+        if (!ok) return Fail(fd, error, "uinput gamepad setup");
+        if (!CreateDevice(fd, name, BUS_USB, kSonyVendor, kDs4Product, kDs4Version)) return Fail(fd, error, "uinput gamepad create");
+        return fd;
+    }
+
+    int CreateMotion(const std::string& name, std::string& error)
+    {
+        const int fd = OpenUinput(error);
+        if (fd < 0) return -1;
+        bool ok = ioctl(fd, UI_SET_EVBIT, EV_ABS) == 0 && ioctl(fd, UI_SET_EVBIT, EV_MSC) == 0 &&
+                  ioctl(fd, UI_SET_MSCBIT, MSC_TIMESTAMP) == 0 &&
+                  ioctl(fd, UI_SET_PROPBIT, INPUT_PROP_ACCELEROMETER) == 0;
+        for (uint16_t code : { ABS_X, ABS_Y, ABS_Z }) ok = ok && EnableAbs(fd, code, -kAccelRange, kAccelRange, kAccelPerG);
+        for (uint16_t code : { ABS_RX, ABS_RY, ABS_RZ }) ok = ok && EnableAbs(fd, code, -kGyroRange, kGyroRange, kGyroPerDps);
+        if (!ok) return Fail(fd, error, "uinput motion setup");
+        if (!CreateDevice(fd, name, BUS_USB, kSonyVendor, kDs4Product, kDs4Version)) return Fail(fd, error, "uinput motion create");
+        return fd;
+    }
+
+    // The eventN node udev made for a uinput device, from its sysfs entry.
+    std::string EventNode(int fd)
+    {
+        if (fd < 0) return {};
+        char sysname[64] = {};
+        if (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname) < 0) return {};
+        const std::string dir = std::string("/sys/devices/virtual/input/") + sysname;
+        DIR* d = opendir(dir.c_str());
+        if (!d) return {};
+        std::string node;
+        while (const dirent* entry = readdir(d)) {
+            if (std::strncmp(entry->d_name, "event", 5) == 0) {
+                node = std::string("/dev/input/") + entry->d_name;
+                break;
+            }
+        }
+        closedir(d);
+        return node;
+    }
+
+    void Destroy(int& fd)
+    {
+        if (fd < 0) return;
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+        fd = -1;
+    }
+
+    int32_t Scaled(float value, int perUnit, int range)
+    {
+        return static_cast<int32_t>(std::clamp(std::lround(value * static_cast<float>(perUnit)), -static_cast<long>(range), static_cast<long>(range)));
+    }
+}
+#endif
+
+UinputReportSink::~UinputReportSink()
+{
+    Close();
+}
+
+bool UinputReportSink::Supported()
+{
+#ifdef __linux__
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool UinputReportSink::Open(uint8_t slot, const std::string& name)
+{
+#ifdef __linux__
+    if (slot >= kMaxSlots) {
+        error_ = "slot out of range";
+        return false;
+    }
+    Slot& s = slots_[slot];
+    if (s.gamepadFd >= 0) return true;
+    s = Slot{};
+    s.gamepadFd = CreateGamepad(name, error_);
+    if (s.gamepadFd < 0) return false;
+    s.motionFd = CreateMotion(name + " Motion Sensors", error_);
+    if (s.motionFd < 0) {
+        Destroy(s.gamepadFd);
+        return false;
+    }
+    return true;
+#else
+    (void)slot;
+    (void)name;
+    error_ = "uinput is only available on Linux";
+    return false;
+#endif
+}
+
+void UinputReportSink::Close()
+{
+#ifdef __linux__
+    for (Slot& s : slots_) {
+        Destroy(s.gamepadFd);
+        Destroy(s.motionFd);
+        s.primed = false;
+    }
+#endif
+}
+
+void UinputReportSink::Emit(uint8_t slot, const PipelineOutput& out)
+{
+    if (slot >= kMaxSlots) return;
+    Slot& s = slots_[slot];
+    if (s.gamepadFd < 0) return;
+    EmitGamepad(s, out.report);
+    if (out.motion.valid) EmitMotion(s, out.motion);
+}
+
+void UinputReportSink::EmitGamepad(Slot& s, const DS4_REPORT_EX& report)
+{
+#ifdef __linux__
+    const auto& r = report.Report;
+    EventBatch batch;
+    const uint8_t axes[6] = { r.bThumbLX, r.bThumbLY, r.bThumbRX, r.bThumbRY, r.bTriggerL, r.bTriggerR };
+    for (int i = 0; i < 6; ++i)
+        if (!s.primed || axes[i] != s.lastAxes[i]) batch.Add(EV_ABS, kAxisCodes[i], axes[i]);
+
+    const int8_t* hat = kHat[std::min(r.wButtons & 0xF, 8)];
+    if (!s.primed || hat[0] != s.lastHatX) batch.Add(EV_ABS, ABS_HAT0X, hat[0]);
+    if (!s.primed || hat[1] != s.lastHatY) batch.Add(EV_ABS, ABS_HAT0Y, hat[1]);
+
+    const uint16_t changed = s.primed ? static_cast<uint16_t>(r.wButtons ^ s.lastButtons) : 0xFFFF;
+    for (const auto& b : kButtons)
+        if (changed & b.mask) batch.Add(EV_KEY, b.code, (r.wButtons & b.mask) ? 1 : 0);
+    // The touchpad click has a device of its own in hid-playstation; only
+    // the PS button is carried over from bSpecial.
+    if (!s.primed || ((r.bSpecial ^ s.lastSpecial) & DS4_SPECIAL_BUTTON_PS))
+        batch.Add(EV_KEY, BTN_MODE, (r.bSpecial & DS4_SPECIAL_BUTTON_PS) ? 1 : 0);
+
+    std::memcpy(s.lastAxes, axes, sizeof(axes));
+    s.lastHatX = hat[0];
+    s.lastHatY = hat[1];
+    s.lastButtons = r.wButtons;
+    s.lastSpecial = r.bSpecial;
+    s.primed = true;
+    if (batch.count == 0) return;   // nothing a reader could see
+    batch.Sync();
+    if (!WriteBatch(s.gamepadFd, batch, writes_, writeErrors_)) s.primed = false;
+#else
+    (void)s;
+    (void)report;
+#endif
+}
+
+void UinputReportSink::EmitMotion(Slot& s, const MotionSample& m)
+{
+#ifdef __linux__
+    EventBatch batch;
+    batch.Add(EV_ABS, ABS_X, Scaled(m.accelX, kAccelPerG, kAccelRange));
+    batch.Add(EV_ABS, ABS_Y, Scaled(m.accelY, kAccelPerG, kAccelRange));
+    batch.Add(EV_ABS, ABS_Z, Scaled(m.accelZ, kAccelPerG, kAccelRange));
+    batch.Add(EV_ABS, ABS_RX, Scaled(m.gyroX, kGyroPerDps, kGyroRange));
+    batch.Add(EV_ABS, ABS_RY, Scaled(m.gyroY, kGyroPerDps, kGyroRange));
+    batch.Add(EV_ABS, ABS_RZ, Scaled(m.gyroZ, kGyroPerDps, kGyroRange));
+    batch.Add(EV_MSC, MSC_TIMESTAMP, static_cast<int32_t>(static_cast<uint32_t>(m.timestampUs)));
+    batch.Sync();
+    WriteBatch(s.motionFd, batch, writes_, writeErrors_);
+#else
+    (void)s;
+    (void)m;
+#endif
+}
+
+std::string UinputReportSink::GamepadNode(uint8_t slot) const
+{
+#ifdef __linux__
+    return slot < kMaxSlots ? EventNode(slots_[slot].gamepadFd) : std::string();
+#else
+    (void)slot;
+    return {};
+#endif
+}
+
+std::string UinputReportSink::MotionNode(uint8_t slot) const
+{
+#ifdef __linux__
+    return slot < kMaxSlots ? EventNode(slots_[slot].motionFd) : std::string();
+#else
+    (void)slot;
+    return {};
+#endif
+}
+
+UinputMouseSink::~UinputMouseSink()
+{
+    Close();
+}
+
+bool UinputMouseSink::Open(const std::string& name)
+{
+#ifdef __linux__
+    if (fd_ >= 0) return true;
+    const int fd = OpenUinput(error_);
+    if (fd < 0) return false;
+    bool ok = ioctl(fd, UI_SET_EVBIT, EV_KEY) == 0 && ioctl(fd, UI_SET_EVBIT, EV_REL) == 0;
+    for (int code : { BTN_LEFT, BTN_RIGHT, BTN_MIDDLE, BTN_SIDE, BTN_EXTRA }) ok = ok && ioctl(fd, UI_SET_KEYBIT, code) == 0;
+    for (int code : { REL_X, REL_Y, REL_WHEEL, REL_WHEEL_HI_RES }) ok = ok && ioctl(fd, UI_SET_RELBIT, code) == 0;
+    if (!ok || !CreateDevice(fd, name, BUS_VIRTUAL, 0, 0, 1)) {
+        Fail(fd, error_, ok ? "uinput mouse create" : "uinput mouse setup");
+        return false;
+    }
+    fd_ = fd;
+    return true;
+#else
+    (void)name;
+    error_ = "uinput is only available on Linux";
+    return false;
+#endif
+}
+
+void UinputMouseSink::Close()
+{
+#ifdef __linux__
+    Destroy(fd_);
+#endif
+}
+
+void UinputMouseSink::Send(const MouseBatch& batch)
+{
+#ifdef __linux__
+    if (fd_ < 0 || batch.Empty()) return;
+    static constexpr uint16_t kCodes[] = { BTN_LEFT, BTN_RIGHT, BTN_MIDDLE, BTN_SIDE, BTN_EXTRA };
+    EventBatch events;
+    unsigned inFrame = 0;   // buttons already changed since the last SYN_REPORT
+    for (const MouseEvent& e : batch) {
+        switch (e.type) {
+        case MouseEvent::Type::Move:
+            if (e.dx) events.Add(EV_REL, REL_X, e.dx);
+            if (e.dy) events.Add(EV_REL, REL_Y, e.dy);
+            break;
+        case MouseEvent::Type::Wheel:
+            // Both units are 120 per notch on Windows; the classic event
+            // counts whole notches.
+            if (e.wheel / 120) events.Add(EV_REL, REL_WHEEL, e.wheel / 120);
+            events.Add(EV_REL, REL_WHEEL_HI_RES, e.wheel);
+            break;
+        case MouseEvent::Type::Down:
+        case MouseEvent::Type::Up: {
+            const unsigned bit = 1u << static_cast<unsigned>(e.button);
+            if (inFrame & bit) {
+                events.Sync();
+                inFrame = 0;
+            }
+            events.Add(EV_KEY, kCodes[static_cast<size_t>(e.button)], e.type == MouseEvent::Type::Down ? 1 : 0);
+            inFrame |= bit;
+            break;
+        }
+        }
+    }
+    if (events.count == 0) return;
+    events.Sync();
+    WriteBatch(fd_, events, writes_, writeErrors_);
+#else
+    (void)batch;
+#endif
+}
+
+std::string UinputMouseSink::Node() const
+{
+#ifdef __linux__
+    return EventNode(fd_);
+#else
+    return {};
+#endif
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "MousePipeline.h"
+#include "ReportPipeline.h"
+
+// Linux output through /dev/uinput, for test rigs that need to see what a
+// game would. Each slot becomes two devices laid out like the kernel's own
+// DualShock 4 driver (hid-playstation): a gamepad with the DS4's sticks,
+// triggers, hat and buttons, and a motion sensor device with accelerometer
+// and gyro axes. Every report is one write() per device: only what changed
+// since the last report, then SYN_REPORT. Off Linux, Open fails.
+class UinputReportSink : public ReportSink {
+public:
+    static constexpr int kMaxSlots = 4;
+
+    UinputReportSink() = default;
+    ~UinputReportSink();
+
+    UinputReportSink(const UinputReportSink&) = delete;
+    UinputReportSink& operator=(const UinputReportSink&) = delete;
+
+    static bool Supported();
+
+    // Creates the slot's devices; Error says why not.
+    bool Open(uint8_t slot, const std::string& name = "joycon2cpp DS4");
+    void Close();
+
+    // Reports for slots that are not open are dropped. Motion goes out
+    // only when the pipeline decoded it.
+    void Emit(uint8_t slot, const PipelineOutput& out) override;
+
+    // /dev/input/eventN of an open slot's devices, for reading them back.
+    std::string GamepadNode(uint8_t slot) const;
+    std::string MotionNode(uint8_t slot) const;
+
+    const std::string& Error() const { return error_; }
+    uint64_t Writes() const { return writes_; }
+    uint64_t WriteErrors() const { return writeErrors_; }
+
+private:
+    struct Slot {
+        int      gamepadFd = -1;
+        int      motionFd = -1;
+        bool     primed = false;   // last* hold what the gamepad device shows
+        uint8_t  lastAxes[6] = {};
+        int8_t   lastHatX = 0, lastHatY = 0;
+        uint16_t lastButtons = 0;
+        uint8_t  lastSpecial = 0;
+    };
+
+    void EmitGamepad(Slot& s, const DS4_REPORT_EX& report);
+    void EmitMotion(Slot& s, const MotionSample& motion);
+
+    Slot slots_[kMaxSlots];
+    std::string error_;
+    uint64_t writes_ = 0;
+    uint64_t writeErrors_ = 0;
+};
+
+// A relative mouse: motion, wheel (with high-resolution wheel events) and
+// five buttons. A batch is one write(); a button pressed and released in
+// the same batch gets a SYN_REPORT in between so readers see the click.
+class UinputMouseSink : public MouseSink {
+public:
+    UinputMouseSink() = default;
+    ~UinputMouseSink();
+
+    UinputMouseSink(const UinputMouseSink&) = delete;
+    UinputMouseSink& operator=(const UinputMouseSink&) = delete;
+
+    bool Open(const std::string& name = "joycon2cpp mouse");
+    void Close();
+    bool IsOpen() const { return fd_ >= 0; }
+
+    void Send(const MouseBatch& batch) override;
+
+    std::string Node() const;
+    const std::string& Error() const { return error_; }
+    uint64_t Writes() const { return writes_; }
+    uint64_t WriteErrors() const { return writeErrors_; }
+
+private:
+    int fd_ = -1;
+    std::string error_;
+    uint64_t writes_ = 0;
+    uint64_t writeErrors_ = 0;
+};
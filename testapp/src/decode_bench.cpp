@@ -0,0 +1,503 @@
+#include "ConfigFile.h"
+#include "DsuServer.h"
+#include "GyroAim.h"
+#include "JoyConDecoder.h"
+#include "LogRing.h"
+#include "MousePipeline.h"
+#include "PlayerTelemetry.h"
+#include "ReportCapture.h"
+#include "ReportPipeline.h"
+#include "Snapshot.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Every allocation in the process goes through these, so a benchmark can
+// read off how many the code under test made per call.
+namespace {
+std::atomic<uint64_t> g_allocations{ 0 };
+std::atomic<uint64_t> g_allocatedBytes{ 0 };
+
+void* CountedAlloc(std::size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+}
+
+void* operator new(std::size_t size) { return CountedAlloc(size); }
+void* operator new[](std::size_t size) { return CountedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+namespace {
+constexpr size_t kReportSize = 0x40;
+constexpr size_t kCorpusSize = 4096;
+#ifdef NDEBUG
+constexpr const char* kBuild = "release";
+#else
+constexpr const char* kBuild = "debug";
+#endif
+
+struct Options {
+    double minTimeMs = 200.0;
+    int repeat = 5;
+    std::string filter;
+    std::vector<std::string> corpusPaths;
+    std::string jsonPath;
+    std::string baselinePath;
+    double threshold = 10.0;
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations = 0;
+    double nsPerOp = 0.0;        // median of the repeats
+    double nsMin = 0.0;
+    double allocsPerOp = 0.0;
+    double bytesPerOp = 0.0;
+};
+
+// Keeps results observable so the optimizer cannot drop the work.
+volatile uint64_t g_sink = 0;
+
+void Consume(const DS4_REPORT_EX& report)
+{
+    uint64_t h = 0;
+    std::memcpy(&h, report.ReportBuffer, sizeof(h));
+    g_sink = g_sink + h + report.ReportBuffer[20];
+}
+
+void PutStick(std::vector<uint8_t>& r, size_t offset, int x, int y)
+{
+    r[offset] = static_cast<uint8_t>(x & 0xFF);
+    r[offset + 1] = static_cast<uint8_t>(((x >> 8) & 0x0F) | ((y & 0x0F) << 4));
+    r[offset + 2] = static_cast<uint8_t>(y >> 4);
+}
+
+void PutS16(std::vector<uint8_t>& r, size_t offset, int value)
+{
+    const auto v = static_cast<int16_t>(std::clamp(value, -32768, 32767));
+    r[offset] = static_cast<uint8_t>(v & 0xFF);
+    r[offset + 1] = static_cast<uint8_t>((v >> 8) & 0xFF);
+}
+
+// A few seconds of play in the Joy-Con 2 input report layout: counter,
+// button bits that press and release, both sticks circling with some
+// off-centre drift, the optical mouse drifting, analog triggers and IMU data
+// with noise, all with the common-report marker set so motion decodes.
+std::vector<std::vector<uint8_t>> SynthesizeCorpus(uint32_t seed)
+{
+    std::vector<std::vector<uint8_t>> corpus(kCorpusSize, std::vector<uint8_t>(kReportSize, 0));
+    uint32_t rng = seed;
+    auto noise = [&rng](int amplitude) {
+        rng = rng * 1664525u + 1013904223u;
+        return static_cast<int>((rng >> 16) % (2 * amplitude + 1)) - amplitude;
+    };
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        auto& r = corpus[i];
+        const uint32_t counter = static_cast<uint32_t>(i * 3);
+        std::memcpy(r.data(), &counter, sizeof(counter));
+        const double t = static_cast<double>(i) / 250.0;
+
+        const uint32_t buttons = ((i / 40) % 3 == 0) ? (1u << ((i / 120) % 24)) : 0u;
+        r[3] = static_cast<uint8_t>(buttons >> 16);
+        r[4] = static_cast<uint8_t>(buttons >> 8);
+        r[5] = static_cast<uint8_t>(buttons);
+        r[6] = static_cast<uint8_t>((i / 300) % 2 ? 0x03 : 0x00);
+
+        PutStick(r, 10, 2048 + static_cast<int>(1500 * std::cos(t * 2.0)) + noise(8),
+                        2048 + static_cast<int>(1500 * std::sin(t * 2.0)) + noise(8));
+        PutStick(r, 13, 2048 + static_cast<int>(900 * std::sin(t * 5.0)) + noise(8),
+                        2048 + static_cast<int>(400 * std::cos(t * 3.0)) + noise(8));
+        PutS16(r, 0x10, static_cast<int>(i * 2 % 4000) - 2000);
+        PutS16(r, 0x12, static_cast<int>(i % 3000) - 1500);
+
+        r[0x29] = 0x01;
+        PutS16(r, 0x30, static_cast<int>(300 * std::sin(t)) + noise(20));
+        PutS16(r, 0x32, noise(20));
+        PutS16(r, 0x34, 4096 + noise(20));
+        PutS16(r, 0x36, static_cast<int>(2000 * std::sin(t * 4.0)) + noise(40));
+        PutS16(r, 0x38, static_cast<int>(1200 * std::cos(t * 3.0)) + noise(40));
+        PutS16(r, 0x3A, noise(40));
+        r[0x3C] = static_cast<uint8_t>((i / 60) % 2 ? 200 + noise(10) : 0);
+        r[0x3D] = static_cast<uint8_t>((i / 90) % 2 ? 180 + noise(10) : 0);
+    }
+    return corpus;
+}
+
+bool LoadCorpus(const std::vector<std::string>& paths, std::vector<std::vector<uint8_t>>& corpus)
+{
+    for (const auto& path : paths) {
+        CaptureFile file;
+        if (!file.Open(path)) {
+            std::fprintf(stderr, "Cannot read capture %s\n", path.c_str());
+            return false;
+        }
+        for (size_t i = 0; i < file.Count(); ++i) {
+            const auto& rec = file.Record(i);
+            if (rec.length >= 0x3C) corpus.emplace_back(rec.data, rec.data + rec.length);
+        }
+    }
+    if (corpus.empty()) {
+        std::fprintf(stderr, "No full-size reports in the given captures\n");
+        return false;
+    }
+    return true;
+}
+
+// Times fn over the corpus in batches until minTimeMs has passed, repeat
+// times, and reports the median. fn gets the running op index.
+Result Measure(const std::string& name, const Options& opts, const std::function<void(size_t)>& fn)
+{
+    using Clock = std::chrono::steady_clock;
+    for (size_t i = 0; i < 256; ++i) fn(i);
+
+    size_t batch = 256;
+    for (;;) {
+        const auto start = Clock::now();
+        for (size_t i = 0; i < batch; ++i) fn(i);
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        if (ms >= opts.minTimeMs / 10.0 || batch >= (size_t{ 1 } << 30)) break;
+        batch *= 2;
+    }
+
+    Result result;
+    result.name = name;
+    std::vector<double> samples;
+    uint64_t allocs = 0, bytes = 0, ops = 0;
+    for (int rep = 0; rep < opts.repeat; ++rep) {
+        uint64_t repOps = 0;
+        const uint64_t a0 = g_allocations.load(std::memory_order_relaxed);
+        const uint64_t b0 = g_allocatedBytes.load(std::memory_order_relaxed);
+        const auto start = Clock::now();
+        double elapsedNs = 0.0;
+        do {
+            for (size_t i = 0; i < batch; ++i) fn(repOps + i);
+            repOps += batch;
+            elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        } while (elapsedNs < opts.minTimeMs * 1e6);
+        allocs += g_allocations.load(std::memory_order_relaxed) - a0;
+        bytes += g_allocatedBytes.load(std::memory_order_relaxed) - b0;
+        ops += repOps;
+        samples.push_back(elapsedNs / static_cast<double>(repOps));
+    }
+    std::sort(samples.begin(), samples.end());
+    result.iterations = ops;
+    result.nsPerOp = samples[samples.size() / 2];
+    result.nsMin = samples.front();
+    result.allocsPerOp = static_cast<double>(allocs) / static_cast<double>(ops);
+    result.bytesPerOp = static_cast<double>(bytes) / static_cast<double>(ops);
+    return result;
+}
+
+// Reads "name" / "ns_per_op" pairs back out of a previous --json file.
+bool ReadBaseline(const std::string& path, std::vector<std::pair<std::string, double>>& out)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    std::string line, name;
+    while (std::getline(file, line)) {
+        const size_t n = line.find("\"name\": \"");
+        if (n != std::string::npos) {
+            const size_t start = n + 9;
+            name = line.substr(start, line.find('"', start) - start);
+        }
+        const size_t v = line.find("\"ns_per_op\": ");
+        if (v != std::string::npos && !name.empty()) {
+            out.emplace_back(name, std::atof(line.c_str() + v + 13));
+            name.clear();
+        }
+    }
+    return !out.empty();
+}
+
+void PrintUsage()
+{
+    std::printf(
+        "usage: decode_bench [options]\n"
+        "  --min-time MS        time per repeat of each benchmark (default 200)\n"
+        "  --repeat N           repeats; ns/op is their median (default 5)\n"
+        "  --filter TEXT        only run benchmarks whose name contains TEXT\n"
+        "  --corpus PATH        decode reports from a .j2cap capture instead of the\n"
+        "                       built-in synthetic corpus (repeatable)\n"
+        "  --json PATH          also write results as JSON\n"
+        "  --baseline PATH      compare against an earlier --json file\n"
+        "  --threshold PCT      with --baseline, exit with 1 if any benchmark is more\n"
+        "                       than PCT percent slower (default 10)\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options& opts)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--help" || arg == "-h") return false;
+        if (!(value = next())) return false;
+        if (arg == "--min-time") opts.minTimeMs = std::max(1.0, std::atof(value));
+        else if (arg == "--repeat") opts.repeat = std::max(1, std::atoi(value));
+        else if (arg == "--filter") opts.filter = value;
+        else if (arg == "--corpus") opts.corpusPaths.push_back(value);
+        else if (arg == "--json") opts.jsonPath = value;
+        else if (arg == "--baseline") opts.baselinePath = value;
+        else if (arg == "--threshold") opts.threshold = std::max(0.0, std::atof(value));
+        else return false;
+    }
+    return true;
+}
+
+CalibrationProfile MakeBenchProfile(int index)
+{
+    CalibrationProfile p;
+    p.name = "Bench " + std::to_string(index);
+    p.leftStick = { 2010 + index, 2090 - index, 310, 3790, 280, 3820 };
+    p.rightStick = { 2075 - index, 2030 + index, 295, 3805, 330, 3760 };
+    return p;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::vector<std::vector<uint8_t>> corpus;
+    if (opts.corpusPaths.empty()) corpus = SynthesizeCorpus(1);
+    else if (!LoadCorpus(opts.corpusPaths, corpus)) return 1;
+    const size_t n = corpus.size();
+    const CalibrationProfile profile = MakeBenchProfile(0);
+
+    const std::string calibPath = (std::filesystem::temp_directory_path() / "decode_bench_calibration.json").string();
+    for (int i = 0; i < 8; ++i) AddCalibrationProfile(MakeBenchProfile(i));
+
+    std::vector<DsuServer::ControllerState> dsuStates(n);
+    for (size_t i = 0; i < n; ++i) {
+        dsuStates[i].report = GenerateProControllerReport(corpus[i], &profile);
+        dsuStates[i].motion = DecodeMotionSample(corpus[i], 1000 + i * 4000);
+        dsuStates[i].connected = true;
+        dsuStates[i].packetCounter = static_cast<uint32_t>(i);
+    }
+
+    ReportPipeline pipeline;
+    pipeline.Config().controllerType = ProController;
+    pipeline.Config().glMapping = ButtonMapping::CROSS;
+    pipeline.Config().grMapping = ButtonMapping::CIRCLE;
+    PipelineOutput pipelineOut;
+
+    // A config the size a busy user ends up with: every player slot filled,
+    // a layout per game.
+    AppConfig appConfig;
+    for (int i = 0; i < 8; ++i)
+        appConfig.layouts.push_back({ "Layout " + std::to_string(i + 1), static_cast<ButtonMapping>(i + 1), static_cast<ButtonMapping>(16 - i) });
+    appConfig.policy.emplace();
+    appConfig.players.emplace(AppConfig::kMaxPlayers);
+    const std::string appConfigText = SerializeAppConfig(appConfig);
+    const std::string calibrationText = SerializeCalibrationProfiles();
+    AppConfig parsedApp;
+    CalibrationConfig parsedCalibration;
+
+    LogRing logRing(1024);
+
+    // Aim sees the samples in order with a steady clock, as a live handler does.
+    GyroAim gyroAim;
+    GyroAimTuning aimTuning;
+    aimTuning.acceleration = 0.5f;
+    GyroAimResult aimResult;
+    std::vector<MotionSample> aimSamples(n);
+    for (size_t i = 0; i < n; ++i) aimSamples[i] = dsuStates[i].motion;
+    uint64_t aimClockUs = 0;
+    auto aimSample = [&](size_t i) {
+        MotionSample m = aimSamples[i % n];
+        m.timestampUs = aimClockUs += 4000;
+        m.valid = true;
+        return m;
+    };
+
+    MousePipeline mouse({ 1.0f, 0.5f });
+    MouseBatch mouseBatch;
+    std::vector<MouseReport> mouseReports(n);
+    for (size_t i = 0; i < n; ++i) {
+        const auto [x, y] = GetRawOpticalMouse(corpus[i]);
+        const StickData stick = DecodeJoystick(corpus[i], JoyConSide::Right, JoyConOrientation::Upright, &profile);
+        mouseReports[i] = { x, y, (i & 31) < 4, false, false, stick.x, stick.y };
+    }
+
+    auto telemetry = std::make_unique<PlayerTelemetry>();
+    ReportChangeFilter changeFilter;
+    const ChangeFilterConfig changeFilterConfig;
+
+    SnapshotCell<CalibrationProfile> snapshotCell{ profile };
+    SnapshotReader<CalibrationProfile> snapshotReader;
+
+    struct Bench {
+        const char* name;
+        std::function<void(size_t)> fn;
+    };
+    const std::vector<Bench> benches = {
+        { "ds4/left/upright", [&](size_t i) { Consume(GenerateDS4Report(corpus[i % n], JoyConSide::Left, JoyConOrientation::Upright, &profile)); } },
+        { "ds4/left/sideways", [&](size_t i) { Consume(GenerateDS4Report(corpus[i % n], JoyConSide::Left, JoyConOrientation::Sideways, &profile)); } },
+        { "ds4/right/upright", [&](size_t i) { Consume(GenerateDS4Report(corpus[i % n], JoyConSide::Right, JoyConOrientation::Upright, &profile)); } },
+        { "ds4/right/sideways", [&](size_t i) { Consume(GenerateDS4Report(corpus[i % n], JoyConSide::Right, JoyConOrientation::Sideways, &profile)); } },
+        { "dual/both", [&](size_t i) { Consume(GenerateDualJoyConDS4Report(corpus[i % n], corpus[(i + 1) % n], GyroSource::Both, &profile)); } },
+        { "pro", [&](size_t i) { Consume(GenerateProControllerReport(corpus[i % n], &profile)); } },
+        { "nsogc", [&](size_t i) { Consume(GenerateNSOGCReport(corpus[i % n], &profile)); } },
+        { "motion/raw", [&](size_t i) {
+            const MotionData m = DecodeMotionRaw(corpus[i % n]);
+            g_sink = g_sink + static_cast<uint16_t>(m.gyroX + m.accelZ);
+        } },
+        { "motion/sample", [&](size_t i) {
+            const MotionSample m = DecodeMotionSample(corpus[i % n], i * 4000);
+            g_sink = g_sink + static_cast<uint64_t>(m.gyroX * 1000.0f);
+        } },
+        { "pipeline/pro", [&](size_t i) {
+            if (pipeline.Process(corpus[i % n], i * 4000000ULL, pipelineOut)) Consume(pipelineOut.report);
+        } },
+        { "snapshot/read", [&](size_t) { g_sink = g_sink + snapshotReader.Read(snapshotCell).leftStick.centerX; } },
+        { "snapshot/publish+read", [&](size_t) {
+            snapshotCell.Publish(profile);
+            g_sink = g_sink + snapshotReader.Read(snapshotCell).leftStick.centerX;
+        } },
+        { "aim/mouse", [&](size_t i) {
+            gyroAim.Update(aimSample(i), GyroAimOutput::Mouse, aimTuning, aimResult);
+            g_sink = g_sink + static_cast<uint64_t>(aimResult.mouseDx);
+        } },
+        { "aim/stick", [&](size_t i) {
+            gyroAim.Update(aimSample(i), GyroAimOutput::RightStick, aimTuning, aimResult);
+            g_sink = g_sink + static_cast<uint64_t>(aimResult.stickX * 127.f);
+        } },
+        { "mouse/process", [&](size_t i) {
+            mouseBatch.Clear();
+            mouse.Process(mouseReports[i % n], 0.3f, mouseBatch);
+            g_sink = g_sink + mouseBatch.count;
+        } },
+        { "telemetry/record", [&](size_t i) {
+            // Per report on every input thread; publishes every 500 ms of report time.
+            telemetry->RecordReport(i * 8000000ULL, static_cast<uint32_t>(i));
+            telemetry->RecordOutput(pipelineOut, 2000, 5000);
+        } },
+        { "filter/admit", [&](size_t i) {
+            // Per sink per report; the corpus changes every report, so every one is compared and kept.
+            g_sink = g_sink + changeFilter.Admit(dsuStates[i % n].report, i * 8000000ULL, changeFilterConfig, MotionFilter::Ignore);
+        } },
+        { "log/push", [&](size_t i) {
+            // What a BLE callback pays to log; the UI thread drains every frame.
+            logRing.Push(LogLevel::Info, 0, "[LINK] Pro Controller reconnected after 1 attempt(s)");
+            if ((i & 255) == 255) logRing.Drain([](const LogRecord& r) { g_sink = g_sink + r.length; });
+        } },
+        { "dsu/data_packet", [&](size_t i) {
+            const auto packet = DsuServer::EncodeDataPacket(0x12345678u, static_cast<uint8_t>(i & 3), dsuStates[i % n]);
+            g_sink = g_sink + packet[8];
+        } },
+        { "calibration/save", [&](size_t) {
+            // Save logs every call; keep that off the terminal.
+            std::streambuf* old = std::cout.rdbuf(nullptr);
+            SaveCalibrationProfiles(calibPath);
+            std::cout.rdbuf(old);
+        } },
+        { "config/parse", [&](size_t) {
+            ConfigDiagnostics diagnostics;
+            ParseAppConfig(appConfigText, parsedApp, diagnostics);
+            g_sink = g_sink + parsedApp.layouts.size();
+        } },
+        { "calibration/parse", [&](size_t) {
+            ConfigDiagnostics diagnostics;
+            ParseCalibrationConfig(calibrationText, parsedCalibration, diagnostics);
+            g_sink = g_sink + parsedCalibration.profiles.size();
+        } },
+        { "calibration/load", [&](size_t) {
+            LoadCalibrationProfiles(calibPath);
+            g_sink = g_sink + GetCalibrationProfiles().size();
+        } },
+    };
+
+    // Load reads what save wrote; make sure the file exists if only load runs.
+    {
+        std::streambuf* old = std::cout.rdbuf(nullptr);
+        SaveCalibrationProfiles(calibPath);
+        std::cout.rdbuf(old);
+    }
+
+    std::vector<Result> results;
+    std::printf("corpus %zu reports (%s), %s build\n", n, opts.corpusPaths.empty() ? "synthetic" : "captured", kBuild);
+    if (std::strcmp(kBuild, "release") != 0) std::printf("numbers from an unoptimized build; configure with -DCMAKE_BUILD_TYPE=Release\n");
+    std::printf("\n");
+    std::printf("%-22s %12s %10s %10s %10s %10s\n", "benchmark", "iterations", "ns/op", "min ns/op", "allocs/op", "bytes/op");
+    for (const auto& b : benches) {
+        if (!opts.filter.empty() && std::string(b.name).find(opts.filter) == std::string::npos) continue;
+        const Result r = Measure(b.name, opts, b.fn);
+        std::printf("%-22s %12llu %10.1f %10.1f %10.2f %10.1f\n", r.name.c_str(),
+            (unsigned long long)r.iterations, r.nsPerOp, r.nsMin, r.allocsPerOp, r.bytesPerOp);
+        results.push_back(r);
+    }
+    std::error_code ec;
+    std::filesystem::remove(calibPath, ec);
+
+    int status = 0;
+    if (!opts.baselinePath.empty()) {
+        std::vector<std::pair<std::string, double>> baseline;
+        if (!ReadBaseline(opts.baselinePath, baseline)) {
+            std::fprintf(stderr, "Cannot read baseline %s\n", opts.baselinePath.c_str());
+            return 1;
+        }
+        std::printf("\n%-22s %10s %10s %8s\n", "vs baseline", "before", "now", "change");
+        for (const auto& r : results) {
+            const auto it = std::find_if(baseline.begin(), baseline.end(), [&](const auto& b) { return b.first == r.name; });
+            if (it == baseline.end() || it->second <= 0.0) continue;
+            const double change = 100.0 * (r.nsPerOp - it->second) / it->second;
+            const bool regressed = change > opts.threshold;
+            std::printf("%-22s %10.1f %10.1f %+7.1f%%%s\n", r.name.c_str(), it->second, r.nsPerOp, change, regressed ? "  REGRESSED" : "");
+            if (regressed) status = 1;
+        }
+    }
+
+    if (!opts.jsonPath.empty()) {
+        std::ostringstream json;
+        char line[512];
+        std::snprintf(line, sizeof(line), "{\n  \"timestamp\": %lld,\n  \"build\": \"%s\",\n  \"corpus\": \"%s\",\n  \"corpus_reports\": %zu,\n"
+            "  \"min_time_ms\": %.1f,\n  \"repeat\": %d,\n  \"benchmarks\": [\n",
+            static_cast<long long>(std::time(nullptr)), kBuild, opts.corpusPaths.empty() ? "synthetic" : "captured", n,
+            opts.minTimeMs, opts.repeat);
+        json << line;
+        for (size_t i = 0; i < results.size(); ++i) {
+            const auto& r = results[i];
+            std::snprintf(line, sizeof(line),
+                "    {\n      \"name\": \"%s\",\n      \"iterations\": %llu,\n      \"ns_per_op\": %.3f,\n"
+                "      \"ns_per_op_min\": %.3f,\n      \"allocs_per_op\": %.4f,\n      \"bytes_per_op\": %.2f\n    }%s\n",
+                r.name.c_str(), (unsigned long long)r.iterations, r.nsPerOp, r.nsMin, r.allocsPerOp, r.bytesPerOp,
+                i + 1 < results.size() ? "," : "");
+            json << line;
+        }
+        json << "  ]\n}\n";
+        std::ofstream out(opts.jsonPath, std::ios::out | std::ios::trunc);
+        if (!out.is_open()) {
+            std::fprintf(stderr, "Failed to write %s\n", opts.jsonPath.c_str());
+            return 1;
+        }
+        out << json.str();
+    }
+    return status;
+}
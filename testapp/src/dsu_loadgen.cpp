@@ -0,0 +1,621 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "DsuServer.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+constexpr uint16_t kProtocolVersion = 1001;
+constexpr uint32_t kMsgVersion = 0x100000;
+constexpr uint32_t kMsgControllerInfo = 0x100001;
+constexpr uint32_t kMsgControllerData = 0x100002;
+constexpr size_t kDataPacketSize = 100;
+constexpr int kSlotCount = 4;
+
+struct Options {
+    int clients = 8;
+    double durationSec = 10.0;
+    std::string host = "127.0.0.1";
+    uint16_t port = 26760;
+    bool external = false;
+    int serverPid = 0;
+    int feedRateHz = 250;
+    int connectedSlots = kSlotCount;
+    double malformedRatio = 0.05;
+    int requestIntervalMs = 500;
+    uint32_t seed = 1;
+    std::string jsonPath;
+};
+
+struct SlotStats {
+    bool seen = false;
+    uint32_t firstCounter = 0;
+    uint32_t maxCounter = 0;
+    uint64_t received = 0;
+    uint64_t duplicates = 0;
+    uint64_t reordered = 0;
+    uint64_t lastTimestamp = 0;
+    uint64_t lastArrivalUs = 0;
+    double tsDeltaSum = 0.0;
+    double tsDeltaSumSq = 0.0;
+    uint64_t tsDeltaCount = 0;
+    double arrivalDeltaSum = 0.0;
+    double arrivalDeltaSumSq = 0.0;
+    uint64_t arrivalDeltaCount = 0;
+};
+
+struct ClientStats {
+    uint64_t sentRequests = 0;
+    uint64_t sentMalformed = 0;
+    uint64_t receivedPackets = 0;
+    uint64_t versionPackets = 0;
+    uint64_t infoPackets = 0;
+    uint64_t dataPackets = 0;
+    uint64_t badPackets = 0;
+    double threadCpuSec = 0.0;
+    std::array<SlotStats, kSlotCount> slots{};
+};
+
+void WriteU16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void WriteU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (i * 8)));
+    }
+}
+
+uint16_t ReadU16(const uint8_t* data)
+{
+    return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t ReadU32(const uint8_t* data)
+{
+    return static_cast<uint32_t>(data[0])
+        | (static_cast<uint32_t>(data[1]) << 8)
+        | (static_cast<uint32_t>(data[2]) << 16)
+        | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint64_t ReadU64(const uint8_t* data)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(data[i]) << (i * 8);
+    }
+    return value;
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size)
+{
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+uint64_t NowMicros()
+{
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now).count());
+}
+
+double ThreadCpuSeconds()
+{
+    timespec ts{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) / 1e9;
+}
+
+// utime + stime of a process from /proc, in seconds. Returns a negative value
+// when the process cannot be read.
+double ProcessCpuSeconds(int pid)
+{
+    const std::string path = pid > 0 ? "/proc/" + std::to_string(pid) + "/stat" : "/proc/self/stat";
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return -1.0;
+    }
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    const size_t commEnd = content.rfind(')');
+    if (commEnd == std::string::npos) {
+        return -1.0;
+    }
+
+    // Fields after the command name start at field 3 (state); utime and stime
+    // are fields 14 and 15.
+    std::vector<std::string> fields;
+    size_t pos = commEnd + 2;
+    while (pos < content.size() && fields.size() < 13) {
+        const size_t end = content.find(' ', pos);
+        fields.push_back(content.substr(pos, end - pos));
+        if (end == std::string::npos) break;
+        pos = end + 1;
+    }
+    if (fields.size() < 13) {
+        return -1.0;
+    }
+    const double ticks = static_cast<double>(sysconf(_SC_CLK_TCK));
+    try {
+        return (std::stod(fields[11]) + std::stod(fields[12])) / ticks;
+    } catch (...) {
+        return -1.0;
+    }
+}
+
+std::vector<uint8_t> MakePacket(uint32_t clientId, uint32_t messageType)
+{
+    std::vector<uint8_t> out;
+    out.reserve(64);
+    out.push_back('D');
+    out.push_back('S');
+    out.push_back('U');
+    out.push_back('C');
+    WriteU16(out, kProtocolVersion);
+    WriteU16(out, 0);
+    WriteU32(out, 0);
+    WriteU32(out, clientId);
+    WriteU32(out, messageType);
+    return out;
+}
+
+void FinalizePacket(std::vector<uint8_t>& packet)
+{
+    const uint16_t payloadLength = static_cast<uint16_t>(packet.size() - 16);
+    packet[6] = static_cast<uint8_t>(payloadLength);
+    packet[7] = static_cast<uint8_t>(payloadLength >> 8);
+    packet[8] = packet[9] = packet[10] = packet[11] = 0;
+    const uint32_t crc = Crc32(packet.data(), packet.size());
+    packet[8] = static_cast<uint8_t>(crc);
+    packet[9] = static_cast<uint8_t>(crc >> 8);
+    packet[10] = static_cast<uint8_t>(crc >> 16);
+    packet[11] = static_cast<uint8_t>(crc >> 24);
+}
+
+std::vector<uint8_t> MakeVersionRequest(uint32_t clientId)
+{
+    auto packet = MakePacket(clientId, kMsgVersion);
+    FinalizePacket(packet);
+    return packet;
+}
+
+std::vector<uint8_t> MakeInfoRequest(uint32_t clientId, std::mt19937& rng)
+{
+    auto packet = MakePacket(clientId, kMsgControllerInfo);
+    const uint32_t count = 1 + rng() % kSlotCount;
+    WriteU32(packet, count);
+    for (uint32_t i = 0; i < count; ++i) {
+        packet.push_back(static_cast<uint8_t>(rng() % (kSlotCount + 1)));
+    }
+    FinalizePacket(packet);
+    return packet;
+}
+
+// Data requests rotate through the three DSU registration flavours: all
+// slots (flags 0), by slot id (flags 1) and by MAC (flags 2), with optional
+// trailing padding so the server sees varied datagram sizes.
+std::vector<uint8_t> MakeDataRequest(uint32_t clientId, std::mt19937& rng, uint8_t& outFlags, uint8_t& outSlot)
+{
+    static constexpr uint8_t kFlagChoices[] = { 0x00, 0x01, 0x02 };
+    outFlags = kFlagChoices[rng() % 3];
+    outSlot = static_cast<uint8_t>(rng() % kSlotCount);
+
+    auto packet = MakePacket(clientId, kMsgControllerData);
+    packet.push_back(outFlags);
+    packet.push_back(outSlot);
+    packet.insert(packet.end(), 6, 0x00);
+    packet.insert(packet.end(), rng() % 24, 0xAA);
+    FinalizePacket(packet);
+    return packet;
+}
+
+std::vector<uint8_t> MakeMalformedRequest(uint32_t clientId, std::mt19937& rng)
+{
+    switch (rng() % 5) {
+        case 0: {
+            std::vector<uint8_t> packet(rng() % 20);
+            for (auto& b : packet) b = static_cast<uint8_t>(rng());
+            return packet;
+        }
+        case 1: {
+            auto packet = MakeVersionRequest(clientId);
+            packet[3] = 'X';
+            return packet;
+        }
+        case 2: {
+            auto packet = MakePacket(clientId, kMsgControllerInfo);
+            packet[4] = 0xFF;
+            FinalizePacket(packet);
+            return packet;
+        }
+        case 3: {
+            auto packet = MakePacket(clientId, kMsgControllerData);
+            FinalizePacket(packet);
+            return packet;
+        }
+        default: {
+            auto packet = MakePacket(clientId, kMsgControllerInfo);
+            WriteU32(packet, 0xFFFFFFFFu);
+            FinalizePacket(packet);
+            return packet;
+        }
+    }
+}
+
+bool ValidateServerPacket(const uint8_t* data, int size)
+{
+    if (size < 20 || std::memcmp(data, "DSUS", 4) != 0 || ReadU16(data + 4) != kProtocolVersion) {
+        return false;
+    }
+    if (ReadU16(data + 6) != static_cast<uint16_t>(size - 16)) {
+        return false;
+    }
+    std::array<uint8_t, 512> copy{};
+    if (size > static_cast<int>(copy.size())) {
+        return false;
+    }
+    std::memcpy(copy.data(), data, size);
+    const uint32_t crc = ReadU32(copy.data() + 8);
+    copy[8] = copy[9] = copy[10] = copy[11] = 0;
+    return Crc32(copy.data(), size) == crc;
+}
+
+void RecordDataPacket(ClientStats& stats, const uint8_t* data, uint64_t arrivalUs)
+{
+    const uint8_t slot = data[20];
+    if (slot >= kSlotCount) {
+        ++stats.badPackets;
+        return;
+    }
+    auto& s = stats.slots[slot];
+    const uint32_t counter = ReadU32(data + 32);
+    const uint64_t timestamp = ReadU64(data + 68);
+
+    if (!s.seen) {
+        s.seen = true;
+        s.firstCounter = counter;
+        s.maxCounter = counter;
+    } else if (counter == s.maxCounter) {
+        ++s.duplicates;
+        return;
+    } else if (counter < s.maxCounter) {
+        ++s.reordered;
+    } else {
+        s.maxCounter = counter;
+        if (s.lastTimestamp != 0 && timestamp >= s.lastTimestamp) {
+            const double d = static_cast<double>(timestamp - s.lastTimestamp);
+            s.tsDeltaSum += d;
+            s.tsDeltaSumSq += d * d;
+            ++s.tsDeltaCount;
+        }
+        if (s.lastArrivalUs != 0) {
+            const double d = static_cast<double>(arrivalUs - s.lastArrivalUs);
+            s.arrivalDeltaSum += d;
+            s.arrivalDeltaSumSq += d * d;
+            ++s.arrivalDeltaCount;
+        }
+        s.lastTimestamp = timestamp;
+        s.lastArrivalUs = arrivalUs;
+    }
+    ++s.received;
+}
+
+void RunClient(const Options& opts, int index, const sockaddr_in& server, std::atomic<bool>& running, ClientStats& stats)
+{
+    const int sock = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (sock < 0) {
+        return;
+    }
+    timeval timeout{ 0, 20000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    std::mt19937 rng(opts.seed * 7919u + static_cast<uint32_t>(index));
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    const uint32_t clientId = 0x4C470000u + static_cast<uint32_t>(index);
+    std::array<uint8_t, 512> buffer{};
+    uint64_t lastRequestUs = 0;
+    const uint64_t requestIntervalUs = static_cast<uint64_t>(opts.requestIntervalMs) * 1000;
+
+    auto send = [&](const std::vector<uint8_t>& packet) {
+        sendto(sock, packet.data(), packet.size(), 0, reinterpret_cast<const sockaddr*>(&server), sizeof(server));
+    };
+
+    while (running.load(std::memory_order_relaxed)) {
+        const uint64_t now = NowMicros();
+        if (now - lastRequestUs >= requestIntervalUs) {
+            send(MakeVersionRequest(clientId));
+            send(MakeInfoRequest(clientId, rng));
+            uint8_t flags = 0, slot = 0;
+            send(MakeDataRequest(clientId, rng, flags, slot));
+            stats.sentRequests += 3;
+            if (unit(rng) < opts.malformedRatio * 3.0) {
+                send(MakeMalformedRequest(clientId, rng));
+                ++stats.sentMalformed;
+            }
+            lastRequestUs = now;
+        }
+
+        const ssize_t received = recvfrom(sock, buffer.data(), buffer.size(), 0, nullptr, nullptr);
+        if (received <= 0) {
+            continue;
+        }
+        const uint64_t arrival = NowMicros();
+        ++stats.receivedPackets;
+        if (!ValidateServerPacket(buffer.data(), static_cast<int>(received))) {
+            ++stats.badPackets;
+            continue;
+        }
+        const uint32_t type = ReadU32(buffer.data() + 16);
+        if (type == kMsgVersion) {
+            ++stats.versionPackets;
+        } else if (type == kMsgControllerInfo) {
+            ++stats.infoPackets;
+        } else if (type == kMsgControllerData) {
+            if (received < static_cast<ssize_t>(kDataPacketSize)) {
+                ++stats.badPackets;
+                continue;
+            }
+            ++stats.dataPackets;
+            RecordDataPacket(stats, buffer.data(), arrival);
+        } else {
+            ++stats.badPackets;
+        }
+    }
+
+    stats.threadCpuSec = ThreadCpuSeconds();
+    ::close(sock);
+}
+
+// cpuSec is the whole thread; sendCpuSec the part spent inside
+// UpdateController, which builds and sends the data packets and so belongs
+// to the server.
+void RunFeeder(const Options& opts, DsuServer& server, std::atomic<bool>& running, uint64_t& updates, double& cpuSec, double& sendCpuSec)
+{
+    for (int slot = 0; slot < opts.connectedSlots; ++slot) {
+        server.SetControllerConnected(static_cast<uint8_t>(slot));
+    }
+    const auto interval = std::chrono::nanoseconds(1000000000LL / std::max(1, opts.feedRateHz));
+    auto next = std::chrono::steady_clock::now();
+    uint32_t tick = 0;
+    while (running.load(std::memory_order_relaxed)) {
+        for (int slot = 0; slot < opts.connectedSlots; ++slot) {
+            DS4_REPORT_EX report{};
+            DS4_REPORT_INIT(reinterpret_cast<PDS4_REPORT>(&report.Report));
+            const float phase = static_cast<float>(tick) * 0.01f + static_cast<float>(slot);
+            report.Report.bThumbLX = static_cast<BYTE>(128 + 100 * std::sin(phase));
+            report.Report.bThumbLY = static_cast<BYTE>(128 + 100 * std::cos(phase));
+            if (tick % 50 < 25) report.Report.wButtons |= DS4_BUTTON_CROSS;
+            MotionSample motion{};
+            motion.gyroX = 15.0f * std::sin(phase * 3.0f);
+            motion.accelZ = 1.0f;
+            motion.timestampUs = NowMicros();
+            motion.valid = true;
+            const double sendStart = ThreadCpuSeconds();
+            server.UpdateController(static_cast<uint8_t>(slot), report, motion);
+            sendCpuSec += ThreadCpuSeconds() - sendStart;
+            ++updates;
+        }
+        ++tick;
+        next += interval;
+        std::this_thread::sleep_until(next);
+    }
+    cpuSec = ThreadCpuSeconds();
+}
+
+double StdDev(double sum, double sumSq, uint64_t n)
+{
+    if (n < 2) return 0.0;
+    const double mean = sum / static_cast<double>(n);
+    return std::sqrt(std::max(0.0, sumSq / static_cast<double>(n) - mean * mean));
+}
+
+void PrintUsage()
+{
+    std::printf(
+        "usage: dsu_loadgen [options]\n"
+        "  --clients N          simulated DSU clients (default 8)\n"
+        "  --duration SEC       run time in seconds (default 10)\n"
+        "  --port PORT          DSU port (default 26760)\n"
+        "  --external HOST      load an already running server instead of an in-process one\n"
+        "  --server-pid PID     with --external, sample that process's CPU time\n"
+        "  --feed-rate HZ       in-process report rate per slot (default 250)\n"
+        "  --slots N            in-process connected slots, 0-4 (default 4)\n"
+        "  --malformed RATIO    fraction of requests that are malformed (default 0.05)\n"
+        "  --request-ms MS      client re-subscription interval (default 500)\n"
+        "  --seed N             RNG seed for reproducible runs (default 1)\n"
+        "  --json PATH          also write results as JSON\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options& opts)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--help" || arg == "-h") return false;
+        if (!(value = next())) return false;
+        if (arg == "--clients") opts.clients = std::max(1, std::atoi(value));
+        else if (arg == "--duration") opts.durationSec = std::max(0.1, std::atof(value));
+        else if (arg == "--port") opts.port = static_cast<uint16_t>(std::atoi(value));
+        else if (arg == "--external") { opts.external = true; opts.host = value; }
+        else if (arg == "--server-pid") opts.serverPid = std::atoi(value);
+        else if (arg == "--feed-rate") opts.feedRateHz = std::max(1, std::atoi(value));
+        else if (arg == "--slots") opts.connectedSlots = std::clamp(std::atoi(value), 0, kSlotCount);
+        else if (arg == "--malformed") opts.malformedRatio = std::clamp(std::atof(value), 0.0, 1.0);
+        else if (arg == "--request-ms") opts.requestIntervalMs = std::max(1, std::atoi(value));
+        else if (arg == "--seed") opts.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        else if (arg == "--json") opts.jsonPath = value;
+        else return false;
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage();
+        return 2;
+    }
+
+    DsuServer server;
+    if (!opts.external && !server.Start(opts.port)) {
+        std::fprintf(stderr, "Failed to start in-process DSU server on port %u\n", opts.port);
+        return 1;
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(opts.port);
+    if (inet_pton(AF_INET, opts.host.c_str(), &address.sin_addr) != 1) {
+        std::fprintf(stderr, "Invalid host %s\n", opts.host.c_str());
+        return 1;
+    }
+
+    std::atomic<bool> running{ true };
+    std::vector<ClientStats> stats(opts.clients);
+    std::vector<std::thread> clients;
+    uint64_t feederUpdates = 0;
+    double feederCpu = 0.0, feederSendCpu = 0.0;
+    std::thread feeder;
+
+    const int cpuPid = opts.external ? opts.serverPid : 0;
+    const double cpuStart = (!opts.external || cpuPid > 0) ? ProcessCpuSeconds(cpuPid) : -1.0;
+    const double mainCpuStart = ThreadCpuSeconds();
+    const auto start = std::chrono::steady_clock::now();
+
+    if (!opts.external) {
+        feeder = std::thread(RunFeeder, std::cref(opts), std::ref(server), std::ref(running), std::ref(feederUpdates), std::ref(feederCpu), std::ref(feederSendCpu));
+    }
+    for (int i = 0; i < opts.clients; ++i) {
+        clients.emplace_back(RunClient, std::cref(opts), i, std::cref(address), std::ref(running), std::ref(stats[i]));
+    }
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(opts.durationSec));
+    running.store(false);
+    for (auto& t : clients) t.join();
+    if (feeder.joinable()) feeder.join();
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double cpuEnd = cpuStart >= 0.0 ? ProcessCpuSeconds(cpuPid) : -1.0;
+    const double mainCpu = ThreadCpuSeconds() - mainCpuStart;
+    server.Stop();
+
+    // In-process runs count the DSU server thread (whatever the client,
+    // feeder and main threads did not burn) plus the feeder's time inside
+    // UpdateController, where the data packets are built and sent.
+    double serverCpu = -1.0;
+    if (cpuStart >= 0.0 && cpuEnd >= 0.0) {
+        serverCpu = cpuEnd - cpuStart;
+        if (!opts.external) {
+            serverCpu -= (feederCpu - feederSendCpu) + mainCpu;
+            for (const auto& s : stats) serverCpu -= s.threadCpuSec;
+            serverCpu = std::max(0.0, serverCpu);
+        }
+    }
+
+    uint64_t totalRx = 0, totalData = 0, totalBad = 0, totalSent = 0, totalMalformed = 0;
+    std::string json = "{\n  \"clients\": [\n";
+    std::printf("%-6s %9s %9s %9s %7s %8s %8s %11s %11s\n",
+        "client", "rx", "data", "loss", "loss%", "reorder", "dup", "ts_jit_us", "arr_jit_us");
+    for (int c = 0; c < opts.clients; ++c) {
+        const auto& s = stats[c];
+        uint64_t expected = 0, received = 0, reordered = 0, dups = 0;
+        double tsSum = 0, tsSq = 0, arrSum = 0, arrSq = 0;
+        uint64_t tsN = 0, arrN = 0;
+        for (const auto& slot : s.slots) {
+            if (!slot.seen) continue;
+            expected += static_cast<uint64_t>(slot.maxCounter - slot.firstCounter) + 1;
+            received += slot.received - slot.reordered;
+            reordered += slot.reordered;
+            dups += slot.duplicates;
+            tsSum += slot.tsDeltaSum; tsSq += slot.tsDeltaSumSq; tsN += slot.tsDeltaCount;
+            arrSum += slot.arrivalDeltaSum; arrSq += slot.arrivalDeltaSumSq; arrN += slot.arrivalDeltaCount;
+        }
+        const uint64_t lost = expected > received ? expected - received : 0;
+        const double lossPct = expected ? 100.0 * static_cast<double>(lost) / static_cast<double>(expected) : 0.0;
+        const double tsJitter = StdDev(tsSum, tsSq, tsN);
+        const double arrJitter = StdDev(arrSum, arrSq, arrN);
+        std::printf("%-6d %9llu %9llu %9llu %6.2f%% %8llu %8llu %11.1f %11.1f\n",
+            c, (unsigned long long)s.receivedPackets, (unsigned long long)s.dataPackets,
+            (unsigned long long)lost, lossPct, (unsigned long long)reordered, (unsigned long long)dups,
+            tsJitter, arrJitter);
+
+        char line[512];
+        std::snprintf(line, sizeof(line),
+            "    {\"id\": %d, \"sent\": %llu, \"malformed_sent\": %llu, \"rx\": %llu, \"version\": %llu, \"info\": %llu, "
+            "\"data\": %llu, \"bad\": %llu, \"lost\": %llu, \"loss_pct\": %.3f, \"reordered\": %llu, \"duplicates\": %llu, "
+            "\"ts_jitter_us\": %.2f, \"arrival_jitter_us\": %.2f}%s\n",
+            c, (unsigned long long)s.sentRequests, (unsigned long long)s.sentMalformed,
+            (unsigned long long)s.receivedPackets, (unsigned long long)s.versionPackets,
+            (unsigned long long)s.infoPackets, (unsigned long long)s.dataPackets,
+            (unsigned long long)s.badPackets, (unsigned long long)lost, lossPct,
+            (unsigned long long)reordered, (unsigned long long)dups, tsJitter, arrJitter,
+            c + 1 < opts.clients ? "," : "");
+        json += line;
+
+        totalRx += s.receivedPackets;
+        totalData += s.dataPackets;
+        totalBad += s.badPackets;
+        totalSent += s.sentRequests;
+        totalMalformed += s.sentMalformed;
+    }
+
+    const double rxRate = static_cast<double>(totalRx) / elapsed;
+    const double cpuPct = serverCpu >= 0.0 ? 100.0 * serverCpu / elapsed : -1.0;
+    std::printf("\nelapsed %.2fs  sent %llu (+%llu malformed)  rx %llu (%.0f pkt/s, %.0f data/s)  bad %llu\n",
+        elapsed, (unsigned long long)totalSent, (unsigned long long)totalMalformed,
+        (unsigned long long)totalRx, rxRate, static_cast<double>(totalData) / elapsed, (unsigned long long)totalBad);
+    if (!opts.external) {
+        std::printf("feeder %llu updates (%.0f/s)\n", (unsigned long long)feederUpdates, static_cast<double>(feederUpdates) / elapsed);
+    }
+    if (cpuPct >= 0.0) std::printf("server cpu %.3fs (%.1f%%, receive thread and data packet send path)\n", serverCpu, cpuPct);
+    else std::printf("server cpu n/a\n");
+
+    if (!opts.jsonPath.empty()) {
+        char tail[512];
+        std::snprintf(tail, sizeof(tail),
+            "  ],\n  \"elapsed_s\": %.3f,\n  \"client_count\": %d,\n  \"seed\": %u,\n  \"feed_rate_hz\": %d,\n"
+            "  \"feeder_updates\": %llu,\n  \"rx_packets\": %llu,\n  \"rx_per_s\": %.1f,\n  \"data_per_s\": %.1f,\n"
+            "  \"bad_packets\": %llu,\n  \"server_cpu_s\": %.4f,\n  \"server_cpu_pct\": %.2f\n}\n",
+            elapsed, opts.clients, opts.seed, opts.external ? 0 : opts.feedRateHz,
+            (unsigned long long)feederUpdates, (unsigned long long)totalRx, rxRate,
+            static_cast<double>(totalData) / elapsed, (unsigned long long)totalBad, serverCpu, cpuPct);
+        json += tail;
+        std::ofstream out(opts.jsonPath, std::ios::out | std::ios::trunc);
+        if (!out.is_open()) {
+            std::fprintf(stderr, "Failed to write %s\n", opts.jsonPath.c_str());
+            return 1;
+        }
+        out << json;
+    }
+    return 0;
+}
@@ -0,0 +1,241 @@
+#include "DsuServer.h"
+#include "ReportReplay.h"
+#include "UinputSink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+constexpr int kSlotCount = 4;
+
+struct Options {
+    ReplayOptions replay;
+    std::string sink = "null";
+    std::string outPath = "replay.j2rep";
+    uint16_t port = 26760;
+    std::string calibrationPath;
+    std::string jsonPath;
+    std::string expectDigest;
+    std::vector<std::pair<std::string, uint8_t>> captures;
+};
+
+std::atomic<bool> g_cancel{ false };
+
+void OnSignal(int)
+{
+    g_cancel.store(true);
+}
+
+bool ParseMapping(const char* value, ButtonMapping& out)
+{
+    static const char* kNames[] = {
+        "none", "l3", "r3", "l1", "r1", "l2", "r2", "cross", "circle", "square", "triangle",
+        "share", "options", "up", "down", "left", "right",
+    };
+    for (size_t i = 0; i < sizeof(kNames) / sizeof(kNames[0]); ++i) {
+        if (std::strcmp(value, kNames[i]) == 0) {
+            out = static_cast<ButtonMapping>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void PrintUsage()
+{
+    std::printf(
+        "usage: report_replay [options] CAPTURE...\n"
+        "  --mode MODE          realtime, fast or max (default realtime)\n"
+        "  --speed X            playback speed for --mode fast (default 4)\n"
+        "  --sink SINK          null, dsu, record or uinput (default null); uinput makes\n"
+        "                       a Linux DS4 gamepad and motion device per slot\n"
+        "  --out PATH           file written by --sink record (default replay.j2rep)\n"
+        "  --port PORT          DSU port for --sink dsu (default 26760)\n"
+        "  --slot N             slot for the next capture; both halves of a dual\n"
+        "                       Joy-Con go on the same slot (default: next free)\n"
+        "  --policy POLICY      low, 120 or 60 (default low)\n"
+        "  --raw-motion-clock   use arrival times as motion timestamps\n"
+        "  --sideways           single Joy-Con held sideways\n"
+        "  --gyro SOURCE        dual Joy-Con gyro: both, left or right (default both)\n"
+        "  --gl BUTTON          Pro Controller GL mapping (none, l3, r3, l1, r1, l2, r2, cross,\n"
+        "  --gr BUTTON          circle, square, triangle, share, options, up, down, left, right)\n"
+        "  --calibration PATH   stick calibration profiles to load (default: built-in)\n"
+        "  --expect-digest HEX  exit with 1 if the output digest differs\n"
+        "  --json PATH          also write results as JSON\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options& opts)
+{
+    int slot = -1;
+    int nextSlot = 0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--help" || arg == "-h") return false;
+        if (arg.rfind("--", 0) != 0) {
+            const int s = slot >= 0 ? slot : nextSlot;
+            opts.captures.emplace_back(arg, static_cast<uint8_t>(s));
+            nextSlot = std::max(nextSlot, s + 1);
+            slot = -1;
+            continue;
+        }
+        if (arg == "--raw-motion-clock") { opts.replay.smoothMotionClock = false; continue; }
+        if (arg == "--sideways") { opts.replay.orientation = JoyConOrientation::Sideways; continue; }
+        if (!(value = next())) return false;
+        const std::string v = value;
+        if (arg == "--mode") {
+            if (v == "realtime") opts.replay.mode = ReplayMode::RealTime;
+            else if (v == "fast") opts.replay.mode = ReplayMode::Accelerated;
+            else if (v == "max") opts.replay.mode = ReplayMode::AsFastAsPossible;
+            else return false;
+        }
+        else if (arg == "--speed") opts.replay.speed = std::max(0.01, std::atof(value));
+        else if (arg == "--sink") {
+            if (v != "null" && v != "dsu" && v != "record" && v != "uinput") return false;
+            opts.sink = v;
+        }
+        else if (arg == "--out") opts.outPath = v;
+        else if (arg == "--port") opts.port = static_cast<uint16_t>(std::atoi(value));
+        else if (arg == "--slot") slot = std::clamp(std::atoi(value), 0, kSlotCount - 1);
+        else if (arg == "--policy") {
+            if (v == "low") opts.replay.policy = UpdatePolicy::LowLatency;
+            else if (v == "120") opts.replay.policy = UpdatePolicy::Balanced120Hz;
+            else if (v == "60") opts.replay.policy = UpdatePolicy::Legacy60Hz;
+            else return false;
+        }
+        else if (arg == "--gyro") {
+            if (v == "both") opts.replay.gyroSource = GyroSource::Both;
+            else if (v == "left") opts.replay.gyroSource = GyroSource::Left;
+            else if (v == "right") opts.replay.gyroSource = GyroSource::Right;
+            else return false;
+        }
+        else if (arg == "--gl") { if (!ParseMapping(value, opts.replay.glMapping)) return false; }
+        else if (arg == "--gr") { if (!ParseMapping(value, opts.replay.grMapping)) return false; }
+        else if (arg == "--calibration") opts.calibrationPath = v;
+        else if (arg == "--expect-digest") opts.expectDigest = v;
+        else if (arg == "--json") opts.jsonPath = v;
+        else return false;
+    }
+    if (opts.replay.mode != ReplayMode::Accelerated) opts.replay.speed = 1.0;
+    else if (opts.replay.speed == 1.0) opts.replay.speed = 4.0;
+    return !opts.captures.empty();
+}
+
+const char* ModeName(ReplayMode mode)
+{
+    switch (mode) {
+        case ReplayMode::Accelerated: return "fast";
+        case ReplayMode::AsFastAsPossible: return "max";
+        default: return "realtime";
+    }
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage();
+        return 2;
+    }
+
+    if (!opts.calibrationPath.empty()) {
+        LoadCalibrationProfiles(opts.calibrationPath);
+    }
+
+    NullReportSink nullSink;
+    RecordingReportSink recordSink;
+    DsuServer server;
+    DsuReportSink dsuSink(server);
+    ReportSink* sink = &nullSink;
+    if (opts.sink == "record") {
+        if (!recordSink.Open(opts.outPath)) {
+            std::fprintf(stderr, "Failed to create %s\n", opts.outPath.c_str());
+            return 1;
+        }
+        sink = &recordSink;
+    } else if (opts.sink == "dsu") {
+        if (!server.Start(opts.port)) {
+            std::fprintf(stderr, "Failed to start DSU server on port %u\n", opts.port);
+            return 1;
+        }
+        sink = &dsuSink;
+    }
+
+    UinputReportSink uinputSink;
+    if (opts.sink == "uinput") sink = &uinputSink;
+
+    ReplayDriver driver(*sink, opts.replay);
+    for (const auto& [path, slot] : opts.captures) {
+        if (!driver.Add(path, slot)) {
+            std::fprintf(stderr, "%s\n", driver.Error().c_str());
+            return 1;
+        }
+        if (opts.sink == "dsu") server.SetControllerConnected(slot);
+        if (opts.sink == "uinput") {
+            if (!uinputSink.Open(slot, "joycon2cpp replay " + std::to_string(slot + 1))) {
+                std::fprintf(stderr, "Failed to create uinput devices: %s\n", uinputSink.Error().c_str());
+                return 1;
+            }
+            std::printf("slot %u: %s (motion %s)\n", slot, uinputSink.GamepadNode(slot).c_str(), uinputSink.MotionNode(slot).c_str());
+        }
+    }
+
+    std::signal(SIGINT, OnSignal);
+    const ReplayStats stats = driver.Run(&g_cancel);
+    server.Stop();
+    recordSink.Close();
+
+    // DSU and uinput keep no digest; their runs are for watching, not diffing.
+    const uint64_t digest = opts.sink == "record" ? recordSink.Digest() : nullSink.Digest();
+    char digestHex[17];
+    std::snprintf(digestHex, sizeof(digestHex), "%016llx", (unsigned long long)digest);
+
+    std::printf("streams %zu  records %llu  emitted %llu  gaps %llu  truncated %llu%s\n",
+        driver.Streams(), (unsigned long long)stats.records, (unsigned long long)stats.emitted,
+        (unsigned long long)stats.sequenceGaps, (unsigned long long)stats.truncated,
+        stats.cancelled ? "  (cancelled)" : "");
+    std::printf("mode %s  captured %.1f ms  wall %.1f ms  %.0f reports/s  %.1f ns/report",
+        ModeName(opts.replay.mode), stats.capturedMs, stats.wallMs, stats.ReportsPerSecond(), stats.NsPerReport());
+    if (opts.replay.mode != ReplayMode::AsFastAsPossible) std::printf("  max late %.1f us", stats.maxLateUs);
+    std::printf("\n");
+    if (opts.sink == "uinput")
+        std::printf("uinput writes %llu  failed %llu\n", (unsigned long long)uinputSink.Writes(), (unsigned long long)uinputSink.WriteErrors());
+    else if (opts.sink != "dsu") std::printf("digest %s\n", digestHex);
+
+    if (!opts.jsonPath.empty()) {
+        char json[1024];
+        std::snprintf(json, sizeof(json),
+            "{\n  \"mode\": \"%s\",\n  \"speed\": %.3f,\n  \"sink\": \"%s\",\n  \"streams\": %zu,\n"
+            "  \"records\": %llu,\n  \"emitted\": %llu,\n  \"sequence_gaps\": %llu,\n  \"truncated\": %llu,\n"
+            "  \"captured_ms\": %.3f,\n  \"wall_ms\": %.3f,\n  \"reports_per_s\": %.1f,\n  \"ns_per_report\": %.2f,\n"
+            "  \"max_late_us\": %.1f,\n  \"cancelled\": %s,\n  \"digest\": \"%s\"\n}\n",
+            ModeName(opts.replay.mode), opts.replay.speed, opts.sink.c_str(), driver.Streams(),
+            (unsigned long long)stats.records, (unsigned long long)stats.emitted,
+            (unsigned long long)stats.sequenceGaps, (unsigned long long)stats.truncated,
+            stats.capturedMs, stats.wallMs, stats.ReportsPerSecond(), stats.NsPerReport(),
+            stats.maxLateUs, stats.cancelled ? "true" : "false", opts.sink == "null" || opts.sink == "record" ? digestHex : "");
+        std::ofstream out(opts.jsonPath, std::ios::out | std::ios::trunc);
+        if (!out.is_open()) {
+            std::fprintf(stderr, "Failed to write %s\n", opts.jsonPath.c_str());
+            return 1;
+        }
+        out << json;
+    }
+
+    if (!opts.expectDigest.empty() && opts.expectDigest != digestHex) {
+        std::fprintf(stderr, "digest mismatch: expected %s, got %s\n", opts.expectDigest.c_str(), digestHex);
+        return 1;
+    }
+    return 0;
+}
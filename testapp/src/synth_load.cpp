@@ -0,0 +1,465 @@
+#include "DsuServer.h"
+#include "ReportCapture.h"
+#include "ReportSynth.h"
+#include "UinputSink.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr int kDsuSlots = 4;
+constexpr uint64_t kStartNs = 1'000'000'000;   // virtual time of the first report
+
+struct Options {
+    int devices = 4;
+    std::string type = "pro";
+    double rateHz = 125.0;
+    double durationS = 10.0;
+    bool realtime = true;
+    ChannelConfig channel;
+    double burstLength = 4.0;
+    uint32_t seed = 1;
+    std::string sink = "null";
+    uint16_t port = 26760;
+    UpdatePolicy policy = UpdatePolicy::LowLatency;
+    bool smoothMotionClock = true;
+    std::string captureDir;
+    bool ceiling = false;
+    std::string jsonPath;
+    std::string expectDigest;
+};
+
+std::atomic<bool> g_cancel{ false };
+
+void OnSignal(int)
+{
+    g_cancel.store(true);
+}
+
+void PrintUsage()
+{
+    std::printf(
+        "usage: synth_load [options]\n"
+        "  --devices N          players (default 4); a dual Joy-Con is one player, two links\n"
+        "  --type TYPE          pro, gc, left, right, dual or mix (default pro)\n"
+        "  --rate HZ            reports per second per device (default 125)\n"
+        "  --duration S         seconds of controller time to generate (default 10)\n"
+        "  --mode MODE          realtime or max (default realtime)\n"
+        "  --latency-ms MS      fixed link delay (default 7.5)\n"
+        "  --jitter-ms MS       mean extra delay, exponentially distributed (default 0)\n"
+        "  --loss P             independent loss probability per report (default 0)\n"
+        "  --burst P            chance per report that a loss burst starts (default 0)\n"
+        "  --burst-len N        mean burst length in reports (default 4)\n"
+        "  --reorder            let jitter reorder reports instead of queueing them\n"
+        "  --seed N             seed for controllers and channels (default 1)\n"
+        "  --sink SINK          null, dsu or uinput (default null); dsu and uinput serve\n"
+        "                       the first 4 players, uinput as Linux DS4 gamepads\n"
+        "  --port PORT          DSU port for --sink dsu (default 26760)\n"
+        "  --policy POLICY      low, 120 or 60 (default low)\n"
+        "  --raw-motion-clock   use arrival times as motion timestamps\n"
+        "  --capture DIR        also record what arrives as .j2cap files for report_replay\n"
+        "  --ceiling            double the devices until one pipeline thread can't keep up\n"
+        "  --expect-digest HEX  exit with 1 if the output digest differs\n"
+        "  --json PATH          also write results as JSON\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options& opts)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--help" || arg == "-h") return false;
+        if (arg == "--raw-motion-clock") { opts.smoothMotionClock = false; continue; }
+        if (arg == "--reorder") { opts.channel.preserveOrder = false; continue; }
+        if (arg == "--ceiling") { opts.ceiling = true; continue; }
+        if (!(value = next())) return false;
+        const std::string v = value;
+        if (arg == "--devices") opts.devices = std::max(1, std::atoi(value));
+        else if (arg == "--type") {
+            if (v != "pro" && v != "gc" && v != "left" && v != "right" && v != "dual" && v != "mix") return false;
+            opts.type = v;
+        }
+        else if (arg == "--rate") opts.rateHz = std::clamp(std::atof(value), 1.0, 2000.0);
+        else if (arg == "--duration") opts.durationS = std::max(0.01, std::atof(value));
+        else if (arg == "--mode") {
+            if (v == "realtime") opts.realtime = true;
+            else if (v == "max") opts.realtime = false;
+            else return false;
+        }
+        else if (arg == "--latency-ms") opts.channel.latencyUs = std::max(0.0, std::atof(value)) * 1000.0;
+        else if (arg == "--jitter-ms") opts.channel.jitterUs = std::max(0.0, std::atof(value)) * 1000.0;
+        else if (arg == "--loss") opts.channel.lossRate = std::clamp(std::atof(value), 0.0, 1.0);
+        else if (arg == "--burst") opts.channel.burstEnter = std::clamp(std::atof(value), 0.0, 1.0);
+        else if (arg == "--burst-len") opts.burstLength = std::max(1.0, std::atof(value));
+        else if (arg == "--seed") opts.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 0));
+        else if (arg == "--sink") {
+            if (v != "null" && v != "dsu" && v != "uinput") return false;
+            opts.sink = v;
+        }
+        else if (arg == "--port") opts.port = static_cast<uint16_t>(std::atoi(value));
+        else if (arg == "--policy") {
+            if (v == "low") opts.policy = UpdatePolicy::LowLatency;
+            else if (v == "120") opts.policy = UpdatePolicy::Balanced120Hz;
+            else if (v == "60") opts.policy = UpdatePolicy::Legacy60Hz;
+            else return false;
+        }
+        else if (arg == "--capture") opts.captureDir = v;
+        else if (arg == "--expect-digest") opts.expectDigest = v;
+        else if (arg == "--json") opts.jsonPath = v;
+        else return false;
+    }
+    opts.channel.burstExit = 1.0 / opts.burstLength;
+    if (opts.ceiling) opts.realtime = false;
+    return true;
+}
+
+// One virtual player: a pipeline fed by one device, or by both halves of a
+// dual Joy-Con, exactly as a GATT notification handler would feed it.
+struct Player {
+    ReportPipeline pipeline;
+    uint8_t slot = 0;
+    std::vector<uint8_t> left, right;
+    uint64_t leftUs = 0, rightUs = 0;
+    bool hasLeft = false, hasRight = false;
+    uint64_t lastStampUs = 0, lastSentNs = 0;
+};
+
+struct Device {
+    size_t player = 0;
+    JoyConSide half = JoyConSide::Left;
+    std::shared_ptr<CaptureStream> capture;
+};
+
+struct RunStats {
+    int devices = 0;
+    size_t players = 0;
+    uint64_t sent = 0, lost = 0, burstLost = 0, delivered = 0, emitted = 0;
+    double virtualMs = 0.0, wallMs = 0.0, pipelineMs = 0.0;
+    std::vector<double> motionErrorUs;   // |stamp interval - true sample interval|
+    std::vector<double> lateUs;          // realtime: processing behind arrival
+    bool cancelled = false;
+
+    double ReportsPerSecond() const { return wallMs > 0.0 ? delivered * 1000.0 / wallMs : 0.0; }
+    double NsPerReport() const { return delivered ? wallMs * 1e6 / delivered : 0.0; }
+    double PipelineNsPerReport() const { return delivered ? pipelineMs * 1e6 / delivered : 0.0; }
+    // How many times faster than real time the pipeline alone ran; the
+    // generator and channel model are test overhead, not part of the app.
+    double Headroom() const { return pipelineMs > 0.0 ? virtualMs / pipelineMs : 0.0; }
+};
+
+double Percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) return 0.0;
+    const size_t k = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+ControllerType TypeFor(const std::string& type, int index)
+{
+    static const ControllerType kMix[] = { ProController, NSOGCController, SingleJoyCon, SingleJoyCon, DualJoyCon };
+    if (type == "mix") return kMix[index % 5];
+    if (type == "gc") return NSOGCController;
+    if (type == "dual") return DualJoyCon;
+    if (type == "left" || type == "right") return SingleJoyCon;
+    return ProController;
+}
+
+JoyConSide SideFor(const std::string& type, int index)
+{
+    if (type == "right") return JoyConSide::Right;
+    if (type == "mix" && index % 5 == 3) return JoyConSide::Right;
+    return JoyConSide::Left;
+}
+
+RunStats Run(const Options& opts, int deviceCount, ReportSink& sink, CaptureRecorder* recorder)
+{
+    RunStats stats;
+    std::vector<SyntheticDeviceSpec> specs;
+    std::vector<Device> devices;
+    std::vector<std::unique_ptr<Player>> players;
+
+    for (int i = 0; i < deviceCount; ++i) {
+        const ControllerType type = TypeFor(opts.type, i);
+        PipelineConfig cfg;
+        cfg.controllerType = type;
+        cfg.side = SideFor(opts.type, i);
+        cfg.policy = opts.policy;
+        cfg.smoothMotionClock = opts.smoothMotionClock;
+
+        auto player = std::make_unique<Player>();
+        player->pipeline = ReportPipeline(cfg);
+        player->slot = static_cast<uint8_t>(players.size());
+        const size_t index = players.size();
+        players.push_back(std::move(player));
+
+        const int halves = type == DualJoyCon ? 2 : 1;
+        for (int h = 0; h < halves; ++h) {
+            SyntheticDeviceSpec spec;
+            spec.controller.type = type;
+            spec.controller.side = halves == 2 ? (h ? JoyConSide::Right : JoyConSide::Left) : cfg.side;
+            spec.controller.rateHz = opts.rateHz;
+            spec.controller.seed = opts.seed * 7919u + static_cast<uint32_t>(specs.size());
+            spec.channel = opts.channel;
+            spec.channel.seed = opts.seed * 104729u + static_cast<uint32_t>(specs.size());
+
+            Device d;
+            d.player = index;
+            d.half = spec.controller.side;
+            if (recorder) {
+                CaptureStreamInfo info;
+                info.controllerType = type;
+                info.side = d.half;
+                info.address = specs.size();
+                info.label = "synthetic " + std::to_string(specs.size());
+                d.capture = recorder->Open(info);
+            }
+            devices.push_back(std::move(d));
+            specs.push_back(spec);
+        }
+    }
+    stats.devices = deviceCount;
+    stats.players = players.size();
+
+    SyntheticStream stream(specs, kStartNs);
+    const uint64_t endNs = kStartNs + static_cast<uint64_t>(opts.durationS * 1e9);
+    stats.virtualMs = opts.durationS * 1000.0;
+    const auto start = Clock::now();
+
+    auto deliver = [&](size_t device, const std::vector<uint8_t>& report, uint64_t sentNs, uint64_t arrivalNs) {
+        const auto t0 = Clock::now();
+        if (opts.realtime) {
+            const double dueUs = (arrivalNs - kStartNs) / 1000.0;
+            stats.lateUs.push_back(std::chrono::duration<double, std::micro>(t0 - start).count() - dueUs);
+        }
+
+        Device& d = devices[device];
+        if (d.capture) {
+            // Back-pressure instead of losing records the replay would miss.
+            while (!d.capture->Push(report.data(), report.size(), arrivalNs))
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        Player& p = *players[d.player];
+        PipelineOutput out;
+        bool emitted = false;
+        if (p.pipeline.Config().controllerType != DualJoyCon) {
+            emitted = p.pipeline.Process(report, arrivalNs, out);
+        } else {
+            const bool isLeft = d.half == JoyConSide::Left;
+            auto& buf = isLeft ? p.left : p.right;
+            buf = report;
+            (isLeft ? p.leftUs : p.rightUs) = p.pipeline.StampMotion(buf, arrivalNs, d.half);
+            (isLeft ? p.hasLeft : p.hasRight) = true;
+            if (p.hasLeft && p.hasRight)
+                emitted = p.pipeline.ProcessDual(p.left, p.leftUs, p.right, p.rightUs, arrivalNs, out);
+        }
+
+        if (emitted) {
+            sink.Emit(p.slot, out);
+            ++stats.emitted;
+            if (out.motion.valid && !opts.ceiling) {
+                if (p.lastStampUs) {
+                    // Signed: with --reorder a report can be older than the last one.
+                    const double stampDelta = static_cast<double>(out.motion.timestampUs) - static_cast<double>(p.lastStampUs);
+                    const double trueDelta = (static_cast<double>(sentNs) - static_cast<double>(p.lastSentNs)) / 1000.0;
+                    stats.motionErrorUs.push_back(std::abs(stampDelta - trueDelta));
+                }
+                p.lastStampUs = out.motion.timestampUs;
+                p.lastSentNs = sentNs;
+            }
+        }
+        stats.pipelineMs += std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+    };
+
+    if (opts.realtime) {
+        // Wake for each arrival, the way the BLE stack would call back.
+        for (;;) {
+            if (g_cancel.load(std::memory_order_relaxed)) { stats.cancelled = true; break; }
+            const uint64_t nowNs = kStartNs + static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+            stream.RunUntil(std::min(nowNs, endNs), deliver);
+            if (nowNs >= endNs) break;
+            const uint64_t nextNs = std::min(stream.NextEventNs(), endNs);
+            if (nextNs > nowNs)
+                std::this_thread::sleep_until(start + std::chrono::nanoseconds(nextNs - kStartNs));
+        }
+    } else {
+        // Virtual time in 10 ms steps keeps the in-flight queue small.
+        for (uint64_t t = kStartNs; t < endNs && !stats.cancelled; ) {
+            t = std::min(t + 10'000'000, endNs);
+            stream.RunUntil(t, deliver);
+            stats.cancelled = g_cancel.load(std::memory_order_relaxed);
+        }
+    }
+    stats.wallMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    for (size_t i = 0; i < stream.Devices(); ++i) {
+        stats.sent += stream.Channel(i).Sent();
+        stats.lost += stream.Channel(i).Lost();
+        stats.burstLost += stream.Channel(i).BurstLost();
+    }
+    stats.delivered = stream.Delivered();
+    return stats;
+}
+
+void PrintStats(const Options& opts, const RunStats& s)
+{
+    std::printf("devices %d  players %zu  type %s  rate %.0f Hz  mode %s\n",
+        s.devices, s.players, opts.type.c_str(), opts.rateHz, opts.realtime ? "realtime" : "max");
+    std::printf("sent %llu  lost %llu (%llu in bursts, %.2f%%)  delivered %llu  emitted %llu%s\n",
+        (unsigned long long)s.sent, (unsigned long long)s.lost, (unsigned long long)s.burstLost,
+        s.sent ? s.lost * 100.0 / s.sent : 0.0, (unsigned long long)s.delivered, (unsigned long long)s.emitted,
+        s.cancelled ? "  (cancelled)" : "");
+    std::printf("virtual %.1f ms  wall %.1f ms  %.0f reports/s  %.1f ns/report  pipeline %.1f ns/report\n",
+        s.virtualMs, s.wallMs, s.ReportsPerSecond(), s.NsPerReport(), s.PipelineNsPerReport());
+    std::printf("motion dt error p50 %.1f us  p99 %.1f us  max %.1f us\n",
+        Percentile(s.motionErrorUs, 0.5), Percentile(s.motionErrorUs, 0.99), Percentile(s.motionErrorUs, 1.0));
+    if (opts.realtime) {
+        std::printf("late p50 %.1f us  p99 %.1f us  max %.1f us\n",
+            Percentile(s.lateUs, 0.5), Percentile(s.lateUs, 0.99), Percentile(s.lateUs, 1.0));
+    }
+}
+
+// Doubles the device count until the pipeline on a single thread needs more
+// time than the controllers spent generating, and reports the last count
+// that kept up.
+int RunCeiling(const Options& opts)
+{
+    std::printf("%8s %8s %14s %12s %12s %10s\n", "devices", "players", "reports/s", "ns/report", "pipeline ns", "headroom");
+    int best = 0;
+    double bestRate = 0.0;
+    for (int n = 1; n <= (1 << 20) && !g_cancel.load(); n *= 2) {
+        NullReportSink sink;
+        const RunStats s = Run(opts, n, sink, nullptr);
+        std::printf("%8d %8zu %14.0f %12.1f %12.1f %9.2fx\n",
+            n, s.players, s.ReportsPerSecond(), s.NsPerReport(), s.PipelineNsPerReport(), s.Headroom());
+        if (s.Headroom() < 1.0) break;
+        best = n;
+        bestRate = s.delivered * 1000.0 / s.virtualMs;
+    }
+    std::printf("ceiling: %d devices at %.0f Hz (%.0f reports/s) through one pipeline thread\n", best, opts.rateHz, bestRate);
+
+    if (!opts.jsonPath.empty()) {
+        char json[512];
+        std::snprintf(json, sizeof(json),
+            "{\n  \"type\": \"%s\",\n  \"rate_hz\": %.1f,\n  \"ceiling_devices\": %d,\n  \"ceiling_reports_per_s\": %.1f\n}\n",
+            opts.type.c_str(), opts.rateHz, best, bestRate);
+        std::ofstream out(opts.jsonPath, std::ios::out | std::ios::trunc);
+        if (!out.is_open()) {
+            std::fprintf(stderr, "Failed to write %s\n", opts.jsonPath.c_str());
+            return 1;
+        }
+        out << json;
+    }
+    return 0;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    if (opts.ceiling) return RunCeiling(opts);
+
+    NullReportSink nullSink;
+    DsuServer server;
+    DsuReportSink dsuSink(server);
+    ReportSink* sink = &nullSink;
+    if (opts.sink == "dsu") {
+        if (!server.Start(opts.port)) {
+            std::fprintf(stderr, "Failed to start DSU server on port %u\n", opts.port);
+            return 1;
+        }
+        for (int slot = 0; slot < kDsuSlots; ++slot) server.SetControllerConnected(static_cast<uint8_t>(slot));
+        sink = &dsuSink;
+    }
+    UinputReportSink uinputSink;
+    if (opts.sink == "uinput") {
+        for (int slot = 0; slot < std::min(opts.devices, kDsuSlots); ++slot) {
+            if (!uinputSink.Open(static_cast<uint8_t>(slot), "joycon2cpp synth " + std::to_string(slot + 1))) {
+                std::fprintf(stderr, "Failed to create uinput devices: %s\n", uinputSink.Error().c_str());
+                return 1;
+            }
+            std::printf("player %d: %s (motion %s)\n", slot + 1, uinputSink.GamepadNode(static_cast<uint8_t>(slot)).c_str(),
+                uinputSink.MotionNode(static_cast<uint8_t>(slot)).c_str());
+        }
+        sink = &uinputSink;
+    }
+
+    std::unique_ptr<CaptureRecorder> recorder;
+    if (!opts.captureDir.empty()) {
+        recorder = std::make_unique<CaptureRecorder>(opts.captureDir, 1 << 14);
+        if (!recorder->Start()) {
+            std::fprintf(stderr, "Failed to start capture in %s\n", opts.captureDir.c_str());
+            return 1;
+        }
+    }
+
+    RunStats stats = Run(opts, opts.devices, *sink, recorder.get());
+    server.Stop();
+    if (recorder) {
+        const size_t streams = recorder->Streams();
+        recorder->Stop();
+        std::printf("captured %zu streams to %s\n", streams, opts.captureDir.c_str());
+    }
+
+    PrintStats(opts, stats);
+    char digestHex[17];
+    std::snprintf(digestHex, sizeof(digestHex), "%016llx", (unsigned long long)nullSink.Digest());
+    if (opts.sink == "null") std::printf("digest %s\n", digestHex);
+    if (opts.sink == "uinput")
+        std::printf("uinput writes %llu  failed %llu\n", (unsigned long long)uinputSink.Writes(), (unsigned long long)uinputSink.WriteErrors());
+
+    if (!opts.jsonPath.empty()) {
+        char json[1536];
+        std::snprintf(json, sizeof(json),
+            "{\n  \"type\": \"%s\",\n  \"devices\": %d,\n  \"players\": %zu,\n  \"rate_hz\": %.1f,\n  \"mode\": \"%s\",\n"
+            "  \"latency_us\": %.1f,\n  \"jitter_us\": %.1f,\n  \"loss\": %.4f,\n  \"burst\": %.4f,\n  \"burst_len\": %.1f,\n"
+            "  \"seed\": %u,\n  \"sent\": %llu,\n  \"lost\": %llu,\n  \"burst_lost\": %llu,\n  \"delivered\": %llu,\n"
+            "  \"emitted\": %llu,\n  \"virtual_ms\": %.3f,\n  \"wall_ms\": %.3f,\n  \"reports_per_s\": %.1f,\n"
+            "  \"ns_per_report\": %.2f,\n  \"pipeline_ns_per_report\": %.2f,\n"
+            "  \"motion_dt_error_us\": { \"p50\": %.2f, \"p99\": %.2f, \"max\": %.2f },\n"
+            "  \"late_us\": { \"p50\": %.2f, \"p99\": %.2f, \"max\": %.2f },\n"
+            "  \"cancelled\": %s,\n  \"digest\": \"%s\"\n}\n",
+            opts.type.c_str(), stats.devices, stats.players, opts.rateHz, opts.realtime ? "realtime" : "max",
+            opts.channel.latencyUs, opts.channel.jitterUs, opts.channel.lossRate, opts.channel.burstEnter, opts.burstLength,
+            opts.seed, (unsigned long long)stats.sent, (unsigned long long)stats.lost, (unsigned long long)stats.burstLost,
+            (unsigned long long)stats.delivered, (unsigned long long)stats.emitted, stats.virtualMs, stats.wallMs,
+            stats.ReportsPerSecond(), stats.NsPerReport(), stats.PipelineNsPerReport(),
+            Percentile(stats.motionErrorUs, 0.5), Percentile(stats.motionErrorUs, 0.99), Percentile(stats.motionErrorUs, 1.0),
+            Percentile(stats.lateUs, 0.5), Percentile(stats.lateUs, 0.99), Percentile(stats.lateUs, 1.0),
+            stats.cancelled ? "true" : "false", opts.sink == "null" ? digestHex : "");
+        std::ofstream out(opts.jsonPath, std::ios::out | std::ios::trunc);
+        if (!out.is_open()) {
+            std::fprintf(stderr, "Failed to write %s\n", opts.jsonPath.c_str());
+            return 1;
+        }
+        out << json;
+    }
+
+    if (!opts.expectDigest.empty() && opts.expectDigest != digestHex) {
+        std::fprintf(stderr, "digest mismatch: expected %s, got %s\n", opts.expectDigest.c_str(), digestHex);
+        return 1;
+    }
+    return 0;
+}
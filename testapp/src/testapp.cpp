@@ -30,9 +30,31 @@
 #include <iomanip>
 #include <string>
 #include <functional>
+#include <array>
+#include <future>
 
 #include "JoyConDecoder.h"
 #include "DsuServer.h"
+#include "MotionClock.h"
+#include "BleDiscovery.h"
+#include "GattCache.h"
+#include "CommandSequencer.h"
+#include "CommandQueue.h"
+#include "FlashCalibration.h"
+#include "DeviceRegistry.h"
+#include "ReconnectSupervisor.h"
+#include "CoroutineExecutor.h"
+#include "ReportCapture.h"
+#include "ReportPipeline.h"
+#include "Snapshot.h"
+#include "Persistence.h"
+#include "ConfigFile.h"
+#include "FileWatcher.h"
+#include "LogRing.h"
+#include "MousePipeline.h"
+#include "GyroAim.h"
+#include "PlayerTelemetry.h"
+#include "RedrawScheduler.h"
 #include <Windows.h>
 #include <ViGEm/Client.h>
 #include <ViGEm/Common.h>
@@ -48,37 +70,12 @@ extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg
 
 constexpr uint16_t JOYCON_MANUFACTURER_ID = 1363;
 const std::vector<uint8_t> JOYCON_MANUFACTURER_PREFIX = { 0x01, 0x00, 0x03, 0x7E };
-const wchar_t* INPUT_REPORT_UUID  = L"ab7de9be-89fe-49ad-828f-118f09df7fd2";
-const wchar_t* WRITE_COMMAND_UUID = L"649d4ac9-8eb7-4e6c-af44-1ea54fe5f005";
-
-
-const wchar_t* CMD_RESPONSE_UUID_BASIC = L"c765a961-d9d8-4d36-a20a-5315b111836a";
-const wchar_t* CMD_RESPONSE_UUID_L     = L"63a3810f-aec7-474b-9010-3d52403cb996";
-const wchar_t* CMD_RESPONSE_UUID_R     = L"640ca58e-0e88-410c-a7f3-426faf2b690b";
-const wchar_t* CMD_RESPONSE_UUID_PRO   = L"506d9f7d-4278-4e95-a549-326ba77657e0";
-const wchar_t* CMD_RESPONSE_UUID_GC    = L"46f6ad29-cdaf-4569-a2fe-339020b94604";
-
-const wchar_t* RUMBLE_CHAR_UUID_L   = L"ce49a830-dced-48ae-931e-c8cf88aadbea";
-const wchar_t* RUMBLE_CHAR_UUID_R   = L"65a724b3-f1e7-4a61-8078-a342376b27ff";
-const wchar_t* RUMBLE_CHAR_UUID_PRO = L"3dacbc7e-6955-40b5-8eaf-6f9809e8b379";
-const wchar_t* RUMBLE_CHAR_UUID_GC  = L"af95885e-44b3-4a24-9cf0-483cc129469a";
-
-const wchar_t* VIBRATION_CHAR_UUID_L = L"289326cb-a471-485d-a8f4-240c14f18241";
-const wchar_t* VIBRATION_CHAR_UUID_R = L"fa19b0fb-cd1f-46a7-84a1-bbb09e00c149";
-const wchar_t* VIBRATION_CHAR_UUID_PRO = L"cc483f51-9258-427d-a939-630c31f72b05";
-const wchar_t* VIBRATION_CHAR_UUID_GC  = L"3f8fb670-ab25-45bf-b540-38c72834d064";
-
 const std::string CONFIG_FILE = "joycon2cpp_config.json";
-
-enum class UpdatePolicy { LowLatency, Balanced120Hz, Legacy60Hz };
-enum ControllerType { SingleJoyCon = 1, DualJoyCon = 2, ProController = 3, NSOGCController = 4 };
-
-enum class ButtonMapping {
-    NONE, L3, R3, L1, R1, L2, R2,
-    CROSS, CIRCLE, SQUARE, TRIANGLE,
-    SHARE, OPTIONS,
-    DPAD_UP, DPAD_DOWN, DPAD_LEFT, DPAD_RIGHT
-};
+const std::string CALIBRATION_FILE = "calibration.json";
+const std::string GATT_CACHE_FILE = "joycon2cpp_gatt_cache.txt";
+const std::string FLASH_CALIB_FILE = "joycon2cpp_flash_calib.txt";
+const std::string KNOWN_DEVICES_FILE = "joycon2cpp_known_devices.txt";
+const std::string CAPTURE_DIR = "captures";
 
 enum class AppScreen { Setup, Connecting, Running };
 
@@ -86,6 +83,7 @@ struct GLGRLayout {
     char name[64] = "Layout 1";
     ButtonMapping glMapping = ButtonMapping::NONE;
     ButtonMapping grMapping = ButtonMapping::NONE;
+    bool operator==(const GLGRLayout&) const = default;
 };
 
 struct ProControllerConfig {
@@ -96,7 +94,33 @@ struct ProControllerConfig {
 struct RuntimeOptions {
     bool latencyMetrics = false;
     UpdatePolicy updatePolicy = UpdatePolicy::LowLatency;
+    bool smoothMotionClock = true;
+    bool useControllerCalibration = true;
+    bool connectKnownDevices = true;
+    bool captureReports = false;
+    bool logToFile = false;
+    float mouseSensitivity = 1.0f;
+    float mouseAcceleration = 0.0f;
+    GyroAimTuning gyroAim;
+    bool skipUnchangedReports = true;
+    int keepaliveMs = 100;
     char latencyCsvPath[256] = "latency_benchmark.csv";
+    char logFilePath[256] = "joycon2cpp.log";
+};
+
+// The part of g_opts and g_proConfig that input threads use. The UI thread
+// owns those two and publishes a fresh copy of this whenever they change;
+// handlers read it through a SnapshotReader and never touch the originals.
+struct LiveSettings {
+    UpdatePolicy updatePolicy = UpdatePolicy::LowLatency;
+    bool smoothMotionClock = true;
+    bool useControllerCalibration = true;
+    std::vector<GLGRLayout> layouts;
+    int activeLayoutIndex = 0;
+    MouseCurve mouseCurve;
+    GyroAimTuning gyroAim;
+    ChangeFilterConfig changeFilter;
+    bool operator==(const LiveSettings&) const = default;
 };
 
 struct PlayerConfig {
@@ -105,6 +129,7 @@ struct PlayerConfig {
     JoyConOrientation joyconOrientation = JoyConOrientation::Upright;
     GyroSource     gyroSource        = GyroSource::Both;
     GyroMode       gyroMode          = GyroMode::Raw;
+    GyroAimOutput  gyroAim           = GyroAimOutput::Off;
 };
 
 struct ConnectedJoyCon {
@@ -117,6 +142,11 @@ struct ConnectedJoyCon {
     GattCharacteristic     vibrationCharRight = nullptr;
     GattCharacteristic     cmdRespBasicChar = nullptr;
     GattCharacteristic     cmdRespExtChar = nullptr;
+    MotionScale            motionScale{};
+    std::shared_ptr<const CalibrationProfile> stickCalibration;   // null: active profile
+    std::shared_ptr<CommandEngine>    commands;
+    std::shared_ptr<CommandQueue>     outbound;
+    std::shared_ptr<CaptureStream>    capture;   // null unless reports are being recorded
 };
 
 using SteadyClock = std::chrono::steady_clock;
@@ -124,7 +154,6 @@ using TimePoint   = SteadyClock::time_point;
 
 struct LatencyTracker {
     TimePoint lastBleTime{};
-    TimePoint lastEmitTime{};
     uint64_t  eventIndex = 0;
 };
 
@@ -133,46 +162,98 @@ struct TimedInputBuffer {
     TimePoint  receivedAt{};
     double     bleDeltaMs = -1.0;
     uint64_t   sequence   = 0;
+    uint64_t   sampleTimeUs = 0;
 };
 
 struct DualJoyConSharedState {
     std::mutex              mutex;
     std::condition_variable cv;
     TimedInputBuffer        left, right;
-    TimePoint               lastLeftBleTime{}, lastRightBleTime{}, lastEmitTime{};
+    TimePoint               lastLeftBleTime{}, lastRightBleTime{};
+    MotionClock             leftClock, rightClock;
+    SnapshotReader<LiveSettings> settings;
     uint64_t                sequence = 0, eventIndex = 0;
 };
 
+// What the running screen last read from a player's telemetry. UI thread
+// only; kept with the player so it goes away with it.
+struct TelemetryView {
+    TelemetrySnapshot snap;
+    std::array<std::vector<float>, (size_t)TelemetryTrace::Count> traces;
+    uint64_t readNs = 0;
+};
+
+// A player's live connection, which a reconnect replaces while the old
+// connection's input handler may still be in a report. Handlers process
+// each report inside Enter; Rebind publishes the new connection under the
+// same lock, after which the old handler returns early, so only one
+// handler at a time touches the player's state. Other threads read the
+// connection through Current without the lock.
+class PlayerConnection {
+public:
+    explicit PlayerConnection(ConnectedJoyCon cj) : cell_(std::move(cj)) {}
+
+    std::shared_ptr<const ConnectedJoyCon> Current() const { return cell_.Load(); }
+    uint64_t Version() const { return cell_.Version(); }
+
+    // Owns the lock only while version is still the current connection.
+    std::unique_lock<std::mutex> Enter(uint64_t version) {
+        std::unique_lock<std::mutex> lk(mutex_);
+        if (cell_.Version() != version) lk.unlock();
+        return lk;
+    }
+
+    // Swaps in fresh and runs fn with no report in progress; returns the
+    // connection it replaced.
+    template <typename Fn>
+    std::shared_ptr<const ConnectedJoyCon> Rebind(ConnectedJoyCon fresh, Fn&& fn) {
+        std::lock_guard<std::mutex> lk(mutex_);
+        auto old = cell_.Load();
+        cell_.Publish(std::move(fresh));
+        fn();
+        return old;
+    }
+
+private:
+    SnapshotCell<ConnectedJoyCon> cell_;
+    std::mutex mutex_;
+};
+
 struct SingleJoyConPlayer {
-    ConnectedJoyCon joycon;
+    std::shared_ptr<PlayerConnection> joycon;
     PVIGEM_TARGET   ds4Controller = nullptr;
     JoyConSide      side;
     JoyConOrientation orientation;
+    GyroAimOutput   gyroAim = GyroAimOutput::Off;
     int             mouseMode      = 0;
     bool            wasChatPressed = false;
-    int16_t         lastOpticalX   = 0, lastOpticalY = 0;
-    bool            firstOpticalRead = true;
-    float           scrollAccumulator = 0.f;
-    bool            mb4Pressed = false, mb5Pressed = false;
-    bool            leftBtnPressed = false, rightBtnPressed = false, middleBtnPressed = false;
+    MousePipeline   mouse;
     LatencyTracker  latency;
+    std::shared_ptr<PlayerTelemetry> telemetry = std::make_shared<PlayerTelemetry>();
+    TelemetryView   telemetryView;
 };
 
 struct DualJoyConPlayer {
     ConnectedJoyCon leftJoyCon, rightJoyCon;
     GyroSource      gyroSource;
     GyroMode        gyroMode;
+    GyroAimOutput   gyroAim = GyroAimOutput::Off;
     uint8_t         dsuSlot = 0;
     PVIGEM_TARGET   ds4Controller = nullptr;
+    std::shared_ptr<const CalibrationProfile> stickCalibration;
     std::atomic<bool> running{false};
     std::thread     updateThread;
     std::shared_ptr<DualJoyConSharedState> sharedState;
+    std::shared_ptr<PlayerTelemetry> telemetry = std::make_shared<PlayerTelemetry>();
+    TelemetryView   telemetryView;
 };
 
 struct ProControllerPlayer {
-    ConnectedJoyCon controller;
+    std::shared_ptr<PlayerConnection> controller;
     PVIGEM_TARGET   ds4Controller = nullptr;
     LatencyTracker  latency;
+    std::shared_ptr<PlayerTelemetry> telemetry;
+    TelemetryView   telemetryView;
 };
 
 struct ConnectionTask {
@@ -192,22 +273,37 @@ struct SingleRumbleCtx {
     PVIGEM_TARGET       target    = nullptr;
     GattCharacteristic  secondaryVibrationChar = nullptr;
     RumbleMode          mode      = RumbleMode::JoyCon;
+    std::shared_ptr<CommandQueue> queue;
     std::atomic<bool>   running{true};
     std::thread         thread;
+    std::mutex          linkMutex;   // characteristics and queue change on reconnect
 };
 struct DualRumbleCtx {
     GattCharacteristic  leftVibration;
     GattCharacteristic  rightVibration;
     PVIGEM_TARGET       target    = nullptr;
+    std::shared_ptr<CommandQueue> leftQueue;
+    std::shared_ptr<CommandQueue> rightQueue;
     std::atomic<bool>   running{true};
     std::thread         thread;
+    std::mutex          linkMutex;
 };
 
 static AppScreen              g_screen        = AppScreen::Setup;
 static RuntimeOptions         g_opts;
 static ProControllerConfig    g_proConfig;
+static SnapshotCell<LiveSettings> g_liveSettings;
 static PVIGEM_CLIENT          g_vigem         = nullptr;
 static DsuServer              g_dsuServer;
+static DsuReportSink          g_dsuSink{ g_dsuServer };
+static GattCache              g_gattCache{ GATT_CACHE_FILE };
+static FlashCalibrationCache  g_flashCalibCache{ FLASH_CALIB_FILE };
+static DeviceRegistry         g_deviceRegistry{ KNOWN_DEVICES_FILE };
+// Every settings and cache file is written from here, off the input and UI threads.
+static PersistenceService     g_persistence;
+// Runs the connect/discover/subscribe/init coroutines of every controller.
+static Executor               g_executor;
+static CaptureRecorder        g_captureRecorder{ CAPTURE_DIR };
 
 static std::vector<PlayerConfig>                    g_playerConfigs;
 static std::vector<SingleJoyConPlayer>              g_singlePlayers;
@@ -219,23 +315,60 @@ static std::vector<DualRumbleCtx*>   g_dualRumbleCtxs;
 static std::vector<SingleRumbleCtx*> g_proRumbleCtxs;
 
 static std::vector<ConnectionTask>  g_connectionTasks;
+static std::mutex                   g_connectionMutex;
 static int                          g_connectionTaskIndex = 0;
 static bool                         g_connectionDone      = false;
 static std::string                  g_connectionError;
 
+// Connection tasks now progress concurrently, so status text written from the
+// opener threads is guarded against the UI thread reading it.
+static void SetTaskStatus(int idx, const std::string& msg) {
+    std::lock_guard<std::mutex> lk(g_connectionMutex);
+    if (idx >= 0 && idx < (int)g_connectionTasks.size()) g_connectionTasks[idx].statusMsg = msg;
+}
+
 static bool g_showLayoutManager = false;
 static bool g_screenshotButtonPressed = false;
 static bool g_cButtonPressed          = false;
 static bool g_comboPressed            = false;
 static std::atomic<bool> g_openLayoutManager{false};
+static std::atomic<int>  g_layoutCycleRequests{0};   // C presses the UI thread has yet to apply
 static std::atomic<bool> g_shuttingDown{false};
 
-static std::mutex         g_logMutex;
-static std::vector<std::string> g_logLines;
-static void AppLog(const std::string& s) {
-    std::lock_guard<std::mutex> lk(g_logMutex);
-    g_logLines.push_back(s);
-    if (g_logLines.size() > 200) g_logLines.erase(g_logLines.begin());
+// Any thread logs into the ring without locking or formatting; the UI
+// thread drains it once a frame into the on-screen history and the file.
+static LogRing        g_logRing{1024};
+static LogHistory     g_logHistory{1000};
+static RollingLogFile g_logFile;
+// Wakes the UI thread out of its idle wait so new lines show at once. Only
+// the first message since the last wake pays for the SetEvent.
+static HANDLE            g_uiWake = nullptr;
+static std::atomic<bool> g_uiWakePending{false};
+static void WakeUi() {
+    if (g_uiWake && !g_uiWakePending.exchange(true, std::memory_order_acq_rel)) SetEvent(g_uiWake);
+}
+static void AppLog(LogLevel level, int player, std::string_view s) { g_logRing.Push(level, player, s); WakeUi(); }
+static void AppLog(std::string_view s) {
+    g_logRing.Push(s.rfind("[ERROR]", 0) == 0 ? LogLevel::Error : LogLevel::Info, -1, s);
+    WakeUi();
+}
+// UI thread, each time it wakes: formats what was logged since the last
+// time. Returns whether there was anything.
+static bool DrainLog() {
+    if (g_opts.logToFile != g_logFile.IsOpen()) {
+        if (!g_opts.logToFile) g_logFile.Close();
+        else if (!g_logFile.Open(g_opts.logFilePath)) {
+            AppLog(LogLevel::Error, -1, std::string("[LOG] Cannot open ") + g_opts.logFilePath);
+            g_opts.logToFile = false;
+        }
+    }
+    if (g_logRing.Drain([](const LogRecord& r) {
+            g_logHistory.Append(r);
+            if (g_logFile.IsOpen()) g_logFile.Write(g_logHistory.Line(g_logHistory.Size() - 1));
+        }) == 0)
+        return false;
+    g_logFile.Flush();
+    return true;
 }
 
 class LatencyCsvLogger {
@@ -281,17 +414,21 @@ static double MsBetween(TimePoint a, TimePoint b) {
 static double UsBetween(TimePoint a, TimePoint b) {
     return std::chrono::duration<double, std::micro>(b - a).count();
 }
-static std::chrono::microseconds PolicyInterval(UpdatePolicy p) {
-    switch(p) {
-        case UpdatePolicy::Balanced120Hz: return std::chrono::microseconds(8333);
-        case UpdatePolicy::Legacy60Hz:    return std::chrono::microseconds(16667);
-        default:                          return std::chrono::microseconds(0);
-    }
+static uint64_t SteadyMicros(TimePoint t) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
 }
-static bool ShouldEmit(UpdatePolicy p, TimePoint& last, TimePoint now) {
-    auto iv = PolicyInterval(p);
-    if (iv.count() == 0 || last == TimePoint{} || now - last >= iv) { last = now; return true; }
-    return false;
+static uint64_t SteadyNanos(TimePoint t) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+// First thing every input handler does with a report, so the capture sees
+// exactly what the decoder is about to.
+static void CaptureReport(const std::shared_ptr<CaptureStream>& cap, const std::vector<uint8_t>& buf, TimePoint arrival) {
+    if (cap) cap->Push(buf.data(), buf.size(), SteadyNanos(arrival));
+}
+static uint64_t StampMotion(MotionClock& clock, TimePoint arrival, const std::vector<uint8_t>& buf, bool smooth) {
+    const uint64_t us = SteadyMicros(arrival);
+    const uint64_t smoothed = clock.Stamp(us, ExtractReportCounter(buf));
+    return smooth ? smoothed : us;
 }
 static const char* CtrlTypeName(int t) {
     switch(t) {
@@ -310,74 +447,155 @@ static const char* BtnMapNames[] = {
     "DPad Up","DPad Down","DPad Left","DPad Right"
 };
 static const char* BtnMapStr(ButtonMapping m) { return BtnMapNames[(int)m]; }
-static ButtonMapping BtnMapFromStr(const std::string& s) {
-    for (int i = 0; i < 17; i++)
-        if (s == BtnMapNames[i]) return (ButtonMapping)i;
-    return ButtonMapping::NONE;
+
+// The settings the config file holds, as the UI thread last saved or loaded
+// them, and per file the text last handed to g_persistence; a change
+// notification carrying that same text is our own write coming back.
+static AppConfig                          g_savedConfig;
+static std::map<std::string, std::string> g_submittedText;
+static FileWatcher                        g_configWatcher;
+static std::atomic<bool> g_configChanged{false};        // set by the watcher thread
+static std::atomic<bool> g_calibrationChanged{false};
+
+static void SubmitConfigText(const std::string& path, std::string text) {
+    g_submittedText[path] = text;
+    g_persistence.Submit(path, std::move(text));
+}
+static AppConfig CurrentAppConfig() {
+    AppConfig c;
+    for (auto& l : g_proConfig.layouts) c.layouts.push_back({ l.name, l.glMapping, l.grMapping });
+    c.activeLayoutIndex = g_proConfig.activeLayoutIndex;
+    c.policy = PolicyConfig{ g_opts.updatePolicy, g_opts.smoothMotionClock, g_opts.useControllerCalibration, g_opts.connectKnownDevices,
+                             g_opts.mouseSensitivity, g_opts.mouseAcceleration, g_opts.gyroAim,
+                             g_opts.skipUnchangedReports, g_opts.keepaliveMs };
+    c.players.emplace();
+    for (auto& pc : g_playerConfigs)
+        c.players->push_back({ pc.controllerType, pc.joyconSide, pc.joyconOrientation, pc.gyroSource, pc.gyroMode, pc.gyroAim });
+    return c;
+}
+static void ApplyAppConfig(const AppConfig& c) {
+    g_proConfig.layouts.clear();
+    for (auto& l : c.layouts) {
+        GLGRLayout lay;
+        strncpy_s(lay.name, l.name.c_str(), 63);
+        lay.glMapping = l.glMapping; lay.grMapping = l.grMapping;
+        g_proConfig.layouts.push_back(lay);
+    }
+    if (g_proConfig.layouts.empty()) g_proConfig.layouts.push_back(GLGRLayout{});
+    g_proConfig.activeLayoutIndex = c.activeLayoutIndex < (int)g_proConfig.layouts.size() ? c.activeLayoutIndex : 0;
+    if (c.policy) {
+        g_opts.updatePolicy = c.policy->updatePolicy;
+        g_opts.smoothMotionClock = c.policy->smoothMotionClock;
+        g_opts.useControllerCalibration = c.policy->useControllerCalibration;
+        g_opts.connectKnownDevices = c.policy->connectKnownDevices;
+        g_opts.mouseSensitivity = c.policy->mouseSensitivity;
+        g_opts.mouseAcceleration = c.policy->mouseAcceleration;
+        g_opts.gyroAim = c.policy->gyroAim;
+        g_opts.skipUnchangedReports = c.policy->skipUnchangedReports;
+        g_opts.keepaliveMs = c.policy->keepaliveMs;
+    }
+    if (c.players && !c.players->empty()) {
+        g_playerConfigs.clear();
+        for (auto& p : *c.players) {
+            PlayerConfig pc;
+            pc.controllerType = p.controllerType; pc.joyconSide = p.joyconSide; pc.joyconOrientation = p.joyconOrientation;
+            pc.gyroSource = p.gyroSource; pc.gyroMode = p.gyroMode; pc.gyroAim = p.gyroAim;
+            g_playerConfigs.push_back(pc);
+        }
+    }
+}
+static void LogConfigIssues(const std::string& path, const ConfigDiagnostics& d) {
+    for (auto& i : d.issues)
+        AppLog(i.error ? LogLevel::Error : LogLevel::Warning, -1,
+               "[CONFIG] " + path + ":" + std::to_string(i.line) + ":" + std::to_string(i.column) + ": " + i.message);
 }
 
+// Queues the write; the C button and every layout edit call this.
 static void SaveProConfig() {
-    std::ofstream f(CONFIG_FILE);
-    if (!f.is_open()) return;
-    f << "{\n  \"activeLayoutIndex\": " << g_proConfig.activeLayoutIndex << ",\n  \"layouts\": [\n";
-    for (size_t i = 0; i < g_proConfig.layouts.size(); ++i) {
-        auto& l = g_proConfig.layouts[i];
-        f << "    {\"name\":\"" << l.name << "\","
-          << "\"glMapping\":\"" << BtnMapStr(l.glMapping) << "\","
-          << "\"grMapping\":\"" << BtnMapStr(l.grMapping) << "\"}";
-        if (i+1 < g_proConfig.layouts.size()) f << ",";
-        f << "\n";
-    }
-    f << "  ]\n}\n";
+    g_savedConfig = CurrentAppConfig();
+    SubmitConfigText(CONFIG_FILE, SerializeAppConfig(g_savedConfig));
+}
+// UI thread, once per frame, so settings changed anywhere in the UI are saved.
+static void SaveProConfigIfChanged() {
+    if (!(CurrentAppConfig() == g_savedConfig)) SaveProConfig();
 }
 static void LoadProConfig() {
-    std::ifstream f(CONFIG_FILE);
-    if (!f.is_open()) {
-        GLGRLayout def; def.glMapping = ButtonMapping::NONE; def.grMapping = ButtonMapping::NONE;
-        g_proConfig.layouts.push_back(def);
+    if (g_playerConfigs.empty()) g_playerConfigs.push_back({});
+    std::string text;
+    if (!ReadTextFile(CONFIG_FILE, text)) {
+        g_proConfig.layouts.assign(1, GLGRLayout{});
         g_proConfig.activeLayoutIndex = 0;
         SaveProConfig();
         return;
     }
-    std::string json((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
-    g_proConfig.layouts.clear(); g_proConfig.activeLayoutIndex = 0;
-    auto readField = [&](const std::string& key) -> std::string {
-        auto p = json.find("\"" + key + "\"");
-        if (p == std::string::npos) return "";
-        auto c = json.find(':', p); auto e = json.find_first_of(",}\n", c);
-        auto v = json.substr(c+1, e-c-1);
-        v.erase(0, v.find_first_not_of(" \t\n\r\""));
-        v.erase(v.find_last_not_of(" \t\n\r\"")+1);
-        return v;
-    };
-    try { g_proConfig.activeLayoutIndex = std::stoi(readField("activeLayoutIndex")); } catch(...) {}
-    size_t pos = json.find('[');
-    while (pos != std::string::npos) {
-        auto ob = json.find('{', pos);
-        if (ob == std::string::npos) break;
-        auto oe = json.find('}', ob);
-        if (oe == std::string::npos) break;
-        auto obj = json.substr(ob, oe-ob+1);
-        GLGRLayout lay;
-        auto getStr = [&](const std::string& key) -> std::string {
-            auto kp = obj.find("\""+key+"\"");
-            if (kp == std::string::npos) return "";
-            auto q1 = obj.find('"', kp+key.size()+2);
-            auto q2 = obj.find('"', q1+1);
-            return obj.substr(q1+1, q2-q1-1);
-        };
-        auto nm = getStr("name");
-        if (!nm.empty()) strncpy_s(lay.name, nm.c_str(), 63);
-        lay.glMapping = BtnMapFromStr(getStr("glMapping"));
-        lay.grMapping = BtnMapFromStr(getStr("grMapping"));
-        g_proConfig.layouts.push_back(lay);
-        pos = oe+1;
+    AppConfig c; ConfigDiagnostics d;
+    const bool ok = ParseAppConfig(text, c, d);
+    LogConfigIssues(CONFIG_FILE, d);
+    ApplyAppConfig(ok ? c : AppConfig{});
+    g_submittedText[CONFIG_FILE] = text;
+    // A file that failed to load is left as it is until a setting changes.
+    g_savedConfig = CurrentAppConfig();
+}
+
+// The text of a config file that changed on disk, unless the change is our
+// own save, or an edit made here is still queued and will replace it anyway.
+static bool ReadChangedConfig(const std::string& path, std::string& text) {
+    if (!ReadTextFile(path, text)) return false;
+    auto it = g_submittedText.find(path);
+    if (it != g_submittedText.end() && it->second == text) return false;
+    if (g_persistence.Pending(path)) {
+        AppLog("[CONFIG] " + path + " changed on disk while edits made here were unsaved; keeping those");
+        return false;
     }
-    if (g_proConfig.layouts.empty()) {
-        GLGRLayout def; g_proConfig.layouts.push_back(def); g_proConfig.activeLayoutIndex = 0;
+    g_submittedText[path] = text;
+    return true;
+}
+// UI thread, once per frame. Settings reach connected controllers through
+// the next PublishLiveSettings and calibration through its own snapshot, so
+// nothing is reconnected; a file that does not validate changes nothing.
+static void ReloadChangedConfig() {
+    std::string text;
+    if (g_configChanged.exchange(false) && ReadChangedConfig(CONFIG_FILE, text)) {
+        AppConfig c; ConfigDiagnostics d;
+        const bool ok = ParseAppConfig(text, c, d);
+        LogConfigIssues(CONFIG_FILE, d);
+        if (!ok) {
+            AppLog("[CONFIG] " + CONFIG_FILE + " not reloaded; keeping the current settings");
+        } else {
+            const bool playersChanged = c.players && !c.players->empty() && c.players != CurrentAppConfig().players;
+            ApplyAppConfig(c);
+            g_savedConfig = CurrentAppConfig();
+            AppLog("[CONFIG] Reloaded " + CONFIG_FILE);
+            if (playersChanged && g_screen != AppScreen::Setup)
+                AppLog("[CONFIG] Player setup changes take effect at the next connect");
+        }
     }
-    if (g_proConfig.activeLayoutIndex < 0 || g_proConfig.activeLayoutIndex >= (int)g_proConfig.layouts.size())
-        g_proConfig.activeLayoutIndex = 0;
+    if (g_calibrationChanged.exchange(false) && ReadChangedConfig(CALIBRATION_FILE, text)) {
+        CalibrationConfig c; ConfigDiagnostics d;
+        const bool ok = ParseCalibrationConfig(text, c, d);
+        LogConfigIssues(CALIBRATION_FILE, d);
+        if (!ok) {
+            AppLog("[CONFIG] " + CALIBRATION_FILE + " not reloaded; keeping the current profiles");
+        } else {
+            SetCalibrationProfiles(std::move(c.profiles), c.activeIndex);
+            AppLog("[CONFIG] Reloaded " + CALIBRATION_FILE);
+        }
+    }
+}
+// UI thread, once per frame: edits anywhere in the UI reach the handlers
+// with the next report after the frame that made them.
+static void PublishLiveSettings() {
+    LiveSettings s;
+    s.updatePolicy = g_opts.updatePolicy;
+    s.smoothMotionClock = g_opts.smoothMotionClock;
+    s.useControllerCalibration = g_opts.useControllerCalibration;
+    s.layouts = g_proConfig.layouts;
+    s.activeLayoutIndex = g_proConfig.activeLayoutIndex;
+    s.mouseCurve = { g_opts.mouseSensitivity, g_opts.mouseAcceleration };
+    s.gyroAim = g_opts.gyroAim;
+    s.changeFilter = { g_opts.skipUnchangedReports, (uint32_t)g_opts.keepaliveMs };
+    if (*g_liveSettings.Load() == s) return;
+    g_liveSettings.Publish(std::move(s));
 }
 
 
@@ -392,37 +610,82 @@ static std::string HexBytes(const std::vector<uint8_t>& bytes) {
     return hex;
 }
 
+// Resumes on g_executor once a WinRT async operation has finished, instead of
+// blocking a thread in .get(). GetResults rethrows the operation's error.
+template <typename Op>
+static Task<decltype(std::declval<Op>().GetResults())> AwaitWinRt(Op op)
+{
+    Completion<bool> done(g_executor);
+    op.Completed([done](auto const&, AsyncStatus) { done.Set(true); });
+    co_await done;
+    co_return op.GetResults();
+}
+
+static Task<bool> SubscribeAsync(GattCharacteristic ch,
+    GattClientCharacteristicConfigurationDescriptorValue value =
+        GattClientCharacteristicConfigurationDescriptorValue::Notify)
+{
+    if (!ch) co_return false;
+    try {
+        auto status = co_await AwaitWinRt(ch.WriteClientCharacteristicConfigurationDescriptorAsync(value));
+        co_return status == GattCommunicationStatus::Success;
+    } catch (...) {
+        co_return false;
+    }
+}
+
+// Notifications are turned on separately with SubscribeAsync.
 static void AttachCommandResponseLogger(
     GattCharacteristic const& ch,
     const std::string& name,
-    GattClientCharacteristicConfigurationDescriptorValue cccValue =
-        GattClientCharacteristicConfigurationDescriptorValue::Notify)
+    std::function<void(const std::vector<uint8_t>&)> onResponse = nullptr)
 {
     if (!ch) {
         return;
     }
 
-    ch.ValueChanged([name](GattCharacteristic const&, GattValueChangedEventArgs const& args) {
+    ch.ValueChanged([name, onResponse](GattCharacteristic const&, GattValueChangedEventArgs const& args) {
         if (g_shuttingDown.load()) return;
         auto rdr = DataReader::FromBuffer(args.CharacteristicValue());
         std::vector<uint8_t> buf(rdr.UnconsumedBufferLength());
         rdr.ReadBytes(buf);
-
-
-        if (buf.size() >= 8) {
-            char tmp[160];
-            sprintf_s(tmp,"[CMDRESP] parsed cmd=0x%02X sub=0x%02X ack0=0x%02X ack1=0x%02X transport=0x%02X",buf[0], buf[3], buf[4], buf[5], buf[2]);
-        }
+        if (onResponse) onResponse(buf);
     });
+}
+
+static bool WriteNoResponse(GattCharacteristic const& ch, const std::vector<uint8_t>& pkt) {
+    if (!ch || g_shuttingDown.load()) return false;
+    DataWriter w;
+    w.WriteBytes(pkt);
+    try {
+        return ch.WriteValueAsync(w.DetachBuffer(), GattWriteOption::WriteWithoutResponse).get()
+            == GattCommunicationStatus::Success;
+    } catch (...) {
+        return false;
+    }
+}
 
+// Issues the write without waiting for it, for code running on g_executor.
+// Writes to one characteristic still go out in the order they were issued;
+// a failed write shows up as a missing ack rather than a false return.
+static bool PostWriteNoResponse(GattCharacteristic const& ch, const std::vector<uint8_t>& pkt) {
+    if (!ch || g_shuttingDown.load()) return false;
+    DataWriter w;
+    w.WriteBytes(pkt);
     try {
-        auto status = ch.WriteClientCharacteristicConfigurationDescriptorAsync(cccValue).get();
-    } catch (...) { }
+        ch.WriteValueAsync(w.DetachBuffer(), GattWriteOption::WriteWithoutResponse);
+        return true;
+    } catch (...) {
+        return false;
+    }
 }
 
-static void SendGenericCommand(GattCharacteristic const& ch, uint8_t cmdId, uint8_t subId, const std::vector<uint8_t>& data) {
+// Queued on the device's outbound worker: callers include BLE input
+// callbacks, which must not wait on the write or its ack.
+static void SendGenericCommand(const ConnectedJoyCon& cj, uint8_t cmdId, uint8_t subId, const std::vector<uint8_t>& data) {
     if (g_shuttingDown.load()) return;
-    if (!ch) {
+    auto ch = cj.writeChar;
+    if (!ch || !cj.outbound) {
         return;
     }
 
@@ -438,27 +701,35 @@ static void SendGenericCommand(GattCharacteristic const& ch, uint8_t cmdId, uint
     pkt.push_back(0x00);
     pkt.insert(pkt.end(), data.begin(), data.end());
 
-    DataWriter w;
-    w.WriteBytes(pkt);
-    try {
-        auto status = ch.WriteValueAsync(
-            w.DetachBuffer(),
-            GattWriteOption::WriteWithoutResponse
-        ).get();
-    } catch (...) {
-        return;
-    }
-    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    // The next command waits for this one's ack, up to the old fixed 50 ms
+    // gap, in the queue's settle time rather than on its worker, so rumble
+    // frames still go out meanwhile. The ack (or the timeout, which fires
+    // inside the settle time) ends the settle early.
+    constexpr auto kAckTimeout = std::chrono::milliseconds(50);
+    OutboundCommand cmd;
+    cmd.settle = kAckTimeout + std::chrono::milliseconds(10);
+    cmd.write = [ch, engine = cj.commands, queue = std::weak_ptr<CommandQueue>(cj.outbound), pkt = std::move(pkt), kAckTimeout]() {
+        if (g_shuttingDown.load()) return false;
+        auto write = [&ch](const std::vector<uint8_t>& p) { return WriteNoResponse(ch, p); };
+        if (!engine) return write(pkt);
+        bool written = false;
+        engine->Send(pkt, 0, [&](const std::vector<uint8_t>& p) { return written = write(p); }, kAckTimeout,
+            [queue](CommandReply reply) {
+                if (auto q = queue.lock()) q->EndSettle(reply.status == CommandStatus::TimedOut);
+            });
+        return written;
+    };
+    cj.outbound->Submit(std::move(cmd));
 }
-static void SetPlayerLEDs(GattCharacteristic const& ch, uint8_t pat) {
+static void SetPlayerLEDs(const ConnectedJoyCon& cj, uint8_t pat) {
     std::vector<uint8_t> d(8, 0); d[0] = pat;
-    SendGenericCommand(ch, 0x09, 0x07, d);
+    SendGenericCommand(cj, 0x09, 0x07, d);
 }
 
-static void SendVibrationSample(GattCharacteristic const& ch, uint8_t sampleId);
+static void SendVibrationSample(const ConnectedJoyCon& cj, uint8_t sampleId);
 
-static void EmitSound(GattCharacteristic const& ch) {
-    SendVibrationSample(ch, 0x04);
+static void EmitSound(const ConnectedJoyCon& cj) {
+    SendVibrationSample(cj, 0x04);
 }
 static void SendCustomCommands(GattCharacteristic const& ch) {
     if (!ch || g_shuttingDown.load()) return;
@@ -485,115 +756,97 @@ static void SendCustomCommands(GattCharacteristic const& ch) {
 }
 
 
-static void Send0016Command(GattCharacteristic const& ch, const std::vector<uint8_t>& cmd,
-                             int prefixSize = 17)
+// Sticks the controller reports are layered over the active profile, so a
+// device missing one record still gets the user's values for it.
+static void ApplyDeviceCalibration(ConnectedJoyCon& cj, const DeviceCalibration& dc)
 {
-    if (!ch || g_shuttingDown.load()) return;
-
-    std::vector<uint8_t> pkt(prefixSize, 0x00);
-    pkt.insert(pkt.end(), cmd.begin(), cmd.end());
-
-    DataWriter w;
-    w.WriteBytes(pkt);
-    ch.WriteValueAsync(w.DetachBuffer(), GattWriteOption::WriteWithoutResponse);
+    if (!g_liveSettings.Load()->useControllerCalibration || !dc.Any()) return;
+    if (dc.hasLeftStick || dc.hasRightStick) {
+        auto profile = std::make_shared<CalibrationProfile>(*GetActiveCalibrationSnapshot());
+        profile->name = "Controller flash";
+        dc.ApplyTo(*profile);
+        cj.stickCalibration = std::move(profile);
+    }
+    dc.ApplyTo(cj.motionScale);
 }
 
-
-static void SendJoyCon2OfficialInit(GattCharacteristic const& ch)
+static std::shared_ptr<const CalibrationProfile> CombineStickCalibration(const ConnectedJoyCon& l, const ConnectedJoyCon& r)
 {
-    if (!ch || g_shuttingDown.load()) return;
-
-    std::vector<std::vector<uint8_t>> cmds = {
-        {0x07,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x00,0x30,0x01,0x00},
-        {0x10,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x16,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x0A,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x03,0x00,0x00,0x00},                     
-        {0x09,0x91,0x01,0x07,0x00,0x08,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00}, 
-        {0x0C,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x37,0x00,0x00,0x00},                     
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x80,0x30,0x01,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x40,0xC0,0x1F,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x10,0x7E,0x00,0x00,0x40,0x30,0x01,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x18,0x7E,0x00,0x00,0x00,0x31,0x01,0x00},
-        {0x11,0x91,0x01,0x03,0x00,0x00,0x00,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x20,0x7E,0x00,0x00,0x60,0x30,0x01,0x00}, 
-        {0x0A,0x91,0x01,0x08,0x00,0x14,0x00,0x00,
-         0x01,0x59,0x09,0x00,0x00,0xFF,0xFF,0xFF,0xFF,0x35,0x00,0x46,
-         0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},                                        
-        {0x11,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x0C,0x91,0x01,0x04,0x00,0x04,0x00,0x00,0x37,0x00,0x00,0x00},                   
-    };
-
-    for (auto& cmd : cmds) {
-        Send0016Command(ch, cmd, 17); 
-        std::this_thread::sleep_for(std::chrono::milliseconds(80));
-    }
+    if (!l.stickCalibration && !r.stickCalibration) return nullptr;
+    auto profile = std::make_shared<CalibrationProfile>(*GetActiveCalibrationSnapshot());
+    profile->name = "Controller flash";
+    if (l.stickCalibration) profile->leftStick = l.stickCalibration->leftStick;
+    if (r.stickCalibration) profile->rightStick = r.stickCalibration->rightStick;
+    return profile;
 }
 
-static void SendProCon2OfficialInit(GattCharacteristic const& ch)
+// Init scripts live in CommandSequencer.cpp; each command waits for its
+// cmd/sub ack instead of a fixed 80 ms sleep. The scripts already read the
+// calibration blocks from flash, so their replies are decoded on the way.
+// A cached copy is applied first in case the reads go unanswered.
+static Task<void> RunOfficialInitAsync(ConnectedJoyCon& cj, const InitScript& script, FlashStickLayout layout)
 {
-    if (!ch || g_shuttingDown.load()) return;
-
-    std::vector<std::vector<uint8_t>> cmds = {
-        {0x07,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x00,0x30,0x01,0x00},
-        {0x16,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x0A,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x03,0x00,0x00,0x00},                     
-        {0x09,0x91,0x01,0x07,0x00,0x08,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00},  
-        {0x0C,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x2F,0x00,0x00,0x00},                 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x80,0x30,0x01,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0xC0,0x30,0x01,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x40,0xC0,0x1F,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x10,0x7E,0x00,0x00,0x40,0x30,0x01,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x18,0x7E,0x00,0x00,0x00,0x31,0x01,0x00}, 
-        {0x11,0x91,0x01,0x03,0x00,0x00,0x00,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x20,0x7E,0x00,0x00,0x60,0x30,0x01,0x00},
-        {0x0A,0x91,0x01,0x08,0x00,0x14,0x00,0x00,
-         0x01,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x35,0x00,0x46,
-         0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},                                         
-        {0x0C,0x91,0x01,0x04,0x00,0x04,0x00,0x00,0x2F,0x00,0x00,0x00},                 
-    };
-
-    for (auto& cmd : cmds) {
-        Send0016Command(ch, cmd, 33);
-        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+    if (!cj.rumbleChar || !cj.commands || g_shuttingDown.load()) co_return;
+
+    const uint64_t address = cj.device ? cj.device.BluetoothAddress() : 0;
+    DeviceCalibration cached;
+    if (address && g_flashCalibCache.Find(address, cached)) ApplyDeviceCalibration(cj, cached);
+
+    auto ch = cj.rumbleChar;
+    FlashCalibrationReader reader(layout);
+    CommandSequencer seq(*cj.commands, [ch](const std::vector<uint8_t>& pkt) { return PostWriteNoResponse(ch, pkt); });
+    seq.OnReply([&reader](const CommandReply& reply) { reader.Feed(reply.payload.data(), reply.payload.size()); });
+    auto r = co_await seq.RunAsync(g_executor, script, &g_shuttingDown);
+
+    const DeviceCalibration dc = reader.Result();
+    if (dc.Any()) {
+        ApplyDeviceCalibration(cj, dc);
+        if (address) { g_flashCalibCache.Store(address, dc); g_persistence.MarkDirty(FLASH_CALIB_FILE); }
+        char cal[160];
+        sprintf_s(cal, "[INIT] %s: calibration from flash (left stick %s, right stick %s, gyro bias %s)",
+            script.name,
+            dc.hasLeftStick ? (dc.leftFromUser ? "user" : "factory") : "-",
+            dc.hasRightStick ? (dc.rightFromUser ? "user" : "factory") : "-",
+            dc.hasGyroBias ? "yes" : "-");
+        AppLog(cal);
     }
-}
 
+    double rttSum = 0.0; uint64_t rttCount = 0;
+    for (auto& [key, st] : cj.commands->AllStats()) { rttSum += st.totalRttMs; rttCount += st.acked; }
+    char tmp[224];
+    sprintf_s(tmp, "[INIT] %s: %zu/%zu acked, %zu retried, %zu timed out%s, %.0f ms (mean ack RTT %.1f ms)",
+        script.name, r.acked, r.sent, r.retried, r.timedOut,
+        r.blind ? " (no responses, fixed pacing)" : "", r.elapsedMs,
+        rttCount ? rttSum / (double)rttCount : 0.0);
+    AppLog(tmp);
+}
 
-static void SendNSOGCOfficialInit(GattCharacteristic const& ch)
+static Task<void> InitControllerAsync(ConnectedJoyCon& cj, ControllerType type, JoyConSide side)
 {
-    if (!ch || g_shuttingDown.load()) return;
-
-    std::vector<std::vector<uint8_t>> cmds = {
-        {0x07,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x00,0x30,0x01,0x00}, 
-        {0x10,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x16,0x91,0x01,0x01,0x00,0x00,0x00,0x00},
-        {0x0A,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x03,0x00,0x00,0x00},                    
-        {0x09,0x91,0x01,0x07,0x00,0x08,0x00,0x00,0x01,0x00,0x00,0x00,0x00,0x00,0x00,0x00},
-        {0x0C,0x91,0x01,0x02,0x00,0x04,0x00,0x00,0x27,0x00,0x00,0x00},                    
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x80,0x30,0x01,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0xC0,0x30,0x01,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x40,0x7E,0x00,0x00,0x40,0xC0,0x1F,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x10,0x7E,0x00,0x00,0x40,0x30,0x01,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x18,0x7E,0x00,0x00,0x00,0x31,0x01,0x00}, 
-        {0x11,0x91,0x01,0x03,0x00,0x00,0x00,0x00},
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x02,0x7E,0x00,0x00,0x40,0x31,0x01,0x00}, 
-        {0x02,0x91,0x01,0x04,0x00,0x08,0x00,0x00,0x20,0x7E,0x00,0x00,0x60,0x30,0x01,0x00},
-        {0x0A,0x91,0x01,0x08,0x00,0x14,0x00,0x00,
-         0x01,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0x35,0x00,0x46,
-         0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00},                                        
-        {0x0C,0x91,0x01,0x04,0x00,0x04,0x00,0x00,0x27,0x00,0x00,0x00},                    
-    };
+    const auto joyconLayout = side==JoyConSide::Left ? FlashStickLayout::LeftOnly : FlashStickLayout::RightOnly;
+    if (type == ProController)        co_await RunOfficialInitAsync(cj, ProCon2InitScript(), FlashStickLayout::Both);
+    else if (type == NSOGCController) co_await RunOfficialInitAsync(cj, NSOGCInitScript(), FlashStickLayout::Both);
+    else                              co_await RunOfficialInitAsync(cj, JoyCon2InitScript(), joyconLayout);
+}
 
-    for (auto& cmd : cmds) {
-        Send0016Command(ch, cmd, 13); 
-        std::this_thread::sleep_for(std::chrono::milliseconds(80));
+// Rumble frames jump ahead of queued commands and replace any older frame
+// for the same characteristic that has not gone out yet.
+static void SubmitRumble(const std::shared_ptr<CommandQueue>& q, GattCharacteristic const& ch, std::vector<uint8_t> pkt, uint32_t key)
+{
+    if (!q) {
+        DataWriter w;
+        w.WriteBytes(pkt);
+        ch.WriteValueAsync(w.DetachBuffer(), GattWriteOption::WriteWithoutResponse);
+        return;
     }
+    OutboundCommand cmd;
+    cmd.priority = CommandPriority::Rumble;
+    cmd.coalesceKey = key;
+    cmd.write = [ch, pkt = std::move(pkt)]() { return WriteNoResponse(ch, pkt); };
+    q->Submit(std::move(cmd));
 }
 
-static void SendRumble(GattCharacteristic const& ch, float amp)
+static void SendRumble(const std::shared_ptr<CommandQueue>& q, GattCharacteristic const& ch, float amp, uint32_t key = 1)
 {
     if (!ch || g_shuttingDown.load()) return;
 
@@ -614,13 +867,11 @@ static void SendRumble(GattCharacteristic const& ch, float amp)
         c = (c + 1) & 0x0F;
     }
 
-    DataWriter w;
-    w.WriteBytes(pkt);
-    ch.WriteValueAsync(w.DetachBuffer(), GattWriteOption::WriteWithoutResponse);
+    SubmitRumble(q, ch, std::move(pkt), key);
 }
 
 
-static void SendGCRumble(GattCharacteristic const& ch, float amp)
+static void SendGCRumble(const std::shared_ptr<CommandQueue>& q, GattCharacteristic const& ch, float amp)
 {
     if (!ch || g_shuttingDown.load()) return;
     std::vector<uint8_t> pkt(5, 0x00);
@@ -628,12 +879,10 @@ static void SendGCRumble(GattCharacteristic const& ch, float amp)
         pkt[1] = 0x01;
         pkt[2] = static_cast<uint8_t>(std::min(amp * 255.f, 255.f));
     }
-    DataWriter w;
-    w.WriteBytes(pkt);
-    ch.WriteValueAsync(w.DetachBuffer(), GattWriteOption::WriteWithoutResponse);
+    SubmitRumble(q, ch, std::move(pkt), 1);
 }
 
-static void SendProRumble(GattCharacteristic const& ch, float amp)
+static void SendProRumble(const std::shared_ptr<CommandQueue>& q, GattCharacteristic const& ch, float amp)
 {
     if (!ch || g_shuttingDown.load()) return;
     static uint8_t c = 0;
@@ -648,16 +897,14 @@ static void SendProRumble(GattCharacteristic const& ch, float amp)
         memcpy(pkt.data() + 18, p, 5); 
         c = (c + 1) & 0x0F;
     }
-    DataWriter w;
-    w.WriteBytes(pkt);
-    ch.WriteValueAsync(w.DetachBuffer(), GattWriteOption::WriteWithoutResponse);
+    SubmitRumble(q, ch, std::move(pkt), 1);
 }
 
-static void SendVibrationSample(GattCharacteristic const& ch, uint8_t sampleId)
+static void SendVibrationSample(const ConnectedJoyCon& cj, uint8_t sampleId)
 {
     std::vector<uint8_t> data(4, 0);
     data[0] = sampleId;
-    SendGenericCommand(ch, 0x0A, 0x02, data);
+    SendGenericCommand(cj, 0x0A, 0x02, data);
 }
 
 static void StartSingleRumbleThread(SingleRumbleCtx* ctx) {
@@ -668,28 +915,32 @@ static void StartSingleRumbleThread(SingleRumbleCtx* ctx) {
             DS4_OUTPUT_DATA out{};
             auto err = vigem_target_ds4_get_output(g_vigem, ctx->target, &out);
             if (VIGEM_SUCCESS(err)) {
+                GattCharacteristic ch = nullptr, ch2 = nullptr;
+                std::shared_ptr<CommandQueue> q;
+                {
+                    std::lock_guard<std::mutex> lk(ctx->linkMutex);
+                    ch = ctx->vibrationChar; ch2 = ctx->secondaryVibrationChar; q = ctx->queue;
+                }
                 float amp = std::max(out.LargeMotor, out.SmallMotor) / 255.0f;
                 if (amp >= 0.01f) {
                     if (ctx->mode == RumbleMode::GC) {
-                        SendGCRumble(ctx->vibrationChar, amp);
+                        SendGCRumble(q, ch, amp);
                     } else if (ctx->mode == RumbleMode::Pro) {
-                        SendProRumble(ctx->vibrationChar, amp);
+                        SendProRumble(q, ch, amp);
                     } else {
-                        SendRumble(ctx->vibrationChar, amp);
-                        if (ctx->secondaryVibrationChar)
-                            SendRumble(ctx->secondaryVibrationChar, amp);
+                        SendRumble(q, ch, amp);
+                        if (ch2) SendRumble(q, ch2, amp, 2);
                     }
                     silentFrames = 0;
                 } else {
                     if (silentFrames == 0) {
                         if (ctx->mode == RumbleMode::GC) {
-                            SendGCRumble(ctx->vibrationChar, 0.0f);
+                            SendGCRumble(q, ch, 0.0f);
                         } else if (ctx->mode == RumbleMode::Pro) {
-                            SendProRumble(ctx->vibrationChar, 0.0f);
+                            SendProRumble(q, ch, 0.0f);
                         } else {
-                            SendRumble(ctx->vibrationChar, 0.0f);
-                            if (ctx->secondaryVibrationChar)
-                                SendRumble(ctx->secondaryVibrationChar, 0.0f);
+                            SendRumble(q, ch, 0.0f);
+                            if (ch2) SendRumble(q, ch2, 0.0f, 2);
                         }
                     }
                     silentFrames++;
@@ -709,15 +960,21 @@ static void StartDualRumbleThread(DualRumbleCtx* ctx) {
             DS4_OUTPUT_DATA out{};
             auto err = vigem_target_ds4_get_output(g_vigem, ctx->target, &out);
             if (VIGEM_SUCCESS(err)) {
+                GattCharacteristic lch = nullptr, rch = nullptr;
+                std::shared_ptr<CommandQueue> lq, rq;
+                {
+                    std::lock_guard<std::mutex> lk(ctx->linkMutex);
+                    lch = ctx->leftVibration; rch = ctx->rightVibration; lq = ctx->leftQueue; rq = ctx->rightQueue;
+                }
                 float amp = std::max(out.LargeMotor, out.SmallMotor) / 255.0f;
                 if (amp >= 0.01f) {
-                    SendRumble(ctx->leftVibration, amp);
-                    SendRumble(ctx->rightVibration, amp);
+                    SendRumble(lq, lch, amp);
+                    SendRumble(rq, rch, amp);
                     silentFrames = 0;
                 } else {
                     if (silentFrames == 0) {
-                        SendRumble(ctx->leftVibration, 0.0f);
-                        SendRumble(ctx->rightVibration, 0.0f);
+                        SendRumble(lq, lch, 0.0f);
+                        SendRumble(rq, rch, 0.0f);
                     }
                     silentFrames++;
                 }
@@ -729,170 +986,236 @@ static void StartDualRumbleThread(DualRumbleCtx* ctx) {
 }
 
 
-static bool TryParseSwitch2ControllerAd(const std::vector<uint8_t>& d, uint16_t& productId)
-{
-    if (d.size() < 7) return false;
-    if (d[0] != 0x01 || d[1] != 0x00 || d[2] != 0x03) return false;
-    if (d[3] != 0x7E || d[4] != 0x05) return false;
-
-    productId = static_cast<uint16_t>(d[5] | (static_cast<uint16_t>(d[6]) << 8));
-    return productId >= 0x2060;
-}
-
-static ConnectedJoyCon BleConnect(std::function<void(const std::string&)> statusCb, bool& outSuccess, JoyConSide side = JoyConSide::Left) {
-    outSuccess = false;
-    ConnectedJoyCon cj{};
-    BluetoothLEDevice device = nullptr;
-
-    std::mutex mtx;
-    std::condition_variable cv;
-    bool found = false;
-    uint64_t foundAddress = 0;
-    uint16_t foundProductId = 0;
-    int16_t foundRssi = 0;
-
-    BluetoothLEAdvertisementWatcher watcher;
-    watcher.ScanningMode(BluetoothLEScanningMode::Passive);
-    auto token = watcher.Received([&](auto const&, auto const& args) {
-        if (g_shuttingDown.load()) return;
-
-        uint16_t productId = 0;
-        bool match = false;
-
-        try {
-            auto mfg = args.Advertisement().ManufacturerData();
-            for (uint32_t i = 0; i < mfg.Size(); i++) {
-                auto sec = mfg.GetAt(i);
-                if (sec.CompanyId() != JOYCON_MANUFACTURER_ID) continue;
-
-                auto rdr = DataReader::FromBuffer(sec.Data());
-                std::vector<uint8_t> d(rdr.UnconsumedBufferLength());
-                rdr.ReadBytes(d);
-
-                if (TryParseSwitch2ControllerAd(d, productId)) {
-                    match = true;
-                    break;
+// Feeds DiscoveryService from one long-lived passive watcher for the whole
+// connection phase instead of a watcher per player.
+class WinRtAdvertisementSource : public AdvertisementSource {
+public:
+    ~WinRtAdvertisementSource() override { Stop(); }
+
+    bool Start(Callback onAdvertisement) override {
+        m_callback = std::move(onAdvertisement);
+        m_watcher = BluetoothLEAdvertisementWatcher();
+        m_watcher.ScanningMode(BluetoothLEScanningMode::Passive);
+        m_token = m_watcher.Received([this](auto const&, auto const& args) {
+            if (g_shuttingDown.load()) return;
+            try {
+                auto mfg = args.Advertisement().ManufacturerData();
+                for (uint32_t i = 0; i < mfg.Size(); i++) {
+                    auto sec = mfg.GetAt(i);
+                    if (sec.CompanyId() != JOYCON_MANUFACTURER_ID) continue;
+
+                    auto rdr = DataReader::FromBuffer(sec.Data());
+                    std::vector<uint8_t> d(rdr.UnconsumedBufferLength());
+                    rdr.ReadBytes(d);
+
+                    uint16_t productId = 0;
+                    if (TryParseSwitch2ControllerAd(d, productId)) {
+                        m_callback({ args.BluetoothAddress(), productId, args.RawSignalStrengthInDBm() });
+                        return;
+                    }
                 }
-            }
+            } catch (...) {}
+        });
+        try {
+            m_watcher.Start();
         } catch (...) {
-            return;
+            m_watcher.Received(m_token);
+            m_watcher = nullptr;
+            return false;
         }
+        return true;
+    }
 
-        if (!match) return;
+    void Stop() override {
+        if (!m_watcher) return;
+        try { m_watcher.Stop(); } catch (...) {}
+        m_watcher.Received(m_token);
+        m_watcher = nullptr;
+    }
 
-        {
-            std::lock_guard<std::mutex> lk(mtx);
-            if (found) return;
-            found = true;
-            foundAddress = args.BluetoothAddress();
-            foundProductId = productId;
-            foundRssi = args.RawSignalStrengthInDBm();
-        }
-        cv.notify_one();
-    });
+private:
+    BluetoothLEAdvertisementWatcher m_watcher{ nullptr };
+    winrt::event_token              m_token{};
+    Callback                        m_callback;
+};
 
-    statusCb("Scanning... (hold sync button)");
-    try {
-        watcher.Start();
-    } catch (...) {
-        statusCb("BLE scan failed to start");
-        return cj;
+static Uuid128 ToUuid(const winrt::guid& g) {
+    return UuidFromGuidFields(g.Data1, g.Data2, g.Data3, g.Data4);
+}
+static winrt::guid ToGuid(const Uuid128& u) {
+    uint32_t d1; uint16_t d2, d3; std::array<uint8_t, 8> d4{};
+    UuidToGuidFields(u, d1, d2, d3, d4.data());
+    return winrt::guid(d1, d2, d3, d4);
+}
+
+// Returns false for roles that belong to the other side of a JoyCon pair.
+static bool AssignCharacteristic(ConnectedJoyCon& cj, GattRole role, GattCharacteristic const& ch, JoyConSide side) {
+    const bool left = side == JoyConSide::Left;
+    switch (role) {
+    case GattRole::InputReport:      cj.inputChar = ch; return true;
+    case GattRole::WriteCommand:     cj.writeChar = ch; return true;
+    case GattRole::CmdResponseBasic: cj.cmdRespBasicChar = ch; return true;
+    case GattRole::CmdResponseLeft:  if (!left) return false; cj.cmdRespExtChar = ch; return true;
+    case GattRole::CmdResponseRight: if (left) return false; cj.cmdRespExtChar = ch; return true;
+    case GattRole::CmdResponsePro:
+    case GattRole::CmdResponseGC:    cj.cmdRespExtChar = ch; return true;
+    case GattRole::RumbleLeft:       if (!left) return false; cj.rumbleChar = ch; return true;
+    case GattRole::RumbleRight:      if (left) return false; cj.rumbleChar = ch; return true;
+    case GattRole::RumblePro:
+    case GattRole::RumbleGC:         cj.rumbleChar = ch; return true;
+    case GattRole::VibrationLeft:    cj.vibrationCharLeft = ch; if (left) cj.vibrationChar = ch; return true;
+    case GattRole::VibrationRight:   cj.vibrationCharRight = ch; if (!left) cj.vibrationChar = ch; return true;
+    case GattRole::VibrationPro:
+    case GattRole::VibrationGC:      cj.vibrationChar = ch; return true;
+    default: return false;
     }
+}
 
-    {
-        std::unique_lock<std::mutex> lk(mtx);
-        if (!cv.wait_for(lk, std::chrono::seconds(30), [&]{ return found || g_shuttingDown.load(); })) {
-            watcher.Stop();
-            watcher.Received(token);
-            statusCb("Timed out — device not found");
-            return cj;
+// Fast path: ask the system cache for exactly the services and
+// characteristics recorded last time. Any miss sends the caller back to full
+// uncached discovery.
+static Task<bool> OpenFromGattCacheAsync(BluetoothLEDevice device, GattCacheEntry entry, ConnectedJoyCon& cj, JoyConSide side) {
+    std::unordered_map<Uuid128, GattDeviceService, Uuid128Hash> services;
+    try {
+        for (const auto& c : entry.characteristics) {
+            auto it = services.find(c.service);
+            if (it == services.end()) {
+                auto sr = co_await AwaitWinRt(device.GetGattServicesForUuidAsync(ToGuid(c.service), BluetoothCacheMode::Cached));
+                if (sr.Status() != GattCommunicationStatus::Success || sr.Services().Size() == 0) co_return false;
+                it = services.emplace(c.service, sr.Services().GetAt(0)).first;
+            }
+            auto cr = co_await AwaitWinRt(it->second.GetCharacteristicsForUuidAsync(ToGuid(c.characteristic), BluetoothCacheMode::Cached));
+            if (cr.Status() != GattCommunicationStatus::Success || cr.Characteristics().Size() == 0) co_return false;
+            AssignCharacteristic(cj, c.role, cr.Characteristics().GetAt(0), side);
         }
+    } catch (...) {
+        co_return false;
     }
+    co_return cj.inputChar && cj.writeChar;
+}
+
+// FromBluetoothAddressAsync and the cached GATT path both succeed for a
+// controller that is switched off; only the link status tells them apart.
+static bool IsLinkUp(const ConnectedJoyCon& cj) {
+    try { return cj.device && cj.device.ConnectionStatus() == BluetoothConnectionStatus::Connected; }
+    catch (...) { return false; }
+}
 
-    watcher.Stop();
-    watcher.Received(token);
+struct OpenedDevice {
+    ConnectedJoyCon cj{};
+    bool            ok = false;
+};
+
+// Connect, discover, subscribe and init as one coroutine on g_executor, so
+// any number of controllers progress together while each waits on the radio.
+// A remembered controller is opened by address without an advertisement, so
+// with requireLink the link has to be confirmed up before it counts. Input
+// notifications are turned on here; attaching a player only registers its
+// handler.
+static Task<OpenedDevice> OpenAndInitAsync(uint64_t address, uint16_t productId, ControllerType type, JoyConSide side,
+                                           std::function<void(const std::string&)> statusCb, bool requireLink) {
+    OpenedDevice out;
+    auto& cj = out.cj;
+    BluetoothLEDevice device = nullptr;
 
     if (g_shuttingDown.load()) {
         statusCb("Cancelled");
-        return cj;
-    }
-
-    {
-        char tmp[160];
-        sprintf_s(tmp, "Found advertisement PID 0x%04X RSSI %d, opening device...", foundProductId, (int)foundRssi);
-        statusCb(tmp);
+        co_return out;
     }
 
     try {
-        device = BluetoothLEDevice::FromBluetoothAddressAsync(foundAddress).get();
+        device = co_await AwaitWinRt(BluetoothLEDevice::FromBluetoothAddressAsync(address));
     } catch (...) {
-        statusCb("Failed to open BLE device");
-        return cj;
+        device = nullptr;
     }
 
     if (!device) {
-        statusCb("BLE device opened as null");
-        return cj;
+        statusCb("Failed to open BLE device");
+        co_return out;
     }
 
-    statusCb("Device opened, fetching GATT services...");
     cj.device = device;
 
-    GattDeviceServicesResult sr = nullptr;
-    for (int att = 1; att <= 10; ++att) {
-        sr = device.GetGattServicesAsync(BluetoothCacheMode::Uncached).get();
-        if (sr.Status() == GattCommunicationStatus::Success) break;
-        statusCb("Retrying GATT (" + std::to_string(att) + "/10)...");
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    }
-    if (!sr || sr.Status() != GattCommunicationStatus::Success) {
-        statusCb("Failed to get GATT services. Re-pair/forget the device.");
-        return cj;
-    }
-    for (auto svc : sr.Services()) {
-        auto cr = svc.GetCharacteristicsAsync().get();
-        if (cr.Status() != GattCommunicationStatus::Success) continue;
-        for (auto ch : cr.Characteristics()) {
-            if (ch.Uuid() == guid(INPUT_REPORT_UUID))  cj.inputChar  = ch;
-            if (ch.Uuid() == guid(WRITE_COMMAND_UUID)) cj.writeChar  = ch;
-            if (ch.Uuid() == guid(CMD_RESPONSE_UUID_BASIC)) cj.cmdRespBasicChar = ch;
-            if (ch.Uuid() == guid(CMD_RESPONSE_UUID_L))   { if (side == JoyConSide::Left)  cj.cmdRespExtChar = ch; }
-            if (ch.Uuid() == guid(CMD_RESPONSE_UUID_R))   { if (side == JoyConSide::Right) cj.cmdRespExtChar = ch; }
-            if (ch.Uuid() == guid(CMD_RESPONSE_UUID_PRO)) cj.cmdRespExtChar = ch;
-            if (ch.Uuid() == guid(CMD_RESPONSE_UUID_GC))  cj.cmdRespExtChar = ch; 
-            if (ch.Uuid() == guid(RUMBLE_CHAR_UUID_L))   { if (side == JoyConSide::Left)  cj.rumbleChar = ch; }
-            if (ch.Uuid() == guid(RUMBLE_CHAR_UUID_R))   { if (side == JoyConSide::Right) cj.rumbleChar = ch; }
-            if (ch.Uuid() == guid(RUMBLE_CHAR_UUID_PRO)) cj.rumbleChar = ch;
-            if (ch.Uuid() == guid(RUMBLE_CHAR_UUID_GC))  cj.rumbleChar = ch;
-            if (ch.Uuid() == guid(VIBRATION_CHAR_UUID_L)) {
-                cj.vibrationCharLeft = ch;
-                if (side == JoyConSide::Left) cj.vibrationChar = ch;
-            }
-            if (ch.Uuid() == guid(VIBRATION_CHAR_UUID_R)) {
-                cj.vibrationCharRight = ch;
-                if (side == JoyConSide::Right) cj.vibrationChar = ch;
-            }
-            if (ch.Uuid() == guid(VIBRATION_CHAR_UUID_PRO)) {
-                cj.vibrationChar = ch;
-            }
-            if (ch.Uuid() == guid(VIBRATION_CHAR_UUID_GC)) {
-                cj.vibrationChar = ch;
+    GattCacheEntry cached;
+    bool fromCache = false;
+    if (g_gattCache.Find(address, productId, cached)) {
+        statusCb("Device opened, using cached GATT layout...");
+        fromCache = co_await OpenFromGattCacheAsync(device, cached, cj, side);
+        if (!fromCache) {
+            AppLog("[GATT] Cached layout mismatch, running full discovery");
+            g_gattCache.Invalidate(address, productId);
+            ConnectedJoyCon fresh{};
+            fresh.device = device;
+            cj = fresh;
+        }
+    }
+
+    if (!fromCache) {
+        statusCb("Device opened, fetching GATT services...");
+
+        GattDeviceServicesResult sr = nullptr;
+        for (int att = 1; att <= 10; ++att) {
+            sr = co_await AwaitWinRt(device.GetGattServicesAsync(BluetoothCacheMode::Uncached));
+            if (sr.Status() == GattCommunicationStatus::Success) break;
+            statusCb("Retrying GATT (" + std::to_string(att) + "/10)...");
+            co_await g_executor.Sleep(std::chrono::milliseconds(500));
+        }
+        if (!sr || sr.Status() != GattCommunicationStatus::Success) {
+            statusCb("Failed to get GATT services. Re-pair/forget the device.");
+            co_return out;
+        }
+        GattCacheEntry entry{ address, productId, {} };
+        for (auto svc : sr.Services()) {
+            auto cr = co_await AwaitWinRt(svc.GetCharacteristicsAsync());
+            if (cr.Status() != GattCommunicationStatus::Success) continue;
+            for (auto ch : cr.Characteristics()) {
+                GattRole role;
+                if (!LookupGattRole(ToUuid(ch.Uuid()), role)) continue;
+                if (AssignCharacteristic(cj, role, ch, side))
+                    entry.characteristics.push_back({ role, ToUuid(svc.Uuid()), ToUuid(ch.Uuid()) });
             }
         }
+        if (cj.inputChar && cj.writeChar && g_gattCache.Store(std::move(entry)))
+            g_persistence.MarkDirty(GATT_CACHE_FILE);
     }
     if (!cj.inputChar || !cj.writeChar) {
         statusCb("Required GATT characteristics not found. Re-pair/forget the device.");
-        return cj;
+        co_return out;
+    }
+    if (requireLink && !IsLinkUp(cj)) {
+        statusCb("Controller is not connected");
+        co_return out;
     }
 
-    AttachCommandResponseLogger(cj.cmdRespBasicChar, "basic 0x001A");
-    AttachCommandResponseLogger(cj.cmdRespExtChar, "extended 0x001E");
+    cj.outbound = std::make_shared<CommandQueue>();
+    cj.commands = std::make_shared<CommandEngine>();
+    std::weak_ptr<CommandEngine> engine = cj.commands;
+    auto onResponse = [engine](const std::vector<uint8_t>& buf) {
+        if (auto sp = engine.lock()) sp->OnResponse(buf.data(), buf.size());
+    };
+    AttachCommandResponseLogger(cj.cmdRespBasicChar, "basic 0x001A", onResponse);
+    AttachCommandResponseLogger(cj.cmdRespExtChar, "extended 0x001E", onResponse);
+    co_await SubscribeAsync(cj.cmdRespBasicChar);
+    co_await SubscribeAsync(cj.cmdRespExtChar);
     try {
         cj.device.RequestPreferredConnectionParameters(BluetoothLEPreferredConnectionParameters::ThroughputOptimized());
     } catch(...) {}
-    outSuccess = true;
-    statusCb("Connected!");
-    return cj;
+
+    statusCb("Initializing...");
+    co_await InitControllerAsync(cj, type, side);
+
+    if (g_opts.captureReports && g_captureRecorder.Start()) {
+        static const char* names[] = { "", "JoyCon", "DualJoyCon", "ProController", "NSOGC" };
+        std::string label = names[type];
+        if (type == SingleJoyCon || type == DualJoyCon) label += side == JoyConSide::Left ? "-L" : "-R";
+        cj.capture = g_captureRecorder.Open({ (int)type, side, address, productId, label });
+        AppLog(cj.capture ? "[CAPTURE] Recording to " + cj.capture->Path() : std::string("[CAPTURE] Could not create a file in ") + CAPTURE_DIR);
+    }
+    co_await SubscribeAsync(cj.inputChar);
+
+    out.ok = !g_shuttingDown.load();
+    statusCb(out.ok ? "Connected!" : "Cancelled");
+    co_return out;
 }
 
 static void InitViGEm() {
@@ -910,36 +1233,186 @@ static PVIGEM_TARGET AddDS4() {
     return t;
 }
 
-static void ApplyBtnMapping(DS4_REPORT_EX& r, ButtonMapping m) {
-    switch(m) {
-        case ButtonMapping::L3:       r.Report.wButtons |= DS4_BUTTON_THUMB_LEFT;    break;
-        case ButtonMapping::R3:       r.Report.wButtons |= DS4_BUTTON_THUMB_RIGHT;   break;
-        case ButtonMapping::L1:       r.Report.wButtons |= DS4_BUTTON_SHOULDER_LEFT; break;
-        case ButtonMapping::R1:       r.Report.wButtons |= DS4_BUTTON_SHOULDER_RIGHT;break;
-        case ButtonMapping::L2:       r.Report.bTriggerL = 255;                      break;
-        case ButtonMapping::R2:       r.Report.bTriggerR = 255;                      break;
-        case ButtonMapping::CROSS:    r.Report.wButtons |= DS4_BUTTON_CROSS;         break;
-        case ButtonMapping::CIRCLE:   r.Report.wButtons |= DS4_BUTTON_CIRCLE;        break;
-        case ButtonMapping::SQUARE:   r.Report.wButtons |= DS4_BUTTON_SQUARE;        break;
-        case ButtonMapping::TRIANGLE: r.Report.wButtons |= DS4_BUTTON_TRIANGLE;      break;
-        case ButtonMapping::SHARE:    r.Report.wButtons |= DS4_BUTTON_SHARE;         break;
-        case ButtonMapping::OPTIONS:  r.Report.wButtons |= DS4_BUTTON_OPTIONS;       break;
-        case ButtonMapping::DPAD_UP:    DS4_SET_DPAD(reinterpret_cast<PDS4_REPORT>(&r.Report), DS4_BUTTON_DPAD_NORTH); break;
-        case ButtonMapping::DPAD_DOWN:  DS4_SET_DPAD(reinterpret_cast<PDS4_REPORT>(&r.Report), DS4_BUTTON_DPAD_SOUTH); break;
-        case ButtonMapping::DPAD_LEFT:  DS4_SET_DPAD(reinterpret_cast<PDS4_REPORT>(&r.Report), DS4_BUTTON_DPAD_WEST);  break;
-        case ButtonMapping::DPAD_RIGHT: DS4_SET_DPAD(reinterpret_cast<PDS4_REPORT>(&r.Report), DS4_BUTTON_DPAD_EAST);  break;
-        default: break;
-    }
-}
-static void ApplyGLGR(DS4_REPORT_EX& r, const std::vector<uint8_t>& buf) {
-    if (buf.size() < 9 || g_proConfig.layouts.empty()) return;
-    int li = g_proConfig.activeLayoutIndex;
-    if (li < 0 || li >= (int)g_proConfig.layouts.size()) li = 0;
-    auto& lay = g_proConfig.layouts[li];
-    uint64_t st = 0;
-    for (int i = 3; i <= 8; ++i) st = (st << 8) | buf[i];
-    if (st & 0x000000000200ULL) ApplyBtnMapping(r, lay.glMapping);
-    if (st & 0x000000000100ULL) ApplyBtnMapping(r, lay.grMapping);
+// Releases every held input while a controller is away, so a dropped link
+// does not leave a button or stick stuck on the virtual pad.
+static void SendNeutralReport(PVIGEM_TARGET tgt) {
+    if (g_shuttingDown.load() || !g_vigem || !tgt) return;
+    DS4_REPORT_EX report{};
+    DS4_REPORT_INIT(reinterpret_cast<PDS4_REPORT>(&report.Report));
+    vigem_target_ds4_update_ex(g_vigem, tgt, report);
+}
+
+// A player's controller for the rest of the session. When its BLE link drops,
+// the supervisor opens the same address again and rebind puts the fresh
+// device behind the player's existing ViGEm target and DSU slot.
+struct LiveLink {
+    ControllerType type = SingleJoyCon;
+    std::string    label;
+    std::function<void()>                       onDrop;
+    std::function<void(const ConnectedJoyCon&)> rebind;
+    BluetoothLEDevice   device = nullptr;
+    winrt::event_token  statusToken{};
+};
+
+static std::mutex                           g_liveLinksMutex;
+static std::unordered_map<int, LiveLink>    g_liveLinks;
+static std::unique_ptr<ReconnectSupervisor> g_reconnect;
+
+static void WatchConnection(const ConnectedJoyCon& cj, int link) {
+    if (!cj.device) return;
+    auto token = cj.device.ConnectionStatusChanged([link](BluetoothLEDevice const& d, auto const&) {
+        if (g_shuttingDown.load() || d.ConnectionStatus() != BluetoothConnectionStatus::Disconnected) return;
+        std::function<void()> onDrop;
+        {
+            std::lock_guard<std::mutex> lk(g_liveLinksMutex);
+            auto it = g_liveLinks.find(link);
+            if (it == g_liveLinks.end()) return;
+            onDrop = it->second.onDrop;
+        }
+        if (onDrop) onDrop();
+        if (g_reconnect) g_reconnect->OnDisconnected(link);
+    });
+    std::lock_guard<std::mutex> lk(g_liveLinksMutex);
+    auto it = g_liveLinks.find(link);
+    if (it == g_liveLinks.end()) { cj.device.ConnectionStatusChanged(token); return; }
+    if (it->second.device) {
+        try { it->second.device.ConnectionStatusChanged(it->second.statusToken); } catch (...) {}
+    }
+    it->second.device = cj.device;
+    it->second.statusToken = token;
+}
+
+class WinRtReconnectTransport : public ReconnectTransport {
+public:
+    bool Reconnect(int link, const KnownDevice& kd) override {
+        std::function<void(const ConnectedJoyCon&)> rebind;
+        {
+            std::lock_guard<std::mutex> lk(g_liveLinksMutex);
+            auto it = g_liveLinks.find(link);
+            if (it == g_liveLinks.end()) return false;
+            rebind = it->second.rebind;
+        }
+        // Supervisor workers may block; the open itself runs on g_executor.
+        auto opened = SpawnFuture(g_executor, OpenAndInitAsync(kd.address, kd.productId,
+            (ControllerType)kd.controllerType, kd.side, [](const std::string&){}, true)).get();
+        if (!opened.ok || g_shuttingDown.load()) return false;
+        if (rebind) rebind(opened.cj);
+        WatchConnection(opened.cj, link);
+        return true;
+    }
+};
+
+static WinRtReconnectTransport g_reconnectTransport;
+
+static void TrackLiveLink(const KnownDevice& kd, const ConnectedJoyCon& cj, LiveLink link) {
+    if (!g_reconnect) return;
+    const int id = g_reconnect->Track(kd);
+    {
+        std::lock_guard<std::mutex> lk(g_liveLinksMutex);
+        g_liveLinks[id] = std::move(link);
+    }
+    WatchConnection(cj, id);
+}
+
+static void ClearLiveLinks() {
+    std::lock_guard<std::mutex> lk(g_liveLinksMutex);
+    for (auto& [id, l] : g_liveLinks) {
+        if (g_reconnect) g_reconnect->Untrack(id);
+        if (l.device) { try { l.device.ConnectionStatusChanged(l.statusToken); } catch (...) {} }
+    }
+    g_liveLinks.clear();
+}
+
+// One press of Connect. The open coroutines share it with the connection
+// thread and keep it alive while they finish, even after the thread has given
+// up on their slot.
+struct ConnectSession {
+    struct PendingOpen {
+        int                   player = 0;
+        ControllerType        type = SingleJoyCon;
+        JoyConSide            side = JoyConSide::Left;
+        std::vector<uint16_t> productIds;
+        uint64_t              address = 0;
+        uint16_t              productId = 0;
+        std::promise<bool>    promise;
+        std::future<bool>     future;
+    };
+
+    std::vector<PendingOpen>          opens;
+    std::atomic<uint64_t>             lastActivityUs{ SteadyMicros(SteadyClock::now()) };
+    WinRtAdvertisementSource          adSource;
+    std::unique_ptr<DiscoveryService> discovery;
+
+    void Touch() { lastActivityUs.store(SteadyMicros(SteadyClock::now())); }
+};
+
+static Task<bool> OpenSlotAsync(std::shared_ptr<ConnectSession> session, int slot, uint64_t address, uint16_t pid, bool requireLink) {
+    auto& op = session->opens[slot];
+    session->Touch();
+    auto opened = co_await OpenAndInitAsync(address, pid, op.type, op.side,
+        [slot](const std::string& st) { SetTaskStatus(slot, st); }, requireLink);
+    if (opened.ok) {
+        g_connectionTasks[slot].result = opened.cj;
+        op.address = address; op.productId = pid;
+    }
+    session->Touch();
+    co_return opened.ok;
+}
+
+// A handler's pipeline plus its view of the live settings.
+struct LivePipeline {
+    ReportPipeline pipeline;
+    SnapshotReader<LiveSettings> settings;
+    ReportChangeFilter vigemFilter, dsuFilter;
+};
+// Settings the user can change while controllers are live; checked before
+// every report, applied only when a new snapshot has been published.
+static void SyncPipeline(LivePipeline& lp) {
+    if (!lp.settings.Refresh(g_liveSettings)) return;
+    const LiveSettings& s = *lp.settings.Current();
+    auto& c = lp.pipeline.Config();
+    c.policy = s.updatePolicy;
+    c.smoothMotionClock = s.smoothMotionClock;
+    c.aim = s.gyroAim;
+    if (c.controllerType != ProController) return;
+    c.glMapping = c.grMapping = ButtonMapping::NONE;
+    if (s.layouts.empty()) return;
+    int li = s.activeLayoutIndex;
+    if (li < 0 || li >= (int)s.layouts.size()) li = 0;
+    c.glMapping = s.layouts[li].glMapping;
+    c.grMapping = s.layouts[li].grMapping;
+}
+// One per connection: a rebind attaches a fresh handler with a fresh pipeline.
+static std::shared_ptr<LivePipeline> MakeLivePipeline(ControllerType type, const ConnectedJoyCon& cj, bool decodeMotion,
+        GyroAimOutput aim = GyroAimOutput::Off,
+        JoyConSide side = JoyConSide::Left, JoyConOrientation orientation = JoyConOrientation::Upright) {
+    PipelineConfig cfg;
+    cfg.controllerType = type; cfg.side = side; cfg.orientation = orientation;
+    cfg.decodeMotion = decodeMotion; cfg.aimOutput = aim;
+    cfg.calibration = cj.stickCalibration; cfg.motionScale = cj.motionScale;
+    auto p = std::make_shared<LivePipeline>();
+    p->pipeline = ReportPipeline(std::move(cfg));
+    SyncPipeline(*p);
+    return p;
+}
+// Hands an output to the player's sinks, each skipping what it has already
+// seen. DSU always streams, its clients integrate the motion. When the ViGEm
+// pad's motion fields are the player's gyro output, a change in them beyond
+// sensor noise counts as new input, so a controller resting on the desk
+// still goes quiet. Returns false once the pad is gone.
+static bool SubmitOutput(LivePipeline& lp, const PipelineOutput& out, PVIGEM_TARGET tgt, bool padMotion, int dsuSlot, PlayerTelemetry& tel) {
+    const uint64_t now = SteadyNanos(SteadyClock::now());
+    const ChangeFilterConfig& f = lp.settings.Current()->changeFilter;
+    bool dsuSkipped = false;
+    if (dsuSlot >= 0) {
+        if (lp.dsuFilter.Admit(out.report, now, f, out.motion.valid ? MotionFilter::Stream : MotionFilter::Ignore)) g_dsuSink.Emit((uint8_t)dsuSlot, out);
+        else dsuSkipped = true;
+    }
+    if (g_shuttingDown.load() || !g_vigem || !tgt) return false;
+    const bool padSkipped = !lp.vigemFilter.Admit(out.report, now, f, padMotion ? MotionFilter::Changes : MotionFilter::Ignore);
+    if (!padSkipped) vigem_target_ds4_update_ex(g_vigem, tgt, out.report);
+    if (padSkipped || dsuSkipped) tel.RecordSkipped(padSkipped, dsuSkipped);
+    return true;
 }
 static void HandleSpecialProButtons(const std::vector<uint8_t>& buf) {
     if (buf.size() < 9) return;
@@ -960,17 +1433,61 @@ static void HandleSpecialProButtons(const std::vector<uint8_t>& buf) {
     if (screenshot && !g_screenshotButtonPressed) { INPUT ip{}; ip.type=INPUT_KEYBOARD; ip.ki.wVk=VK_F12; SendInput(1,&ip,sizeof(ip)); g_screenshotButtonPressed=true; }
     else if (!screenshot && g_screenshotButtonPressed) { INPUT ip{}; ip.type=INPUT_KEYBOARD; ip.ki.wVk=VK_F12; ip.ki.dwFlags=KEYEVENTF_KEYUP; SendInput(1,&ip,sizeof(ip)); g_screenshotButtonPressed=false; }
 
+    // The layout list belongs to the UI thread; it applies the switch and
+    // publishes it with the next frame.
     bool cBtn = (st & CBTN) != 0;
     if (cBtn && !g_cButtonPressed) {
-        if (!g_proConfig.layouts.empty()) {
-            g_proConfig.activeLayoutIndex = (g_proConfig.activeLayoutIndex + 1) % (int)g_proConfig.layouts.size();
-            SaveProConfig();
-            AppLog(std::string("Layout -> ") + g_proConfig.layouts[g_proConfig.activeLayoutIndex].name);
-        }
+        g_layoutCycleRequests.fetch_add(1);
         g_cButtonPressed = true;
     } else if (!cBtn) g_cButtonPressed = false;
 }
 
+// One SendInput per report however many mouse events it made, so motion,
+// clicks and scrolling from the same report reach the system together.
+class SendInputMouseSink : public MouseSink {
+public:
+    void Send(const MouseBatch& batch) override {
+        INPUT in[MouseBatch::kMaxEvents]{};
+        UINT n = 0;
+        for (const MouseEvent& e : batch) {
+            INPUT& ip = in[n++];
+            ip.type = INPUT_MOUSE;
+            switch (e.type) {
+            case MouseEvent::Type::Move:
+                ip.mi.dx = e.dx; ip.mi.dy = e.dy; ip.mi.dwFlags = MOUSEEVENTF_MOVE; break;
+            case MouseEvent::Type::Wheel:
+                ip.mi.mouseData = (DWORD)e.wheel; ip.mi.dwFlags = MOUSEEVENTF_WHEEL; break;
+            case MouseEvent::Type::Down:
+            case MouseEvent::Type::Up: {
+                const bool down = e.type == MouseEvent::Type::Down;
+                switch (e.button) {
+                case MouseButton::Left:   ip.mi.dwFlags = down ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP; break;
+                case MouseButton::Right:  ip.mi.dwFlags = down ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP; break;
+                case MouseButton::Middle: ip.mi.dwFlags = down ? MOUSEEVENTF_MIDDLEDOWN : MOUSEEVENTF_MIDDLEUP; break;
+                case MouseButton::X1:
+                case MouseButton::X2:
+                    ip.mi.mouseData = e.button == MouseButton::X1 ? XBUTTON1 : XBUTTON2;
+                    ip.mi.dwFlags = down ? MOUSEEVENTF_XDOWN : MOUSEEVENTF_XUP;
+                    break;
+                }
+                break;
+            }
+            }
+        }
+        if (n) SendInput(n, in, sizeof(INPUT));
+    }
+};
+static SendInputMouseSink g_mouseSink;
+
+// Gyro aim in mouse mode moves the pointer straight from the input callback.
+static void SendAimMouse(const PipelineOutput& out) {
+    if (!out.aimMouseDx && !out.aimMouseDy) return;
+    MouseBatch mb;
+    MouseEvent e; e.dx = out.aimMouseDx; e.dy = out.aimMouseDy;
+    mb.Add(e);
+    g_mouseSink.Send(mb);
+}
+
 static void SendKey(WORD vk, bool down) {
     INPUT ip{}; ip.type=INPUT_KEYBOARD; ip.ki.wVk=vk;
     ip.ki.dwFlags = down ? 0 : KEYEVENTF_KEYUP;
@@ -1032,100 +1549,214 @@ static void UpdateCalibLiveValues() {
 }
 
 static void AttachSingleJoyConHandler(SingleJoyConPlayer& player, GyroMode gyroMode, uint8_t dsuSlot) {
-    player.joycon.inputChar.ValueChanged(
-        [&player, gyroMode, dsuSlot]
+    const auto cj = player.joycon->Current();
+    cj->inputChar.ValueChanged(
+        [&player, gyroMode, dsuSlot, cj, version = player.joycon->Version(), cap = cj->capture,
+         pipe = MakeLivePipeline(SingleJoyCon, *cj, gyroMode == GyroMode::DsuUdp, player.gyroAim, player.side, player.orientation)]
         (GattCharacteristic const&, GattValueChangedEventArgs const& args)
     {
         if (g_shuttingDown.load()) return;
+        const auto live = player.joycon->Enter(version);
+        if (!live.owns_lock()) return;   // replaced by a reconnect
         const auto now = SteadyClock::now();
         auto rdr = DataReader::FromBuffer(args.CharacteristicValue());
         std::vector<uint8_t> buf(rdr.UnconsumedBufferLength());
         rdr.ReadBytes(buf);
+        CaptureReport(cap, buf, now);
 
         FeedCalibBuffer(buf, player.side == JoyConSide::Left);
 
         const double bleDelta = MsBetween(player.latency.lastBleTime, now);
         player.latency.lastBleTime = now;
+        player.telemetry->RecordReport(SteadyNanos(now), ExtractReportCounter(buf));
 
+        SyncPipeline(*pipe);
         if (player.side == JoyConSide::Right) {
             uint32_t btnState = ExtractButtonState(buf);
             bool chatPressed = (btnState & 0x000040) != 0;
+            MouseBatch mb;
             if (chatPressed && !player.wasChatPressed) {
                 player.mouseMode = (player.mouseMode + 1) % 4;
-                const char* names[] = {"OFF","FAST","NORMAL","SLOW"};
+                if (player.mouseMode == 0) player.mouse.Release(mb);
+                const char* names[] = {"Mouse mode: OFF","Mouse mode: FAST","Mouse mode: NORMAL","Mouse mode: SLOW"};
                 uint8_t leds[] = {0x01, 0x02, 0x04, 0x08};
-                AppLog(std::string("Mouse mode: ") + names[player.mouseMode]);
-                SetPlayerLEDs(player.joycon.writeChar, leds[player.mouseMode]);
-                EmitSound(player.joycon.writeChar);
+                AppLog(names[player.mouseMode]);
+                SetPlayerLEDs(*cj, leds[player.mouseMode]);
+                EmitSound(*cj);
             }
             player.wasChatPressed = chatPressed;
 
             if (player.mouseMode > 0) {
                 auto [rx, ry] = GetRawOpticalMouse(buf);
-                if (player.firstOpticalRead) { player.lastOpticalX=rx; player.lastOpticalY=ry; player.firstOpticalRead=false; }
-                else {
-                    int16_t dx=rx-player.lastOpticalX, dy=ry-player.lastOpticalY;
-                    player.lastOpticalX=rx; player.lastOpticalY=ry;
-                    if (dx||dy) {
-                        float s = player.mouseMode==1?1.f:player.mouseMode==2?0.6f:0.3f;
-                        INPUT ip{}; ip.type=INPUT_MOUSE; ip.mi.dx=(int)(dx*s); ip.mi.dy=(int)(dy*s); ip.mi.dwFlags=MOUSEEVENTF_MOVE;
-                        SendInput(1,&ip,sizeof(ip));
-                    }
-                }
-                bool R=(btnState&0x004000)!=0, ZR=(btnState&0x008000)!=0, ST=(btnState&0x000004)!=0;
-                auto mkMouse=[](DWORD f){INPUT ip{}; ip.type=INPUT_MOUSE; ip.mi.dwFlags=f; SendInput(1,&ip,sizeof(ip));};
-                if (R&&!player.leftBtnPressed)   mkMouse(MOUSEEVENTF_LEFTDOWN);
-                if (!R&&player.leftBtnPressed)   mkMouse(MOUSEEVENTF_LEFTUP);
-                player.leftBtnPressed=R;
-                if (ZR&&!player.rightBtnPressed) mkMouse(MOUSEEVENTF_RIGHTDOWN);
-                if (!ZR&&player.rightBtnPressed) mkMouse(MOUSEEVENTF_RIGHTUP);
-                player.rightBtnPressed=ZR;
-                if (ST&&!player.middleBtnPressed) mkMouse(MOUSEEVENTF_MIDDLEDOWN);
-                if (!ST&&player.middleBtnPressed) mkMouse(MOUSEEVENTF_MIDDLEUP);
-                player.middleBtnPressed=ST;
-
-                auto sd = DecodeJoystick(buf, player.side, player.orientation);
-                const int SZ=4000, BT=28000;
-                if (abs(sd.y)>SZ) {
-                    float inten=(abs(sd.y)-SZ)/(32767.f-SZ);
-                    float spd=inten*40.f;
-                    player.scrollAccumulator += sd.y>0 ? -spd : spd;
-                    if (abs(player.scrollAccumulator)>=120.f) {
-                        int clicks=(int)(player.scrollAccumulator/120.f);
-                        player.scrollAccumulator-=clicks*120.f;
-                        INPUT ip{}; ip.type=INPUT_MOUSE; ip.mi.mouseData=clicks*120; ip.mi.dwFlags=MOUSEEVENTF_WHEEL;
-                        SendInput(1,&ip,sizeof(ip));
-                    }
-                } else player.scrollAccumulator=0.f;
-                auto mkX=[](DWORD xb, DWORD f){INPUT ip{}; ip.type=INPUT_MOUSE; ip.mi.mouseData=xb; ip.mi.dwFlags=f; SendInput(1,&ip,sizeof(ip));};
-                if (sd.x<-BT&&!player.mb4Pressed) { mkX(XBUTTON1,MOUSEEVENTF_XDOWN); mkX(XBUTTON1,MOUSEEVENTF_XUP); player.mb4Pressed=true; }
-                else if (sd.x>=-BT) player.mb4Pressed=false;
-                if (sd.x>BT&&!player.mb5Pressed) { mkX(XBUTTON2,MOUSEEVENTF_XDOWN); mkX(XBUTTON2,MOUSEEVENTF_XUP); player.mb5Pressed=true; }
-                else if (sd.x<=BT) player.mb5Pressed=false;
+                auto sd = DecodeJoystick(buf, player.side, player.orientation, cj->stickCalibration.get());
+                MouseReport mr;
+                mr.opticalX = rx; mr.opticalY = ry;
+                mr.left = (btnState&0x004000)!=0; mr.right = (btnState&0x008000)!=0; mr.middle = (btnState&0x000004)!=0;
+                mr.stickX = sd.x; mr.stickY = sd.y;
+                const float s = player.mouseMode==1?1.f:player.mouseMode==2?0.6f:0.3f;
+                player.mouse.SetCurve(pipe->settings.Current()->mouseCurve);
+                player.mouse.Process(mr, s, mb);
                 buf[4]&=~0x40; buf[4]&=~0x80; buf[5]&=~0x04;
                 if (buf.size()>=16){buf[13]=0x00;buf[14]=0x08;buf[15]=0x80;}
-            } else player.firstOpticalRead=true;
+            }
+            if (!mb.Empty()) g_mouseSink.Send(mb);
         }
 
-        if (!ShouldEmit(g_opts.updatePolicy, player.latency.lastEmitTime, SteadyClock::now())) return;
         const auto ds = SteadyClock::now();
-        DS4_REPORT_EX report = GenerateDS4Report(buf, player.side, player.orientation);
-        if (gyroMode==GyroMode::DsuUdp && g_dsuServer.IsRunning()) {
-            g_dsuServer.UpdateController(dsuSlot, report); 
-        }
-        if (g_shuttingDown.load() || !g_vigem || !player.ds4Controller) return;
-        vigem_target_ds4_update_ex(g_vigem, player.ds4Controller, report);
+        PipelineOutput out;
+        if (!pipe->pipeline.Process(buf, SteadyNanos(now), out)) { player.telemetry->RecordHeld(); return; }
+        const auto de = SteadyClock::now();
+        SendAimMouse(out);
+        if (!SubmitOutput(*pipe, out, player.ds4Controller, gyroMode==GyroMode::Raw, gyroMode==GyroMode::DsuUdp ? dsuSlot : -1, *player.telemetry)) return;
         const auto vc = SteadyClock::now();
-        g_latencyLogger.Record(g_opts.updatePolicy, CtrlTypeName(1), ++player.latency.eventIndex,
+        player.telemetry->RecordOutput(out, SteadyNanos(de) - SteadyNanos(ds), SteadyNanos(vc) - SteadyNanos(de));
+        g_latencyLogger.Record(pipe->pipeline.Config().policy, CtrlTypeName(1), ++player.latency.eventIndex,
                                bleDelta, 0.0, -1.0, UsBetween(ds,vc), UsBetween(now,vc));
     });
 }
 
+static void AttachDualSideHandler(const std::shared_ptr<DualJoyConSharedState>& ss, const ConnectedJoyCon& cj, bool isLeft) {
+    cj.inputChar.ValueChanged([ss, isLeft, cap = cj.capture](GattCharacteristic const&, GattValueChangedEventArgs const& a){
+        if (g_shuttingDown.load()) return;
+        auto now=SteadyClock::now(); auto rdr=DataReader::FromBuffer(a.CharacteristicValue());
+        std::vector<uint8_t> buf(rdr.UnconsumedBufferLength()); rdr.ReadBytes(buf);
+        CaptureReport(cap, buf, now);
+        FeedCalibBuffer(buf, isLeft);
+        std::lock_guard<std::mutex> lk(ss->mutex);
+        auto& in = isLeft ? ss->left : ss->right;
+        auto& last = isLeft ? ss->lastLeftBleTime : ss->lastRightBleTime;
+        in.bleDeltaMs=MsBetween(last,now); last=now;
+        in.sampleTimeUs=StampMotion(isLeft ? ss->leftClock : ss->rightClock,now,buf,ss->settings.Read(g_liveSettings).smoothMotionClock);
+        in.buffer=std::move(buf); in.receivedAt=now; in.sequence=++ss->sequence;
+        ss->cv.notify_one();
+    });
+}
+
 static ID3D11Device*           g_pd3dDevice       = nullptr;
 static ID3D11DeviceContext*    g_pd3dDeviceContext = nullptr;
 static IDXGISwapChain*         g_pSwapChain        = nullptr;
 static ID3D11RenderTargetView* g_mainRTV           = nullptr;
 static HWND                    g_hwnd              = nullptr;
+static bool                    g_swapChainOccluded = false;
+static RedrawScheduler         g_redraw;
+
+// How often each screen redraws with no input, for numbers that change on
+// their own: the setup screen's device list, the connect spinner and the
+// running screen's telemetry.
+static uint64_t RefreshIntervalNs(AppScreen screen) {
+    switch (screen) {
+        case AppScreen::Setup:      return 1'000'000'000;
+        case AppScreen::Connecting: return 100'000'000;
+        case AppScreen::Running:    return 250'000'000;
+    }
+    return 0;
+}
+
+// Times the UI's own GPU work with timestamp queries. Results are read a
+// few frames late without flushing, so the CPU never waits on the GPU; a
+// frame whose query set is still in flight just goes untimed.
+class GpuFrameTimer {
+public:
+    bool Init(ID3D11Device* device) {
+        D3D11_QUERY_DESC disjoint{D3D11_QUERY_TIMESTAMP_DISJOINT, 0}, stamp{D3D11_QUERY_TIMESTAMP, 0};
+        for (auto& q : m_sets) {
+            if (FAILED(device->CreateQuery(&disjoint, &q.disjoint)) ||
+                FAILED(device->CreateQuery(&stamp, &q.start)) ||
+                FAILED(device->CreateQuery(&stamp, &q.end))) { Release(); return false; }
+        }
+        return true;
+    }
+    void Release() {
+        for (auto& q : m_sets) {
+            for (ID3D11Query** p : {&q.disjoint, &q.start, &q.end}) if (*p) { (*p)->Release(); *p = nullptr; }
+            q.pending = false;
+        }
+    }
+    void Begin(ID3D11DeviceContext* ctx) {
+        QuerySet& q = m_sets[m_next];
+        m_timing = q.disjoint && !q.pending;
+        if (!m_timing) return;
+        ctx->Begin(q.disjoint);
+        ctx->End(q.start);
+    }
+    void End(ID3D11DeviceContext* ctx) {
+        if (!m_timing) return;
+        QuerySet& q = m_sets[m_next];
+        ctx->End(q.end);
+        ctx->End(q.disjoint);
+        q.pending = true;
+        m_next = (m_next + 1) % kSets;
+    }
+    // Adds every finished frame to the running totals.
+    void Collect(ID3D11DeviceContext* ctx) {
+        for (auto& q : m_sets) {
+            if (!q.pending) continue;
+            D3D11_QUERY_DATA_TIMESTAMP_DISJOINT dj{};
+            UINT64 t0 = 0, t1 = 0;
+            if (ctx->GetData(q.disjoint, &dj, sizeof(dj), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+                ctx->GetData(q.start, &t0, sizeof(t0), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK ||
+                ctx->GetData(q.end, &t1, sizeof(t1), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) continue;
+            q.pending = false;
+            if (dj.Disjoint || dj.Frequency == 0 || t1 < t0) continue;
+            m_totalNs += (t1 - t0) * 1'000'000'000ull / dj.Frequency;
+            ++m_frames;
+        }
+    }
+    uint64_t TotalNs() const { return m_totalNs; }
+    uint64_t Frames() const { return m_frames; }
+private:
+    static constexpr int kSets = 4;
+    struct QuerySet {
+        ID3D11Query* disjoint = nullptr;
+        ID3D11Query* start = nullptr;
+        ID3D11Query* end = nullptr;
+        bool pending = false;
+    };
+    QuerySet m_sets[kSets];
+    int      m_next = 0;
+    bool     m_timing = false;
+    uint64_t m_totalNs = 0;
+    uint64_t m_frames = 0;
+};
+static GpuFrameTimer g_gpuTimer;
+
+// What the whole app costs, over the last second: process CPU time (BLE
+// callbacks, pipelines, ViGEm and the UI together), the UI thread's share
+// of it, and the GPU time the UI's frames took.
+struct AppCost {
+    double processCpuPct = 0.0;   // of one core
+    double uiCpuPct = 0.0;
+    double uiFps = 0.0;
+    double gpuMsPerSec = 0.0;
+    double gpuUsPerFrame = 0.0;
+};
+static AppCost g_appCost;
+
+static uint64_t FileTimeNs(const FILETIME& ft) {
+    return ((uint64_t)ft.dwHighDateTime << 32 | ft.dwLowDateTime) * 100;
+}
+
+// UI thread, each time it wakes; publishes a new g_appCost once a second.
+static void SampleAppCost(uint64_t nowNs) {
+    static uint64_t lastNs = 0, lastProcessNs = 0, lastUiNs = 0, lastFrames = 0, lastGpuNs = 0, lastGpuFrames = 0;
+    if (lastNs && nowNs - lastNs < 1'000'000'000) return;
+    FILETIME created, exited, kernel, user;
+    uint64_t processNs = 0, uiNs = 0;
+    if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) processNs = FileTimeNs(kernel) + FileTimeNs(user);
+    if (GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) uiNs = FileTimeNs(kernel) + FileTimeNs(user);
+    if (lastNs) {
+        const double wallNs = (double)(nowNs - lastNs);
+        const uint64_t gpuFrames = g_gpuTimer.Frames() - lastGpuFrames;
+        const uint64_t gpuNs = g_gpuTimer.TotalNs() - lastGpuNs;
+        g_appCost.processCpuPct = (processNs - lastProcessNs) * 100.0 / wallNs;
+        g_appCost.uiCpuPct = (uiNs - lastUiNs) * 100.0 / wallNs;
+        g_appCost.uiFps = (g_redraw.Frames() - lastFrames) * 1e9 / wallNs;
+        g_appCost.gpuMsPerSec = gpuNs * 1e-6 * 1e9 / wallNs;
+        g_appCost.gpuUsPerFrame = gpuFrames ? gpuNs * 1e-3 / gpuFrames : 0.0;
+    }
+    lastNs = nowNs; lastProcessNs = processNs; lastUiNs = uiNs;
+    lastFrames = g_redraw.Frames(); lastGpuNs = g_gpuTimer.TotalNs(); lastGpuFrames = g_gpuTimer.Frames();
+}
 
 static void CreateRTV() {
     ID3D11Texture2D* bb = nullptr;
@@ -1160,6 +1791,8 @@ static void RequestImmediateExit() {
 }
 
 static LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam) {
+    // Every message is the user or the system touching the window.
+    g_redraw.Request();
     if (ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam)) return true;
     switch(msg) {
         case WM_CLOSE:
@@ -1240,9 +1873,48 @@ static void DrawPlayerConfigRow(int i, PlayerConfig& cfg) {
         }
     } else ImGui::TextDisabled("—");
 
+    ImGui::TableSetColumnIndex(6);
+    if (cfg.controllerType != NSOGCController) {
+        const char* ga[] = {"Off","Mouse","Right Stick"};
+        int av = (int)cfg.gyroAim;
+        ImGui::SetNextItemWidth(-1);
+        if (ImGui::Combo("##gyroaim", &av, ga, 3)) cfg.gyroAim = (GyroAimOutput)av;
+    } else ImGui::TextDisabled("—");
+
     ImGui::PopID();
 }
 
+// Shared by both screens, like the gyro aim settings.
+static void DrawChangeFilterSettings() {
+    ImGui::Checkbox("Skip unchanged reports", &g_opts.skipUnchangedReports);
+    ImGui::SameLine(); HelpMarker("Does not send the virtual pad or DSU a report identical to the last one, so an idle controller\n"
+                                  "costs no driver calls. Motion still streams every report wherever it is the gyro output.");
+    if (!g_opts.skipUnchangedReports) return;
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderInt("Keepalive (ms)", &g_opts.keepaliveMs, 10, 1000, "%d", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::SameLine(); HelpMarker("An unchanged report is still sent this often.");
+}
+
+// Shared by both screens; the handlers pick changes up with the next report.
+static void DrawGyroAimSettings() {
+    auto& a = g_opts.gyroAim;
+    ImGui::TextDisabled("Gyro aim (players with Gyro Aim set to Mouse or Right Stick)");
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderFloat("Aim sensitivity", &a.sensitivity, 0.05f, 20.0f, "%.2f", ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+    ImGui::SameLine(); HelpMarker("Mouse: 10 pixels per degree turned at 1.0.\nRight Stick: full deflection at 360 degrees per second at 1.0.");
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderFloat("Aim acceleration", &a.acceleration, 0.0f, 4.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::SameLine(); HelpMarker("Extra sensitivity for fast turns, reaching its full amount at 180 degrees per second.");
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderFloat("Tightening (deg/s)", &a.tighteningDps, 0.0f, 30.0f, "%.1f", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::SameLine(); HelpMarker("Turns slower than this are scaled down toward zero, hiding hand shake without a hard deadzone.");
+    ImGui::SetNextItemWidth(200);
+    ImGui::SliderFloat("Game stick deadzone", &a.stickDeadzone, 0.0f, 0.9f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+    ImGui::SameLine(); HelpMarker("Right Stick only: the game's own inner deadzone. Aim starts just past it so slow turns still register.");
+    ImGui::Checkbox("Invert aim X", &a.invertX);
+    ImGui::SameLine(); ImGui::Checkbox("Invert aim Y", &a.invertY);
+}
+
 static void DrawSetupScreen() {
     ImGuiIO& io = ImGui::GetIO();
     ImGui::SetNextWindowPos({0,0}); ImGui::SetNextWindowSize(io.DisplaySize);
@@ -1256,7 +1928,7 @@ static void DrawSetupScreen() {
 
     if (ImGui::CollapsingHeader("Players", ImGuiTreeNodeFlags_DefaultOpen)) {
         ImGui::Spacing();
-        if (ImGui::BeginTable("players", 6,
+        if (ImGui::BeginTable("players", 7,
             ImGuiTableFlags_Borders|ImGuiTableFlags_RowBg|ImGuiTableFlags_SizingStretchProp)) {
             ImGui::TableSetupColumn("Player",       ImGuiTableColumnFlags_WidthFixed, 60);
             ImGui::TableSetupColumn("Type",         ImGuiTableColumnFlags_WidthStretch, 1.4f);
@@ -1264,6 +1936,7 @@ static void DrawSetupScreen() {
             ImGui::TableSetupColumn("Orientation",  ImGuiTableColumnFlags_WidthStretch, 0.9f);
             ImGui::TableSetupColumn("Gyro Source",  ImGuiTableColumnFlags_WidthStretch, 0.9f);
             ImGui::TableSetupColumn("Gyro Output",  ImGuiTableColumnFlags_WidthStretch, 1.2f);
+            ImGui::TableSetupColumn("Gyro Aim",     ImGuiTableColumnFlags_WidthStretch, 1.1f);
             ImGui::TableHeadersRow();
 
             for (int i = 0; i < (int)g_playerConfigs.size(); ++i)
@@ -1291,12 +1964,48 @@ static void DrawSetupScreen() {
             g_opts.updatePolicy = (UpdatePolicy)pol;
         ImGui::SameLine(); HelpMarker("Low Latency forwards every BLE packet immediately.\nBalanced/Legacy cap the output rate.");
 
+        ImGui::Checkbox("Smooth DSU motion timestamps", &g_opts.smoothMotionClock);
+        ImGui::SameLine(); HelpMarker("Stamps DSU motion with the controller's report cadence instead of raw BLE arrival times,\nso radio jitter does not turn into gyro integration error.");
+
+        ImGui::Checkbox("Use controller's stored calibration", &g_opts.useControllerCalibration);
+        ImGui::SameLine(); HelpMarker("Reads stick and gyro calibration from the controller's flash while connecting.\nTurn off to always use the active calibration profile.");
+
+        ImGui::Checkbox("Connect remembered controllers directly", &g_opts.connectKnownDevices);
+        ImGui::SameLine(); HelpMarker("Opens controllers paired to the same player before by address, without waiting for the sync button.\nControllers that do not answer fall back to scanning.");
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Forget")) { g_deviceRegistry.Clear(); g_persistence.MarkDirty(KNOWN_DEVICES_FILE); AppLog("Forgot remembered controllers"); }
+
+        ImGui::SetNextItemWidth(200);
+        ImGui::SliderFloat("Mouse sensitivity", &g_opts.mouseSensitivity, 0.1f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic | ImGuiSliderFlags_AlwaysClamp);
+        ImGui::SetNextItemWidth(200);
+        ImGui::SliderFloat("Mouse acceleration", &g_opts.mouseAcceleration, 0.0f, 4.0f, "%.2f", ImGuiSliderFlags_AlwaysClamp);
+        ImGui::SameLine(); HelpMarker("Optical mouse mode on a right Joy-Con. Sensitivity scales the pointer at any speed;\nacceleration makes fast swipes go further (at 1, twice as far at 16 sensor counts per report).\nThe FAST / NORMAL / SLOW modes scale on top of this.");
+
+        DrawGyroAimSettings();
+        DrawChangeFilterSettings();
+
+        ImGui::Checkbox("Record raw reports", &g_opts.captureReports);
+        ImGui::SameLine(); HelpMarker("Writes every input report with its arrival time to the captures folder, one file per controller,\nfor replaying decode or latency problems later. Applies to controllers connected afterwards.");
+        if (g_captureRecorder.Running()) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("%zu file(s), %llu reports, %llu dropped", g_captureRecorder.Streams(),
+                (unsigned long long)g_captureRecorder.Written(), (unsigned long long)g_captureRecorder.Dropped());
+        }
+
         ImGui::Checkbox("Record latency metrics to CSV", &g_opts.latencyMetrics);
         if (g_opts.latencyMetrics) {
             ImGui::SetNextItemWidth(300);
             ImGui::InputText("CSV path", g_opts.latencyCsvPath, sizeof(g_opts.latencyCsvPath));
         }
 
+        ImGui::Checkbox("Write the log to a file", &g_opts.logToFile);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Rolls over at 1 MB, keeping the last three files as .1 to .3.");
+        ImGui::BeginDisabled(g_opts.logToFile);   // the path is taken when logging starts
+        ImGui::SetNextItemWidth(300);
+        ImGui::InputText("Log path", g_opts.logFilePath, sizeof(g_opts.logFilePath));
+        ImGui::EndDisabled();
+
         ImGui::Unindent(10);
         ImGui::Spacing();
     }
@@ -1334,7 +2043,7 @@ static void DrawSetupScreen() {
             DeleteCalibrationProfile(0);
             AddCalibrationProfile(def);
             SetActiveCalibrationIndex(0);
-            SaveCalibrationProfiles("calibration.json");
+            SubmitConfigText(CALIBRATION_FILE, SerializeCalibrationProfiles());
         }
         ImGui::Unindent(10);
         ImGui::Spacing();
@@ -1423,9 +2132,13 @@ static void DrawSetupScreen() {
         std::thread([configs = g_playerConfigs]() mutable {
             int taskIdx = 0;
 
+            ClearLiveLinks();
             g_singlePlayers.clear();
             g_dualPlayers.clear();
             g_proPlayers.clear();
+            // Reconnect handlers keep references to players; no reallocation.
+            g_singlePlayers.reserve(configs.size());
+            g_proPlayers.reserve(configs.size());
 
             for (auto* p : g_singleRumbleCtxs) delete p;
             for (auto* p : g_dualRumbleCtxs)   delete p;
@@ -1434,80 +2147,156 @@ static void DrawSetupScreen() {
             g_dualRumbleCtxs.clear();
             g_proRumbleCtxs.clear();
 
+            // Every task scans at once through one shared watcher. Opening, GATT
+            // discovery, subscriptions and the init script run as coroutines on
+            // g_executor, so every device progresses at once without a thread of
+            // its own; ViGEm/DSU attachment below stays sequential in player order.
+            auto session = std::make_shared<ConnectSession>();
+            auto& opens = session->opens;
+            opens.resize(g_connectionTasks.size());
+            {
+                int ti = 0;
+                int pi = 0;
+                auto addOpen = [&](ControllerType type, JoyConSide side, uint16_t pid) {
+                    opens[ti].player = pi; opens[ti].type = type; opens[ti].side = side; opens[ti].productIds = { pid };
+                    opens[ti].future = opens[ti].promise.get_future();
+                    ++ti;
+                };
+                for (auto& pc : configs) {
+                    if (pc.controllerType == SingleJoyCon)
+                        addOpen(SingleJoyCon, pc.joyconSide, pc.joyconSide==JoyConSide::Left ? SWITCH2_PID_JOYCON_L : SWITCH2_PID_JOYCON_R);
+                    else if (pc.controllerType == DualJoyCon) {
+                        addOpen(DualJoyCon, JoyConSide::Right, SWITCH2_PID_JOYCON_R);
+                        addOpen(DualJoyCon, JoyConSide::Left,  SWITCH2_PID_JOYCON_L);
+                    } else if (pc.controllerType == ProController)
+                        addOpen(ProController, JoyConSide::Right, SWITCH2_PID_PRO);
+                    else
+                        addOpen(NSOGCController, JoyConSide::Left, SWITCH2_PID_NSO_GC);
+                    ++pi;
+                }
+            }
+
+            session->discovery = std::make_unique<DiscoveryService>(session->adSource,
+                [weak = std::weak_ptr<ConnectSession>(session)](const PairingRequest& req, const ControllerAdvertisement& ad) {
+                    auto s = weak.lock();
+                    if (!s) return;
+                    char tmp[160];
+                    sprintf_s(tmp, "Found advertisement PID 0x%04X RSSI %d, opening device...", ad.productId, (int)ad.rssi);
+                    SetTaskStatus(req.slot, tmp);
+                    Spawn<bool>(g_executor, OpenSlotAsync(s, req.slot, ad.address, ad.productId, false),
+                        [s, slot = req.slot](std::optional<bool> ok, std::exception_ptr) { s->opens[slot].promise.set_value(ok.value_or(false)); });
+                });
+            session->discovery->SetExecutor(&g_executor);
+            auto& discovery = *session->discovery;
+
+            if (!discovery.Start()) { g_connectionError="BLE scan failed to start"; g_connectionDone=true; return; }
+
+            // Remembered controllers are opened directly, all at once; any that
+            // does not answer falls back to the shared scan.
+            for (int ti = 0; ti < (int)opens.size(); ++ti) {
+                KnownDevice kd;
+                if (g_opts.connectKnownDevices &&
+                    g_deviceRegistry.Find(opens[ti].player, opens[ti].type, opens[ti].side, kd)) {
+                    SetTaskStatus(ti, "Connecting to remembered controller...");
+                    Spawn<bool>(g_executor, OpenSlotAsync(session, ti, kd.address, kd.productId, true),
+                        [session, ti](std::optional<bool> ok, std::exception_ptr) {
+                            auto& op = session->opens[ti];
+                            if (ok.value_or(false) || g_shuttingDown.load()) { op.promise.set_value(ok.value_or(false)); return; }
+                            SetTaskStatus(ti, "Remembered controller not reachable. Scanning... (hold sync button)");
+                            session->discovery->Enqueue(g_connectionTasks[ti].label, op.productIds, ti);
+                        });
+                } else {
+                    SetTaskStatus(ti, "Scanning... (hold sync button)");
+                    discovery.Enqueue(g_connectionTasks[ti].label, opens[ti].productIds, ti);
+                }
+            }
+
+            // Times out only when no controller has made progress for 30s, so a
+            // long list of players is not limited by a fixed per-device budget.
+            auto awaitOpen = [&](int ti) -> bool {
+                auto& fut = opens[ti].future;
+                while (fut.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready) {
+                    if (g_shuttingDown.load()) { SetTaskStatus(ti, "Cancelled"); return false; }
+                    const uint64_t last = session->lastActivityUs.load();
+                    if (SteadyMicros(SteadyClock::now()) > last + 30000000ull) {
+                        SetTaskStatus(ti, "Timed out — device not found");
+                        return false;
+                    }
+                }
+                if (!fut.get()) return false;
+                std::lock_guard<std::mutex> lk(g_connectionMutex);
+                g_connectionTasks[ti].done=true; g_connectionTasks[ti].success=true;
+                return true;
+            };
+
+            auto knownDevice = [&](int ti) {
+                KnownDevice kd;
+                kd.player = opens[ti].player; kd.controllerType = opens[ti].type; kd.side = opens[ti].side;
+                kd.address = opens[ti].address; kd.productId = opens[ti].productId;
+                return kd;
+            };
+            auto dropLog = [](std::string label) { return [label] { AppLog(LogLevel::Warning, -1, "[LINK] " + label + " disconnected, reconnecting in background"); }; };
+
             int dsuSlot = 0;
             for (int pi = 0; pi < (int)configs.size(); ++pi) {
                 auto& pc = configs[pi];
 
                 if (pc.controllerType == SingleJoyCon) {
-                    g_connectionTasks[taskIdx].statusMsg = "Scanning...";
-                    bool ok = false;
-                    auto cj = BleConnect([&](const std::string& s){ g_connectionTasks[taskIdx].statusMsg=s; }, ok, pc.joyconSide);
-                    if (!ok) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
-                    g_connectionTasks[taskIdx].done=true; g_connectionTasks[taskIdx].success=true;
-                    if (cj.rumbleChar) { SendJoyCon2OfficialInit(cj.rumbleChar); }
+                    if (!awaitOpen(taskIdx)) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
+                    auto cj = g_connectionTasks[taskIdx].result;
                     auto t = AddDS4();
-                    g_singlePlayers.push_back({ cj, t, pc.joyconSide, pc.joyconOrientation });
+                    g_singlePlayers.push_back({ std::make_shared<PlayerConnection>(cj), t, pc.joyconSide, pc.joyconOrientation });
                     auto& player = g_singlePlayers.back();
+                    player.gyroAim = pc.gyroAim;
                     if (pc.gyroMode==GyroMode::DsuUdp && g_dsuServer.IsRunning()) g_dsuServer.SetControllerConnected(dsuSlot);
                     AttachSingleJoyConHandler(player, pc.gyroMode, dsuSlot);
-                    cj.inputChar.WriteClientCharacteristicConfigurationDescriptorAsync(GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
 
                     auto* rctx = new SingleRumbleCtx{ cj.vibrationChar, t };
+                    rctx->queue = cj.outbound;
                     g_singleRumbleCtxs.push_back(rctx);
                     StartSingleRumbleThread(rctx);
 
-                    AppLog("Player " + std::to_string(pi+1) + " Single JoyCon connected");
+                    LiveLink link{ SingleJoyCon, g_connectionTasks[taskIdx].label };
+                    link.onDrop = [t, log = dropLog(link.label)] { SendNeutralReport(t); log(); };
+                    link.rebind = [&player, rctx, gm = pc.gyroMode, slot = (uint8_t)dsuSlot](const ConnectedJoyCon& fresh) {
+                        auto old = player.joycon->Rebind(fresh, [&player] { player.mouse.Reset(); });
+                        AttachSingleJoyConHandler(player, gm, slot);
+                        { std::lock_guard<std::mutex> lk(rctx->linkMutex); rctx->vibrationChar = fresh.vibrationChar; rctx->queue = fresh.outbound; }
+                        if (old->outbound) old->outbound->Stop();
+                    };
+                    g_deviceRegistry.Remember(knownDevice(taskIdx));
+                    TrackLiveLink(knownDevice(taskIdx), cj, std::move(link));
+
+                    AppLog(LogLevel::Info, pi, "Single JoyCon connected");
                     ++taskIdx; ++dsuSlot;
 
                 } else if (pc.controllerType == DualJoyCon) {
-                    g_connectionTasks[taskIdx].statusMsg = "Scanning...";
-                    bool okR = false;
-                    auto rjc = BleConnect([&](const std::string& s){ g_connectionTasks[taskIdx].statusMsg=s; }, okR, JoyConSide::Right);
-                    if (!okR) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
-                    g_connectionTasks[taskIdx].done=true; g_connectionTasks[taskIdx].success=true;
-                    if (rjc.rumbleChar) { SendJoyCon2OfficialInit(rjc.rumbleChar); }
+                    if (!awaitOpen(taskIdx)) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
+                    auto rjc = g_connectionTasks[taskIdx].result;
                     ++taskIdx;
 
-                    g_connectionTasks[taskIdx].statusMsg = "Scanning...";
-                    bool okL = false;
-                    auto ljc = BleConnect([&](const std::string& s){ g_connectionTasks[taskIdx].statusMsg=s; }, okL, JoyConSide::Left);
-                    if (!okL) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
-                    g_connectionTasks[taskIdx].done=true; g_connectionTasks[taskIdx].success=true;
-                    if (ljc.rumbleChar) { SendJoyCon2OfficialInit(ljc.rumbleChar); }
+                    if (!awaitOpen(taskIdx)) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
+                    auto ljc = g_connectionTasks[taskIdx].result;
                     ++taskIdx;
 
                     auto dp = std::make_unique<DualJoyConPlayer>();
                     dp->leftJoyCon=ljc; dp->rightJoyCon=rjc;
-                    dp->gyroSource=pc.gyroSource; dp->gyroMode=pc.gyroMode;
+                    dp->gyroSource=pc.gyroSource; dp->gyroMode=pc.gyroMode; dp->gyroAim=pc.gyroAim;
+                    dp->stickCalibration=CombineStickCalibration(ljc,rjc);
                     dp->dsuSlot=dsuSlot;
                     dp->ds4Controller=AddDS4(); dp->running.store(true);
                     dp->sharedState=std::make_shared<DualJoyConSharedState>();
                     if (dp->gyroMode==GyroMode::DsuUdp&&g_dsuServer.IsRunning()) g_dsuServer.SetControllerConnected(dsuSlot);
                     auto ss=dp->sharedState;
-                    ljc.inputChar.ValueChanged([ss](GattCharacteristic const&, GattValueChangedEventArgs const& a){
-                        if (g_shuttingDown.load()) return;
-                        auto now=SteadyClock::now(); auto rdr=DataReader::FromBuffer(a.CharacteristicValue());
-                        std::vector<uint8_t> buf(rdr.UnconsumedBufferLength()); rdr.ReadBytes(buf);
-                        FeedCalibBuffer(buf, true);
-                        std::lock_guard<std::mutex> lk(ss->mutex);
-                        ss->left.bleDeltaMs=MsBetween(ss->lastLeftBleTime,now); ss->lastLeftBleTime=now;
-                        ss->left.buffer=std::move(buf); ss->left.receivedAt=now; ss->left.sequence=++ss->sequence;
-                        ss->cv.notify_one();
-                    });
-                    ljc.inputChar.WriteClientCharacteristicConfigurationDescriptorAsync(GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
-                    rjc.inputChar.ValueChanged([ss](GattCharacteristic const&, GattValueChangedEventArgs const& a){
-                        if (g_shuttingDown.load()) return;
-                        auto now=SteadyClock::now(); auto rdr=DataReader::FromBuffer(a.CharacteristicValue());
-                        std::vector<uint8_t> buf(rdr.UnconsumedBufferLength()); rdr.ReadBytes(buf);
-                        FeedCalibBuffer(buf, false);
-                        std::lock_guard<std::mutex> lk(ss->mutex);
-                        ss->right.bleDeltaMs=MsBetween(ss->lastRightBleTime,now); ss->lastRightBleTime=now;
-                        ss->right.buffer=std::move(buf); ss->right.receivedAt=now; ss->right.sequence=++ss->sequence;
-                        ss->cv.notify_one();
-                    });
-                    rjc.inputChar.WriteClientCharacteristicConfigurationDescriptorAsync(GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
+                    AttachDualSideHandler(ss, ljc, true);
+                    AttachDualSideHandler(ss, rjc, false);
                     dp->updateThread=std::thread([dpptr=dp.get(),ss](){
                         uint64_t lastSeq=0;
+                        LivePipeline pipe;
+                        pipe.pipeline.Config().controllerType=DualJoyCon;
+                        pipe.pipeline.Config().gyroSource=dpptr->gyroSource;
+                        pipe.pipeline.Config().decodeMotion=dpptr->gyroMode==GyroMode::DsuUdp;
+                        pipe.pipeline.Config().aimOutput=dpptr->gyroAim;
                         while (dpptr->running.load(std::memory_order_acquire) && !g_shuttingDown.load()) {
                             TimedInputBuffer ls,rs;
                             {
@@ -1515,92 +2304,165 @@ static void DrawSetupScreen() {
                                 ss->cv.wait_for(lk,std::chrono::milliseconds(1),[&]{ return !dpptr->running.load()||ss->sequence!=lastSeq; });
                                 if (!dpptr->running.load()) break;
                                 if (ss->left.buffer.empty()||ss->right.buffer.empty()||ss->sequence==lastSeq) continue;
-                                auto now=SteadyClock::now();
-                                if (!ShouldEmit(g_opts.updatePolicy,ss->lastEmitTime,now)){lastSeq=ss->sequence;continue;}
                                 ls=ss->left; rs=ss->right; lastSeq=ss->sequence;
+                                // A step over one is a half overwritten before this thread took it.
+                                dpptr->telemetry->RecordReport(SteadyNanos(std::max(ls.receivedAt,rs.receivedAt)),(uint32_t)lastSeq);
+                                // A reconnect swaps the Joy-Cons under this lock.
+                                auto& pc=pipe.pipeline.Config();
+                                pc.motionScale=dpptr->leftJoyCon.motionScale; pc.rightMotionScale=dpptr->rightJoyCon.motionScale;
+                                pc.calibration=dpptr->stickCalibration;
                             }
-                            auto report=GenerateDualJoyConDS4Report(ls.buffer,rs.buffer,dpptr->gyroSource);
-                            if (dpptr->gyroMode==GyroMode::DsuUdp&&g_dsuServer.IsRunning()) {
-                                g_dsuServer.UpdateController(dpptr->dsuSlot,report);
-                            }
-                            if (g_shuttingDown.load() || !g_vigem || !dpptr->ds4Controller) break;
-                            vigem_target_ds4_update_ex(g_vigem,dpptr->ds4Controller,report);
+                            SyncPipeline(pipe);
+                            PipelineOutput out;
+                            const uint64_t ds=SteadyNanos(SteadyClock::now());
+                            if (!pipe.pipeline.ProcessDual(ls.buffer,ls.sampleTimeUs,rs.buffer,rs.sampleTimeUs,ds,out)) { dpptr->telemetry->RecordHeld(); continue; }
+                            const uint64_t de=SteadyNanos(SteadyClock::now());
+                            SendAimMouse(out);
+                            const bool dsu=dpptr->gyroMode==GyroMode::DsuUdp;
+                            if (!SubmitOutput(pipe,out,dpptr->ds4Controller,!dsu,dsu?dpptr->dsuSlot:-1,*dpptr->telemetry)) break;
+                            dpptr->telemetry->RecordOutput(out,de-ds,SteadyNanos(SteadyClock::now())-de);
                         }
                     });
 
                     auto* rctx = new DualRumbleCtx{ ljc.vibrationChar, rjc.vibrationChar, dp->ds4Controller };
+                    rctx->leftQueue = ljc.outbound; rctx->rightQueue = rjc.outbound;
                     g_dualRumbleCtxs.push_back(rctx);
                     StartDualRumbleThread(rctx);
 
+                    // Each half reconnects on its own; the other keeps its buffer,
+                    // but no report goes out until both halves are live again.
+                    for (int half = 0; half < 2; ++half) {
+                        const bool isLeft = half == 0;
+                        const int ti = isLeft ? taskIdx-1 : taskIdx-2;
+                        LiveLink link{ DualJoyCon, g_connectionTasks[ti].label };
+                        link.onDrop = [ss, tgt = dp->ds4Controller, isLeft, log = dropLog(link.label)] {
+                            { std::lock_guard<std::mutex> lk(ss->mutex); (isLeft ? ss->left : ss->right).buffer.clear(); }
+                            SendNeutralReport(tgt); log();
+                        };
+                        link.rebind = [dpptr = dp.get(), ss, rctx, isLeft](const ConnectedJoyCon& fresh) {
+                            std::shared_ptr<CommandQueue> old;
+                            {
+                                std::lock_guard<std::mutex> lk(ss->mutex);
+                                auto& jc = isLeft ? dpptr->leftJoyCon : dpptr->rightJoyCon;
+                                old = jc.outbound; jc = fresh;
+                                dpptr->stickCalibration = CombineStickCalibration(dpptr->leftJoyCon, dpptr->rightJoyCon);
+                            }
+                            AttachDualSideHandler(ss, fresh, isLeft);
+                            {
+                                std::lock_guard<std::mutex> lk(rctx->linkMutex);
+                                (isLeft ? rctx->leftVibration : rctx->rightVibration) = fresh.vibrationChar;
+                                (isLeft ? rctx->leftQueue : rctx->rightQueue) = fresh.outbound;
+                            }
+                            if (old) old->Stop();
+                        };
+                        g_deviceRegistry.Remember(knownDevice(ti));
+                        TrackLiveLink(knownDevice(ti), isLeft ? ljc : rjc, std::move(link));
+                    }
+
                     g_dualPlayers.push_back(std::move(dp));
-                    AppLog("Player " + std::to_string(pi+1) + " Dual JoyCon connected");
+                    AppLog(LogLevel::Info, pi, "Dual JoyCon connected");
                     ++dsuSlot;
 
                 } else if (pc.controllerType == ProController) {
-                    g_connectionTasks[taskIdx].statusMsg = "Scanning...";
-                    bool ok = false;
-                    auto cj = BleConnect([&](const std::string& s){ g_connectionTasks[taskIdx].statusMsg=s; }, ok, JoyConSide::Right);
-                    if (!ok) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
-                    g_connectionTasks[taskIdx].done=true; g_connectionTasks[taskIdx].success=true;
-                    if (cj.rumbleChar) { SendProCon2OfficialInit(cj.rumbleChar); }
+                    if (!awaitOpen(taskIdx)) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
+                    auto cj = g_connectionTasks[taskIdx].result;
                     auto tgt=AddDS4();
                     auto latPtr=std::make_shared<LatencyTracker>();
-                    auto gm=pc.gyroMode; uint8_t ds=(uint8_t)dsuSlot;
-                    cj.inputChar.ValueChanged([tgt,gm,ds,latPtr](GattCharacteristic const&, GattValueChangedEventArgs const& a) mutable {
-                        if (g_shuttingDown.load()) return;
-                        auto now=SteadyClock::now(); auto rdr=DataReader::FromBuffer(a.CharacteristicValue());
-                        std::vector<uint8_t> buf(rdr.UnconsumedBufferLength()); rdr.ReadBytes(buf);
-                        FeedCalibBuffer(buf, g_calib.isLeft);
-                        double bd=MsBetween(latPtr->lastBleTime,now); latPtr->lastBleTime=now;
-                        if (!ShouldEmit(g_opts.updatePolicy,latPtr->lastEmitTime,SteadyClock::now())) return;
-                        DS4_REPORT_EX report=GenerateProControllerReport(buf);
-                        ApplyGLGR(report,buf); HandleSpecialProButtons(buf);
-                        if (gm==GyroMode::DsuUdp&&g_dsuServer.IsRunning()) {
-                            ApplyGLGR(report,buf); g_dsuServer.UpdateController(ds,report);
-                        }
-                        if (g_shuttingDown.load() || !g_vigem || !tgt) return;
-                        if (g_shuttingDown.load() || !g_vigem || !tgt) return;
-                        vigem_target_ds4_update_ex(g_vigem,tgt,report);
-                    });
-                    cj.inputChar.WriteClientCharacteristicConfigurationDescriptorAsync(GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
+                    auto tel=std::make_shared<PlayerTelemetry>();
+                    auto gm=pc.gyroMode; auto aim=pc.gyroAim; uint8_t ds=(uint8_t)dsuSlot;
+                    auto conn=std::make_shared<PlayerConnection>(cj);
+                    auto attach=[tgt,gm,aim,ds,latPtr,tel,conn](const ConnectedJoyCon& c){
+                        auto cap=c.capture; auto pipe=MakeLivePipeline(ProController,c,gm==GyroMode::DsuUdp,aim);
+                        c.inputChar.ValueChanged([tgt,gm,ds,cap,latPtr,tel,pipe,conn,version=conn->Version()](GattCharacteristic const&, GattValueChangedEventArgs const& a) mutable {
+                            if (g_shuttingDown.load()) return;
+                            const auto live=conn->Enter(version);
+                            if (!live.owns_lock()) return;
+                            auto now=SteadyClock::now(); auto rdr=DataReader::FromBuffer(a.CharacteristicValue());
+                            std::vector<uint8_t> buf(rdr.UnconsumedBufferLength()); rdr.ReadBytes(buf);
+                            CaptureReport(cap,buf,now);
+                            FeedCalibBuffer(buf, g_calib.isLeft);
+                            double bd=MsBetween(latPtr->lastBleTime,now); latPtr->lastBleTime=now;
+                            tel->RecordReport(SteadyNanos(now),ExtractReportCounter(buf));
+                            SyncPipeline(*pipe); PipelineOutput out;
+                            const auto dstart=SteadyClock::now();
+                            if (!pipe->pipeline.Process(buf,SteadyNanos(now),out)) { tel->RecordHeld(); return; }
+                            const auto dend=SteadyClock::now();
+                            SendAimMouse(out);
+                            HandleSpecialProButtons(buf);
+                            if (!SubmitOutput(*pipe,out,tgt,gm==GyroMode::Raw,gm==GyroMode::DsuUdp?ds:-1,*tel)) return;
+                            tel->RecordOutput(out,SteadyNanos(dend)-SteadyNanos(dstart),SteadyNanos(SteadyClock::now())-SteadyNanos(dend));
+                        });
+                    };
+                    attach(cj);
                     if (pc.gyroMode==GyroMode::DsuUdp&&g_dsuServer.IsRunning()) g_dsuServer.SetControllerConnected(dsuSlot);
 
                     auto* rctx = new SingleRumbleCtx{ cj.rumbleChar, tgt, nullptr, RumbleMode::Pro };
+                    rctx->queue = cj.outbound;
                     g_proRumbleCtxs.push_back(rctx);
                     StartSingleRumbleThread(rctx);
 
-                    g_proPlayers.push_back({cj,tgt});
-                    AppLog("Player " + std::to_string(pi+1) + " Pro Controller connected");
+                    g_proPlayers.push_back({conn,tgt,{},tel});
+                    LiveLink link{ ProController, g_connectionTasks[taskIdx].label };
+                    link.onDrop = [tgt, log = dropLog(link.label)] { SendNeutralReport(tgt); log(); };
+                    link.rebind = [attach, rctx, conn](const ConnectedJoyCon& fresh) {
+                        auto old = conn->Rebind(fresh, [] {});
+                        attach(fresh);
+                        { std::lock_guard<std::mutex> lk(rctx->linkMutex); rctx->vibrationChar = fresh.rumbleChar; rctx->queue = fresh.outbound; }
+                        if (old->outbound) old->outbound->Stop();
+                    };
+                    g_deviceRegistry.Remember(knownDevice(taskIdx));
+                    TrackLiveLink(knownDevice(taskIdx), cj, std::move(link));
+                    AppLog(LogLevel::Info, pi, "Pro Controller connected");
                     ++taskIdx; ++dsuSlot;
 
                 } else {
-                    g_connectionTasks[taskIdx].statusMsg = "Scanning...";
-                    bool ok = false;
-                    auto cj = BleConnect([&](const std::string& s){ g_connectionTasks[taskIdx].statusMsg=s; }, ok);
-                    if (!ok) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
-                    g_connectionTasks[taskIdx].done=true; g_connectionTasks[taskIdx].success=true;
-                    if (cj.rumbleChar) { SendNSOGCOfficialInit(cj.rumbleChar); }
+                    if (!awaitOpen(taskIdx)) { g_connectionError="Failed: "+g_connectionTasks[taskIdx].label; g_connectionDone=true; return; }
+                    auto cj = g_connectionTasks[taskIdx].result;
                     auto tgt=AddDS4();
-                    cj.inputChar.ValueChanged([tgt](GattCharacteristic const&, GattValueChangedEventArgs const& a) mutable {
-                        if (g_shuttingDown.load()) return;
-                        auto rdr=DataReader::FromBuffer(a.CharacteristicValue());
-                        std::vector<uint8_t> buf(rdr.UnconsumedBufferLength()); rdr.ReadBytes(buf);
-                        DS4_REPORT_EX report=GenerateNSOGCReport(buf);
-                        if (g_shuttingDown.load() || !g_vigem || !tgt) return;
-                        if (g_shuttingDown.load() || !g_vigem || !tgt) return;
-                        vigem_target_ds4_update_ex(g_vigem,tgt,report);
-                    });
-                    cj.inputChar.WriteClientCharacteristicConfigurationDescriptorAsync(GattClientCharacteristicConfigurationDescriptorValue::Notify).get();
+                    auto tel=std::make_shared<PlayerTelemetry>();
+                    auto conn=std::make_shared<PlayerConnection>(cj);
+                    auto attach=[tgt,tel,conn](const ConnectedJoyCon& c){
+                        auto cap=c.capture; auto pipe=MakeLivePipeline(NSOGCController,c,false);
+                        c.inputChar.ValueChanged([tgt,cap,tel,pipe,conn,version=conn->Version()](GattCharacteristic const&, GattValueChangedEventArgs const& a) mutable {
+                            if (g_shuttingDown.load()) return;
+                            const auto live=conn->Enter(version);
+                            if (!live.owns_lock()) return;
+                            auto now=SteadyClock::now(); auto rdr=DataReader::FromBuffer(a.CharacteristicValue());
+                            std::vector<uint8_t> buf(rdr.UnconsumedBufferLength()); rdr.ReadBytes(buf);
+                            CaptureReport(cap,buf,now);
+                            tel->RecordReport(SteadyNanos(now),ExtractReportCounter(buf));
+                            SyncPipeline(*pipe); PipelineOutput out;
+                            const auto dstart=SteadyClock::now();
+                            if (!pipe->pipeline.Process(buf,SteadyNanos(now),out)) { tel->RecordHeld(); return; }
+                            const auto dend=SteadyClock::now();
+                            if (!SubmitOutput(*pipe,out,tgt,false,-1,*tel)) return;
+                            tel->RecordOutput(out,SteadyNanos(dend)-SteadyNanos(dstart),SteadyNanos(SteadyClock::now())-SteadyNanos(dend));
+                        });
+                    };
+                    attach(cj);
 
                     auto* rctx = new SingleRumbleCtx{ cj.vibrationChar, tgt, nullptr, RumbleMode::GC };
+                    rctx->queue = cj.outbound;
                     g_proRumbleCtxs.push_back(rctx);
                     StartSingleRumbleThread(rctx);
 
-                    g_proPlayers.push_back({cj,tgt});
-                    AppLog("Player " + std::to_string(pi+1) + " NSO GC connected");
+                    g_proPlayers.push_back({conn,tgt,{},tel});
+                    LiveLink link{ NSOGCController, g_connectionTasks[taskIdx].label };
+                    link.onDrop = [tgt, log = dropLog(link.label)] { SendNeutralReport(tgt); log(); };
+                    link.rebind = [attach, rctx, conn](const ConnectedJoyCon& fresh) {
+                        auto old = conn->Rebind(fresh, [] {});
+                        attach(fresh);
+                        { std::lock_guard<std::mutex> lk(rctx->linkMutex); rctx->vibrationChar = fresh.vibrationChar; rctx->queue = fresh.outbound; }
+                        if (old->outbound) old->outbound->Stop();
+                    };
+                    g_deviceRegistry.Remember(knownDevice(taskIdx));
+                    TrackLiveLink(knownDevice(taskIdx), cj, std::move(link));
+                    AppLog(LogLevel::Info, pi, "NSO GC connected");
                     ++taskIdx; ++dsuSlot;
                 }
             }
+            discovery.Stop();
+            g_persistence.MarkDirty(KNOWN_DEVICES_FILE);
             g_connectionDone = true;
         }).detach();
     }
@@ -1624,15 +2486,15 @@ static void DrawConnectingScreen() {
         ImGui::Spacing();
         if (ImGui::Button("Back to Setup")) { g_connectionError=""; g_screen=AppScreen::Setup; }
     } else {
+        static float spin = 0.f; spin += ImGui::GetIO().DeltaTime * 3.f;
+        const char* spinners[] = {"|","/","-","\\"};
+        std::lock_guard<std::mutex> lk(g_connectionMutex);
         for (auto& t : g_connectionTasks) {
             if (t.done) {
                 ImGui::TextColored({0.3f,1.f,0.3f,1.f}, "[OK] %s", t.label.c_str());
             } else {
-                static float spin = 0.f; spin += ImGui::GetIO().DeltaTime * 3.f;
-                const char* spinners[] = {"|","/","-","\\"};
                 ImGui::TextColored({1.f,0.8f,0.2f,1.f}, "[%s] %s — %s",
                     spinners[(int)(spin)%4], t.label.c_str(), t.statusMsg.c_str());
-                break;
             }
         }
 
@@ -1708,7 +2570,7 @@ static void DrawCalibWizard() {
             if (ImGui::Button("Apply", {100,32})) {
                 if (g_calib.minX >= g_calib.maxX || g_calib.minY >= g_calib.maxY
                     || g_calib.captureFrames < 10) {
-                    AppLog("Calibration failed: rotate the stick fully before applying.");
+                    AppLog(LogLevel::Warning, -1, "Calibration failed: rotate the stick fully before applying.");
                     g_calib.step = 1;
                 } else {
                     CalibrationProfile updated = GetActiveCalibration();
@@ -1720,7 +2582,7 @@ static void DrawCalibWizard() {
                     DeleteCalibrationProfile(idx);
                     AddCalibrationProfile(updated);
                     SetActiveCalibrationIndex((int)GetCalibrationProfiles().size()-1);
-                    SaveCalibrationProfiles("calibration.json");
+                    SubmitConfigText(CALIBRATION_FILE, SerializeCalibrationProfiles());
                     AppLog(std::string("Calibration applied for ") + stickName);
                     g_calib.active = false;
                 }
@@ -1784,6 +2646,49 @@ static void DrawLayoutManager() {
     }
 }
 
+// One player's telemetry, read without locks. The copies the plots draw
+// from are refreshed 4 times a second however often the window redraws.
+static void DrawPlayerTelemetry(int index, const char* label, const PlayerTelemetry* t, TelemetryView& v) {
+    if (!t) return;
+    const uint64_t now = SteadyNanos(SteadyClock::now());
+    if (!v.readNs || now - v.readNs >= 250'000'000) {
+        v.snap = t->Snapshot();
+        for (size_t i = 0; i < v.traces.size(); ++i) {
+            v.traces[i].resize(PlayerTelemetry::kTraceLength);
+            v.traces[i].resize(t->CopyTrace((TelemetryTrace)i, v.traces[i].data()));
+        }
+        v.readNs = now;
+    }
+
+    ImGui::PushID(index);
+    if (ImGui::TreeNode("##player", "Player %d: %s", index, label)) {
+        const TelemetrySnapshot& s = v.snap;
+        if (!s.windowEndNs || now - s.windowEndNs > 2'000'000'000)
+            ImGui::TextColored({1.f,0.6f,0.2f,1.f}, "No reports");
+        ImGui::Text("Rate %.1f Hz   interval %.2f ms  jitter %.2f ms  max %.2f ms", s.rateHz, s.intervalMs, s.jitterMs, s.intervalMaxMs);
+        ImGui::Text("Decode %.1f us (max %.1f)   submit %.1f us (max %.1f)", s.decodeUs, s.decodeMaxUs, s.submitUs, s.submitMaxUs);
+        ImGui::Text("Reports %llu  submitted %llu  held %llu  lost %llu",
+            (unsigned long long)s.reports, (unsigned long long)s.submitted, (unsigned long long)s.held, (unsigned long long)s.lost);
+        ImGui::SameLine(); HelpMarker("Held: kept back by the update policy. Lost: gaps in the controller's report counter;\n"
+                                      "for a dual pair, a half's report replaced by the next before it was sent.");
+        ImGui::Text("Unchanged, not sent: ViGEm %llu  DSU %llu", (unsigned long long)s.vigemSkipped, (unsigned long long)s.dsuSkipped);
+        const float w = ImGui::GetContentRegionAvail().x;
+        auto plot = [&](TelemetryTrace trace, float lo, float hi) {
+            const auto& d = v.traces[(size_t)trace];
+            ImGui::PlotLines(TelemetryTraceName(trace), d.data(), (int)d.size(), 0, nullptr, lo, hi, {w * 0.6f, 40});
+        };
+        plot(TelemetryTrace::IntervalMs, 0.f, FLT_MAX);
+        plot(TelemetryTrace::DecodeUs, 0.f, FLT_MAX);
+        plot(TelemetryTrace::SubmitUs, 0.f, FLT_MAX);
+        for (auto tr : {TelemetryTrace::LeftX, TelemetryTrace::LeftY, TelemetryTrace::RightX, TelemetryTrace::RightY})
+            plot(tr, -1.f, 1.f);
+        if (!v.traces[(size_t)TelemetryTrace::GyroX].empty())
+            for (auto tr : {TelemetryTrace::GyroX, TelemetryTrace::GyroY, TelemetryTrace::GyroZ}) plot(tr, FLT_MAX, FLT_MAX);
+        ImGui::TreePop();
+    }
+    ImGui::PopID();
+}
+
 static void DrawRunningScreen() {
     ImGuiIO& io = ImGui::GetIO();
     ImGui::SetNextWindowPos({0,0}); ImGui::SetNextWindowSize(io.DisplaySize);
@@ -1867,41 +2772,53 @@ static void DrawRunningScreen() {
         ImGui::SetNextItemWidth(200);
         if (ImGui::Combo("Update Policy##run",&pol,policies,3))
             g_opts.updatePolicy=(UpdatePolicy)pol;
+        DrawGyroAimSettings();
+        DrawChangeFilterSettings();
         ImGui::Unindent(10); ImGui::Spacing();
     }
 
-    if (ImGui::CollapsingHeader("Log", ImGuiTreeNodeFlags_DefaultOpen))
-    {
-        static std::string logBuffer;
-        static size_t lastLogCount = 0;
-    
-        if (lastLogCount != g_logLines.size())
-        {
-            std::lock_guard<std::mutex> lk(g_logMutex);
-    
-            logBuffer.clear();
-    
-            for (auto& line : g_logLines)
-            {
-                logBuffer += line;
-                logBuffer += "\r\n";
-            }
-    
-            lastLogCount = g_logLines.size();
+    if (ImGui::CollapsingHeader("Telemetry")) {
+        ImGui::Indent(10);
+        const AppCost& c = g_appCost;
+        ImGui::Text("App CPU: %.1f%% of one core  (UI thread %.1f%%)", c.processCpuPct, c.uiCpuPct);
+        ImGui::Text("UI GPU:  %.2f ms/s  (%.0f us/frame)", c.gpuMsPerSec, c.gpuUsPerFrame);
+        ImGui::Text("UI frames: %.1f/s", c.uiFps);
+        ImGui::SameLine(); HelpMarker("The window redraws on input and new log lines, and otherwise 4 times a second\n"
+                                      "for these numbers. Minimized or hidden, it does not draw at all.");
+        ImGui::Spacing();
+        int n = 0;
+        for (auto& p : g_singlePlayers)
+            DrawPlayerTelemetry(++n, p.side==JoyConSide::Left ? "Single JoyCon (Left)" : "Single JoyCon (Right)", p.telemetry.get(), p.telemetryView);
+        for (auto& p : g_dualPlayers) if (p) DrawPlayerTelemetry(++n, "Dual JoyCon pair", p->telemetry.get(), p->telemetryView);
+        for (auto& p : g_proPlayers) DrawPlayerTelemetry(++n, "Pro / NSO GC Controller", p.telemetry.get(), p.telemetryView);
+        ImGui::Unindent(10); ImGui::Spacing();
+    }
+
+    if (ImGui::CollapsingHeader("Log", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (ImGui::Button("Copy Log")) ImGui::SetClipboardText(g_logHistory.Joined("\r\n").c_str());
+        if (uint64_t dropped = g_logRing.Dropped()) {
+            ImGui::SameLine(); ImGui::TextDisabled("%llu messages dropped", (unsigned long long)dropped);
         }
-    
-        if (ImGui::Button("Copy Log"))
-        {
-            ImGui::SetClipboardText(logBuffer.c_str());
+        // Only the visible lines are laid out; the view follows new lines
+        // unless scrolled up.
+        static uint64_t lastAppended = 0;
+        ImGui::BeginChild("##log", ImVec2(-FLT_MIN, 150), ImGuiChildFlags_Borders, ImGuiWindowFlags_HorizontalScrollbar);
+        const bool follow = ImGui::GetScrollY() >= ImGui::GetScrollMaxY() - 1.f;
+        ImGuiListClipper clipper;
+        clipper.Begin((int)g_logHistory.Size());
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+                const std::string& line = g_logHistory.Line(i);
+                const LogLevel level = g_logHistory.Level(i);
+                if (level >= LogLevel::Warning)
+                    ImGui::PushStyleColor(ImGuiCol_Text, level == LogLevel::Error ? ImVec4(1.f,0.4f,0.4f,1.f) : ImVec4(1.f,0.8f,0.3f,1.f));
+                ImGui::TextUnformatted(line.data(), line.data() + line.size());
+                if (level >= LogLevel::Warning) ImGui::PopStyleColor();
+            }
         }
-    
-        ImGui::InputTextMultiline(
-            "##log",
-            logBuffer.data(),
-            logBuffer.capacity() + 1,
-            ImVec2(-FLT_MIN, 150),
-            ImGuiInputTextFlags_ReadOnly
-        );
+        if (follow && lastAppended != g_logHistory.Appended()) ImGui::SetScrollHereY(1.f);
+        lastAppended = g_logHistory.Appended();
+        ImGui::EndChild();
     }
 
     if (g_openLayoutManager.load()) { g_openLayoutManager.store(false); g_showLayoutManager=true; }
@@ -1915,9 +2832,36 @@ static void DrawRunningScreen() {
 int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
     init_apartment();
     LoadProConfig();
-    LoadCalibrationProfiles("calibration.json");
-
-    if (g_playerConfigs.empty()) g_playerConfigs.push_back({});
+    g_gattCache.Load();
+    g_flashCalibCache.Load();
+    g_deviceRegistry.Load();
+    g_persistence.Register(GATT_CACHE_FILE, [] { return g_gattCache.Serialize(); });
+    g_persistence.Register(FLASH_CALIB_FILE, [] { return g_flashCalibCache.Serialize(); });
+    g_persistence.Register(KNOWN_DEVICES_FILE, [] { return g_deviceRegistry.Serialize(); });
+    g_persistence.Start();
+    g_executor.Start();
+    g_reconnect = std::make_unique<ReconnectSupervisor>(g_reconnectTransport);
+    g_reconnect->OnEvent([](int link, LinkState state, uint32_t attempts) {
+        std::string label;
+        {
+            std::lock_guard<std::mutex> lk(g_liveLinksMutex);
+            auto it = g_liveLinks.find(link);
+            if (it == g_liveLinks.end()) return;
+            label = it->second.label;
+        }
+        if (state == LinkState::Connected)
+            AppLog("[LINK] " + label + " reconnected after " + std::to_string(attempts) + " attempt(s)");
+    });
+    LoadCalibrationProfiles(CALIBRATION_FILE);
+    PublishLiveSettings();
+    // Hand edits to either file apply while running; see ReloadChangedConfig.
+    if (!g_configWatcher.Start(".", [](const std::vector<std::string>& names) {
+            for (auto& n : names) {
+                if (n == CONFIG_FILE) g_configChanged.store(true);
+                else if (n == CALIBRATION_FILE) g_calibrationChanged.store(true);
+            }
+        }))
+        AppLog("[CONFIG] Cannot watch the config files; edits need a restart");
 
     WNDCLASSEXW wc{sizeof(WNDCLASSEXW), CS_CLASSDC, WndProc, 0L, 0L, hInst,
                    nullptr, nullptr, nullptr, nullptr, L"joycon2cpp", nullptr};
@@ -1947,6 +2891,11 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
     ImGui_ImplWin32_Init(g_hwnd);
     ImGui_ImplDX11_Init(g_pd3dDevice, g_pd3dDeviceContext);
 
+    g_uiWake = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    if (!g_gpuTimer.Init(g_pd3dDevice)) AppLog("[UI] GPU timing unavailable");
+
+    // Frames are drawn only when g_redraw says so; in between the thread
+    // sleeps until a message, a log line or the screen's refresh interval.
     bool done = false;
     while (!done) {
         MSG msg;
@@ -1956,25 +2905,67 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
         }
         if (done) break;
 
-        ImGui_ImplDX11_NewFrame();
-        ImGui_ImplWin32_NewFrame();
-        ImGui::NewFrame();
-
-        switch (g_screen) {
-            case AppScreen::Setup:      DrawSetupScreen();      break;
-            case AppScreen::Connecting: DrawConnectingScreen(); break;
-            case AppScreen::Running:    DrawRunningScreen();    break;
+        g_uiWakePending.store(false, std::memory_order_release);
+        if (DrainLog()) g_redraw.Request();
+        // An occluded swap chain is probed, not presented to, until it shows again.
+        if (g_swapChainOccluded && g_pSwapChain->Present(0, DXGI_PRESENT_TEST) != DXGI_STATUS_OCCLUDED)
+            g_swapChainOccluded = false;
+        g_redraw.SetVisible(!IsIconic(g_hwnd) && !g_swapChainOccluded);
+        g_redraw.SetRefreshInterval(RefreshIntervalNs(g_screen));
+        const uint64_t frameNs = SteadyNanos(SteadyClock::now());
+        const bool draw = g_redraw.Due(frameNs);
+
+        if (draw) {
+            ImGui_ImplDX11_NewFrame();
+            ImGui_ImplWin32_NewFrame();
+            ImGui::NewFrame();
+
+            switch (g_screen) {
+                case AppScreen::Setup:      DrawSetupScreen();      break;
+                case AppScreen::Connecting: DrawConnectingScreen(); break;
+                case AppScreen::Running:    DrawRunningScreen();    break;
+            }
         }
-
-        ImGui::Render();
-        const float cc[4] = {0.06f,0.06f,0.08f,1.f};
-        g_pd3dDeviceContext->OMSetRenderTargets(1, &g_mainRTV, nullptr);
-        g_pd3dDeviceContext->ClearRenderTargetView(g_mainRTV, cc);
-        ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
-        g_pSwapChain->Present(1, 0);
+        if (int n = g_layoutCycleRequests.exchange(0); n > 0 && !g_proConfig.layouts.empty()) {
+            g_proConfig.activeLayoutIndex = (g_proConfig.activeLayoutIndex + n) % (int)g_proConfig.layouts.size();
+            AppLog(std::string("Layout -> ") + g_proConfig.layouts[g_proConfig.activeLayoutIndex].name);
+            SaveProConfig();
+        }
+        ReloadChangedConfig();
+        SaveProConfigIfChanged();
+        PublishLiveSettings();
+
+        if (draw) {
+            // A drag, an open text field or the live calibration readout
+            // keeps drawing every frame until it is let go.
+            if (ImGui::IsAnyItemActive() || g_calib.active) g_redraw.Request(1);
+            ImGui::Render();
+            const float cc[4] = {0.06f,0.06f,0.08f,1.f};
+            g_gpuTimer.Begin(g_pd3dDeviceContext);
+            g_pd3dDeviceContext->OMSetRenderTargets(1, &g_mainRTV, nullptr);
+            g_pd3dDeviceContext->ClearRenderTargetView(g_mainRTV, cc);
+            ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
+            g_gpuTimer.End(g_pd3dDeviceContext);
+            g_swapChainOccluded = g_pSwapChain->Present(1, 0) == DXGI_STATUS_OCCLUDED;
+            g_redraw.Drawn(frameNs);
+        }
+        g_gpuTimer.Collect(g_pd3dDeviceContext);
+        const uint64_t nowNs = SteadyNanos(SteadyClock::now());
+        SampleAppCost(nowNs);
+        MsgWaitForMultipleObjectsEx(1, &g_uiWake, g_redraw.WaitMs(nowNs), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
     }
+    g_gpuTimer.Release();
 
     g_shuttingDown.store(true);
+    // Reconnect workers wait on opens running on the executor, so the
+    // executor has to outlive them.
+    if (g_reconnect) g_reconnect->Stop();
+    g_executor.Stop();
+    g_captureRecorder.Stop();
+    g_configWatcher.Stop();
+    g_persistence.Stop();   // writes whatever is still pending
+    DrainLog();
+    g_logFile.Close();
 
     for (auto* p : g_singleRumbleCtxs) if (p) p->running.store(false);
     for (auto* p : g_dualRumbleCtxs)   if (p) p->running.store(false);
@@ -1991,6 +2982,11 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE, LPSTR, int) {
     g_dualRumbleCtxs.clear();
     g_proRumbleCtxs.clear();
 
+    auto stopQueue = [](const ConnectedJoyCon& cj) { if (cj.outbound) cj.outbound->Stop(); };
+    for (auto& sp : g_singlePlayers) stopQueue(*sp.joycon->Current());
+    for (auto& dp : g_dualPlayers)   if (dp) { stopQueue(dp->leftJoyCon); stopQueue(dp->rightJoyCon); }
+    for (auto& pp : g_proPlayers)    stopQueue(*pp.controller->Current());
+
     for (auto& dp : g_dualPlayers) {
         if (!dp) continue;
         dp->running.store(false);
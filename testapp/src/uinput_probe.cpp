@@ -0,0 +1,423 @@
+// Writes reports through the uinput sinks and reads them back from the
+// evdev nodes they create: first checks that every key, absolute and
+// relative value a report sets comes back as sent, then checks that every
+// report arrives and measures how long the kernel takes to hand it over.
+// Linux only; needs write access to /dev/uinput and read access to
+// /dev/input/event*. Exits 77 (skipped, for ctest) when it has neither.
+
+#include "UinputSink.h"
+
+#include <linux/input.h>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr int kSkipped = 77;   // ctest's SKIP_RETURN_CODE
+
+struct Options {
+    int count = 1000;
+    double rateHz = 250.0;
+    std::string device = "gamepad";
+    int timeoutMs = 100;
+};
+
+volatile std::sig_atomic_t g_cancel = 0;
+
+void OnSignal(int)
+{
+    g_cancel = 1;
+}
+
+void PrintUsage()
+{
+    std::printf(
+        "usage: uinput_probe [options]\n"
+        "  --device DEV         gamepad or mouse (default gamepad)\n"
+        "  --count N            reports to write (default 1000)\n"
+        "  --rate HZ            reports per second (default 250)\n"
+        "  --timeout-ms MS      wait this long for a report before counting it lost (default 100)\n");
+}
+
+bool ParseArgs(int argc, char** argv, Options& opts)
+{
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) return false;
+        const char* value = argv[++i];
+        const std::string v = value;
+        if (arg == "--count") opts.count = std::max(1, std::atoi(value));
+        else if (arg == "--rate") opts.rateHz = std::clamp(std::atof(value), 1.0, 8000.0);
+        else if (arg == "--timeout-ms") opts.timeoutMs = std::max(1, std::atoi(value));
+        else if (arg == "--device") {
+            if (v != "gamepad" && v != "mouse") return false;
+            opts.device = v;
+        }
+        else return false;
+    }
+    return true;
+}
+
+double Percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) return 0.0;
+    const size_t k = std::min(values.size() - 1, static_cast<size_t>(p * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+// udev creates the node a moment after the device; wait for it to open.
+int OpenNode(const std::string& node)
+{
+    const auto deadline = Clock::now() + std::chrono::seconds(2);
+    while (!node.empty()) {
+        const int fd = open(node.c_str(), O_RDONLY | O_NONBLOCK);
+        if (fd >= 0 || Clock::now() > deadline) return fd;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+uint64_t NowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+// Every event one frame read back carried, up to its SYN_REPORT.
+struct Frame {
+    input_event events[32];
+    size_t   count = 0;
+    uint64_t stampNs = 0;      // kernel timestamp of the SYN_REPORT
+    uint64_t readNs = 0;       // when read() handed it over
+
+    const input_event* Find(uint16_t type, uint16_t code) const
+    {
+        for (size_t i = 0; i < count; ++i)
+            if (events[i].type == type && events[i].code == code) return &events[i];
+        return nullptr;
+    }
+};
+
+bool ReadFrame(int fd, int timeoutMs, Frame& frame)
+{
+    frame.count = 0;
+    const auto deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+    for (;;) {
+        input_event ev;
+        const ssize_t n = read(fd, &ev, sizeof(ev));
+        if (n == static_cast<ssize_t>(sizeof(ev))) {
+            if (ev.type == EV_SYN && ev.code == SYN_REPORT) {
+                frame.readNs = NowNs();
+                frame.stampNs = static_cast<uint64_t>(ev.input_event_sec) * 1'000'000'000ull + static_cast<uint64_t>(ev.input_event_usec) * 1000ull;
+                return true;
+            }
+            if (frame.count < sizeof(frame.events) / sizeof(frame.events[0])) frame.events[frame.count++] = ev;
+            continue;
+        }
+        const int left = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count());
+        if (left <= 0) return false;
+        pollfd p{ fd, POLLIN, 0 };
+        poll(&p, 1, left);
+    }
+}
+
+// A value one step of the readback check expects to come back.
+struct Expected {
+    uint16_t type;
+    uint16_t code;
+    int32_t  value;
+};
+
+// Reads one frame and counts what is wrong with it: an event that was not
+// expected or has the wrong value, and an expected value that is missing.
+// The kernel drops key and absolute events that repeat the device's state,
+// so those may instead be read back with EVIOCGKEY / EVIOCGABS; relative
+// and MSC events must be in the frame.
+int CheckFrame(int fd, const char* step, const std::vector<Expected>& expected, int timeoutMs)
+{
+    Frame frame;
+    if (!ReadFrame(fd, timeoutMs, frame)) {
+        std::printf("  %s: no frame within %d ms\n", step, timeoutMs);
+        return 1;
+    }
+    int bad = 0;
+    for (size_t i = 0; i < frame.count; ++i) {
+        const input_event& ev = frame.events[i];
+        const auto it = std::find_if(expected.begin(), expected.end(),
+            [&](const Expected& e) { return e.type == ev.type && e.code == ev.code; });
+        if (it == expected.end() || it->value != ev.value) {
+            std::printf("  %s: unexpected event type %u code %u value %d\n", step, ev.type, ev.code, ev.value);
+            ++bad;
+        }
+    }
+    uint8_t keys[KEY_MAX / 8 + 1] = {};
+    ioctl(fd, EVIOCGKEY(sizeof(keys)), keys);
+    for (const Expected& e : expected) {
+        if (frame.Find(e.type, e.code)) continue;   // value checked above
+        bool shown = false;
+        int32_t state = 0;
+        if (e.type == EV_KEY) {
+            state = (keys[e.code / 8] >> (e.code % 8)) & 1;
+            shown = state == e.value;
+        } else if (e.type == EV_ABS) {
+            input_absinfo abs{};
+            shown = ioctl(fd, EVIOCGABS(e.code), &abs) == 0 && (state = abs.value) == e.value;
+        }
+        if (!shown) {
+            std::printf("  %s: type %u code %u expected %d, device shows %d\n", step, e.type, e.code, e.value, state);
+            ++bad;
+        }
+    }
+    return bad;
+}
+
+// What the gamepad device should show for a report: hid-playstation's
+// layout, written out here rather than taken from the sink.
+std::vector<Expected> GamepadExpected(const DS4_REPORT_EX& report)
+{
+    const auto& r = report.Report;
+    static constexpr int8_t kHat[9][2] = {
+        { 0, -1 }, { 1, -1 }, { 1, 0 }, { 1, 1 }, { 0, 1 }, { -1, 1 }, { -1, 0 }, { -1, -1 }, { 0, 0 },
+    };
+    static constexpr struct { uint16_t mask, code; } kButtons[] = {
+        { DS4_BUTTON_CROSS, BTN_SOUTH }, { DS4_BUTTON_CIRCLE, BTN_EAST },
+        { DS4_BUTTON_TRIANGLE, BTN_NORTH }, { DS4_BUTTON_SQUARE, BTN_WEST },
+        { DS4_BUTTON_SHOULDER_LEFT, BTN_TL }, { DS4_BUTTON_SHOULDER_RIGHT, BTN_TR },
+        { DS4_BUTTON_TRIGGER_LEFT, BTN_TL2 }, { DS4_BUTTON_TRIGGER_RIGHT, BTN_TR2 },
+        { DS4_BUTTON_SHARE, BTN_SELECT }, { DS4_BUTTON_OPTIONS, BTN_START },
+        { DS4_BUTTON_THUMB_LEFT, BTN_THUMBL }, { DS4_BUTTON_THUMB_RIGHT, BTN_THUMBR },
+    };
+    const int8_t* hat = kHat[std::min(r.wButtons & 0xF, 8)];
+    std::vector<Expected> e = {
+        { EV_ABS, ABS_X, r.bThumbLX }, { EV_ABS, ABS_Y, r.bThumbLY },
+        { EV_ABS, ABS_RX, r.bThumbRX }, { EV_ABS, ABS_RY, r.bThumbRY },
+        { EV_ABS, ABS_Z, r.bTriggerL }, { EV_ABS, ABS_RZ, r.bTriggerR },
+        { EV_ABS, ABS_HAT0X, hat[0] }, { EV_ABS, ABS_HAT0Y, hat[1] },
+        { EV_KEY, BTN_MODE, (r.bSpecial & DS4_SPECIAL_BUTTON_PS) ? 1 : 0 },
+    };
+    for (const auto& b : kButtons) e.push_back({ EV_KEY, b.code, (r.wButtons & b.mask) ? 1 : 0 });
+    return e;
+}
+
+// Sets every axis, the d-pad and every button one way and then the other,
+// then moves the motion sensors twice.
+int CheckGamepad(UinputReportSink& pad, int fd, int timeoutMs)
+{
+    PipelineOutput out;
+    auto& r = out.report.Report;
+    const auto pdr = reinterpret_cast<PDS4_REPORT>(&out.report.Report);
+    DS4_REPORT_INIT(pdr);
+    pad.Emit(0, out);
+    int bad = CheckFrame(fd, "initial report", GamepadExpected(out.report), timeoutMs);
+
+    r.bThumbLX = 0x10; r.bThumbLY = 0xF0; r.bThumbRX = 0x33; r.bThumbRY = 0xCC;
+    r.bTriggerL = 0x40; r.bTriggerR = 0xFF;
+    r.wButtons = DS4_BUTTON_CROSS | DS4_BUTTON_TRIANGLE | DS4_BUTTON_SHOULDER_LEFT |
+                 DS4_BUTTON_TRIGGER_RIGHT | DS4_BUTTON_OPTIONS | DS4_BUTTON_THUMB_RIGHT;
+    DS4_SET_DPAD(pdr, DS4_BUTTON_DPAD_NORTHEAST);
+    r.bSpecial = DS4_SPECIAL_BUTTON_PS;
+    pad.Emit(0, out);
+    bad += CheckFrame(fd, "first buttons", GamepadExpected(out.report), timeoutMs);
+
+    r.bThumbLX = 0xEE; r.bThumbLY = 0x01; r.bThumbRX = 0xA0; r.bThumbRY = 0x5A;
+    r.bTriggerL = 0xFF; r.bTriggerR = 0x00;
+    r.wButtons = DS4_BUTTON_CIRCLE | DS4_BUTTON_SQUARE | DS4_BUTTON_SHOULDER_RIGHT |
+                 DS4_BUTTON_TRIGGER_LEFT | DS4_BUTTON_SHARE | DS4_BUTTON_THUMB_LEFT;
+    DS4_SET_DPAD(pdr, DS4_BUTTON_DPAD_SOUTHWEST);
+    r.bSpecial = 0;
+    pad.Emit(0, out);
+    bad += CheckFrame(fd, "other buttons", GamepadExpected(out.report), timeoutMs);
+
+    DS4_REPORT_INIT(pdr);
+    pad.Emit(0, out);
+    bad += CheckFrame(fd, "released", GamepadExpected(out.report), timeoutMs);
+
+    const std::string node = pad.MotionNode(0);
+    const int motionFd = OpenNode(node);
+    if (motionFd < 0) {
+        std::printf("  motion: failed to open %s\n", node.empty() ? "the event node" : node.c_str());
+        return bad + 1;
+    }
+    ioctl(motionFd, EVIOCGRAB, 1);
+    // Values the sink's scales (8192 per g, 1024 per deg/s) turn into whole numbers.
+    const float samples[2][6] = { { 0.5f, -1.0f, 0.25f, 10.0f, -2.5f, 100.0f }, { -0.75f, 0.125f, 1.0f, -300.0f, 0.5f, 0.0f } };
+    for (int i = 0; i < 2; ++i) {
+        MotionSample& m = out.motion;
+        m.accelX = samples[i][0]; m.accelY = samples[i][1]; m.accelZ = samples[i][2];
+        m.gyroX = samples[i][3]; m.gyroY = samples[i][4]; m.gyroZ = samples[i][5];
+        m.timestampUs = 1000u + 5000u * static_cast<unsigned>(i);
+        m.valid = true;
+        pad.Emit(0, out);
+        auto scaled = [](float v, int perUnit) { return static_cast<int32_t>(std::lround(v * static_cast<float>(perUnit))); };
+        const std::vector<Expected> expected = {
+            { EV_ABS, ABS_X, scaled(m.accelX, 8192) }, { EV_ABS, ABS_Y, scaled(m.accelY, 8192) },
+            { EV_ABS, ABS_Z, scaled(m.accelZ, 8192) }, { EV_ABS, ABS_RX, scaled(m.gyroX, 1024) },
+            { EV_ABS, ABS_RY, scaled(m.gyroY, 1024) }, { EV_ABS, ABS_RZ, scaled(m.gyroZ, 1024) },
+            { EV_MSC, MSC_TIMESTAMP, static_cast<int32_t>(m.timestampUs) },
+        };
+        bad += CheckFrame(motionFd, i ? "second motion" : "first motion", expected, timeoutMs);
+    }
+    close(motionFd);
+    return bad;
+}
+
+// Moves, scrolls, holds two buttons and taps a third; a tap inside one
+// batch comes back as two frames.
+int CheckMouse(UinputMouseSink& mouse, int fd, int timeoutMs)
+{
+    auto send = [&](std::initializer_list<MouseEvent> events) {
+        MouseBatch batch;
+        for (const MouseEvent& e : events) batch.Add(e);
+        mouse.Send(batch);
+    };
+    auto button = [](MouseEvent::Type type, MouseButton b) {
+        MouseEvent e;
+        e.type = type;
+        e.button = b;
+        return e;
+    };
+    MouseEvent move;
+    move.dx = 7;
+    move.dy = -5;
+    send({ move });
+    int bad = CheckFrame(fd, "move", { { EV_REL, REL_X, 7 }, { EV_REL, REL_Y, -5 } }, timeoutMs);
+
+    MouseEvent wheel;
+    wheel.type = MouseEvent::Type::Wheel;
+    wheel.wheel = -240;
+    send({ wheel });
+    bad += CheckFrame(fd, "wheel", { { EV_REL, REL_WHEEL, -2 }, { EV_REL, REL_WHEEL_HI_RES, -240 } }, timeoutMs);
+
+    send({ button(MouseEvent::Type::Down, MouseButton::Left), button(MouseEvent::Type::Down, MouseButton::X1) });
+    bad += CheckFrame(fd, "press", { { EV_KEY, BTN_LEFT, 1 }, { EV_KEY, BTN_SIDE, 1 } }, timeoutMs);
+    send({ button(MouseEvent::Type::Up, MouseButton::Left), button(MouseEvent::Type::Up, MouseButton::X1) });
+    bad += CheckFrame(fd, "release", { { EV_KEY, BTN_LEFT, 0 }, { EV_KEY, BTN_SIDE, 0 } }, timeoutMs);
+
+    send({ button(MouseEvent::Type::Down, MouseButton::Right), button(MouseEvent::Type::Up, MouseButton::Right) });
+    bad += CheckFrame(fd, "tap down", { { EV_KEY, BTN_RIGHT, 1 } }, timeoutMs);
+    bad += CheckFrame(fd, "tap up", { { EV_KEY, BTN_RIGHT, 0 } }, timeoutMs);
+    return bad;
+}
+}
+
+int main(int argc, char** argv)
+{
+    Options opts;
+    if (!ParseArgs(argc, argv, opts)) {
+        PrintUsage();
+        return 2;
+    }
+    std::signal(SIGINT, OnSignal);
+    if (access("/dev/uinput", W_OK) != 0) {
+        std::printf("uinput_probe: skipped, /dev/uinput: %s\n", std::strerror(errno));
+        return kSkipped;
+    }
+
+    UinputReportSink pad;
+    UinputMouseSink mouse;
+    const bool isMouse = opts.device == "mouse";
+    std::string node;
+    if (isMouse) {
+        if (!mouse.Open("joycon2cpp probe mouse")) {
+            std::fprintf(stderr, "Failed to create uinput mouse: %s\n", mouse.Error().c_str());
+            return 1;
+        }
+        node = mouse.Node();
+    } else {
+        if (!pad.Open(0, "joycon2cpp probe")) {
+            std::fprintf(stderr, "Failed to create uinput gamepad: %s\n", pad.Error().c_str());
+            return 1;
+        }
+        node = pad.GamepadNode(0);
+    }
+
+    const int fd = OpenNode(node);
+    if (fd < 0 && !node.empty() && (errno == EACCES || errno == EPERM)) {
+        std::printf("uinput_probe: skipped, %s: %s\n", node.c_str(), std::strerror(errno));
+        return kSkipped;
+    }
+    if (fd < 0) {
+        std::fprintf(stderr, "Failed to open %s\n", node.empty() ? "the event node" : node.c_str());
+        return 1;
+    }
+    // Event stamps on the steady clock's timeline, and keep the desktop off
+    // the probe's device so the pointer does not wander.
+    int clockId = CLOCK_MONOTONIC;
+    ioctl(fd, EVIOCSCLOCKID, &clockId);
+    ioctl(fd, EVIOCGRAB, 1);
+    std::printf("%s: %s\n", opts.device.c_str(), node.c_str());
+
+    const int readbackErrors = isMouse ? CheckMouse(mouse, fd, opts.timeoutMs) : CheckGamepad(pad, fd, opts.timeoutMs);
+    std::printf("readback %s\n", readbackErrors ? "FAILED" : "ok");
+
+    // The readback check leaves the gamepad neutral, with the stick centred.
+    PipelineOutput out;
+    DS4_REPORT_INIT(reinterpret_cast<PDS4_REPORT>(&out.report.Report));
+    Frame frame;
+
+    std::vector<double> stampUs, readUs;
+    int lost = 0, mismatched = 0, written = 0;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / opts.rateHz));
+    auto next = Clock::now();
+    for (int i = 0; i < opts.count && !g_cancel; ++i) {
+        std::this_thread::sleep_until(next);
+        next += period;
+
+        // Alternate the value so every report is a change the sink must send.
+        int32_t expected = 0;
+        const uint64_t writeNs = NowNs();
+        if (isMouse) {
+            expected = (i & 1) ? -3 : 3;
+            MouseBatch batch;
+            MouseEvent move;
+            move.dx = expected;
+            batch.Add(move);
+            mouse.Send(batch);
+        } else {
+            expected = (i & 1) ? 0x40 : 0xC0;
+            out.report.Report.bThumbLX = static_cast<uint8_t>(expected);
+            pad.Emit(0, out);
+        }
+        ++written;
+
+        if (!ReadFrame(fd, opts.timeoutMs, frame)) {
+            ++lost;
+            continue;
+        }
+        const input_event* ev = frame.Find(isMouse ? EV_REL : EV_ABS, isMouse ? REL_X : ABS_X);
+        if (!ev || ev->value != expected) ++mismatched;
+        stampUs.push_back(frame.stampNs > writeNs ? (frame.stampNs - writeNs) / 1000.0 : 0.0);
+        readUs.push_back((frame.readNs - writeNs) / 1000.0);
+    }
+    close(fd);
+
+    const uint64_t writeErrors = isMouse ? mouse.WriteErrors() : pad.WriteErrors();
+    std::printf("reports %d  received %zu  lost %d  mismatched %d  write errors %llu\n", written, readUs.size(), lost, mismatched,
+        static_cast<unsigned long long>(writeErrors));
+    if (!readUs.empty()) {
+        std::printf("write to kernel stamp  p50 %.1f us  p99 %.1f us  max %.1f us\n", Percentile(stampUs, 0.5), Percentile(stampUs, 0.99),
+            *std::max_element(stampUs.begin(), stampUs.end()));
+        std::printf("write to reader wake   p50 %.1f us  p99 %.1f us  max %.1f us\n", Percentile(readUs, 0.5), Percentile(readUs, 0.99),
+            *std::max_element(readUs.begin(), readUs.end()));
+    }
+    return readbackErrors == 0 && lost == 0 && mismatched == 0 && writeErrors == 0 ? 0 : 1;
+}
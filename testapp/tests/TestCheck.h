@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdio>
+
+// Just enough of a test harness for the core library's tests: nothing to
+// install, and it builds wherever the core does. CHECK records a failure and
+// carries on, so one run shows every broken expectation; main returns
+// test::Result() for ctest.
+namespace test
+{
+    inline int& Failures()
+    {
+        static int failures = 0;
+        return failures;
+    }
+
+    inline void Fail(const char* file, int line, const char* expression)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+        ++Failures();
+    }
+
+    inline void Run(const char* name, void (*fn)())
+    {
+        const int before = Failures();
+        fn();
+        std::printf("%-40s %s\n", name, Failures() == before ? "ok" : "FAILED");
+    }
+
+    inline int Result()
+    {
+        if (Failures()) std::fprintf(stderr, "%d check(s) failed\n", Failures());
+        return Failures() ? 1 : 0;
+    }
+}
+
+#define CHECK(expression) ((expression) ? (void)0 : test::Fail(__FILE__, __LINE__, #expression))
+#define RUN_TEST(fn) test::Run(#fn, fn)
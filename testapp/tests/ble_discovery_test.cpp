@@ -0,0 +1,195 @@
+#include "BleDiscovery.h"
+#include "TestCheck.h"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr uint64_t kAddressA = 0x98B6E9000001ull;
+    constexpr uint64_t kAddressB = 0x98B6E9000002ull;
+
+    // What the open callback saw, in the order it saw it.
+    struct Opens {
+        struct Open {
+            int      ticket;
+            uint64_t address;
+        };
+
+        std::mutex mutex;
+        std::vector<Open> opens;
+
+        DiscoveryService::OpenCallback Callback()
+        {
+            return [this](const PairingRequest& request, const ControllerAdvertisement& ad) {
+                std::lock_guard<std::mutex> lock(mutex);
+                opens.push_back({ request.ticket, ad.address });
+            };
+        }
+
+        uint64_t AddressFor(int ticket)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const auto& o : opens)
+                if (o.ticket == ticket) return o.address;
+            return 0;
+        }
+
+        size_t Count()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return opens.size();
+        }
+    };
+
+    ControllerAdvertisement Ad(uint64_t address, uint16_t productId)
+    {
+        return { address, productId, -60 };
+    }
+
+    void ParsesManufacturerData()
+    {
+        uint16_t pid = 0;
+        CHECK(TryParseSwitch2ControllerAd({ 0x01, 0x00, 0x03, 0x7E, 0x05, 0x69, 0x20 }, pid));
+        CHECK(pid == SWITCH2_PID_PRO);
+        CHECK(!TryParseSwitch2ControllerAd({ 0x01, 0x00, 0x03, 0x7E, 0x05, 0x69 }, pid));
+        CHECK(!TryParseSwitch2ControllerAd({ 0x01, 0x00, 0x03, 0x7E, 0x06, 0x69, 0x20 }, pid));
+        CHECK(!TryParseSwitch2ControllerAd({ 0x01, 0x00, 0x03, 0x7E, 0x05, 0x10, 0x20 }, pid));
+    }
+
+    void MatchesSlotsInQueueOrder()
+    {
+        FakeAdvertisementSource source;
+        Opens opens;
+        DiscoveryService discovery(source, opens.Callback());
+        CHECK(discovery.Start());
+        CHECK(source.Running());
+
+        const int first = discovery.Enqueue("Player 1");
+        const int second = discovery.Enqueue("Player 2");
+        source.Inject(Ad(kAddressA, SWITCH2_PID_PRO));
+        source.Inject(Ad(kAddressB, SWITCH2_PID_PRO));
+        discovery.WaitForOpens();
+
+        CHECK(opens.Count() == 2);
+        CHECK(opens.AddressFor(first) == kAddressA);
+        CHECK(opens.AddressFor(second) == kAddressB);
+        CHECK(discovery.PendingCount() == 0);
+    }
+
+    void SkipsSlotsThatWantAnotherProduct()
+    {
+        FakeAdvertisementSource source;
+        Opens opens;
+        DiscoveryService discovery(source, opens.Callback());
+        discovery.Start();
+
+        const int pro = discovery.Enqueue("Pro", { SWITCH2_PID_PRO });
+        const int any = discovery.Enqueue("Any");
+        source.Inject(Ad(kAddressA, SWITCH2_PID_JOYCON_R));
+        discovery.WaitForOpens();
+        CHECK(opens.AddressFor(any) == kAddressA);
+        CHECK(opens.AddressFor(pro) == 0);
+        CHECK(discovery.PendingCount() == 1);
+
+        source.Inject(Ad(kAddressB, SWITCH2_PID_PRO));
+        discovery.WaitForOpens();
+        CHECK(opens.AddressFor(pro) == kAddressB);
+    }
+
+    void ClaimedAddressMatchesOnceUntilReleased()
+    {
+        FakeAdvertisementSource source;
+        Opens opens;
+        DiscoveryService discovery(source, opens.Callback());
+        discovery.Start();
+
+        const int first = discovery.Enqueue("Player 1");
+        const int second = discovery.Enqueue("Player 2");
+        source.Inject(Ad(kAddressA, SWITCH2_PID_PRO));
+        source.Inject(Ad(kAddressA, SWITCH2_PID_PRO));
+        discovery.WaitForOpens();
+        CHECK(opens.Count() == 1);
+        CHECK(opens.AddressFor(first) == kAddressA);
+        CHECK(discovery.PendingCount() == 1);
+
+        // The open failed: the controller may now match the next slot.
+        discovery.Release(kAddressA);
+        source.Inject(Ad(kAddressA, SWITCH2_PID_PRO));
+        discovery.WaitForOpens();
+        CHECK(opens.AddressFor(second) == kAddressA);
+        CHECK(discovery.PendingCount() == 0);
+    }
+
+    void ReplaysRecentAdvertisementsOldestFirst()
+    {
+        FakeAdvertisementSource source;
+        Opens opens;
+        DiscoveryService discovery(source, opens.Callback());
+        discovery.Start();
+
+        source.Inject(Ad(kAddressA, SWITCH2_PID_PRO));
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        source.Inject(Ad(kAddressB, SWITCH2_PID_PRO));
+        CHECK(opens.Count() == 0);
+
+        const int first = discovery.Enqueue("Player 1");
+        const int second = discovery.Enqueue("Player 2");
+        discovery.WaitForOpens();
+        CHECK(opens.AddressFor(first) == kAddressA);
+        CHECK(opens.AddressFor(second) == kAddressB);
+        CHECK(discovery.PendingCount() == 0);
+
+        // Both are claimed now, so a third slot waits.
+        discovery.Enqueue("Player 3");
+        CHECK(discovery.PendingCount() == 1);
+    }
+
+    void ForgetsAdvertisementsPastTheirTtl()
+    {
+        FakeAdvertisementSource source;
+        Opens opens;
+        DiscoveryService discovery(source, opens.Callback(), std::chrono::milliseconds(5));
+        discovery.Start();
+
+        source.Inject(Ad(kAddressA, SWITCH2_PID_PRO));
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        discovery.Enqueue("Player 1");
+        discovery.WaitForOpens();
+        CHECK(opens.Count() == 0);
+        CHECK(discovery.PendingCount() == 1);
+    }
+
+    void CancelAndStop()
+    {
+        FakeAdvertisementSource source;
+        Opens opens;
+        DiscoveryService discovery(source, opens.Callback());
+        discovery.Start();
+
+        const int ticket = discovery.Enqueue("Player 1");
+        discovery.Cancel(ticket);
+        CHECK(discovery.PendingCount() == 0);
+
+        discovery.Enqueue("Player 2");
+        discovery.Stop();
+        CHECK(!source.Running());
+        source.Inject(Ad(kAddressA, SWITCH2_PID_PRO));
+        discovery.WaitForOpens();
+        CHECK(opens.Count() == 0);
+        CHECK(discovery.PendingCount() == 1);
+    }
+}
+
+int main()
+{
+    RUN_TEST(ParsesManufacturerData);
+    RUN_TEST(MatchesSlotsInQueueOrder);
+    RUN_TEST(SkipsSlotsThatWantAnotherProduct);
+    RUN_TEST(ClaimedAddressMatchesOnceUntilReleased);
+    RUN_TEST(ReplaysRecentAdvertisementsOldestFirst);
+    RUN_TEST(ForgetsAdvertisementsPastTheirTtl);
+    RUN_TEST(CancelAndStop);
+    return test::Result();
+}
@@ -0,0 +1,180 @@
+#include "CommandEngine.h"
+#include "CommandSequencer.h"
+#include "TestCheck.h"
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    // [cmd, 0x91, transport, sub, 0, size, 0, 0, tag]: the tag comes back
+    // in the fake's response payload, so a reply shows which write caused it.
+    std::vector<uint8_t> Packet(uint8_t cmd, uint8_t sub, uint8_t tag)
+    {
+        return { cmd, 0x91, 0x01, sub, 0x00, 0x01, 0x00, 0x00, tag };
+    }
+
+    std::vector<uint8_t> Tag(const uint8_t* command, size_t size)
+    {
+        return { size > 8 ? command[8] : uint8_t{ 0 } };
+    }
+
+    // An engine wired to the fake controller. The responder is declared
+    // last so its delayed responses are joined before the engine goes.
+    struct Rig {
+        CommandEngine engine;
+        FakeCommandResponder responder{ 0 };
+
+        Rig()
+        {
+            responder.SetPayload(Tag);
+            responder.Attach([this](const uint8_t* data, size_t size) { engine.OnResponse(data, size); });
+        }
+
+        CommandEngine::WriteFn Write()
+        {
+            return [this](const std::vector<uint8_t>& packet) { return responder.Write(packet); };
+        }
+    };
+
+    // The tag a reply's payload carries, or -1.
+    int ReplyTag(const CommandReply& reply)
+    {
+        return reply.payload.size() > 8 ? reply.payload[8] : -1;
+    }
+
+    void RepliesFromInsideTheWriteStillMatch()
+    {
+        Rig rig;
+        auto reply = rig.engine.Send(Packet(0x09, 0x07, 1), 0, rig.Write(), 100ms).get();
+        CHECK(reply.Acked());
+        CHECK(reply.header.cmd == 0x09 && reply.header.sub == 0x07);
+        CHECK(ReplyTag(reply) == 1);
+        CHECK(rig.engine.InFlight() == 0);
+        CHECK(rig.engine.Unmatched() == 0);
+    }
+
+    void SameKeyResponsesCompleteTheOldestCommand()
+    {
+        Rig rig;
+        // Hold the responses and hand them over in a different order.
+        std::vector<std::vector<uint8_t>> held;
+        rig.responder.Attach([&](const uint8_t* data, size_t size) { held.emplace_back(data, data + size); });
+
+        std::mutex mutex;
+        std::vector<std::pair<int, int>> done;   // (tag sent, tag of the response that completed it)
+        auto record = [&](int sent) {
+            return [&, sent](CommandReply reply) {
+                CHECK(reply.Acked());
+                std::lock_guard<std::mutex> lock(mutex);
+                done.emplace_back(sent, ReplyTag(reply));
+            };
+        };
+        rig.engine.Send(Packet(0x10, 0x01, 1), 0, rig.Write(), 1s, record(1));
+        rig.engine.Send(Packet(0x10, 0x02, 2), 0, rig.Write(), 1s, record(2));
+        rig.engine.Send(Packet(0x10, 0x01, 3), 0, rig.Write(), 1s, record(3));
+        CHECK(held.size() == 3);
+        CHECK(rig.engine.InFlight() == 3);
+
+        // The second 10/01 response arrives first: it still completes the
+        // first 10/01 command, since responses carry only cmd/sub.
+        rig.engine.OnResponse(held[2].data(), held[2].size());
+        rig.engine.OnResponse(held[1].data(), held[1].size());
+        rig.engine.OnResponse(held[0].data(), held[0].size());
+        CHECK((done == std::vector<std::pair<int, int>>{ { 1, 3 }, { 2, 2 }, { 3, 1 } }));
+        CHECK(rig.engine.InFlight() == 0);
+        CHECK(rig.engine.ResponsesSeen() == 3);
+    }
+
+    void UnansweredCommandTimesOutAndLateAckIsUnmatched()
+    {
+        Rig rig;
+        rig.responder.Ignore(0x0A, 0x08);
+        auto reply = rig.engine.Send(Packet(0x0A, 0x08, 1), 0, rig.Write(), 20ms).get();
+        CHECK(reply.status == CommandStatus::TimedOut);
+        CHECK(reply.rttMs >= 20.0);
+        CHECK(rig.engine.InFlight() == 0);
+
+        const auto stats = rig.engine.Stats(0x0A, 0x08);
+        CHECK(stats.sent == 1 && stats.timedOut == 1 && stats.acked == 0);
+
+        // The controller answers after all: nothing is waiting for it.
+        const uint8_t late[] = { 0x0A, 0x01, 0x01, 0x08, 0x10, 0x78, 0x00, 0x00 };
+        rig.engine.OnResponse(late, sizeof(late));
+        CHECK(rig.engine.Unmatched() == 1);
+        CHECK(rig.engine.ResponsesSeen() == 1);
+        CHECK(rig.engine.Stats(0x0A, 0x08).acked == 0);
+
+        // Too short to be a response header: not counted at all.
+        rig.engine.OnResponse(late, 4);
+        CHECK(rig.engine.ResponsesSeen() == 1);
+    }
+
+    void FailedWriteCompletesInline()
+    {
+        Rig rig;
+        bool completed = false;
+        rig.engine.Send(Packet(0x09, 0x07, 1), 0, [](const std::vector<uint8_t>&) { return false; }, 1s,
+            [&](CommandReply reply) {
+                CHECK(reply.status == CommandStatus::WriteFailed);
+                completed = true;
+            });
+        CHECK(completed);
+        CHECK(rig.engine.InFlight() == 0);
+        CHECK(rig.engine.Stats(0x09, 0x07).writeFailed == 1);
+
+        // A packet too short to carry cmd/sub never reaches the write.
+        auto reply = rig.engine.Send({ 0x09, 0x91 }, 0, rig.Write(), 1s).get();
+        CHECK(reply.status == CommandStatus::WriteFailed);
+        CHECK(rig.responder.Writes() == 0);
+    }
+
+    void RoundTripStatsPerKey()
+    {
+        Rig rig;
+        rig.responder.SetLatency(5ms);
+        for (uint8_t i = 0; i < 3; ++i)
+            CHECK(rig.engine.Send(Packet(0x0C, 0x02, i), 0, rig.Write(), 1s).get().Acked());
+        CHECK(rig.engine.Send(Packet(0x0C, 0x04, 9), 0, rig.Write(), 1s).get().Acked());
+
+        const auto stats = rig.engine.Stats(0x0C, 0x02);
+        CHECK(stats.sent == 3 && stats.acked == 3);
+        CHECK(stats.timedOut == 0 && stats.writeFailed == 0);
+        CHECK(stats.minRttMs >= 5.0);
+        CHECK(stats.minRttMs <= stats.MeanRttMs() && stats.MeanRttMs() <= stats.maxRttMs);
+        CHECK(stats.totalRttMs >= 3 * stats.minRttMs);
+
+        const auto none = rig.engine.Stats(0x0C, 0x03);
+        CHECK(none.sent == 0 && none.MeanRttMs() == 0.0);
+
+        const auto all = rig.engine.AllStats();
+        CHECK(all.size() == 2 && all[0].first == 0x0C02 && all[1].first == 0x0C04);
+    }
+
+    void CancelAllCompletesWhatIsInFlight()
+    {
+        Rig rig;
+        rig.responder.SetSilent(true);
+        auto a = rig.engine.Send(Packet(0x01, 0x01, 1), 0, rig.Write(), 10s);
+        auto b = rig.engine.Send(Packet(0x01, 0x01, 2), 0, rig.Write(), 10s);
+        CHECK(rig.engine.InFlight() == 2);
+        rig.engine.CancelAll();
+        CHECK(a.get().status == CommandStatus::Cancelled);
+        CHECK(b.get().status == CommandStatus::Cancelled);
+        CHECK(rig.engine.InFlight() == 0);
+    }
+}
+
+int main()
+{
+    RUN_TEST(RepliesFromInsideTheWriteStillMatch);
+    RUN_TEST(SameKeyResponsesCompleteTheOldestCommand);
+    RUN_TEST(UnansweredCommandTimesOutAndLateAckIsUnmatched);
+    RUN_TEST(FailedWriteCompletesInline);
+    RUN_TEST(RoundTripStatsPerKey);
+    RUN_TEST(CancelAllCompletesWhatIsInFlight);
+    return test::Result();
+}
@@ -0,0 +1,261 @@
+#include "CommandQueue.h"
+#include "TestCheck.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+
+    // A BLE write that hangs until released, as a busy radio does.
+    class StalledWriter {
+    public:
+        std::function<bool()> Write()
+        {
+            return [this] {
+                std::unique_lock<std::mutex> lock(mutex_);
+                entered_ = true;
+                cv_.notify_all();
+                cv_.wait(lock, [this] { return released_; });
+                return true;
+            };
+        }
+
+        bool WaitEntered()
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return cv_.wait_for(lock, 2s, [this] { return entered_; });
+        }
+
+        void Release()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            released_ = true;
+            cv_.notify_all();
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        bool entered_ = false;
+        bool released_ = false;
+    };
+
+    // Records the order the worker ran commands in.
+    struct Log {
+        std::mutex mutex;
+        std::vector<std::string> writes;
+
+        std::function<bool()> Write(std::string name)
+        {
+            return [this, name] {
+                std::lock_guard<std::mutex> lock(mutex);
+                writes.push_back(name);
+                return true;
+            };
+        }
+
+        std::vector<std::string> Writes()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return writes;
+        }
+    };
+
+    bool WaitForWrites(const CommandQueue& queue, uint64_t count)
+    {
+        const auto deadline = Clock::now() + 2s;
+        while (Clock::now() < deadline) {
+            const auto s = queue.GetStats();
+            if (s.written + s.failed >= count) return true;
+            std::this_thread::sleep_for(1ms);
+        }
+        return false;
+    }
+
+    OutboundCommand Normal(std::function<bool()> write, std::chrono::milliseconds settle = 0ms)
+    {
+        OutboundCommand c;
+        c.write = std::move(write);
+        c.settle = settle;
+        return c;
+    }
+
+    OutboundCommand Rumble(std::function<bool()> write, uint32_t key)
+    {
+        OutboundCommand c;
+        c.priority = CommandPriority::Rumble;
+        c.write = std::move(write);
+        c.coalesceKey = key;
+        return c;
+    }
+
+    void SubmitNeverWaitsForAStalledWrite()
+    {
+        constexpr size_t kDepth = 8;
+        CommandQueue queue(kDepth);
+        StalledWriter stall;
+        Log log;
+
+        CHECK(queue.Submit(Normal(stall.Write())));
+        CHECK(stall.WaitEntered());
+
+        // The worker is stuck in the first write; the caller still gets
+        // straight back from every Submit, accepted or not.
+        const auto start = Clock::now();
+        for (size_t i = 0; i < kDepth; ++i)
+            CHECK(queue.Submit(Normal(log.Write(std::to_string(i)))));
+        CHECK(!queue.Submit(Normal(log.Write("overflow"))));
+        const auto elapsed = Clock::now() - start;
+        CHECK(elapsed < 50ms);
+
+        CHECK(queue.Depth() == kDepth);
+        auto stats = queue.GetStats();
+        CHECK(stats.dropped == 1);
+        CHECK(stats.maxDepth == kDepth);
+        CHECK(stats.written == 0);
+
+        stall.Release();
+        CHECK(WaitForWrites(queue, kDepth + 1));
+        const auto writes = log.Writes();
+        CHECK(writes.size() == kDepth);
+        for (size_t i = 0; i < writes.size(); ++i)
+            CHECK(writes[i] == std::to_string(i));
+        CHECK(queue.Depth() == 0);
+    }
+
+    void RumbleGoesFirstAndCoalesces()
+    {
+        CommandQueue queue;
+        StalledWriter stall;
+        Log log;
+
+        queue.Submit(Normal(stall.Write()));
+        CHECK(stall.WaitEntered());
+        queue.Submit(Normal(log.Write("normal")));
+        queue.Submit(Rumble(log.Write("left 1"), 1));
+        queue.Submit(Rumble(log.Write("right"), 2));
+        queue.Submit(Rumble(log.Write("left 2"), 1));
+        CHECK(queue.Depth() == 3);
+        CHECK(queue.GetStats().coalesced == 1);
+
+        stall.Release();
+        CHECK(WaitForWrites(queue, 4));
+        CHECK((log.Writes() == std::vector<std::string>{ "left 2", "right", "normal" }));
+    }
+
+    void RumbleQueueDropsOldestWhenFull()
+    {
+        CommandQueue queue(2);
+        StalledWriter stall;
+        Log log;
+
+        queue.Submit(Normal(stall.Write()));
+        CHECK(stall.WaitEntered());
+        CHECK(queue.Submit(Rumble(log.Write("a"), 0)));
+        CHECK(queue.Submit(Rumble(log.Write("b"), 0)));
+        CHECK(queue.Submit(Rumble(log.Write("c"), 0)));
+        CHECK(queue.GetStats().dropped == 1);
+
+        stall.Release();
+        CHECK(WaitForWrites(queue, 3));
+        CHECK((log.Writes() == std::vector<std::string>{ "b", "c" }));
+    }
+
+    void SettleHoldsNormalCommandsButNotRumble()
+    {
+        CommandQueue queue;
+        Log log;
+
+        const auto start = Clock::now();
+        Clock::time_point secondAt{}, rumbleAt{};
+        queue.Submit(Normal(log.Write("first"), 60ms));
+        queue.Submit(Normal([&] { secondAt = Clock::now(); return true; }));
+        CHECK(WaitForWrites(queue, 1));
+        queue.Submit(Rumble([&] { rumbleAt = Clock::now(); return true; }, 0));
+        CHECK(WaitForWrites(queue, 3));
+
+        CHECK(secondAt - start >= 60ms);
+        CHECK(rumbleAt < secondAt);
+    }
+
+    void EndSettleReleasesTheNextNormalCommand()
+    {
+        CommandQueue queue;
+        Clock::time_point secondAt{}, thirdAt{};
+
+        // An ack delivered from inside the write, before its settle starts.
+        const auto start = Clock::now();
+        queue.Submit(Normal([&] { queue.EndSettle(); return true; }, 500ms));
+        queue.Submit(Normal([&] { secondAt = Clock::now(); return true; }, 500ms));
+        CHECK(WaitForWrites(queue, 2));
+        CHECK(secondAt - start < 250ms);
+
+        // A timeout reported from another thread during the settle.
+        queue.Submit(Normal([&] { thirdAt = Clock::now(); return true; }));
+        std::this_thread::sleep_for(20ms);
+        CHECK(queue.GetStats().written == 2);
+        const auto endedAt = Clock::now();
+        std::thread([&] { queue.EndSettle(true); }).join();
+        CHECK(WaitForWrites(queue, 3));
+        CHECK(thirdAt >= endedAt);
+        CHECK(thirdAt - endedAt < 250ms);
+
+        const auto stats = queue.GetStats();
+        CHECK(stats.timedOut == 1);
+        CHECK(stats.written == 3);
+        CHECK(stats.failed == 0);
+    }
+
+    void FailedAndThrowingWritesAreCounted()
+    {
+        CommandQueue queue;
+        queue.Submit(Normal([] { return false; }));
+        queue.Submit(Normal([]() -> bool { throw std::runtime_error("gone"); }));
+        queue.Submit(Normal([] { return true; }));
+        CHECK(WaitForWrites(queue, 3));
+        const auto stats = queue.GetStats();
+        CHECK(stats.failed == 2);
+        CHECK(stats.written == 1);
+    }
+
+    void StopDiscardsQueuedCommands()
+    {
+        CommandQueue queue;
+        StalledWriter stall;
+        Log log;
+
+        queue.Submit(Normal(stall.Write()));
+        CHECK(stall.WaitEntered());
+        queue.Submit(Normal(log.Write("queued")));
+        std::thread stopper([&] { queue.Stop(); });
+        // Stop waits for the write in progress, not for the queue.
+        std::this_thread::sleep_for(10ms);
+        stall.Release();
+        stopper.join();
+
+        CHECK(log.Writes().empty());
+        CHECK(queue.Depth() == 0);
+        CHECK(!queue.Submit(Normal(log.Write("late"))));
+        CHECK(!queue.Submit(OutboundCommand{}));
+    }
+}
+
+int main()
+{
+    RUN_TEST(SubmitNeverWaitsForAStalledWrite);
+    RUN_TEST(RumbleGoesFirstAndCoalesces);
+    RUN_TEST(RumbleQueueDropsOldestWhenFull);
+    RUN_TEST(SettleHoldsNormalCommandsButNotRumble);
+    RUN_TEST(EndSettleReleasesTheNextNormalCommand);
+    RUN_TEST(FailedAndThrowingWritesAreCounted);
+    RUN_TEST(StopDiscardsQueuedCommands);
+    return test::Result();
+}
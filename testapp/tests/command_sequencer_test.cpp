@@ -0,0 +1,148 @@
+#include "CommandSequencer.h"
+#include "TestCheck.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    // A sequencer wired to a fake controller through a real engine, with
+    // timeouts short enough to keep the retry and fallback paths quick.
+    struct Rig {
+        CommandEngine engine;
+        FakeCommandResponder responder;
+        CommandSequencer sequencer;
+
+        explicit Rig(const InitScript& script)
+            : responder(script.prefixSize)
+            , sequencer(engine, [this](const std::vector<uint8_t>& packet) { return responder.Write(packet); },
+                        CommandSequencer::Options{ 30ms, 1, 2ms })
+        {
+            responder.Attach([this](const uint8_t* data, size_t size) { engine.OnResponse(data, size); });
+        }
+    };
+
+    const InitScript& Script() { return JoyCon2InitScript(); }
+    size_t ScriptSize() { return Script().commands.size(); }
+
+    void AcksEveryCommand()
+    {
+        Rig rig(Script());
+        size_t replies = 0;
+        rig.sequencer.OnReply([&](const CommandReply& reply) {
+            CHECK(reply.Acked());
+            ++replies;
+        });
+        const auto r = rig.sequencer.Run(Script());
+        CHECK(r.Complete());
+        CHECK(r.sent == ScriptSize());
+        CHECK(r.acked == ScriptSize());
+        CHECK(r.retried == 0 && r.timedOut == 0 && !r.blind);
+        CHECK(replies == ScriptSize());
+        CHECK(rig.responder.Writes() == ScriptSize());
+    }
+
+    void PacesOnAcksNotTimeouts()
+    {
+        Rig rig(Script());
+        rig.responder.SetLatency(2ms);
+        const auto r = rig.sequencer.Run(Script());
+        CHECK(r.Complete());
+        // Each command waits for its answer (2 ms), never for the 30 ms timeout.
+        CHECK(r.elapsedMs < 30.0 * static_cast<double>(ScriptSize()) / 2);
+    }
+
+    void RetriesADroppedResponse()
+    {
+        Rig rig(Script());
+        rig.responder.DropNext(0x10, 0x01, 1);
+        const auto r = rig.sequencer.Run(Script());
+        CHECK(r.Complete());
+        CHECK(r.retried == 1);
+        CHECK(r.timedOut == 0);
+        CHECK(rig.responder.Writes() == ScriptSize() + 1);
+    }
+
+    void SkipsACommandThatIsNeverAcked()
+    {
+        Rig rig(Script());
+        rig.responder.Ignore(0x16, 0x01);
+        const auto r = rig.sequencer.Run(Script());
+        CHECK(!r.Complete());
+        CHECK(r.sent == ScriptSize());
+        CHECK(r.acked == ScriptSize() - 1);
+        CHECK(r.retried == 1);
+        CHECK(r.timedOut == 1);
+        CHECK(!r.blind);
+        CHECK(rig.responder.Writes() == ScriptSize() + 1);
+    }
+
+    void FallsBackToBlindPacingWhenSilent()
+    {
+        Rig rig(Script());
+        rig.responder.SetSilent(true);
+        const auto r = rig.sequencer.Run(Script());
+        CHECK(r.blind);
+        CHECK(r.sent == ScriptSize());
+        CHECK(r.acked == 0);
+        // Only the first command is retried and timed out; the rest go out
+        // once each on the fixed delay.
+        CHECK(r.retried == 1);
+        CHECK(r.timedOut == 1);
+        CHECK(rig.responder.Writes() == ScriptSize() + 1);
+    }
+
+    void StaysPacedWhenOnlyTheFirstAckIsLate()
+    {
+        Rig rig(Script());
+        rig.responder.DropNext(0x07, 0x01, 1);
+        const auto r = rig.sequencer.Run(Script());
+        CHECK(!r.blind);
+        CHECK(r.Complete());
+        CHECK(r.retried == 1);
+    }
+
+    void StopsWhenCancelled()
+    {
+        Rig rig(Script());
+        std::atomic<bool> cancel{ false };
+        size_t replies = 0;
+        rig.sequencer.OnReply([&](const CommandReply&) {
+            if (++replies == 3) cancel = true;
+        });
+        const auto r = rig.sequencer.Run(Script(), &cancel);
+        CHECK(r.sent == 3);
+        CHECK(r.acked == 3);
+        CHECK(rig.responder.Writes() == 3);
+    }
+
+    void PassesPayloadsToOnReply()
+    {
+        Rig rig(Script());
+        rig.responder.SetPayload([](const uint8_t* command, size_t) {
+            return std::vector<uint8_t>{ command[0], 0xAB };
+        });
+        bool sawPayload = true;
+        rig.sequencer.OnReply([&](const CommandReply& reply) {
+            sawPayload = sawPayload && reply.payload.size() == 10 &&
+                         reply.payload[8] == reply.header.cmd && reply.payload[9] == 0xAB;
+        });
+        CHECK(rig.sequencer.Run(Script()).Complete());
+        CHECK(sawPayload);
+    }
+}
+
+int main()
+{
+    RUN_TEST(AcksEveryCommand);
+    RUN_TEST(PacesOnAcksNotTimeouts);
+    RUN_TEST(RetriesADroppedResponse);
+    RUN_TEST(SkipsACommandThatIsNeverAcked);
+    RUN_TEST(FallsBackToBlindPacingWhenSilent);
+    RUN_TEST(StaysPacedWhenOnlyTheFirstAckIsLate);
+    RUN_TEST(StopsWhenCancelled);
+    RUN_TEST(PassesPayloadsToOnReply);
+    return test::Result();
+}
@@ -0,0 +1,222 @@
+#include "CoroutineExecutor.h"
+#include "TestCheck.h"
+
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using namespace std::chrono_literals;
+    using Clock = Executor::Clock;
+
+    // Wake-ups in the order they happened, with when.
+    struct Log {
+        std::mutex mutex;
+        std::vector<std::pair<int, Clock::time_point>> entries;
+
+        void Add(int id)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            entries.emplace_back(id, Clock::now());
+        }
+        size_t Size()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return entries.size();
+        }
+    };
+
+    Task<> SleepThenLog(Executor& ex, Clock::duration delay, int id, Log& log)
+    {
+        co_await ex.Sleep(delay);
+        log.Add(id);
+    }
+
+    Task<> WakeAtThenLog(Executor& ex, Clock::time_point when, int id, Log& log)
+    {
+        co_await Executor::SleepAwaiter{ ex, when };
+        log.Add(id);
+    }
+
+    Task<int> AwaitCompletion(Completion<int>& c, Executor& ex, bool& onExecutor)
+    {
+        const int v = co_await c;
+        onExecutor = ex.OnExecutorThread();
+        co_return v;
+    }
+
+    Task<int> SleepThenReturn(Executor& ex, Clock::duration delay, int value, Log& log)
+    {
+        co_await ex.Sleep(delay);
+        log.Add(value);
+        co_return value;
+    }
+
+    Task<int> SleepThenThrow(Executor& ex, Clock::duration delay)
+    {
+        co_await ex.Sleep(delay);
+        throw std::runtime_error("lost link");
+    }
+
+    Task<std::vector<int>> All(Executor& ex, std::vector<Task<int>> tasks)
+    {
+        co_return co_await WhenAll(ex, std::move(tasks));
+    }
+
+    Task<int> Throws()
+    {
+        throw std::runtime_error("no ack");
+        co_return 0;
+    }
+
+    Task<int> AwaitsAThrower()
+    {
+        // An exception passes through every co_await up to the spawner.
+        const int v = co_await Throws();
+        co_return v + 1;
+    }
+
+    Task<> ThrowsVoid(Executor& ex)
+    {
+        co_await ex.Schedule();
+        throw std::logic_error("bad state");
+    }
+
+    void TimedWorkWakesInDeadlineOrder()
+    {
+        Executor ex;
+        Log log;
+        const auto start = Clock::now();
+        Spawn(ex, SleepThenLog(ex, 30ms, 3, log));
+        Spawn(ex, SleepThenLog(ex, 10ms, 1, log));
+        Spawn(ex, WakeAtThenLog(ex, start + 20ms, 2, log));
+        // Nothing runs until someone pumps the executor.
+        CHECK(log.Size() == 0);
+        ex.RunUntil([&] { return log.Size() == 3; });
+
+        CHECK(log.entries.size() == 3);
+        const Clock::duration due[] = { 10ms, 20ms, 30ms };
+        for (size_t i = 0; i < log.entries.size() && i < 3; ++i) {
+            CHECK(log.entries[i].first == static_cast<int>(i + 1));
+            CHECK(log.entries[i].second - start >= due[i]);
+        }
+        CHECK(ex.Pending() == 0);
+    }
+
+    void CompletionSetOnAnotherThreadResumesOnTheExecutor()
+    {
+        Executor ex;
+        ex.Start();
+        Completion<int> c(ex);
+        bool onExecutor = false;
+        auto result = SpawnFuture(ex, AwaitCompletion(c, ex, onExecutor));
+
+        std::thread setter([&] {
+            std::this_thread::sleep_for(10ms);
+            CHECK(c.Set(42));
+            CHECK(!c.Set(7));
+        });
+        CHECK(result.wait_for(2s) == std::future_status::ready);
+        CHECK(result.get() == 42);
+        CHECK(onExecutor);
+        CHECK(c.IsSet());
+        setter.join();
+        ex.Stop();
+    }
+
+    void CompletionWakesAPumpedExecutor()
+    {
+        Executor ex;
+        Completion<int> c(ex);
+        bool onExecutor = false;
+        int value = 0;
+        bool done = false;
+        Spawn<int>(ex, AwaitCompletion(c, ex, onExecutor), [&](std::optional<int> v, std::exception_ptr) {
+            value = v.value_or(0);
+            done = true;
+        });
+        std::thread setter([&] {
+            std::this_thread::sleep_for(10ms);
+            c.Set(5);
+        });
+        ex.RunUntil([&] { return done; });
+        setter.join();
+        CHECK(value == 5);
+    }
+
+    void WhenAllRunsTasksTogetherAndKeepsOrder()
+    {
+        Executor ex;
+        ex.Start();
+        Log log;
+        std::vector<Task<int>> tasks;
+        tasks.push_back(SleepThenReturn(ex, 40ms, 0, log));
+        tasks.push_back(SleepThenReturn(ex, 20ms, 10, log));
+        tasks.push_back(SleepThenReturn(ex, 30ms, 20, log));
+        const auto start = Clock::now();
+        auto result = SpawnFuture(ex, All(ex, std::move(tasks)));
+        CHECK(result.wait_for(2s) == std::future_status::ready);
+        const auto elapsed = Clock::now() - start;
+
+        CHECK((result.get() == std::vector<int>{ 0, 10, 20 }));
+        // Finished in wake-up order, not input order, and together.
+        CHECK(log.Size() == 3);
+        CHECK(log.entries.size() == 3 && log.entries[0].first == 10 && log.entries[2].first == 0);
+        CHECK(elapsed < 85ms);
+
+        auto none = SpawnFuture(ex, All(ex, {}));
+        CHECK(none.wait_for(2s) == std::future_status::ready);
+        CHECK(none.get().empty());
+        ex.Stop();
+    }
+
+    void WhenAllRethrowsAfterEveryTaskFinished()
+    {
+        Executor ex;
+        ex.Start();
+        Log log;
+        std::vector<Task<int>> tasks;
+        tasks.push_back(SleepThenThrow(ex, 5ms));
+        tasks.push_back(SleepThenReturn(ex, 30ms, 1, log));
+        auto result = SpawnFuture(ex, All(ex, std::move(tasks)));
+        CHECK(result.wait_for(2s) == std::future_status::ready);
+        bool threw = false;
+        try { result.get(); } catch (const std::runtime_error& e) { threw = std::string(e.what()) == "lost link"; }
+        CHECK(threw);
+        CHECK(log.Size() == 1);
+        ex.Stop();
+    }
+
+    void SpawnFuturePropagatesExceptions()
+    {
+        Executor ex;
+        ex.Start();
+
+        auto value = SpawnFuture(ex, AwaitsAThrower());
+        bool threw = false;
+        try { value.get(); } catch (const std::runtime_error& e) { threw = std::string(e.what()) == "no ack"; }
+        CHECK(threw);
+
+        auto none = SpawnFuture(ex, ThrowsVoid(ex));
+        threw = false;
+        try { none.get(); } catch (const std::logic_error& e) { threw = std::string(e.what()) == "bad state"; }
+        CHECK(threw);
+        ex.Stop();
+    }
+}
+
+int main()
+{
+    RUN_TEST(TimedWorkWakesInDeadlineOrder);
+    RUN_TEST(CompletionSetOnAnotherThreadResumesOnTheExecutor);
+    RUN_TEST(CompletionWakesAPumpedExecutor);
+    RUN_TEST(WhenAllRunsTasksTogetherAndKeepsOrder);
+    RUN_TEST(WhenAllRethrowsAfterEveryTaskFinished);
+    RUN_TEST(SpawnFuturePropagatesExceptions);
+    return test::Result();
+}
@@ -0,0 +1,203 @@
+#include "CommandSequencer.h"
+#include "FlashCalibration.h"
+#include "TestCheck.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    using namespace std::chrono_literals;
+
+    // Packs six 12-bit values the way the controller stores a stick record:
+    // center X/Y, distance to max X/Y, distance to min X/Y.
+    std::vector<uint8_t> PackStick(int centerX, int centerY, int maxDX, int maxDY, int minDX, int minDY)
+    {
+        const int v[6] = { centerX, centerY, maxDX, maxDY, minDX, minDY };
+        std::vector<uint8_t> out;
+        for (int i = 0; i < 3; ++i) {
+            const int a = v[i * 2], b = v[i * 2 + 1];
+            out.push_back(static_cast<uint8_t>(a & 0xFF));
+            out.push_back(static_cast<uint8_t>((a >> 8 & 0x0F) | (b & 0x0F) << 4));
+            out.push_back(static_cast<uint8_t>(b >> 4));
+        }
+        return out;
+    }
+
+    // A user record: two magic bytes, then the stick record.
+    std::vector<uint8_t> UserStick(const std::vector<uint8_t>& record, uint8_t magic0 = 0xB2, uint8_t magic1 = 0xA1)
+    {
+        std::vector<uint8_t> out(2 + record.size());
+        out[0] = magic0;
+        out[1] = magic1;
+        std::copy(record.begin(), record.end(), out.begin() + 2);
+        return out;
+    }
+
+    std::vector<uint8_t> GyroBias(int16_t x, int16_t y, int16_t z)
+    {
+        auto lo = [](int16_t v) { return static_cast<uint8_t>(v & 0xFF); };
+        auto hi = [](int16_t v) { return static_cast<uint8_t>(v >> 8 & 0xFF); };
+        return { lo(x), hi(x), lo(y), hi(y), lo(z), hi(z) };
+    }
+
+    bool Stick(const StickCalibration& c, int centerX, int centerY, int minX, int maxX, int minY, int maxY)
+    {
+        return c.centerX == centerX && c.centerY == centerY && c.minX == minX && c.maxX == maxX &&
+               c.minY == minY && c.maxY == maxY;
+    }
+
+    // Runs an init script against a controller whose flash holds image, and
+    // decodes what its flash read replies carried, as the connect path does.
+    DeviceCalibration ReadThroughScript(const FakeFlashImage& image, const InitScript& script, FlashStickLayout layout)
+    {
+        CommandEngine engine;
+        FakeCommandResponder responder(script.prefixSize);
+        responder.Attach([&](const uint8_t* data, size_t size) { engine.OnResponse(data, size); });
+        responder.SetPayload([&](const uint8_t* command, size_t size) { return image.Reply(command, size); });
+
+        FlashCalibrationReader reader(layout);
+        CommandSequencer sequencer(engine, [&](const std::vector<uint8_t>& packet) { return responder.Write(packet); },
+                                   CommandSequencer::Options{ 30ms, 0, 1ms });
+        sequencer.OnReply([&](const CommandReply& reply) {
+            if (reply.header.cmd == FLASH_READ_CMD && reply.header.sub == FLASH_READ_SUB)
+                reader.Feed(reply.payload.data(), reply.payload.size());
+        });
+        CHECK(sequencer.Run(script).Complete());
+        return reader.Result();
+    }
+
+    void DecodesPackedStickRecords()
+    {
+        StickCalibration c;
+        CHECK(DecodeStickCalibration(PackStick(2048, 2000, 1400, 1300, 1200, 1100).data(), c));
+        CHECK(Stick(c, 2048, 2000, 848, 3448, 900, 3300));
+
+        const std::vector<uint8_t> erased(9, 0xFF), zeroed(9, 0x00);
+        CHECK(!DecodeStickCalibration(erased.data(), c));
+        CHECK(!DecodeStickCalibration(zeroed.data(), c));
+        CHECK(!DecodeStickCalibration(PackStick(500, 2000, 1400, 1300, 1200, 1100).data(), c));
+        CHECK(!DecodeStickCalibration(PackStick(2048, 2000, 100, 1300, 1200, 1100).data(), c));
+        CHECK(!DecodeStickCalibration(nullptr, c));
+    }
+
+    void ParsesOnlyFlashReadReplies()
+    {
+        FlashRead read;
+        const uint8_t reply[] = { 0x02, 0x01, 0x01, 0x04, 0x10, 0x78, 0x00, 0x00,
+                                  0x02, 0x7E, 0x00, 0x00, 0x40, 0x30, 0x01, 0x00, 0xAA, 0xBB };
+        CHECK(ParseFlashReadReply(reply, sizeof(reply), read));
+        CHECK(read.address == 0x13040 && read.data.size() == 2 && read.data[1] == 0xBB);
+        CHECK(!ParseFlashReadReply(reply, sizeof(reply) - 1, read));
+        uint8_t otherCommand[sizeof(reply)];
+        std::copy(reply, reply + sizeof(reply), otherCommand);
+        otherCommand[0] = 0x07;
+        CHECK(!ParseFlashReadReply(otherCommand, sizeof(otherCommand), read));
+    }
+
+    void FactoryOnly()
+    {
+        FakeFlashImage image;
+        image.Write(FLASH_FACTORY_PRIMARY_STICK, PackStick(2048, 2000, 1400, 1300, 1200, 1100));
+        const auto c = ReadThroughScript(image, JoyCon2InitScript(), FlashStickLayout::LeftOnly);
+        CHECK(c.hasLeftStick && !c.leftFromUser);
+        CHECK(Stick(c.leftStick, 2048, 2000, 848, 3448, 900, 3300));
+        CHECK(!c.hasRightStick);
+        // The rest of the flash reads back erased.
+        CHECK(!c.hasGyroBias);
+    }
+
+    void UserRecordWinsOverFactory()
+    {
+        FakeFlashImage image;
+        image.Write(FLASH_FACTORY_PRIMARY_STICK, PackStick(2048, 2000, 1400, 1300, 1200, 1100));
+        image.Write(FLASH_USER_PRIMARY_STICK, UserStick(PackStick(2100, 1950, 1500, 1500, 1500, 1500)));
+        const auto c = ReadThroughScript(image, JoyCon2InitScript(), FlashStickLayout::RightOnly);
+        CHECK(c.hasRightStick && c.rightFromUser);
+        CHECK(Stick(c.rightStick, 2100, 1950, 600, 3600, 450, 3450));
+        CHECK(!c.hasLeftStick);
+    }
+
+    void ErasedOrUnmarkedUserRecordFallsBack()
+    {
+        FakeFlashImage image;
+        image.Write(FLASH_FACTORY_PRIMARY_STICK, PackStick(2048, 2000, 1400, 1300, 1200, 1100));
+        // Magic present but the record itself erased.
+        image.Write(FLASH_USER_PRIMARY_STICK, UserStick(std::vector<uint8_t>(9, 0xFF)));
+        auto c = ReadThroughScript(image, JoyCon2InitScript(), FlashStickLayout::LeftOnly);
+        CHECK(c.hasLeftStick && !c.leftFromUser);
+        CHECK(Stick(c.leftStick, 2048, 2000, 848, 3448, 900, 3300));
+
+        // A plausible record without the magic is not a user calibration.
+        image.Write(FLASH_USER_PRIMARY_STICK, UserStick(PackStick(2100, 1950, 1500, 1500, 1500, 1500), 0xFF, 0xFF));
+        c = ReadThroughScript(image, JoyCon2InitScript(), FlashStickLayout::LeftOnly);
+        CHECK(c.hasLeftStick && !c.leftFromUser);
+
+        // Nothing valid anywhere: no stick calibration at all.
+        FakeFlashImage blank;
+        c = ReadThroughScript(blank, JoyCon2InitScript(), FlashStickLayout::LeftOnly);
+        CHECK(!c.Any());
+    }
+
+    void ReadsBothSticksOfAProController()
+    {
+        FakeFlashImage image;
+        image.Write(FLASH_FACTORY_PRIMARY_STICK, PackStick(2048, 2000, 1400, 1300, 1200, 1100));
+        image.Write(FLASH_FACTORY_SECONDARY_STICK, PackStick(1990, 2060, 1350, 1350, 1250, 1250));
+        image.Write(FLASH_USER_SECONDARY_STICK, UserStick(PackStick(2000, 2050, 1400, 1400, 1400, 1400)));
+        const auto c = ReadThroughScript(image, ProCon2InitScript(), FlashStickLayout::Both);
+        CHECK(c.hasLeftStick && !c.leftFromUser);
+        CHECK(Stick(c.leftStick, 2048, 2000, 848, 3448, 900, 3300));
+        CHECK(c.hasRightStick && c.rightFromUser);
+        CHECK(Stick(c.rightStick, 2000, 2050, 600, 3400, 650, 3450));
+    }
+
+    void GyroBiasMustBePlausible()
+    {
+        FakeFlashImage image;
+        image.Write(FLASH_IMU_CALIBRATION, GyroBias(-12, 40, 7));
+        auto c = ReadThroughScript(image, JoyCon2InitScript(), FlashStickLayout::LeftOnly);
+        CHECK(c.hasGyroBias);
+        CHECK(c.gyroBiasX == -12.0f && c.gyroBiasY == 40.0f && c.gyroBiasZ == 7.0f);
+
+        MotionScale scale;
+        c.ApplyTo(scale);
+        CHECK(scale.gyroBiasY == 40.0f);
+
+        image.Write(FLASH_IMU_CALIBRATION, GyroBias(-12, 1500, 7));
+        c = ReadThroughScript(image, JoyCon2InitScript(), FlashStickLayout::LeftOnly);
+        CHECK(!c.hasGyroBias);
+    }
+
+    void CacheRoundTrip()
+    {
+        FakeFlashImage image;
+        image.Write(FLASH_FACTORY_PRIMARY_STICK, PackStick(2048, 2000, 1400, 1300, 1200, 1100));
+        image.Write(FLASH_IMU_CALIBRATION, GyroBias(-12, 40, 7));
+        const auto read = ReadThroughScript(image, JoyCon2InitScript(), FlashStickLayout::LeftOnly);
+
+        FlashCalibrationCache cache("unused");
+        cache.Store(0x98B6E9A1B2C3ull, read);
+        cache.Store(0x98B6E9A1B2C4ull, DeviceCalibration{});   // nothing to keep
+        FlashCalibrationCache loaded("unused");
+        CHECK(loaded.Parse(cache.Serialize()));
+        DeviceCalibration c;
+        CHECK(loaded.Find(0x98B6E9A1B2C3ull, c));
+        CHECK(c.hasLeftStick && Stick(c.leftStick, 2048, 2000, 848, 3448, 900, 3300));
+        CHECK(c.hasGyroBias && c.gyroBiasX == -12.0f);
+        CHECK(!loaded.Find(0x98B6E9A1B2C4ull, c));
+    }
+}
+
+int main()
+{
+    RUN_TEST(DecodesPackedStickRecords);
+    RUN_TEST(ParsesOnlyFlashReadReplies);
+    RUN_TEST(FactoryOnly);
+    RUN_TEST(UserRecordWinsOverFactory);
+    RUN_TEST(ErasedOrUnmarkedUserRecordFallsBack);
+    RUN_TEST(ReadsBothSticksOfAProController);
+    RUN_TEST(GyroBiasMustBePlausible);
+    RUN_TEST(CacheRoundTrip);
+    return test::Result();
+}
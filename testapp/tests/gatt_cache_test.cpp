@@ -0,0 +1,214 @@
+#include "GattCache.h"
+#include "TestCheck.h"
+
+#include <filesystem>
+#include <string>
+
+namespace
+{
+    constexpr uint64_t kAddress = 0x98B6E9A1B2C3ull;
+    constexpr uint16_t kProductId = 0x2069;
+
+    Uuid128 U(const char* text)
+    {
+        Uuid128 u;
+        ParseUuid(text, u);
+        return u;
+    }
+
+    const Uuid128 kService = U("ab7de9be-89fe-49ad-828f-118f09df7fd0");
+    const Uuid128 kInput = U("ab7de9be-89fe-49ad-828f-118f09df7fd2");
+    const Uuid128 kWrite = U("649d4ac9-8eb7-4e6c-af44-1ea54fe5f005");
+    const Uuid128 kRumblePro = U("3dacbc7e-6955-40b5-8eaf-6f9809e8b379");
+
+    GattCacheEntry ValidEntry(uint64_t address = kAddress)
+    {
+        GattCacheEntry e;
+        e.address = address;
+        e.productId = kProductId;
+        e.characteristics = {
+            { GattRole::InputReport, kService, kInput },
+            { GattRole::WriteCommand, kService, kWrite },
+            { GattRole::RumblePro, kService, kRumblePro },
+        };
+        return e;
+    }
+
+    bool SameEntry(const GattCacheEntry& a, const GattCacheEntry& b)
+    {
+        if (a.address != b.address || a.productId != b.productId) return false;
+        if (a.characteristics.size() != b.characteristics.size()) return false;
+        for (size_t i = 0; i < a.characteristics.size(); ++i) {
+            const auto& x = a.characteristics[i];
+            const auto& y = b.characteristics[i];
+            if (x.role != y.role || x.service != y.service || x.characteristic != y.characteristic) return false;
+        }
+        return true;
+    }
+
+    void UuidsRoundTrip()
+    {
+        Uuid128 u;
+        CHECK(ParseUuid("{649D4AC9-8EB7-4E6C-AF44-1EA54FE5F005}", u));
+        CHECK(u == kWrite);
+        CHECK(FormatUuid(u) == "649d4ac9-8eb7-4e6c-af44-1ea54fe5f005");
+        CHECK(!ParseUuid("649d4ac9-8eb7-4e6c-af44-1ea54fe5f00", u));
+        CHECK(!ParseUuid("649d4ac9x8eb7-4e6c-af44-1ea54fe5f005", u));
+        CHECK(!ParseUuid("649d4ac9-8eb7-4e6c-af44-1ea54fe5f00g", u));
+
+        uint32_t d1;
+        uint16_t d2, d3;
+        uint8_t d4[8];
+        UuidToGuidFields(kRumblePro, d1, d2, d3, d4);
+        CHECK(d1 == 0x3dacbc7e && d2 == 0x6955 && d3 == 0x40b5 && d4[0] == 0x8e && d4[7] == 0x79);
+        CHECK(UuidFromGuidFields(d1, d2, d3, d4) == kRumblePro);
+
+        GattRole role;
+        CHECK(LookupGattRole(kInput, role) && role == GattRole::InputReport);
+        CHECK(!LookupGattRole(kService, role));
+    }
+
+    void StoreFindAndInvalidate()
+    {
+        GattCache cache("unused");
+        CHECK(cache.Store(ValidEntry()));
+        GattCacheEntry found;
+        CHECK(cache.Find(kAddress, kProductId, found));
+        CHECK(SameEntry(found, ValidEntry()));
+        // Keyed by product too: the same address as another controller is a miss.
+        CHECK(!cache.Find(kAddress, 0x2066, found));
+
+        cache.Invalidate(kAddress, kProductId);
+        CHECK(!cache.Find(kAddress, kProductId, found));
+        CHECK(cache.Size() == 0);
+    }
+
+    void StoreRejectsInvalidEntries()
+    {
+        GattCache cache("unused");
+
+        GattCacheEntry noAddress = ValidEntry(0);
+        CHECK(!cache.Store(noAddress));
+
+        GattCacheEntry noWrite = ValidEntry();
+        noWrite.characteristics.erase(noWrite.characteristics.begin() + 1);
+        CHECK(!cache.Store(noWrite));
+
+        // A characteristic stored under a role its UUID does not have.
+        GattCacheEntry wrongRole = ValidEntry();
+        wrongRole.characteristics[2].role = GattRole::RumbleLeft;
+        CHECK(!cache.Store(wrongRole));
+
+        GattCacheEntry unknownCharacteristic = ValidEntry();
+        unknownCharacteristic.characteristics[2].characteristic = kService;
+        CHECK(!cache.Store(unknownCharacteristic));
+
+        GattCacheEntry repeatedRole = ValidEntry();
+        repeatedRole.characteristics.push_back(repeatedRole.characteristics[0]);
+        CHECK(!cache.Store(repeatedRole));
+
+        GattCacheEntry noService = ValidEntry();
+        noService.characteristics[0].service = Uuid128{};
+        CHECK(!cache.Store(noService));
+
+        CHECK(cache.Size() == 0);
+    }
+
+    void SerializeParseRoundTrip()
+    {
+        GattCache cache("unused");
+        cache.Store(ValidEntry());
+        cache.Store(ValidEntry(kAddress + 1));
+        const std::string text = cache.Serialize();
+
+        GattCache loaded("unused");
+        CHECK(loaded.Parse(text));
+        CHECK(loaded.Size() == 2);
+        GattCacheEntry found;
+        CHECK(loaded.Find(kAddress, kProductId, found) && SameEntry(found, ValidEntry()));
+        CHECK(loaded.Find(kAddress + 1, kProductId, found) && SameEntry(found, ValidEntry(kAddress + 1)));
+        CHECK(loaded.Serialize().size() == text.size());
+    }
+
+    void ParseDropsStaleAndCorruptBlocks()
+    {
+        const std::string good =
+            "device 98b6e9a1b2c3 2069\r\n"
+            "char InputReport ab7de9be-89fe-49ad-828f-118f09df7fd0 ab7de9be-89fe-49ad-828f-118f09df7fd2\r\n"
+            "char WriteCommand ab7de9be-89fe-49ad-828f-118f09df7fd0 649d4ac9-8eb7-4e6c-af44-1ea54fe5f005\r\n"
+            "end\r\n";
+        const std::string text =
+            "# joycon2cpp GATT cache v1\r\n" + good +
+            // Stale: the write characteristic is filed under another role.
+            "device 98b6e9a1b2c4 2069\n"
+            "char InputReport ab7de9be-89fe-49ad-828f-118f09df7fd0 ab7de9be-89fe-49ad-828f-118f09df7fd2\n"
+            "char RumblePro ab7de9be-89fe-49ad-828f-118f09df7fd0 649d4ac9-8eb7-4e6c-af44-1ea54fe5f005\n"
+            "end\n"
+            // Corrupt UUID.
+            "device 98b6e9a1b2c5 2069\n"
+            "char InputReport ab7de9be-89fe-49ad-828f-118f09df7fd0 ab7de9be-89fe-49ad-828f-118f09df7f\n"
+            "char WriteCommand ab7de9be-89fe-49ad-828f-118f09df7fd0 649d4ac9-8eb7-4e6c-af44-1ea54fe5f005\n"
+            "end\n"
+            // Unknown role name.
+            "device 98b6e9a1b2c6 2069\n"
+            "char Bogus ab7de9be-89fe-49ad-828f-118f09df7fd0 ab7de9be-89fe-49ad-828f-118f09df7fd2\n"
+            "end\n"
+            // Product id out of range.
+            "device 98b6e9a1b2c7 12069\n"
+            "char InputReport ab7de9be-89fe-49ad-828f-118f09df7fd0 ab7de9be-89fe-49ad-828f-118f09df7fd2\n"
+            "char WriteCommand ab7de9be-89fe-49ad-828f-118f09df7fd0 649d4ac9-8eb7-4e6c-af44-1ea54fe5f005\n"
+            "end\n"
+            // Truncated: no end line.
+            "device 98b6e9a1b2c8 2069\n"
+            "char InputReport ab7de9be-89fe-49ad-828f-118f09df7fd0 ab7de9be-89fe-49ad-828f-118f09df7fd2\n"
+            "char WriteCommand ab7de9be-89fe-49ad-828f-118f09df7fd0 649d4ac9-8eb7-4e6c-af44-1ea54fe5f005\n";
+
+        GattCache cache("unused");
+        CHECK(cache.Parse(text));
+        CHECK(cache.Size() == 1);
+        GattCacheEntry found;
+        CHECK(cache.Find(kAddress, kProductId, found));
+        CHECK(found.characteristics.size() == 2);
+    }
+
+    void ParseRejectsAnotherFormat()
+    {
+        GattCache cache("unused");
+        cache.Store(ValidEntry());
+        CHECK(!cache.Parse("# joycon2cpp GATT cache v2\ndevice 98b6e9a1b2c3 2069\nend\n"));
+        CHECK(!cache.Parse(""));
+        // A rejected file leaves what was there.
+        CHECK(cache.Size() == 1);
+    }
+
+    void SaveAndLoad()
+    {
+        const auto path = std::filesystem::temp_directory_path() / "joycon2cpp_gatt_cache_test.txt";
+        std::filesystem::remove(path);
+
+        GattCache missing(path.string());
+        CHECK(!missing.Load());
+
+        GattCache cache(path.string());
+        cache.Store(ValidEntry());
+        CHECK(cache.Save());
+
+        GattCache loaded(path.string());
+        CHECK(loaded.Load());
+        GattCacheEntry found;
+        CHECK(loaded.Find(kAddress, kProductId, found) && SameEntry(found, ValidEntry()));
+        std::filesystem::remove(path);
+    }
+}
+
+int main()
+{
+    RUN_TEST(UuidsRoundTrip);
+    RUN_TEST(StoreFindAndInvalidate);
+    RUN_TEST(StoreRejectsInvalidEntries);
+    RUN_TEST(SerializeParseRoundTrip);
+    RUN_TEST(ParseDropsStaleAndCorruptBlocks);
+    RUN_TEST(ParseRejectsAnotherFormat);
+    RUN_TEST(SaveAndLoad);
+    return test::Result();
+}
@@ -0,0 +1,83 @@
+#include "GyroAim.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <random>
+
+namespace
+{
+    // A controller lying flat (gravity on +Z, so yaw is the Z rate), sampled
+    // every 4 ms.
+    struct Feed {
+        GyroAim aim;
+        uint64_t us = 1000;
+
+        GyroAimResult Step(float gyroX, float gyroZ, const GyroAimTuning& tuning)
+        {
+            MotionSample s;
+            s.gyroX = gyroX;
+            s.gyroZ = gyroZ;
+            s.accelZ = 1.f;
+            s.timestampUs = us += 4000;
+            s.valid = true;
+            GyroAimResult r;
+            aim.Update(s, GyroAimOutput::RightStick, tuning, r);
+            return r;
+        }
+    };
+
+    float Magnitude(const GyroAimResult& r)
+    {
+        return std::sqrt(r.stickX * r.stickX + r.stickY * r.stickY);
+    }
+
+    void StickStaysCentredAtRest()
+    {
+        std::mt19937 rng(7);
+        std::normal_distribution<float> noise(0.f, 0.15f);
+        for (float tightening : { 3.f, 0.f }) {
+            GyroAimTuning tuning;
+            tuning.tighteningDps = tightening;
+            Feed feed;
+            bool centred = true;
+            for (int i = 0; i < 500; ++i) {
+                const auto r = feed.Step(noise(rng), noise(rng), tuning);
+                centred = centred && r.stickX == 0.f && r.stickY == 0.f;
+            }
+            CHECK(centred);
+        }
+    }
+
+    void SlowTurnStartsAtTheDeadzoneEdge()
+    {
+        GyroAimTuning tuning;
+        tuning.stickDeadzone = 0.2f;
+        Feed feed;
+        feed.Step(0.f, 0.f, tuning);
+        // Slow, but past the rest rate: the game sees it.
+        const auto r = feed.Step(0.f, 1.5f, tuning);
+        CHECK(Magnitude(r) >= 0.2f);
+        CHECK(Magnitude(r) < 0.25f);
+        // Positive yaw turns left.
+        CHECK(r.stickX < 0.f);
+    }
+
+    void FastTurnReachesFullDeflection()
+    {
+        GyroAimTuning tuning;
+        Feed feed;
+        feed.Step(0.f, 0.f, tuning);
+        const auto r = feed.Step(-720.f, 0.f, tuning);
+        CHECK(std::fabs(Magnitude(r) - 1.f) < 1e-4f);
+        // Negative pitch lowers the nose: stick down, which is +y.
+        CHECK(r.stickY > 0.9f);
+    }
+}
+
+int main()
+{
+    RUN_TEST(StickStaysCentredAtRest);
+    RUN_TEST(SlowTurnStartsAtTheDeadzoneEdge);
+    RUN_TEST(FastTurnReachesFullDeflection);
+    return test::Result();
+}
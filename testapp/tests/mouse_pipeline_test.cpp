@@ -0,0 +1,170 @@
+#include "MousePipeline.h"
+#include "TestCheck.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+    // The app's SLOW mouse mode.
+    constexpr float kSlow = 0.3f;
+
+    // Runs one report through the pipeline into the sink, one batch per report.
+    void Feed(MousePipeline& pipeline, RecordingMouseSink& sink, const MouseReport& report, float scale = 1.f)
+    {
+        MouseBatch batch;
+        pipeline.Process(report, scale, batch);
+        if (!batch.Empty()) sink.Send(batch);
+    }
+
+    MouseReport At(int x, int y)
+    {
+        MouseReport r;
+        r.opticalX = static_cast<int16_t>(x);
+        r.opticalY = static_cast<int16_t>(y);
+        return r;
+    }
+
+    bool Is(const MouseEvent& e, MouseEvent::Type type, MouseButton button)
+    {
+        return e.type == type && e.button == button;
+    }
+
+    void SlowMotionCarriesSubPixels()
+    {
+        MousePipeline pipeline;
+        RecordingMouseSink sink;
+        Feed(pipeline, sink, At(0, 0), kSlow);
+
+        // One count per report is 0.3 px: nothing for the first three
+        // reports, then the carried fractions add up to whole pixels.
+        for (int i = 1; i <= 3; ++i) Feed(pipeline, sink, At(i, -i), kSlow);
+        CHECK(sink.Batches() == 0);
+        for (int i = 4; i <= 20; ++i) Feed(pipeline, sink, At(i, -i), kSlow);
+        CHECK(sink.TotalX() >= 5 && sink.TotalX() <= 6);
+        CHECK(sink.TotalY() <= -5 && sink.TotalY() >= -6);
+        for (const MouseEvent& e : sink.Events())
+            CHECK(e.type == MouseEvent::Type::Move && std::abs(e.dx) <= 1 && std::abs(e.dy) <= 1);
+
+        // Reset drops the carried fraction along with the position.
+        pipeline.Reset();
+        sink.Clear();
+        Feed(pipeline, sink, At(100, 0), kSlow);
+        Feed(pipeline, sink, At(103, 0), kSlow);
+        CHECK(sink.Batches() == 0);
+    }
+
+    void SensorCounterWrapsToASmallMove()
+    {
+        CHECK(MousePipeline::WrapDelta(INT16_MIN, INT16_MAX) == 1);    // 0x7FFF -> 0x8000
+        CHECK(MousePipeline::WrapDelta(INT16_MAX, INT16_MIN) == -1);
+        CHECK(MousePipeline::WrapDelta(0, -1) == 1);                   // 0xFFFF -> 0
+        CHECK(MousePipeline::WrapDelta(-1, 0) == -1);
+        CHECK(MousePipeline::WrapDelta(5, -3) == 8);
+
+        MousePipeline pipeline;
+        RecordingMouseSink sink;
+        Feed(pipeline, sink, At(0x7FFE, 0xFFFE));
+        Feed(pipeline, sink, At(0x8001, 0x0001));
+        CHECK(sink.TotalX() == 3);
+        CHECK(sink.TotalY() == 3);
+    }
+
+    void GainTableFollowsTheCurve()
+    {
+        MousePipeline pipeline({ 2.f, 1.f });
+        CHECK(pipeline.Gain(0.f) == 2.f);
+        CHECK(pipeline.Gain(16.f) == 4.f);
+        CHECK(pipeline.Gain(15.6f) == 4.f);   // nearest entry
+        CHECK(pipeline.Gain(static_cast<float>(MousePipeline::kSaturation)) == 10.f);
+        CHECK(pipeline.Gain(1000.f) == 10.f);
+        CHECK(pipeline.Gain(-5.f) == 2.f);
+
+        pipeline.SetCurve({ 0.5f, 0.f });
+        CHECK(pipeline.Curve() == (MouseCurve{ 0.5f, 0.f }));
+        CHECK(pipeline.Gain(0.f) == 0.5f && pipeline.Gain(64.f) == 0.5f);
+
+        // A fast swipe goes further than the same distance moved slowly.
+        MousePipeline accel({ 1.f, 1.f });
+        RecordingMouseSink fast, slow;
+        Feed(accel, fast, At(0, 0));
+        Feed(accel, fast, At(32, 0));
+        accel.Reset();
+        Feed(accel, slow, At(0, 0));
+        for (int x = 1; x <= 32; ++x) Feed(accel, slow, At(x, 0));
+        CHECK(fast.TotalX() == 96);
+        CHECK(slow.TotalX() < fast.TotalX());
+    }
+
+    void OneBatchPerReportWithinItsBound()
+    {
+        MousePipeline pipeline;
+        RecordingMouseSink sink;
+        Feed(pipeline, sink, At(0, 0));
+
+        // Everything at once: move, three buttons, scroll and a back flick.
+        size_t reports = 0;
+        for (int i = 1; i <= 8; ++i) {
+            MouseReport r = At(i * 4, i * 2);
+            r.left = r.right = r.middle = (i % 2) == 1;
+            r.stickY = 32767;
+            r.stickX = (i % 2) ? -32767 : 0;
+            MouseBatch batch;
+            pipeline.Process(r, 1.f, batch);
+            CHECK(batch.count <= MouseBatch::kMaxEvents);
+            sink.Send(batch);
+            ++reports;
+        }
+        CHECK(sink.Batches() == reports);
+
+        size_t wheels = 0, backClicks = 0;
+        for (const MouseEvent& e : sink.Events()) {
+            if (e.type == MouseEvent::Type::Wheel) {
+                CHECK(e.wheel == -120);
+                ++wheels;
+            }
+            if (Is(e, MouseEvent::Type::Down, MouseButton::X1)) ++backClicks;
+        }
+        CHECK(wheels == 2);        // 40 wheel units a report at full deflection
+        CHECK(backClicks == 4);    // once per flick, not per report held
+
+        // A batch never grows past its fixed size.
+        MouseBatch full;
+        for (size_t i = 0; i < MouseBatch::kMaxEvents + 3; ++i) full.Add(MouseEvent{});
+        CHECK(full.count == MouseBatch::kMaxEvents);
+    }
+
+    void ReleaseLetsGoOfHeldButtons()
+    {
+        MousePipeline pipeline;
+        MouseBatch batch;
+        MouseReport r = At(10, 10);
+        r.left = r.middle = true;
+        pipeline.Process(r, 1.f, batch);
+        CHECK(batch.count == 2);
+
+        batch.Clear();
+        pipeline.Release(batch);
+        CHECK(batch.count == 2);
+        CHECK(batch.count == 2 && Is(batch.events[0], MouseEvent::Type::Up, MouseButton::Left));
+        CHECK(batch.count == 2 && Is(batch.events[1], MouseEvent::Type::Up, MouseButton::Middle));
+
+        // Nothing is held any more, and the next report only sets the position.
+        batch.Clear();
+        pipeline.Release(batch);
+        CHECK(batch.Empty());
+        pipeline.Process(At(500, -500), 1.f, batch);
+        CHECK(batch.Empty());
+    }
+}
+
+int main()
+{
+    RUN_TEST(SlowMotionCarriesSubPixels);
+    RUN_TEST(SensorCounterWrapsToASmallMove);
+    RUN_TEST(GainTableFollowsTheCurve);
+    RUN_TEST(OneBatchPerReportWithinItsBound);
+    RUN_TEST(ReleaseLetsGoOfHeldButtons);
+    return test::Result();
+}
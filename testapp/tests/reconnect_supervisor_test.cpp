@@ -0,0 +1,269 @@
+#include "ReconnectSupervisor.h"
+#include "TestCheck.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    using namespace std::chrono_literals;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr uint64_t kAddressA = 0x98B6E9000001ull;
+    constexpr uint64_t kAddressB = 0x98B6E9000002ull;
+
+    KnownDevice Device(uint64_t address, int player = 1)
+    {
+        KnownDevice d;
+        d.player = player;
+        d.address = address;
+        d.productId = 0x2069;
+        return d;
+    }
+
+    // Every state change the supervisor reported, with when it happened.
+    class Events {
+    public:
+        struct Event {
+            int               link;
+            LinkState         state;
+            uint32_t          attempts;
+            Clock::time_point at;
+        };
+
+        ReconnectSupervisor::EventFn Callback()
+        {
+            return [this](int link, LinkState state, uint32_t attempts) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                events_.push_back({ link, state, attempts, Clock::now() });
+                cv_.notify_all();
+            };
+        }
+
+        // Waits for the count'th event of state on link.
+        bool WaitFor(int link, LinkState state, size_t count = 1, std::chrono::milliseconds timeout = 2s)
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            return cv_.wait_for(lock, timeout, [&] { return CountLocked(link, state) >= count; });
+        }
+
+        std::vector<Event> Of(int link, LinkState state)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            std::vector<Event> out;
+            for (const auto& e : events_)
+                if (e.link == link && e.state == state) out.push_back(e);
+            return out;
+        }
+
+        std::vector<Event> All()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return events_;
+        }
+
+    private:
+        size_t CountLocked(int link, LinkState state) const
+        {
+            size_t n = 0;
+            for (const auto& e : events_)
+                n += e.link == link && e.state == state;
+            return n;
+        }
+
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::vector<Event> events_;
+    };
+
+    ReconnectSupervisor::Options Fast(std::chrono::milliseconds initial = 20ms, std::chrono::milliseconds max = 80ms)
+    {
+        ReconnectSupervisor::Options o;
+        o.initialBackoff = initial;
+        o.maxBackoff = max;
+        o.workers = 2;
+        return o;
+    }
+
+    void ReconnectsADroppedLink()
+    {
+        FakeReconnectTransport transport;
+        transport.SetReachable(kAddressA, true);
+        ReconnectSupervisor supervisor(transport, Fast());
+        Events events;
+        supervisor.OnEvent(events.Callback());
+
+        const int link = supervisor.Track(Device(kAddressA));
+        CHECK(supervisor.State(link) == LinkState::Connected);
+        supervisor.OnDisconnected(link);
+        CHECK(events.WaitFor(link, LinkState::Connected));
+
+        // Events are reported off the lock, so only their counts are fixed.
+        CHECK(events.All().size() == 3);
+        const auto waiting = events.Of(link, LinkState::Waiting);
+        const auto reconnecting = events.Of(link, LinkState::Reconnecting);
+        const auto connected = events.Of(link, LinkState::Connected);
+        CHECK(waiting.size() == 1 && waiting[0].attempts == 0);
+        CHECK(reconnecting.size() == 1 && reconnecting[0].attempts == 1);
+        CHECK(connected.size() == 1 && connected[0].attempts == 1);
+        CHECK(supervisor.State(link) == LinkState::Connected);
+        CHECK(supervisor.Attempts(link) == 0);
+        CHECK(supervisor.Reconnects() == 1);
+        CHECK(transport.Calls(kAddressA) == 1);
+
+        // A later drop starts over.
+        supervisor.OnDisconnected(link);
+        CHECK(events.WaitFor(link, LinkState::Connected, 2));
+        CHECK(supervisor.Reconnects() == 2);
+        CHECK(transport.Calls(kAddressA) == 2);
+    }
+
+    void BacksOffWhileUnreachable()
+    {
+        FakeReconnectTransport transport;
+        ReconnectSupervisor supervisor(transport, Fast(20ms, 80ms));
+        Events events;
+        supervisor.OnEvent(events.Callback());
+
+        const int link = supervisor.Track(Device(kAddressA));
+        const auto dropped = Clock::now();
+        supervisor.OnDisconnected(link);
+        CHECK(events.WaitFor(link, LinkState::Reconnecting, 6));
+
+        const auto attempts = events.Of(link, LinkState::Reconnecting);
+        // The first retry is immediate, then the wait doubles up to the cap.
+        CHECK(attempts[0].at - dropped < 20ms);
+        const std::chrono::milliseconds expected[] = { 20ms, 40ms, 80ms, 80ms, 80ms };
+        for (size_t i = 0; i < 5; ++i) {
+            const auto gap = attempts[i + 1].at - attempts[i].at;
+            CHECK(gap >= expected[i]);
+            CHECK(gap < expected[i] + 60ms);
+        }
+        CHECK(supervisor.Attempts(link) >= 6);
+
+        // Once the controller is back the next attempt rebinds it and the
+        // count starts over.
+        transport.SetReachable(kAddressA, true);
+        CHECK(events.WaitFor(link, LinkState::Connected));
+        CHECK(supervisor.State(link) == LinkState::Connected);
+        CHECK(supervisor.Attempts(link) == 0);
+        CHECK(supervisor.Reconnects() == 1);
+    }
+
+    void RetriesADropDuringReconnect()
+    {
+        FakeReconnectTransport transport;
+        transport.SetReachable(kAddressA, true);
+        ReconnectSupervisor supervisor(transport, Fast());
+        Events events;
+        supervisor.OnEvent(events.Callback());
+        const int link = supervisor.Track(Device(kAddressA));
+
+        // The link drops again while the first reconnect is still binding.
+        bool droppedOnce = false;
+        transport.OnConnect([&](int l) {
+            if (droppedOnce) return;
+            droppedOnce = true;
+            supervisor.OnDisconnected(l);
+        });
+
+        supervisor.OnDisconnected(link);
+        CHECK(events.WaitFor(link, LinkState::Connected));
+        CHECK(transport.Calls(kAddressA) == 2);
+        CHECK(events.Of(link, LinkState::Reconnecting).size() == 2);
+        CHECK(supervisor.Reconnects() == 1);
+    }
+
+    void ReconnectsLinksInParallel()
+    {
+        FakeReconnectTransport transport;
+        transport.SetReachable(kAddressA, true);
+        transport.SetReachable(kAddressB, true);
+        transport.SetLatency(100ms);
+        ReconnectSupervisor supervisor(transport, Fast());
+        Events events;
+        supervisor.OnEvent(events.Callback());
+
+        const int a = supervisor.Track(Device(kAddressA, 1));
+        const int b = supervisor.Track(Device(kAddressB, 2));
+        const auto start = Clock::now();
+        supervisor.OnDisconnected(a);
+        supervisor.OnDisconnected(b);
+        CHECK(events.WaitFor(a, LinkState::Connected));
+        CHECK(events.WaitFor(b, LinkState::Connected));
+        CHECK(Clock::now() - start < 190ms);
+        CHECK(supervisor.Reconnects() == 2);
+    }
+
+    void StopCancelsPendingRetries()
+    {
+        FakeReconnectTransport transport;
+        ReconnectSupervisor supervisor(transport, Fast(500ms, 8000ms));
+        Events events;
+        supervisor.OnEvent(events.Callback());
+
+        const int link = supervisor.Track(Device(kAddressA));
+        supervisor.OnDisconnected(link);
+        CHECK(events.WaitFor(link, LinkState::Waiting, 2));
+
+        // The next retry is half a second out; Stop does not wait for it.
+        const auto start = Clock::now();
+        supervisor.Stop();
+        CHECK(Clock::now() - start < 100ms);
+        CHECK(supervisor.State(link) == LinkState::Stopped);
+
+        transport.SetReachable(kAddressA, true);
+        supervisor.OnDisconnected(link);
+        std::this_thread::sleep_for(30ms);
+        CHECK(transport.Calls(kAddressA) == 1);
+        CHECK(supervisor.Reconnects() == 0);
+    }
+
+    void StopDiscardsAnAttemptInFlight()
+    {
+        FakeReconnectTransport transport;
+        transport.SetReachable(kAddressA, true);
+        transport.SetLatency(50ms);
+        ReconnectSupervisor supervisor(transport, Fast());
+        Events events;
+        supervisor.OnEvent(events.Callback());
+
+        const int link = supervisor.Track(Device(kAddressA));
+        supervisor.OnDisconnected(link);
+        CHECK(events.WaitFor(link, LinkState::Reconnecting));
+        supervisor.Stop();
+        CHECK(supervisor.State(link) == LinkState::Stopped);
+        CHECK(events.Of(link, LinkState::Connected).empty());
+        CHECK(supervisor.Reconnects() == 0);
+    }
+
+    void UntrackForgetsTheLink()
+    {
+        FakeReconnectTransport transport;
+        ReconnectSupervisor supervisor(transport, Fast());
+        Events events;
+        supervisor.OnEvent(events.Callback());
+
+        const int link = supervisor.Track(Device(kAddressA));
+        supervisor.Untrack(link);
+        supervisor.OnDisconnected(link);
+        std::this_thread::sleep_for(30ms);
+        CHECK(events.All().empty());
+        CHECK(transport.Calls(kAddressA) == 0);
+        CHECK(supervisor.State(link) == LinkState::Stopped);
+    }
+}
+
+int main()
+{
+    RUN_TEST(ReconnectsADroppedLink);
+    RUN_TEST(BacksOffWhileUnreachable);
+    RUN_TEST(RetriesADropDuringReconnect);
+    RUN_TEST(ReconnectsLinksInParallel);
+    RUN_TEST(StopCancelsPendingRetries);
+    RUN_TEST(StopDiscardsAnAttemptInFlight);
+    RUN_TEST(UntrackForgetsTheLink);
+    return test::Result();
+}
@@ -0,0 +1,131 @@
+#include "ReportPipeline.h"
+#include "TestCheck.h"
+
+#include <cstdint>
+
+namespace
+{
+    constexpr uint64_t kMs = 1000000;   // ns
+
+    DS4_REPORT_EX Idle()
+    {
+        DS4_REPORT_EX r{};
+        DS4_REPORT_INIT(reinterpret_cast<PDS4_REPORT>(&r.Report));
+        r.Report.wAccelY = 4096;   // lying flat
+        return r;
+    }
+
+    void IdenticalReportsAreSuppressed()
+    {
+        ReportChangeFilter filter;
+        const ChangeFilterConfig config;
+        const DS4_REPORT_EX idle = Idle();
+        CHECK(filter.Admit(idle, 0, config, MotionFilter::Ignore));   // the first always goes
+        for (uint64_t i = 1; i <= 10; ++i)
+            CHECK(!filter.Admit(idle, i * kMs, config, MotionFilter::Ignore));
+
+        DS4_REPORT_EX pressed = idle;
+        pressed.Report.wButtons |= DS4_BUTTON_CROSS;
+        CHECK(filter.Admit(pressed, 11 * kMs, config, MotionFilter::Ignore));
+        CHECK(!filter.Admit(pressed, 12 * kMs, config, MotionFilter::Ignore));
+        DS4_REPORT_EX moved = pressed;
+        moved.Report.bThumbLX = 0x81;
+        CHECK(filter.Admit(moved, 13 * kMs, config, MotionFilter::Ignore));
+
+        CHECK(filter.Sent() == 3);
+        CHECK(filter.Suppressed() == 11);
+    }
+
+    void KeepaliveResendsAnUnchangedReport()
+    {
+        ReportChangeFilter filter;
+        ChangeFilterConfig config;
+        config.keepaliveMs = 50;
+        const DS4_REPORT_EX idle = Idle();
+        CHECK(filter.Admit(idle, 0, config, MotionFilter::Ignore));
+        CHECK(!filter.Admit(idle, 49 * kMs, config, MotionFilter::Ignore));
+        CHECK(filter.Admit(idle, 50 * kMs, config, MotionFilter::Ignore));
+        // The keepalive restarts from the report it let through.
+        CHECK(!filter.Admit(idle, 99 * kMs, config, MotionFilter::Ignore));
+        CHECK(filter.Admit(idle, 100 * kMs, config, MotionFilter::Ignore));
+        CHECK(filter.Sent() == 3 && filter.Suppressed() == 2);
+
+        // Reset and a disabled filter let everything through.
+        filter.Reset();
+        CHECK(filter.Admit(idle, 101 * kMs, config, MotionFilter::Ignore));
+        config.enabled = false;
+        CHECK(filter.Admit(idle, 102 * kMs, config, MotionFilter::Ignore));
+    }
+
+    void TimestampAndMotionAreNotInputs()
+    {
+        ReportChangeFilter filter;
+        const ChangeFilterConfig config;
+        DS4_REPORT_EX r = Idle();
+        CHECK(filter.Admit(r, 0, config, MotionFilter::Ignore));
+        r.Report.wTimestamp = 1234;
+        r.Report.wGyroX = 900;
+        r.Report.wGyroZ = -900;
+        r.Report.wAccelX = 3000;
+        CHECK(!filter.Admit(r, 1 * kMs, config, MotionFilter::Ignore));
+        CHECK(filter.Suppressed() == 1);
+    }
+
+    void MotionChangesBeyondNoiseAreInputs()
+    {
+        ReportChangeFilter filter;
+        const ChangeFilterConfig config;
+        DS4_REPORT_EX r = Idle();
+        CHECK(filter.Admit(r, 0, config, MotionFilter::Changes));
+
+        // A resting controller's noise and a new timestamp are not input.
+        const int16_t noise[] = { 3, -5, 16, -16, 7, 0, -2, 11 };
+        uint64_t t = 1;
+        for (int16_t n : noise) {
+            r.Report.wTimestamp = static_cast<uint16_t>(t * 188);
+            r.Report.wGyroX = n;
+            r.Report.wGyroY = static_cast<int16_t>(-n);
+            r.Report.wAccelY = static_cast<int16_t>(4096 + n);
+            CHECK(!filter.Admit(r, t++ * kMs, config, MotionFilter::Changes));
+        }
+
+        // Turning the controller is.
+        r.Report.wGyroZ = 40;
+        CHECK(filter.Admit(r, t++ * kMs, config, MotionFilter::Changes));
+        CHECK(!filter.Admit(r, t++ * kMs, config, MotionFilter::Changes));
+
+        // So is a slow drift once it adds up past the noise since the last send.
+        for (int16_t z = 41; z <= 56; ++z) {
+            r.Report.wGyroZ = z;
+            CHECK(!filter.Admit(r, t++ * kMs, config, MotionFilter::Changes));
+        }
+        r.Report.wGyroZ = 57;
+        CHECK(filter.Admit(r, t++ * kMs, config, MotionFilter::Changes));
+        CHECK(filter.Sent() == 3);
+    }
+
+    void StreamedMotionBypassesTheFilter()
+    {
+        ReportChangeFilter filter;
+        const ChangeFilterConfig config;
+        const DS4_REPORT_EX idle = Idle();
+        for (uint64_t i = 0; i < 20; ++i)
+            CHECK(filter.Admit(idle, i * kMs, config, MotionFilter::Stream));
+        CHECK(filter.Sent() == 20);
+        CHECK(filter.Suppressed() == 0);
+
+        // The same filter goes back to suppressing when its sink stops streaming.
+        CHECK(!filter.Admit(idle, 20 * kMs, config, MotionFilter::Ignore));
+        CHECK(filter.Suppressed() == 1);
+    }
+}
+
+int main()
+{
+    RUN_TEST(IdenticalReportsAreSuppressed);
+    RUN_TEST(KeepaliveResendsAnUnchangedReport);
+    RUN_TEST(TimestampAndMotionAreNotInputs);
+    RUN_TEST(MotionChangesBeyondNoiseAreInputs);
+    RUN_TEST(StreamedMotionBypassesTheFilter);
+    return test::Result();
+}